@@ -19,6 +19,8 @@
 // <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
 
 #include "analyze.h"
+#include "internal/reference_seed.h"
+#include "internal/type_name_index.h"
 
 namespace dexkit {
 
@@ -279,6 +281,9 @@ AnalyzeRet Analyze(const schema::ClassMatcher *matcher, int dex_depth) {
             && string_matcher->match_type() == schema::StringMatchType::Equal) {
             ret.declare_class.emplace_back(string_matcher->value()->string_view());
         }
+        if (internal::GetTypeNameSearchKey(string_matcher)) {
+            ret.need_flags |= kTypeNameIndex;
+        }
     }
     if (matcher->super_class()) {
         // 父类可能定义在其它 dex 中
@@ -366,6 +371,31 @@ AnalyzeRet Analyze(const schema::FieldMatcher *matcher, int dex_depth) {
     return ret;
 }
 
+uint32_t AnalyzeMethodSeedFlags(const schema::MethodMatcher *matcher) {
+    if (!matcher) return 0;
+    uint32_t flags = 0;
+    if (internal::GetExactName(matcher->method_name()) || !internal::GetProtoShortySeeds(matcher).empty()) {
+        flags |= kMemberNameIndex;
+    }
+    if (matcher->using_numbers() && matcher->using_numbers()->size() > 0) {
+        flags |= kUsingNumberIndex;
+    }
+    if (!matcher->op_codes() || !matcher->op_codes()->op_codes()) return flags;
+    auto op_codes = matcher->op_codes()->op_codes();
+    // a 3-gram without wildcard is needed to look up the index
+    for (uint32_t i = 0; i + 3 <= op_codes->size(); ++i) {
+        if (op_codes->Get(i) >= 0 && op_codes->Get(i + 1) >= 0 && op_codes->Get(i + 2) >= 0) {
+            return flags | kOpCodeNgram;
+        }
+    }
+    return flags;
+}
+
+uint32_t AnalyzeFieldSeedFlags(const schema::FieldMatcher *matcher) {
+    if (!matcher) return 0;
+    return internal::GetExactName(matcher->field_name()) ? kMemberNameIndex : 0;
+}
+
 AnalyzeRet Analyze(const schema::MethodMatcher *matcher, int dex_depth) {
     if (!matcher) return {};
     AnalyzeRet ret{};
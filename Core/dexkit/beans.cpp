@@ -158,36 +158,4 @@ AnnotationBean::CreateAnnotationMeta(flatbuffers::FlatBufferBuilder &fbb) const
     return annotation_meta;
 }
 
-flatbuffers::Offset<schema::BatchClassMeta>
-BatchFindClassItemBean::CreateBatchClassMeta(flatbuffers::FlatBufferBuilder &fbb) const {
-    std::vector<flatbuffers::Offset<schema::ClassMeta>> class_metas;
-    class_metas.reserve(this->classes.size());
-    for (auto &clazz : this->classes) {
-        class_metas.push_back(clazz.CreateClassMeta(fbb));
-    }
-    auto batch_find_class_item = schema::CreateBatchClassMeta(
-            fbb,
-            fbb.CreateString(this->union_key),
-            fbb.CreateVector(class_metas)
-    );
-    fbb.Finish(batch_find_class_item);
-    return batch_find_class_item;
-}
-
-flatbuffers::Offset<schema::BatchMethodMeta>
-BatchFindMethodItemBean::CreateBatchMethodMeta(flatbuffers::FlatBufferBuilder &fbb) const {
-    std::vector<flatbuffers::Offset<schema::MethodMeta>> method_metas;
-    method_metas.reserve(this->methods.size());
-    for (auto &method : this->methods) {
-        method_metas.push_back(method.CreateMethodMeta(fbb));
-    }
-    auto batch_find_method_item = schema::CreateBatchMethodMeta(
-            fbb,
-            fbb.CreateString(this->union_key),
-            fbb.CreateVector(method_metas)
-    );
-    fbb.Finish(batch_find_method_item);
-    return batch_find_method_item;
-}
-
 }
\ No newline at end of file
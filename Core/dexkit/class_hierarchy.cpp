@@ -0,0 +1,267 @@
+// DexKit - An high-performance runtime parsing library for dex
+// implemented in C++.
+// Copyright (C) 2022-2023 LuckyPray
+// https://github.com/LuckyPray/DexKit
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+// <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+
+
+#include "internal/class_hierarchy.h"
+
+#include <algorithm>
+#include <tuple>
+
+#include "internal/reference_seed.h"
+
+namespace dexkit {
+
+namespace internal {
+
+namespace {
+
+template<typename Edge, typename KeyFn>
+void BuildOffsets(const std::vector<Edge> &edges, size_t node_count, KeyFn &&key_fn, std::vector<uint32_t> &offsets) {
+    offsets.assign(node_count + 1, 0);
+    for (auto &edge: edges) {
+        ++offsets[key_fn(edge) + 1];
+    }
+    for (size_t i = 0; i < node_count; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+}
+
+} // namespace
+
+uint32_t ClassHierarchy::FindNode(std::string_view descriptor) const {
+    auto it = node_index_.find(descriptor);
+    return it == node_index_.end() ? kNoNode : it->second;
+}
+
+void ClassHierarchy::CollectSubclasses(uint32_t node, bool direct_only, std::vector<uint32_t> &nodes) const {
+    if (direct_only) {
+        for (auto i = child_offsets_[node]; i < child_offsets_[node + 1]; ++i) {
+            if (!is_interface_[children_[i]]) nodes.emplace_back(children_[i]);
+        }
+        return;
+    }
+    for (auto pos = preorder_begin_[node] + 1; pos < preorder_end_[node]; ++pos) {
+        if (!is_interface_[preorder_[pos]]) nodes.emplace_back(preorder_[pos]);
+    }
+}
+
+void ClassHierarchy::CollectImplementors(uint32_t node, bool direct_only, std::vector<uint32_t> &nodes) const {
+    std::vector<bool> seen_interfaces(NodeCount());
+    std::vector<uint32_t> pending{node};
+    seen_interfaces[node] = true;
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    while (!pending.empty()) {
+        auto interface_node = pending.back();
+        pending.pop_back();
+        for (auto i = implementor_offsets_[interface_node]; i < implementor_offsets_[interface_node + 1]; ++i) {
+            auto implementor = implementors_[i];
+            if (is_interface_[implementor]) {
+                if (!direct_only && !seen_interfaces[implementor]) {
+                    seen_interfaces[implementor] = true;
+                    pending.emplace_back(implementor);
+                }
+            } else if (direct_only) {
+                nodes.emplace_back(implementor);
+            } else {
+                ranges.emplace_back(preorder_begin_[implementor], preorder_end_[implementor]);
+            }
+        }
+    }
+    // subtrees are either disjoint or nested, a range starting inside the last one is covered
+    std::sort(ranges.begin(), ranges.end());
+    uint32_t covered_end = 0;
+    for (auto [begin, end]: ranges) {
+        if (begin < covered_end) continue;
+        for (auto pos = begin; pos < end; ++pos) {
+            if (!is_interface_[preorder_[pos]]) nodes.emplace_back(preorder_[pos]);
+        }
+        covered_end = end;
+    }
+}
+
+std::span<const uint32_t> ClassHierarchy::GetDirectSubclassDefs(uint32_t node, uint16_t dex_id) const {
+    return subclass_defs_.Get(node, dex_id);
+}
+
+std::span<const uint32_t> ClassHierarchy::GetDirectImplementorDefs(uint32_t node, uint16_t dex_id) const {
+    return implementor_defs_.Get(node, dex_id);
+}
+
+std::span<const uint32_t> ClassHierarchy::DefEdges::Get(uint32_t node, uint16_t dex_id) const {
+    auto first = dex_ids.begin() + offsets[node];
+    auto last = dex_ids.begin() + offsets[node + 1];
+    auto [lo, hi] = std::equal_range(first, last, dex_id);
+    return {def_idxs.data() + (lo - dex_ids.begin()), (size_t) (hi - lo)};
+}
+
+uint32_t ClassHierarchyBuilder::GetOrAddNode(std::string_view descriptor) {
+    auto [it, inserted] = hierarchy_->node_index_.try_emplace(descriptor, (uint32_t) hierarchy_->descriptors_.size());
+    if (inserted) {
+        hierarchy_->descriptors_.emplace_back(descriptor);
+        hierarchy_->declared_dex_.emplace_back(ClassHierarchy::kNoDex);
+        hierarchy_->declared_type_idx_.emplace_back(0);
+        hierarchy_->is_interface_.emplace_back(false);
+        parents_.emplace_back(ClassHierarchy::kNoNode);
+    }
+    return it->second;
+}
+
+void ClassHierarchyBuilder::AddClassDef(
+        uint16_t dex_id,
+        uint32_t class_def_idx,
+        uint32_t type_idx,
+        std::string_view descriptor,
+        std::string_view super_descriptor,
+        bool is_interface
+) {
+    auto node = GetOrAddNode(descriptor);
+    last_node_ = node;
+    last_dex_id_ = dex_id;
+    last_class_def_idx_ = class_def_idx;
+    last_declares_ = hierarchy_->declared_dex_[node] == ClassHierarchy::kNoDex;
+    if (last_declares_) {
+        hierarchy_->declared_dex_[node] = dex_id;
+        hierarchy_->declared_type_idx_[node] = type_idx;
+        hierarchy_->is_interface_[node] = is_interface;
+    }
+    if (super_descriptor.empty()) {
+        return;
+    }
+    auto super_node = GetOrAddNode(super_descriptor);
+    subclass_def_edges_.push_back({super_node, dex_id, class_def_idx});
+    if (last_declares_) {
+        parents_[node] = super_node;
+    }
+}
+
+void ClassHierarchyBuilder::AddInterface(std::string_view interface_descriptor) {
+    auto interface_node = GetOrAddNode(interface_descriptor);
+    implementor_def_edges_.push_back({interface_node, last_dex_id_, last_class_def_idx_});
+    if (last_declares_) {
+        implementor_edges_.emplace_back(interface_node, last_node_);
+    }
+}
+
+void ClassHierarchyBuilder::BuildDefEdges(std::vector<DefEdge> &edges, size_t node_count, ClassHierarchy::DefEdges &out) {
+    std::sort(edges.begin(), edges.end(), [](const DefEdge &a, const DefEdge &b) {
+        return std::tie(a.node, a.dex_id, a.class_def_idx) < std::tie(b.node, b.dex_id, b.class_def_idx);
+    });
+    // a malformed class def may list one interface twice
+    edges.erase(std::unique(edges.begin(), edges.end(), [](const DefEdge &a, const DefEdge &b) {
+        return a.node == b.node && a.dex_id == b.dex_id && a.class_def_idx == b.class_def_idx;
+    }), edges.end());
+    BuildOffsets(edges, node_count, [](const DefEdge &edge) { return edge.node; }, out.offsets);
+    out.dex_ids.reserve(edges.size());
+    out.def_idxs.reserve(edges.size());
+    for (auto &edge: edges) {
+        out.dex_ids.emplace_back(edge.dex_id);
+        out.def_idxs.emplace_back(edge.class_def_idx);
+    }
+    edges.clear();
+    edges.shrink_to_fit();
+}
+
+std::shared_ptr<const ClassHierarchy> ClassHierarchyBuilder::Build() {
+    auto &hierarchy = *hierarchy_;
+    auto node_count = hierarchy.descriptors_.size();
+
+    std::vector<std::pair<uint32_t /*parent*/, uint32_t /*node*/>> child_edges;
+    child_edges.reserve(node_count);
+    for (uint32_t node = 0; node < node_count; ++node) {
+        if (parents_[node] != ClassHierarchy::kNoNode) child_edges.emplace_back(parents_[node], node);
+    }
+    std::sort(child_edges.begin(), child_edges.end());
+    BuildOffsets(child_edges, node_count, [](const auto &edge) { return edge.first; }, hierarchy.child_offsets_);
+    hierarchy.children_.reserve(child_edges.size());
+    for (auto &edge: child_edges) {
+        hierarchy.children_.emplace_back(edge.second);
+    }
+
+    std::sort(implementor_edges_.begin(), implementor_edges_.end());
+    implementor_edges_.erase(std::unique(implementor_edges_.begin(), implementor_edges_.end()), implementor_edges_.end());
+    BuildOffsets(implementor_edges_, node_count, [](const auto &edge) { return edge.first; }, hierarchy.implementor_offsets_);
+    hierarchy.implementors_.reserve(implementor_edges_.size());
+    for (auto &edge: implementor_edges_) {
+        hierarchy.implementors_.emplace_back(edge.second);
+    }
+
+    // iterative dfs from every root; nodes left unvisited sit on a super class cycle of a
+    // malformed dex, the first one met is treated as a root to cut the cycle
+    hierarchy.preorder_begin_.assign(node_count, 0);
+    hierarchy.preorder_end_.assign(node_count, 0);
+    hierarchy.preorder_.reserve(node_count);
+    std::vector<bool> visited(node_count);
+    std::vector<std::pair<uint32_t /*node*/, uint32_t /*next child*/>> stack;
+    auto visit_tree = [&](uint32_t root) {
+        visited[root] = true;
+        hierarchy.preorder_begin_[root] = hierarchy.preorder_.size();
+        hierarchy.preorder_.emplace_back(root);
+        stack.emplace_back(root, hierarchy.child_offsets_[root]);
+        while (!stack.empty()) {
+            auto &[node, next] = stack.back();
+            if (next == hierarchy.child_offsets_[node + 1]) {
+                hierarchy.preorder_end_[node] = hierarchy.preorder_.size();
+                stack.pop_back();
+                continue;
+            }
+            auto child = hierarchy.children_[next++];
+            if (visited[child]) continue;
+            visited[child] = true;
+            hierarchy.preorder_begin_[child] = hierarchy.preorder_.size();
+            hierarchy.preorder_.emplace_back(child);
+            stack.emplace_back(child, hierarchy.child_offsets_[child]);
+        }
+    };
+    for (uint32_t node = 0; node < node_count; ++node) {
+        if (parents_[node] == ClassHierarchy::kNoNode) visit_tree(node);
+    }
+    for (uint32_t node = 0; node < node_count; ++node) {
+        if (!visited[node]) visit_tree(node);
+    }
+
+    BuildDefEdges(subclass_def_edges_, node_count, hierarchy.subclass_defs_);
+    BuildDefEdges(implementor_def_edges_, node_count, hierarchy.implementor_defs_);
+    parents_.clear();
+    implementor_edges_.clear();
+    return std::shared_ptr<const ClassHierarchy>(std::move(hierarchy_));
+}
+
+std::vector<ClassHierarchySeed> GetClassHierarchySeeds(const schema::ClassMatcher *matcher) {
+    std::vector<ClassHierarchySeed> seeds;
+    if (!matcher) return seeds;
+    if (matcher->super_class()) {
+        if (auto descriptor = GetExactTypeDescriptor(matcher->super_class()->class_name())) {
+            seeds.push_back({false, std::move(*descriptor)});
+        }
+    }
+    // every interface matcher needs a distinct matching interface
+    if (matcher->interfaces() && matcher->interfaces()->interfaces()) {
+        for (auto interface_matcher: *matcher->interfaces()->interfaces()) {
+            if (auto descriptor = GetExactTypeDescriptor(interface_matcher->class_name())) {
+                seeds.push_back({true, std::move(*descriptor)});
+            }
+        }
+    }
+    return seeds;
+}
+
+} // namespace internal
+
+} // namespace dexkit
@@ -0,0 +1,96 @@
+// DexKit - An high-performance runtime parsing library for dex
+// implemented in C++.
+// Copyright (C) 2022-2023 LuckyPray
+// https://github.com/LuckyPray/DexKit
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+// <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+
+
+#include "internal/compiled_matcher_cache.h"
+
+#include <mutex>
+
+namespace dexkit {
+
+namespace internal {
+
+CompiledMatcherCache &CompiledMatcherCache::Global() {
+    // intentionally leaked, artifacts may still be referenced while worker threads shut down
+    static auto *cache = new CompiledMatcherCache();
+    return *cache;
+}
+
+void CompiledMatcherCache::SetCapacity(size_t capacity_bytes) {
+    auto shard_capacity = capacity_bytes / kShardCount;
+    shard_capacity_bytes_.store(shard_capacity, std::memory_order_release);
+    for (auto &shard: shards_) {
+        std::unique_lock lock(shard.mutex);
+        EvictLocked(shard, shard_capacity);
+    }
+}
+
+void CompiledMatcherCache::Clear() {
+    for (auto &shard: shards_) {
+        std::unique_lock lock(shard.mutex);
+        shard.entries.clear();
+        shard.order.clear();
+        shard.bytes = 0;
+    }
+}
+
+std::string CompiledMatcherCache::MakeKey(CompiledMatcherKind kind, std::string_view key) {
+    std::string full_key;
+    full_key.reserve(key.size() + 1);
+    full_key.push_back(static_cast<char>(kind));
+    full_key.append(key);
+    return full_key;
+}
+
+std::shared_ptr<const void> CompiledMatcherCache::Insert(
+        Shard &shard,
+        std::string key,
+        std::shared_ptr<const void> value,
+        size_t bytes
+) {
+    auto capacity_bytes = shard_capacity_bytes_.load(std::memory_order_acquire);
+    std::unique_lock lock(shard.mutex);
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+        return it->second.value;
+    }
+    // too large to keep, the caller still owns its copy for the current query
+    if (bytes > capacity_bytes) {
+        return value;
+    }
+    shard.entries.emplace(key, Entry{value, bytes});
+    shard.order.emplace_back(std::move(key));
+    shard.bytes += bytes;
+    EvictLocked(shard, capacity_bytes);
+    return value;
+}
+
+void CompiledMatcherCache::EvictLocked(Shard &shard, size_t capacity_bytes) {
+    while (shard.bytes > capacity_bytes && !shard.order.empty()) {
+        auto it = shard.entries.find(shard.order.front());
+        shard.bytes -= it->second.bytes;
+        shard.entries.erase(it);
+        shard.order.pop_front();
+    }
+}
+
+} // namespace internal
+
+} // namespace dexkit
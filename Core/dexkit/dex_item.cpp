@@ -19,6 +19,8 @@
 // <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
 
 #include "dex_item.h"
+#include "internal/class_hierarchy.h"
+#include "internal/package_filter.h"
 
 #include "utils/byte_code_util.h"
 #include "utils/opcode_util.h"
@@ -95,7 +97,6 @@ void DexItem::InitBaseCache() {
     }
 
     class_field_ids.resize(reader.TypeIds().size());
-    pending_cross_ref_field_ids.resize(reader.TypeIds().size());
     int field_idx = 0;
     for (auto &field: reader.FieldIds()) {
         if (field.class_idx == element_type_idx) {
@@ -141,7 +142,6 @@ void DexItem::InitBaseCache() {
     class_access_flags.resize(reader.TypeIds().size());
     class_interface_ids.resize(reader.TypeIds().size());
     class_method_ids.resize(reader.TypeIds().size());
-    pending_cross_ref_method_ids.resize(reader.TypeIds().size());
     const auto method_count = reader.MethodIds().size();
     const auto field_count = reader.FieldIds().size();
     method_descriptors.resize(method_count);
@@ -233,18 +233,18 @@ void DexItem::InitBaseCache() {
         }
         std::sort(methods.begin(), methods.end());
     }
+    pending_cross_ref_method_types.resize(type_def_flag.size());
+    pending_cross_ref_field_types.resize(type_def_flag.size());
     for (uint32_t type_idx = 0; type_idx < type_def_flag.size(); ++type_idx) {
         if (!type_def_flag[type_idx]) {
-            std::swap(pending_cross_ref_field_ids[type_idx], class_field_ids[type_idx]);
+            pending_cross_ref_field_types[type_idx] = !class_field_ids[type_idx].empty();
+            std::vector<uint32_t>().swap(class_field_ids[type_idx]);
         }
     }
-
-    auto method_idx = 0;
     for (auto &method_def: reader.MethodIds()) {
         if (!type_def_flag[method_def.class_idx]) {
-            pending_cross_ref_method_ids[method_def.class_idx].emplace_back(method_idx);
+            pending_cross_ref_method_types[method_def.class_idx] = true;
         }
-        ++method_idx;
     }
     {
         static std::mutex put_declare_class_mutex;
@@ -309,6 +309,11 @@ void DexItem::InitCache(uint32_t init_flags) {
     bool need_annotation = need_class_annotation || need_field_annotation || need_method_annotation || need_param_annotation;
     // only used for full cache
     bool need_method_using_number = (init_flags & kUsingNumber) != 0;
+    bool need_op_ngram = (init_flags & kOpCodeNgram) != 0;
+    bool need_member_name_index = (init_flags & kMemberNameIndex) != 0;
+    bool need_using_number_index = (init_flags & kUsingNumberIndex) != 0;
+    bool need_string_index = (init_flags & kStringIndex) != 0;
+    bool need_type_name_index = (init_flags & kTypeNameIndex) != 0;
 
     if (need_op_seq) {
         method_opcode_seq.resize(reader.MethodIds().size(), std::nullopt);
@@ -423,6 +428,26 @@ void DexItem::InitCache(uint32_t init_flags) {
         }
     }
 
+    if (need_op_ngram) {
+        BuildOpCodeNgramIndex();
+    }
+
+    if (need_member_name_index) {
+        BuildMemberNameIndex();
+    }
+
+    if (need_using_number_index) {
+        BuildUsingNumberIndex();
+    }
+
+    if (need_string_index) {
+        BuildStringIndex();
+    }
+
+    if (need_type_name_index) {
+        type_name_trigram_index = internal::TypeNameTrigramIndex(type_names, type_name_array_count);
+    }
+
     if (need_method_caller) {
         for (auto &class_def: reader.ClassDefs()) {
             for (auto method_id: class_method_ids[class_def.class_idx]) {
@@ -505,6 +530,132 @@ void DexItem::InitCache(uint32_t init_flags) {
     }
 }
 
+void DexItem::BuildOpCodeNgramIndex() {
+    // walks the code on its own, kOpSequence may be initialized concurrently
+    std::vector<uint64_t> entries;
+    std::vector<uint32_t> grams;
+    for (auto &class_def: reader.ClassDefs()) {
+        for (auto method_id: class_method_ids[class_def.class_idx]) {
+            auto code = method_codes[method_id];
+            if (code == nullptr) {
+                continue;
+            }
+            grams.clear();
+            uint32_t window = 0;
+            uint32_t op_count = 0;
+            auto p = code->insns;
+            auto end_p = p + code->insns_size;
+            while (p < end_p) {
+                window = ((window << 8) | (uint8_t) *p) & 0xffffff;
+                if (++op_count >= 3) {
+                    grams.emplace_back(window);
+                }
+                p += GetBytecodeWidth(p);
+            }
+            std::sort(grams.begin(), grams.end());
+            grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+            for (auto gram: grams) {
+                entries.emplace_back((uint64_t) gram << 32 | method_id);
+            }
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+    opcode_ngram_keys.clear();
+    opcode_ngram_offsets.clear();
+    opcode_ngram_postings.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        auto gram = (uint32_t) (entries[i] >> 32);
+        if (opcode_ngram_keys.empty() || opcode_ngram_keys.back() != gram) {
+            opcode_ngram_keys.emplace_back(gram);
+            opcode_ngram_offsets.emplace_back(i);
+        }
+        opcode_ngram_postings[i] = (uint32_t) entries[i];
+    }
+    opcode_ngram_offsets.emplace_back(entries.size());
+}
+
+void DexItem::BuildMemberNameIndex() {
+    auto method_ids = reader.MethodIds();
+    auto field_ids = reader.FieldIds();
+    auto proto_ids = reader.ProtoIds();
+    method_name_postings = internal::BuildNamePostings(method_ids.size(), [&](uint32_t method_idx) {
+        return strings[method_ids[method_idx].name_idx];
+    });
+    field_name_postings = internal::BuildNamePostings(field_ids.size(), [&](uint32_t field_idx) {
+        return strings[field_ids[field_idx].name_idx];
+    });
+    method_shorty_postings = internal::BuildNamePostings(method_ids.size(), [&](uint32_t method_idx) {
+        return strings[proto_ids[method_ids[method_idx].proto_idx].shorty_idx];
+    });
+}
+
+void DexItem::BuildUsingNumberIndex() {
+    // decodes the code on its own, the lazy per-method cache stays untouched
+    internal::NumberPostingsBuilder builder;
+    for (uint32_t method_idx = 0; method_idx < method_codes.size(); ++method_idx) {
+        if (method_codes[method_idx] == nullptr) continue;
+        builder.Add(method_idx, ParseUsingNumbersFromCode(method_idx));
+    }
+    method_number_postings = builder.Build();
+}
+
+void DexItem::BuildStringIndex() {
+    string_suffix_array = internal::StringSuffixArray(strings);
+    // walks the code on its own, kUsingString may be initialized concurrently
+    std::vector<uint64_t> entries;
+    for (uint32_t method_idx = 0; method_idx < method_codes.size(); ++method_idx) {
+        if (method_codes[method_idx] == nullptr) continue;
+        for (auto string_idx: GetUsingStringsFromCode(method_idx)) {
+            entries.emplace_back((uint64_t) string_idx << 32 | method_idx);
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+    string_method_offsets.assign(strings.size() + 1, 0);
+    string_method_ids.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        ++string_method_offsets[(entries[i] >> 32) + 1];
+        string_method_ids[i] = (uint32_t) entries[i];
+    }
+    for (size_t i = 0; i + 1 < string_method_offsets.size(); ++i) {
+        string_method_offsets[i + 1] += string_method_offsets[i];
+    }
+}
+
+std::shared_ptr<const internal::TypeNameCandidates> DexItem::GetTypeNameCandidates(const std::string &key) {
+    if ((dex_flag.load(std::memory_order_acquire) & kTypeNameIndex) == 0) {
+        return nullptr;
+    }
+    {
+        std::lock_guard lock(type_name_candidates_mutex);
+        auto it = type_name_candidates.find(key);
+        if (it != type_name_candidates.end()) {
+            return it->second;
+        }
+    }
+    auto candidates = std::make_shared<internal::TypeNameCandidates>();
+    candidates->type_ids = type_name_trigram_index.Find(key);
+    candidates->mask.resize(type_names.size());
+    for (auto type_idx: candidates->type_ids) {
+        candidates->mask[type_idx] = true;
+    }
+    std::lock_guard lock(type_name_candidates_mutex);
+    // keys come from user queries, keep the cache bounded
+    if (type_name_candidates.size() >= 1024) {
+        type_name_candidates.clear();
+    }
+    return type_name_candidates.try_emplace(key, std::move(candidates)).first->second;
+}
+
+size_t DexItem::GetStringIndexMemoryUsage() const {
+    if ((dex_flag.load(std::memory_order_acquire) & kStringIndex) == 0) {
+        return 0;
+    }
+    return string_suffix_array.MemoryUsage()
+           + string_method_offsets.capacity() * sizeof(uint32_t)
+           + string_method_ids.capacity() * sizeof(uint32_t);
+}
+
 bool DexItem::NeedPutCrossRef(uint32_t need_cross_flag) const {
     DEXKIT_CHECK((need_cross_flag & ~(kCallerMethod | kRwFieldMethod)) == 0);
     return (dex_cross_flag.load(std::memory_order_acquire) & need_cross_flag) != need_cross_flag;
@@ -546,14 +697,37 @@ void DexItem::WaitPutCrossRef(uint32_t put_cross_flag) const {
     });
 }
 
+// method_ids and field_ids are sorted by declaring type first, the members a dex references
+// through one type are a contiguous index range
+template<typename MemberIds>
+static std::pair<uint32_t, uint32_t> DeclaringTypeMemberRange(const MemberIds &member_ids, uint32_t type_idx) {
+    auto first = std::partition_point(member_ids.begin(), member_ids.end(), [type_idx](const auto &member) {
+        return member.class_idx < type_idx;
+    });
+    auto last = std::partition_point(first, member_ids.end(), [type_idx](const auto &member) {
+        return member.class_idx == type_idx;
+    });
+    return {static_cast<uint32_t>(first - member_ids.begin()), static_cast<uint32_t>(last - member_ids.begin())};
+}
+
 void DexItem::PutCrossRef(uint32_t put_cross_flag) {
     DEXKIT_CHECK((put_cross_flag & ~(kCallerMethod | kRwFieldMethod)) == 0);
     bool need_caller_cross = (put_cross_flag & kCallerMethod) != 0;
     bool need_rw_field_cross = (put_cross_flag & kRwFieldMethod) != 0;
 
+    // resolved types are cleared, unresolved ones stay flagged so that a later
+    // AddDex/AddImage/AddZipPath can link them against newly declared classes
     for (int type_idx = 0; type_idx < type_names.size(); ++type_idx) {
-        if (!this->type_def_flag[type_idx] && type_names[type_idx][0] != '[') {
-            auto declared_pair = dexkit->GetClassDeclaredPair(type_names[type_idx]);
+        if (this->type_def_flag[type_idx]) {
+            continue;
+        }
+        bool has_pending_methods = need_caller_cross && this->pending_cross_ref_method_types[type_idx];
+        bool has_pending_fields = need_rw_field_cross && this->pending_cross_ref_field_types[type_idx];
+        if (!has_pending_methods && !has_pending_fields) {
+            continue;
+        }
+        if (type_names[type_idx][0] != '[') {
+            auto declared_pair = dexkit->GetClassDeclaredPair(type_names[type_idx], this);
             auto origin_dex = declared_pair.first;
             auto origin_type_idx = declared_pair.second;
 
@@ -564,13 +738,12 @@ void DexItem::PutCrossRef(uint32_t put_cross_flag) {
             auto &mutex = origin_dex->GetTypeDefMutex(origin_type_idx);
             std::lock_guard lock(mutex);
 
-            if (need_caller_cross) {
-                const auto &method_ids = this->pending_cross_ref_method_ids[type_idx];
+            if (has_pending_methods) {
+                auto [method_begin, method_end] = DeclaringTypeMemberRange(reader.MethodIds(), type_idx);
 
                 auto &origin_method_ids = origin_dex->class_method_ids[origin_type_idx];
-                for (int ori_i = 0, cur_i = 0; ori_i < origin_method_ids.size() && cur_i < method_ids.size(); ++ori_i) {
+                for (uint32_t ori_i = 0, curr_method_idx = method_begin; ori_i < origin_method_ids.size() && curr_method_idx < method_end; ++ori_i) {
                     auto origin_method_idx = origin_method_ids[ori_i];
-                    auto curr_method_idx = method_ids[cur_i];
                     auto origin_method_descriptor = origin_dex->GetMethodDescriptor(origin_method_idx);
                     auto curr_method_descriptor = this->GetMethodDescriptor(curr_method_idx);
                     if (curr_method_descriptor != origin_method_descriptor) {
@@ -584,17 +757,16 @@ void DexItem::PutCrossRef(uint32_t put_cross_flag) {
                                 .target_method_idx = origin_method_idx
                         });
                     }
-                    ++cur_i;
+                    ++curr_method_idx;
                 }
             }
 
-            if (need_rw_field_cross) {
-                const auto &field_ids = this->pending_cross_ref_field_ids[type_idx];
+            if (has_pending_fields) {
+                auto [field_begin, field_end] = DeclaringTypeMemberRange(reader.FieldIds(), type_idx);
 
                 auto &origin_field_ids = origin_dex->class_field_ids[origin_type_idx];
-                for (int ori_i = 0, cur_i = 0; ori_i < origin_field_ids.size() && cur_i < field_ids.size(); ++ori_i) {
+                for (uint32_t ori_i = 0, curr_field_idx = field_begin; ori_i < origin_field_ids.size() && curr_field_idx < field_end; ++ori_i) {
                     auto origin_field_idx = origin_field_ids[ori_i];
-                    auto curr_field_idx = field_ids[cur_i];
                     auto origin_field_descriptor = origin_dex->GetFieldDescriptor(origin_field_idx);
                     auto curr_field_descriptor = this->GetFieldDescriptor(curr_field_idx);
                     if (origin_field_descriptor != curr_field_descriptor) {
@@ -608,19 +780,16 @@ void DexItem::PutCrossRef(uint32_t put_cross_flag) {
                                 .target_field_idx = origin_field_idx
                         });
                     }
-                    ++cur_i;
+                    ++curr_field_idx;
                 }
             }
         }
-    }
-
-    if (need_caller_cross) {
-        pending_cross_ref_method_ids.clear();
-        pending_cross_ref_method_ids.shrink_to_fit();
-    }
-    if (need_rw_field_cross) {
-        pending_cross_ref_field_ids.clear();
-        pending_cross_ref_field_ids.shrink_to_fit();
+        if (has_pending_methods) {
+            this->pending_cross_ref_method_types[type_idx] = false;
+        }
+        if (has_pending_fields) {
+            this->pending_cross_ref_field_types[type_idx] = false;
+        }
     }
 }
 
@@ -631,7 +800,7 @@ std::mutex &DexItem::GetTypeDefMutex(uint32_t type_idx) {
 // NOLINTNEXTLINE
 ClassBean DexItem::GetClassBean(uint32_t type_idx) {
     if (!this->type_def_flag[type_idx]) {
-        auto pair = dexkit->GetClassDeclaredPair(this->type_names[type_idx]);
+        auto pair = dexkit->GetClassDeclaredPair(this->type_names[type_idx], this);
         if (pair.first) {
             return pair.first->GetClassBean(pair.second);
         }
@@ -699,6 +868,106 @@ FieldBean DexItem::GetFieldBean(uint32_t field_idx) {
     return bean;
 }
 
+std::shared_ptr<const internal::PackageTypeMask>
+DexItem::GetPackageTypeMask(const internal::PackageFilter &filter) {
+    static constexpr size_t kMaxCachedPackageTypeMasks = 16;
+    if (filter.empty()) {
+        return nullptr;
+    }
+    std::lock_guard lock(package_type_mask_mutex);
+    auto it = std::find_if(package_type_masks.begin(), package_type_masks.end(), [&filter](auto &entry) {
+        return entry.first == filter.cache_key;
+    });
+    if (it != package_type_masks.end()) {
+        std::rotate(it, it + 1, package_type_masks.end());
+        return package_type_masks.back().second;
+    }
+    if (!type_names_sorted.has_value()) {
+        type_names_sorted = std::is_sorted(this->type_names.begin(), this->type_names.end());
+    }
+    auto mask = std::make_shared<const internal::PackageTypeMask>(
+            internal::BuildPackageTypeMask(filter, this->type_names, *type_names_sorted)
+    );
+    if (package_type_masks.size() >= kMaxCachedPackageTypeMasks) {
+        package_type_masks.erase(package_type_masks.begin());
+    }
+    package_type_masks.emplace_back(filter.cache_key, mask);
+    return mask;
+}
+
+// NOLINTNEXTLINE
+flatbuffers::Offset<schema::ClassMeta>
+DexItem::CreateClassMeta(flatbuffers::FlatBufferBuilder &fbb, uint32_t type_idx) {
+    if (!this->type_def_flag[type_idx]) {
+        auto pair = dexkit->GetClassDeclaredPair(this->type_names[type_idx], this);
+        if (pair.first) {
+            return pair.first->CreateClassMeta(fbb, pair.second);
+        }
+        auto empty_ids = fbb.CreateVector(std::vector<int32_t>());
+        auto source_file = fbb.CreateString(std::string_view());
+        auto descriptor = fbb.CreateString(this->type_names[type_idx]);
+        return schema::CreateClassMeta(
+                fbb, type_idx, this->dex_id, source_file, 0, descriptor, -1, empty_ids, empty_ids, empty_ids
+        );
+    }
+    auto &class_def = this->reader.ClassDefs()[this->type_def_idx[type_idx]];
+    // the schema stores ids as int32, the bit patterns are written unchanged
+    auto &interface_ids = this->class_interface_ids[type_idx];
+    auto &method_ids = this->class_method_ids[type_idx];
+    auto &field_ids = this->class_field_ids[type_idx];
+    auto interfaces = fbb.CreateVector(reinterpret_cast<const int32_t *>(interface_ids.data()), interface_ids.size());
+    auto methods = fbb.CreateVector(reinterpret_cast<const int32_t *>(method_ids.data()), method_ids.size());
+    auto fields = fbb.CreateVector(reinterpret_cast<const int32_t *>(field_ids.data()), field_ids.size());
+    auto source_file = fbb.CreateString(this->class_source_files[type_idx]);
+    auto descriptor = fbb.CreateString(this->type_names[type_idx]);
+    return schema::CreateClassMeta(
+            fbb, type_idx, this->dex_id, source_file, class_def.access_flags, descriptor,
+            class_def.superclass_idx, interfaces, methods, fields
+    );
+}
+
+// NOLINTNEXTLINE
+flatbuffers::Offset<schema::MethodMeta>
+DexItem::CreateMethodMeta(flatbuffers::FlatBufferBuilder &fbb, uint32_t method_idx) {
+    auto &method_def = this->reader.MethodIds()[method_idx];
+    if (!this->type_def_flag[method_def.class_idx]) {
+        auto cross_info = this->method_cross_info[method_idx];
+        if (cross_info.has_value()) {
+            return this->dexkit->GetDexItem(cross_info->first)->CreateMethodMeta(fbb, cross_info->second);
+        }
+    }
+    auto &proto_def = this->reader.ProtoIds()[method_def.proto_idx];
+    auto type_list = this->proto_type_list[method_def.proto_idx];
+    auto len = type_list ? type_list->size : 0;
+    int32_t *parameter_type_ids = nullptr;
+    auto parameter_types = fbb.CreateUninitializedVector(len, &parameter_type_ids);
+    for (uint32_t i = 0; i < len; ++i) {
+        parameter_type_ids[i] = flatbuffers::EndianScalar<int32_t>(type_list->list[i].type_idx);
+    }
+    auto descriptor = fbb.CreateString(this->GetMethodDescriptor(method_idx));
+    return schema::CreateMethodMeta(
+            fbb, method_idx, this->dex_id, method_def.class_idx, this->method_access_flags[method_idx],
+            descriptor, proto_def.return_type_idx, parameter_types
+    );
+}
+
+// NOLINTNEXTLINE
+flatbuffers::Offset<schema::FieldMeta>
+DexItem::CreateFieldMeta(flatbuffers::FlatBufferBuilder &fbb, uint32_t field_idx) {
+    auto &field_def = this->reader.FieldIds()[field_idx];
+    if (!this->type_def_flag[field_def.class_idx]) {
+        auto cross_info = this->field_cross_info[field_idx];
+        if (cross_info.has_value()) {
+            return this->dexkit->GetDexItem(cross_info->first)->CreateFieldMeta(fbb, cross_info->second);
+        }
+    }
+    auto descriptor = fbb.CreateString(this->GetFieldDescriptor(field_idx));
+    return schema::CreateFieldMeta(
+            fbb, field_idx, this->dex_id, field_def.class_idx, this->field_access_flags[field_idx],
+            descriptor, field_def.type_idx
+    );
+}
+
 std::optional<MethodBean> DexItem::GetMethodBean(uint32_t type_idx, std::string_view method_descriptor) {
     auto &methods = this->class_method_ids[type_idx];
     for (auto method_idx: methods) {
@@ -1339,6 +1608,15 @@ const std::vector<EncodeNumber> &DexItem::GetUsingNumbers(uint32_t method_idx) {
     return *slot.data;
 }
 
+bool DexItem::SharesSourceWith(const DexItem *other) const {
+    for (auto source_id: this->source_ids) {
+        if (std::find(other->source_ids.begin(), other->source_ids.end(), source_id) != other->source_ids.end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool DexItem::CheckAllTypeNamesDeclared(std::vector<std::string_view> &types) {
     for (auto &type: types) { // NOLINT
         if (!this->type_ids_map.contains(NameToDescriptor(type))) {
@@ -1348,4 +1626,20 @@ bool DexItem::CheckAllTypeNamesDeclared(std::vector<std::string_view> &types) {
     return true;
 }
 
+void DexItem::CollectClassHierarchy(internal::ClassHierarchyBuilder &builder) const {
+    uint32_t class_def_idx = 0;
+    for (auto &class_def: reader.ClassDefs()) {
+        auto def_idx = class_def_idx++;
+        std::string_view super_name;
+        if (class_def.superclass_idx != dex::kNoIndex) {
+            super_name = type_names[class_def.superclass_idx];
+        }
+        builder.AddClassDef(dex_id, def_idx, class_def.class_idx, type_names[class_def.class_idx], super_name,
+                            (class_def.access_flags & dex::kAccInterface) != 0);
+        for (auto interface_idx: class_interface_ids[class_def.class_idx]) {
+            builder.AddInterface(type_names[interface_idx]);
+        }
+    }
+}
+
 }
@@ -18,9 +18,92 @@
 // <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
 
 #include "dex_item.h"
+#include "internal/batch_using_strings.h"
+#include "internal/id_set.h"
+#include "internal/package_filter.h"
+#include "internal/result_serializer.h"
+
+#include <bit>
 
 namespace dexkit {
 
+namespace internal {
+
+BatchUsingStringsPlan BuildBatchUsingStringsPlan(
+        const std::map<std::string_view, std::set<std::string_view>> &keywords_map,
+        const phmap::flat_hash_map<std::string_view, schema::StringMatchType> &match_type_map
+) {
+    BatchUsingStringsPlan plan;
+    std::vector<uint32_t> keyword_key_counts;
+    for (auto &[union_key, keywords]: keywords_map) {
+        for (auto keyword: keywords) {
+            auto [it, inserted] = plan.keyword_bits.try_emplace(keyword, static_cast<uint32_t>(plan.keyword_match_types.size()));
+            if (inserted) {
+                auto match_type = match_type_map.at(keyword);
+                plan.keyword_match_types.emplace_back(match_type);
+                keyword_key_counts.emplace_back(0);
+                if (keyword.empty()) {
+                    DEXKIT_CHECK(match_type == schema::StringMatchType::Equal);
+                    plan.empty_keyword_bit = it->second;
+                }
+            }
+            ++keyword_key_counts[it->second];
+        }
+    }
+    std::vector<std::string_view> literals;
+    literals.reserve(plan.keyword_bits.size());
+    for (auto &[keyword, bit]: plan.keyword_bits) {
+        if (!keyword.empty()) {
+            literals.emplace_back(keyword);
+        }
+    }
+    plan.prefilter = MultiLiteralPrefilter(literals);
+    plan.mask_words = (plan.keyword_match_types.size() + 63) / 64;
+    plan.anchored_keys.resize(plan.keyword_match_types.size());
+    plan.required_masks.resize(keywords_map.size() * plan.mask_words);
+    for (auto &[union_key, keywords]: keywords_map) {
+        auto key_index = static_cast<uint32_t>(plan.union_keys.size());
+        plan.union_keys.emplace_back(union_key);
+        auto required_mask = plan.required_masks.data() + key_index * plan.mask_words;
+        auto anchor_bit = UINT32_MAX;
+        for (auto keyword: keywords) {
+            auto bit = plan.keyword_bits.at(keyword);
+            required_mask[bit / 64] |= 1ULL << (bit % 64);
+            // the keyword shared by the fewest keys keeps the lists tested per hit short
+            if (anchor_bit == UINT32_MAX || keyword_key_counts[bit] < keyword_key_counts[anchor_bit]) {
+                anchor_bit = bit;
+            }
+        }
+        plan.anchored_keys[anchor_bit].emplace_back(key_index);
+    }
+    return plan;
+}
+
+BatchStringHitMasks MergeBatchStringHitMasks(std::vector<BatchStringHitMasks> &&parts) {
+    if (parts.size() == 1) {
+        return std::move(parts.front());
+    }
+    BatchStringHitMasks merged;
+    size_t string_count = 0, mask_count = 0;
+    for (auto &part: parts) {
+        string_count += part.mask_offsets.size();
+        mask_count += part.masks.size();
+    }
+    merged.mask_offsets.reserve(string_count);
+    merged.masks.reserve(mask_count);
+    for (auto &part: parts) {
+        DEXKIT_CHECK(part.first_string_idx == merged.mask_offsets.size());
+        auto base = static_cast<uint32_t>(merged.masks.size());
+        for (auto offset: part.mask_offsets) {
+            merged.mask_offsets.emplace_back(offset == BatchStringHitMasks::kNoHit ? offset : base + offset);
+        }
+        merged.masks.insert(merged.masks.end(), part.masks.begin(), part.masks.end());
+    }
+    return merged;
+}
+
+} // namespace internal
+
 namespace {
 
 template<typename MatchFunc>
@@ -48,31 +131,234 @@ bool MatchUsingStringGroup(
     return true;
 }
 
+bool IsKeywordHitMatched(schema::StringMatchType match_type, int begin, int end, size_t str_size) {
+    switch (match_type) {
+        case schema::StringMatchType::Contains: return true;
+        case schema::StringMatchType::StartWith: return begin == 0;
+        case schema::StringMatchType::EndWith: return end == str_size;
+        case schema::StringMatchType::Equal: return begin == 0 && end == str_size;
+        case schema::StringMatchType::SimilarRegex:
+        case schema::StringMatchType::Regex: abort();
+    }
+    return false;
+}
+
+bool OrStringHitMasks(
+        const internal::BatchStringHitMasks &hit_masks,
+        const std::vector<uint32_t> &string_ids,
+        std::vector<uint64_t> &mask
+) {
+    bool has_hit = false;
+    for (auto string_idx: string_ids) {
+        auto offset = hit_masks.mask_offsets[string_idx - hit_masks.first_string_idx];
+        if (offset == internal::BatchStringHitMasks::kNoHit) {
+            continue;
+        }
+        for (size_t i = 0; i < mask.size(); ++i) {
+            mask[i] |= hit_masks.masks[offset + i];
+        }
+        has_hit = true;
+    }
+    return has_hit;
+}
+
+template<typename Callback>
+void ForEachMatchedUnionKey(
+        const internal::BatchUsingStringsPlan &plan,
+        const std::vector<uint64_t> &mask,
+        Callback &&callback
+) {
+    for (size_t word = 0; word < plan.mask_words; ++word) {
+        for (auto bits = mask[word]; bits != 0; bits &= bits - 1) {
+            auto bit = word * 64 + std::countr_zero(bits);
+            for (auto key_index: plan.anchored_keys[bit]) {
+                auto required_mask = plan.required_masks.data() + key_index * plan.mask_words;
+                bool matched = true;
+                for (size_t i = 0; i < plan.mask_words; ++i) {
+                    if ((mask[i] & required_mask[i]) != required_mask[i]) {
+                        matched = false;
+                        break;
+                    }
+                }
+                if (matched) {
+                    callback(key_index);
+                }
+            }
+        }
+    }
+}
+
 } // namespace
 
-std::vector<BatchFindClassItemBean>
+std::vector<std::future<internal::BatchStringHitMasks>>
+DexItem::ScanBatchStringHitMasks(
+        acdat::AhoCorasickDoubleArrayTrie<std::string_view> &acTrie,
+        const internal::BatchUsingStringsPlan &plan,
+        IQueryExecutor &executor,
+        uint32_t slice_size,
+        QueryContext &query_context
+) {
+    std::vector<std::future<internal::BatchStringHitMasks>> futures;
+    auto string_count = (uint32_t) this->strings.size();
+    auto split_count = std::max<uint32_t>(1, (string_count + slice_size - 1) / slice_size);
+    QueryTaskBatch batch(executor);
+    futures.reserve(split_count);
+    batch.Reserve(split_count);
+    for (uint32_t i = 0; i < split_count; ++i) {
+        query_context.MarkTaskSubmitted();
+        futures.emplace_back(batch.Add(
+                [this, &acTrie, &plan, i, slice_size, string_count, &query_context] {
+                    auto task_scope = query_context.TrackTaskExecution();
+                    auto result = ScanBatchStringHitMasks(acTrie, plan, i * slice_size,
+                                                          std::min((i + 1) * slice_size, string_count),
+                                                          query_context);
+                    query_context.MarkTaskCompleted();
+                    return result;
+                }
+        ));
+    }
+    batch.Submit();
+    return futures;
+}
+
+std::vector<std::future<std::vector<internal::BatchHits>>>
 DexItem::BatchFindClassUsingStrings(
         const schema::BatchFindClassUsingStrings *query,
+        const internal::BatchUsingStringsPlan &plan,
+        const internal::BatchStringHitMasks &hit_masks,
+        const internal::IdSet *in_class_set,
+        const internal::PackageFilter &package_filter,
+        IQueryExecutor &executor,
+        uint32_t slice_size,
+        QueryContext &query_context
+) {
+    std::vector<std::future<std::vector<internal::BatchHits>>> futures;
+    auto type_count = (uint32_t) this->type_names.size();
+    auto split_count = std::max<uint32_t>(1, (type_count + slice_size - 1) / slice_size);
+    QueryTaskBatch batch(executor);
+    futures.reserve(split_count);
+    batch.Reserve(split_count);
+    for (uint32_t i = 0; i < split_count; ++i) {
+        query_context.MarkTaskSubmitted();
+        futures.emplace_back(batch.Add(
+                [this, query, &plan, &hit_masks, in_class_set, &package_filter, i, slice_size, type_count, &query_context] {
+                    auto task_scope = query_context.TrackTaskExecution();
+                    auto result = BatchFindClassUsingStrings(query, plan, hit_masks, in_class_set, package_filter,
+                                                             i * slice_size, std::min((i + 1) * slice_size, type_count),
+                                                             query_context);
+                    query_context.MarkTaskCompleted();
+                    return result;
+                }
+        ));
+    }
+    batch.Submit();
+    return futures;
+}
+
+std::vector<std::future<std::vector<internal::BatchHits>>>
+DexItem::BatchFindMethodUsingStrings(
+        const schema::BatchFindMethodUsingStrings *query,
+        const internal::BatchUsingStringsPlan &plan,
+        const internal::BatchStringHitMasks &hit_masks,
+        const internal::IdSet *in_class_set,
+        const internal::IdSet *in_method_set,
+        const internal::PackageFilter &package_filter,
+        IQueryExecutor &executor,
+        uint32_t slice_size,
+        QueryContext &query_context
+) {
+    std::vector<std::future<std::vector<internal::BatchHits>>> futures;
+    auto type_count = (uint32_t) this->type_names.size();
+    auto split_count = std::max<uint32_t>(1, (type_count + slice_size - 1) / slice_size);
+    QueryTaskBatch batch(executor);
+    futures.reserve(split_count);
+    batch.Reserve(split_count);
+    for (uint32_t i = 0; i < split_count; ++i) {
+        query_context.MarkTaskSubmitted();
+        futures.emplace_back(batch.Add(
+                [this, query, &plan, &hit_masks, in_class_set, in_method_set, &package_filter, i, slice_size, type_count,
+                 &query_context] {
+                    auto task_scope = query_context.TrackTaskExecution();
+                    auto result = BatchFindMethodUsingStrings(query, plan, hit_masks, in_class_set, in_method_set,
+                                                              package_filter, i * slice_size,
+                                                              std::min((i + 1) * slice_size, type_count),
+                                                              query_context);
+                    query_context.MarkTaskCompleted();
+                    return result;
+                }
+        ));
+    }
+    batch.Submit();
+    return futures;
+}
+
+// one pass over the string table, every string is parsed once no matter how many methods use it
+internal::BatchStringHitMasks
+DexItem::ScanBatchStringHitMasks(
         acdat::AhoCorasickDoubleArrayTrie<std::string_view> &acTrie,
-        std::map<std::string_view, std::set<std::string_view>> &keywords_map,
-        phmap::flat_hash_map<std::string_view, schema::StringMatchType> &match_type_map,
-        std::set<uint32_t> &in_class_set,
-        trie::PackageTrie &packageTrie,
+        const internal::BatchUsingStringsPlan &plan,
+        uint32_t start,
+        uint32_t end,
+        QueryContext &query_context
+) {
+    auto query_binding = query_context.BindToCurrentThread();
+
+    internal::BatchStringHitMasks hit_masks;
+    hit_masks.first_string_idx = start;
+    hit_masks.mask_offsets.assign(end - start, internal::BatchStringHitMasks::kNoHit);
+    std::vector<uint64_t> mask(plan.mask_words);
+    bool has_hit = false;
+    for (uint32_t string_idx = start; string_idx < end; ++string_idx) {
+        auto str = this->strings[string_idx];
+        if (plan.prefilter.MayContain(str)) {
+            acTrie.Scan(str, [&](int hit_begin, int hit_end, std::string_view keyword) {
+                auto bit = plan.keyword_bits.at(keyword);
+                if (IsKeywordHitMatched(plan.keyword_match_types[bit], hit_begin, hit_end, str.size())) {
+                    mask[bit / 64] |= 1ULL << (bit % 64);
+                    has_hit = true;
+                }
+                return true;
+            });
+        }
+        if (string_idx == this->empty_string_id && plan.empty_keyword_bit != UINT32_MAX) {
+            mask[plan.empty_keyword_bit / 64] |= 1ULL << (plan.empty_keyword_bit % 64);
+            has_hit = true;
+        }
+        if (!has_hit) {
+            continue;
+        }
+        hit_masks.mask_offsets[string_idx - start] = static_cast<uint32_t>(hit_masks.masks.size());
+        hit_masks.masks.insert(hit_masks.masks.end(), mask.begin(), mask.end());
+        std::fill(mask.begin(), mask.end(), 0);
+        has_hit = false;
+    }
+    return hit_masks;
+}
+
+std::vector<internal::BatchHits>
+DexItem::BatchFindClassUsingStrings(
+        const schema::BatchFindClassUsingStrings *query,
+        const internal::BatchUsingStringsPlan &plan,
+        const internal::BatchStringHitMasks &hit_masks,
+        const internal::IdSet *in_class_set,
+        const internal::PackageFilter &package_filter,
+        uint32_t start,
+        uint32_t end,
         QueryContext &query_context
 ) {
     auto query_binding = query_context.BindToCurrentThread();
+    auto package_mask = GetPackageTypeMask(package_filter);
 
     std::map<std::string_view, std::vector<uint32_t>> find_result;
-    for (int type_idx = 0; type_idx < this->type_names.size(); ++type_idx) {
+    std::vector<std::vector<uint32_t>> key_results(plan.union_keys.size());
+    std::vector<uint64_t> mask(plan.mask_words);
+    // filtered-out packages are skipped a word at a time
+    for (auto type_idx = internal::NextPackageType(package_mask.get(), start, end); type_idx < end;
+         type_idx = internal::NextPackageType(package_mask.get(), type_idx + 1, end)) {
         if (class_method_ids[type_idx].empty()) continue;
-        if (query->in_classes() && in_class_set.contains(type_idx)) continue;
-        if (query->search_packages() || query->exclude_packages()) {
-            auto hit = packageTrie.search(this->type_names[type_idx], query->ignore_packages_case());
-            if (query->exclude_packages() && (hit & 1)) continue;
-            if (query->search_packages() && !(hit >> 1)) continue;
-        }
+        if (in_class_set && in_class_set->contains(type_idx)) continue;
 
-        if (keywords_map.empty()) {
+        if (plan.empty()) {
             std::vector<std::string_view> using_strings;
             for (auto method_idx: class_method_ids[type_idx]) {
                 auto &method_using_strings = method_using_string_ids[method_idx];
@@ -92,92 +378,61 @@ DexItem::BatchFindClassUsingStrings(
             continue;
         }
 
-        auto using_empty_string_count = 0;
-        std::set<std::string_view> search_set;
+        std::fill(mask.begin(), mask.end(), 0);
+        bool has_hit = false;
         for (auto method_idx: class_method_ids[type_idx]) {
-            for (auto string_idx: method_using_string_ids[method_idx]) {
-                if (string_idx == this->empty_string_id) ++using_empty_string_count;
-                auto str = this->strings[string_idx];
-                auto hits = acTrie.ParseText(str);
-                for (auto &hit: hits) {
-                    auto match_type = match_type_map[hit.value];
-                    bool match;
-                    switch (match_type) {
-                        case schema::StringMatchType::Contains: match = true; break;
-                        case schema::StringMatchType::StartWith: match = (hit.begin == 0); break;
-                        case schema::StringMatchType::EndWith: match = (hit.end == str.size()); break;
-                        case schema::StringMatchType::Equal: match = (hit.begin == 0 && hit.end == str.size()); break;
-                        case schema::StringMatchType::SimilarRegex: abort();
-                    }
-                    if (match) {
-                        search_set.emplace(hit.value);
-                    }
-                }
-            }
-        }
-        if (match_type_map.contains("")) {
-            DEXKIT_CHECK(match_type_map[""] == schema::StringMatchType::Equal);
-            if (using_empty_string_count) {
-                search_set.emplace("");
-            }
+            has_hit |= OrStringHitMasks(hit_masks, method_using_string_ids[method_idx], mask);
         }
-        if (search_set.empty()) continue;
+        if (!has_hit) continue;
 
-        for (auto &[key, matched_set]: keywords_map) {
-            std::vector<std::string_view> vec;
-            std::set_intersection(search_set.begin(), search_set.end(),
-                                  matched_set.begin(), matched_set.end(),
-                                  std::inserter(vec, vec.begin()));
-            if (vec.size() == matched_set.size()) {
-                find_result[key].emplace_back(type_idx);
-            }
+        ForEachMatchedUnionKey(plan, mask, [&key_results, type_idx](uint32_t key_index) {
+            key_results[key_index].emplace_back(type_idx);
+        });
+    }
+    for (size_t key_index = 0; key_index < key_results.size(); ++key_index) {
+        if (!key_results[key_index].empty()) {
+            find_result[plan.union_keys[key_index]] = std::move(key_results[key_index]);
         }
     }
 
-    std::vector<BatchFindClassItemBean> result;
+    std::vector<internal::BatchHits> result;
+    result.reserve(find_result.size());
     for (auto &[key, values]: find_result) {
-        std::vector<ClassBean> classes;
-        for (auto id: values) {
-            classes.emplace_back(this->GetClassBean(id));
-        }
-        BatchFindClassItemBean itemBean;
-        itemBean.union_key = key;
-        itemBean.classes = classes;
-        result.emplace_back(itemBean);
+        result.push_back({key, std::move(values)});
     }
-
     return result;
 }
 
-std::vector<BatchFindMethodItemBean>
+std::vector<internal::BatchHits>
 DexItem::BatchFindMethodUsingStrings(
         const schema::BatchFindMethodUsingStrings *query,
-        acdat::AhoCorasickDoubleArrayTrie<std::string_view> &acTrie,
-        std::map<std::string_view, std::set<std::string_view>> &keywords_map,
-        phmap::flat_hash_map<std::string_view, schema::StringMatchType> &match_type_map,
-        std::set<uint32_t> &in_class_set,
-        std::set<uint32_t> &in_method_set,
-        trie::PackageTrie &packageTrie,
+        const internal::BatchUsingStringsPlan &plan,
+        const internal::BatchStringHitMasks &hit_masks,
+        const internal::IdSet *in_class_set,
+        const internal::IdSet *in_method_set,
+        const internal::PackageFilter &package_filter,
+        uint32_t start,
+        uint32_t end,
         QueryContext &query_context
 ) {
     auto query_binding = query_context.BindToCurrentThread();
+    auto package_mask = GetPackageTypeMask(package_filter);
 
     std::map<std::string_view, std::vector<uint32_t>> find_result;
-    for (int type_idx = 0; type_idx < this->type_names.size(); ++type_idx) {
+    std::vector<std::vector<uint32_t>> key_results(plan.union_keys.size());
+    std::vector<uint64_t> mask(plan.mask_words);
+    // filtered-out packages are skipped a word at a time
+    for (auto type_idx = internal::NextPackageType(package_mask.get(), start, end); type_idx < end;
+         type_idx = internal::NextPackageType(package_mask.get(), type_idx + 1, end)) {
         if (class_method_ids[type_idx].empty()) continue;
-        if (query->in_classes() && in_class_set.contains(type_idx)) continue;
-        if (query->search_packages() || query->exclude_packages()) {
-            auto hit = packageTrie.search(this->type_names[type_idx], query->ignore_packages_case());
-            if (query->exclude_packages() && (hit & 1)) continue;
-            if (query->search_packages() && !(hit >> 1)) continue;
-        }
+        if (in_class_set && in_class_set->contains(type_idx)) continue;
 
         for (auto method_idx: class_method_ids[type_idx]) {
-            if (query->in_methods() && in_method_set.contains(method_idx)) continue;
+            if (in_method_set && in_method_set->contains(method_idx)) continue;
             auto code = this->method_codes[method_idx];
             if (code == nullptr) continue;
 
-            if (keywords_map.empty()) {
+            if (plan.empty()) {
                 std::vector<std::string_view> using_strings;
                 auto &using_string_ids = method_using_string_ids[method_idx];
                 using_strings.reserve(using_string_ids.size());
@@ -195,57 +450,24 @@ DexItem::BatchFindMethodUsingStrings(
                 continue;
             }
 
-            auto using_empty_string_count = 0;
-            std::set<std::string_view> search_set;
-            for (auto string_idx: method_using_string_ids[method_idx]) {
-                if (string_idx == this->empty_string_id) ++using_empty_string_count;
-                auto str = this->strings[string_idx];
-                auto hits = acTrie.ParseText(str);
-                for (auto &hit: hits) {
-                    auto match_type = match_type_map[hit.value];
-                    bool match;
-                    switch (match_type) {
-                        case schema::StringMatchType::Contains: match = true; break;
-                        case schema::StringMatchType::StartWith: match = (hit.begin == 0); break;
-                        case schema::StringMatchType::EndWith: match = (hit.end == str.size()); break;
-                        case schema::StringMatchType::Equal: match = (hit.begin == 0 && hit.end == str.size()); break;
-                        case schema::StringMatchType::SimilarRegex: abort();
-                    }
-                    if (match) {
-                        search_set.emplace(hit.value);
-                    }
-                }
-            }
-            if (match_type_map.contains("")) {
-                DEXKIT_CHECK(match_type_map[""] == schema::StringMatchType::Equal);
-                if (using_empty_string_count) {
-                    search_set.emplace("");
-                }
-            }
-            if (search_set.empty()) continue;
-
-            for (auto &[key, matched_set]: keywords_map) {
-                std::vector<std::string_view> vec;
-                std::set_intersection(search_set.begin(), search_set.end(),
-                                      matched_set.begin(), matched_set.end(),
-                                      std::inserter(vec, vec.begin()));
-                if (vec.size() == matched_set.size()) {
-                    find_result[key].emplace_back(method_idx);
-                }
-            }
+            std::fill(mask.begin(), mask.end(), 0);
+            if (!OrStringHitMasks(hit_masks, method_using_string_ids[method_idx], mask)) continue;
+
+            ForEachMatchedUnionKey(plan, mask, [&key_results, method_idx](uint32_t key_index) {
+                key_results[key_index].emplace_back(method_idx);
+            });
+        }
+    }
+    for (size_t key_index = 0; key_index < key_results.size(); ++key_index) {
+        if (!key_results[key_index].empty()) {
+            find_result[plan.union_keys[key_index]] = std::move(key_results[key_index]);
         }
     }
 
-    std::vector<BatchFindMethodItemBean> result;
+    std::vector<internal::BatchHits> result;
+    result.reserve(find_result.size());
     for (auto &[key, values]: find_result) {
-        std::vector<MethodBean> methods;
-        for (auto id: values) {
-            methods.emplace_back(this->GetMethodBean(id));
-        }
-        BatchFindMethodItemBean itemBean;
-        itemBean.union_key = key;
-        itemBean.methods = methods;
-        result.emplace_back(itemBean);
+        result.push_back({key, std::move(values)});
     }
     return result;
 }
@@ -19,6 +19,11 @@
 // <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
 
 #include "dex_item.h"
+#include "internal/class_hierarchy.h"
+#include "internal/id_set.h"
+#include "internal/package_filter.h"
+#include "internal/regex.h"
+#include "internal/reference_seed.h"
 #include "internal/using_strings_prefilter.h"
 
 namespace dexkit {
@@ -58,139 +63,697 @@ void ScanFindItems(const Range &items, QueryContext &query_context, MatchFn &&ma
     }
 }
 
-} // namespace
+template<bool kEarlyExit, typename MatchFn>
+void ScanFindSlice(
+        uint32_t start,
+        uint32_t end,
+        const std::vector<uint32_t> *candidates,
+        QueryContext &query_context,
+        MatchFn &&match_fn
+) {
+    if (candidates) {
+        ScanFindItems<kEarlyExit>(std::span(candidates->data() + start, end - start), query_context, match_fn);
+    } else {
+        ScanFindRange<kEarlyExit>(start, end, query_context, match_fn);
+    }
+}
 
-std::vector<std::future<std::vector<ClassBean>>>
-DexItem::FindClass(
-        const schema::FindClass *query,
-        const std::set<uint32_t> &in_class_set,
-        trie::PackageTrie &packageTrie,
+// the first chunk of a query only samples the per item cost
+constexpr uint32_t kSampleChunkItems = 32;
+// a claim should amortize the task and claim overhead
+constexpr int64_t kTargetChunkNs = 200'000;
+constexpr uint32_t kMinChunkItems = 8;
+// each claim takes 1 / (kGuidedDivisor * workers) of the remaining items
+constexpr uint32_t kGuidedDivisor = 2;
+// a guided task hands its worker back to the scheduler after this long and continues in a new task
+constexpr int64_t kSegmentNs = 2'000'000;
+
+// Shared cursor of a guided scan over [0, item_count) of one dex.
+class GuidedScanState {
+public:
+    GuidedScanState(uint32_t item_count, size_t worker_count, uint32_t fallback_chunk_items, uint32_t task_count)
+            : item_count_(item_count),
+              worker_count_(static_cast<uint32_t>(std::max<size_t>(1, worker_count))),
+              fallback_chunk_items_(std::max(fallback_chunk_items, kMinChunkItems)),
+              pending_tasks_(task_count) {}
+
+    // smallest chunk worth a claim at the given per item cost
+    static uint32_t MinChunkItems(uint32_t item_cost_ns, uint32_t fallback_chunk_items) {
+        if (item_cost_ns == 0) {
+            return std::max(fallback_chunk_items, kMinChunkItems);
+        }
+        return static_cast<uint32_t>(std::clamp<int64_t>(kTargetChunkNs / item_cost_ns, kMinChunkItems, fallback_chunk_items * 8LL));
+    }
+
+    bool Claim(QueryContext &query_context, uint32_t &begin, uint32_t &end) {
+        auto cursor = cursor_.load(std::memory_order_relaxed);
+        uint32_t chunk;
+        do {
+            if (cursor >= item_count_) {
+                return false;
+            }
+            auto remaining = item_count_ - cursor;
+            auto item_cost_ns = query_context.GetScanItemCostNs();
+            if (item_cost_ns == 0 && cursor == 0) {
+                chunk = kSampleChunkItems;
+            } else {
+                chunk = std::max(MinChunkItems(item_cost_ns, fallback_chunk_items_), remaining / (kGuidedDivisor * worker_count_));
+                if (item_cost_ns != 0) {
+                    chunk = std::min<uint32_t>(chunk, std::max<int64_t>(kSegmentNs / item_cost_ns, kMinChunkItems));
+                }
+            }
+            chunk = std::min(chunk, remaining);
+        } while (!cursor_.compare_exchange_weak(cursor, cursor + chunk, std::memory_order_relaxed));
+        begin = cursor;
+        end = cursor + chunk;
+        return true;
+    }
+
+    // Chunks finish in any order. Unordered results are returned by the task that found them,
+    // otherwise the last task returns every hit in scan order and the others return nothing.
+    std::vector<uint32_t> Collect(std::vector<std::pair<uint32_t, std::vector<uint32_t>>> &&chunks, bool unordered) {
+        if (!unordered) {
+            std::lock_guard lock(mutex_);
+            for (auto &chunk: chunks) {
+                chunks_.emplace_back(std::move(chunk));
+            }
+            if (--pending_tasks_ > 0) {
+                return {};
+            }
+            chunks.swap(chunks_);
+        }
+        std::sort(chunks.begin(), chunks.end(), [](auto &lhs, auto &rhs) {
+            return lhs.first < rhs.first;
+        });
+        size_t size = 0;
+        for (auto &[begin, ids]: chunks) size += ids.size();
+        std::vector<uint32_t> result;
+        result.reserve(size);
+        for (auto &[begin, ids]: chunks) {
+            result.insert(result.end(), ids.begin(), ids.end());
+        }
+        return result;
+    }
+
+private:
+    uint32_t item_count_;
+    uint32_t worker_count_;
+    uint32_t fallback_chunk_items_;
+    std::atomic<uint32_t> cursor_ = 0;
+    std::mutex mutex_;
+    uint32_t pending_tasks_;
+    std::vector<std::pair<uint32_t, std::vector<uint32_t>>> chunks_;
+};
+
+// One lane of a guided scan. Each run claims chunks for at most kSegmentNs and then resubmits
+// itself through the executor, so a long scan never keeps a worker away from the fair dispatch
+// of other queries. The future is fulfilled by the run that finds the cursor drained.
+template<typename ScanFn>
+class GuidedScanLane {
+public:
+    GuidedScanLane(const ScanFn &scan, std::shared_ptr<GuidedScanState> state, IQueryExecutor &executor, QueryContext &query_context)
+            : scan_(scan), state_(std::move(state)), executor_(executor), query_context_(query_context) {}
+
+    std::future<std::vector<uint32_t>> GetFuture() {
+        return promise_.get_future();
+    }
+
+    // the executor outlives every lane, callers wait for all futures before releasing it
+    static void Run(const std::shared_ptr<GuidedScanLane> &self) {
+        auto &query_context = self->query_context_;
+        auto task_scope = query_context.TrackTaskExecution();
+        auto segment_start = std::chrono::steady_clock::now();
+        uint32_t start, end;
+        while (!query_context.ShouldEarlyExit() && self->state_->Claim(query_context, start, end)) {
+            auto start_time = std::chrono::steady_clock::now();
+            auto ids = self->scan_(start, end);
+            auto end_time = std::chrono::steady_clock::now();
+            query_context.MarkScanChunkCompleted(end - start, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    end_time - start_time).count());
+            if (!ids.empty()) {
+                self->chunks_.emplace_back(start, std::move(ids));
+            }
+            if (std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - segment_start).count() >= kSegmentNs) {
+                self->executor_.Submit([self] {
+                    Run(self);
+                });
+                return;
+            }
+        }
+        // early exit may skip lanes, each returns its own hits then
+        auto result = self->state_->Collect(std::move(self->chunks_), query_context.IsEarlyExitEnabled());
+        query_context.MarkTaskCompleted();
+        self->promise_.set_value(std::move(result));
+    }
+
+private:
+    ScanFn scan_;
+    std::shared_ptr<GuidedScanState> state_;
+    IQueryExecutor &executor_;
+    QueryContext &query_context_;
+    std::vector<std::pair<uint32_t, std::vector<uint32_t>>> chunks_;
+    std::promise<std::vector<uint32_t>> promise_;
+};
+
+// Submits the scan of [0, item_count) of one dex, scan(start, end) returns the hits of a range in
+// scan order. See SlicePolicy, slice_size is the fixed slice and the guided chunk floor until the
+// per item cost is sampled.
+template<typename ScanFn>
+std::vector<std::future<std::vector<uint32_t>>> SubmitFindScan(
         IQueryExecutor &executor,
+        QueryContext &query_context,
+        uint32_t item_count,
         uint32_t slice_size,
-        QueryContext &query_context
+        ScanFn &&scan
 ) {
-    std::vector<std::future<std::vector<ClassBean>>> futures;
-    uint32_t split_count;
+    std::vector<std::future<std::vector<uint32_t>>> futures;
     auto should_stop_submission = query_context.IsEarlyExitEnabled();
-    if (slice_size > 0) {
-        split_count = (this->reader.ClassDefs().size() + slice_size - 1) / slice_size;
-    } else {
-        split_count = 1;
-        slice_size = this->reader.ClassDefs().size();
+    if (query_context.GetSlicePolicy() == SlicePolicy::Fixed || slice_size == 0) {
+        uint32_t split_count;
+        if (slice_size > 0) {
+            split_count = (item_count + slice_size - 1) / slice_size;
+        } else {
+            split_count = 1;
+            slice_size = item_count;
+        }
+        QueryTaskBatch batch(executor);
+        futures.reserve(split_count);
+        batch.Reserve(split_count);
+        for (auto i = 0; i < split_count; ++i) {
+            if (should_stop_submission && executor.ShouldSkipTask()) break;
+            query_context.MarkTaskSubmitted();
+            futures.emplace_back(batch.Add(
+                    [scan, i, slice_size, item_count, &query_context] {
+                        auto task_scope = query_context.TrackTaskExecution();
+                        auto start = i * slice_size, end = std::min((i + 1) * slice_size, item_count);
+                        auto start_time = std::chrono::steady_clock::now();
+                        auto result = scan(start, end);
+                        query_context.MarkScanChunkCompleted(end - start, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - start_time).count());
+                        query_context.MarkTaskCompleted();
+                        return result;
+                    }
+            ));
+        }
+        batch.Submit();
+        return futures;
     }
-    futures.reserve(split_count);
-    for (auto i = 0; i < split_count; ++i) {
+
+    if (item_count == 0) {
+        return futures;
+    }
+    auto worker_count = std::max<size_t>(1, executor.GetWorkerCount());
+    // no more tasks than chunks of the smallest size the known cost allows
+    auto min_chunk_items = GuidedScanState::MinChunkItems(query_context.GetScanItemCostNs(), slice_size);
+    auto task_count = static_cast<uint32_t>(std::min<size_t>(worker_count, (item_count + min_chunk_items - 1) / min_chunk_items));
+    auto state = std::make_shared<GuidedScanState>(item_count, worker_count, slice_size, task_count);
+    QueryTaskBatch batch(executor);
+    futures.reserve(task_count);
+    batch.Reserve(task_count);
+    for (uint32_t i = 0; i < task_count; ++i) {
         if (should_stop_submission && executor.ShouldSkipTask()) break;
         query_context.MarkTaskSubmitted();
-        futures.emplace_back(SubmitQueryTask(executor,
-                [this, query, &in_class_set, &packageTrie, i, slice_size, &query_context] {
-                    auto task_scope = query_context.TrackTaskExecution();
-                    auto result = FindClass(query, in_class_set, packageTrie, i * slice_size,
-                                            std::min((i + 1) * slice_size, (uint32_t) this->reader.ClassDefs().size()),
-                                            query_context);
-                    query_context.MarkTaskCompleted();
-                    return result;
-                }
-        ));
+        auto lane = std::make_shared<GuidedScanLane<std::decay_t<ScanFn>>>(scan, state, executor, query_context);
+        futures.emplace_back(lane->GetFuture());
+        batch.Push([lane] {
+            GuidedScanLane<std::decay_t<ScanFn>>::Run(lane);
+        });
     }
+    batch.Submit();
     return futures;
 }
 
-std::vector<std::future<std::vector<MethodBean>>>
+// both ascending, a null set is unrestricted
+std::shared_ptr<const std::vector<uint32_t>> IntersectCandidates(
+        std::shared_ptr<const std::vector<uint32_t>> lhs,
+        std::shared_ptr<const std::vector<uint32_t>> rhs
+) {
+    if (!lhs) return rhs;
+    if (!rhs) return lhs;
+    auto intersection = std::make_shared<std::vector<uint32_t>>();
+    std::set_intersection(lhs->begin(), lhs->end(), rhs->begin(), rhs->end(),
+                          std::back_inserter(*intersection));
+    return intersection;
+}
+
+template<typename Ids, typename Less>
+std::pair<uint32_t, uint32_t> EqualRangeByClass(const Ids &ids, uint32_t class_idx, Less &&less) {
+    auto first = std::lower_bound(ids.begin(), ids.end(), class_idx, less);
+    auto last = first;
+    while (last != ids.end() && last->class_idx == class_idx) ++last;
+    return {(uint32_t) (first - ids.begin()), (uint32_t) (last - ids.begin())};
+}
+
+} // namespace
+
+std::shared_ptr<const std::vector<uint32_t>>
+DexItem::GetFindClassCandidates(
+        const internal::IdSet *in_class_set,
+        const schema::ClassMatcher *matcher
+) {
+    std::shared_ptr<const std::vector<uint32_t>> seeds;
+    if (dexkit->IsQueryIndexEnabled()) {
+        seeds = IntersectCandidates(GetClassHierarchySeedCandidates(matcher), GetTypeNameSeedCandidates(matcher));
+    }
+    if (!in_class_set) return seeds;
+    auto candidates = std::make_shared<std::vector<uint32_t>>();
+    candidates->reserve(in_class_set->ids.size());
+    for (auto type_idx: in_class_set->ids) {
+        if (type_idx >= this->type_def_flag.size() || !this->type_def_flag[type_idx]) continue;
+        candidates->emplace_back(this->type_def_idx[type_idx]);
+    }
+    // keep class_def order, results are reported in scan order
+    std::sort(candidates->begin(), candidates->end());
+    return IntersectCandidates(std::move(candidates), std::move(seeds));
+}
+
+std::shared_ptr<const std::vector<uint32_t>>
+DexItem::GetClassHierarchySeedCandidates(const schema::ClassMatcher *matcher) {
+    auto seeds = internal::GetClassHierarchySeeds(matcher);
+    if (seeds.empty()) return nullptr;
+    auto hierarchy = dexkit->GetClassHierarchy();
+    // the matched class def itself names its super class and interfaces, so the class defs of
+    // this dex listing the rarest seed are a superset of the result
+    std::optional<std::span<const uint32_t>> best;
+    for (auto &seed: seeds) {
+        auto node = hierarchy->FindNode(seed.descriptor);
+        if (node == internal::ClassHierarchy::kNoNode) {
+            return std::make_shared<std::vector<uint32_t>>();
+        }
+        auto defs = seed.is_interface
+                    ? hierarchy->GetDirectImplementorDefs(node, dex_id)
+                    : hierarchy->GetDirectSubclassDefs(node, dex_id);
+        if (!best || defs.size() < best->size()) {
+            best = defs;
+        }
+    }
+    return std::make_shared<std::vector<uint32_t>>(best->begin(), best->end());
+}
+
+std::shared_ptr<const std::vector<uint32_t>>
+DexItem::GetTypeNameSeedCandidates(const schema::ClassMatcher *matcher) {
+    if (!matcher) return nullptr;
+    auto key = internal::GetTypeNameSearchKey(matcher->class_name());
+    if (!key) return nullptr;
+    auto type_candidates = GetTypeNameCandidates(*key);
+    if (!type_candidates) return nullptr;
+    auto candidates = std::make_shared<std::vector<uint32_t>>();
+    for (auto type_idx: type_candidates->type_ids) {
+        if (!this->type_def_flag[type_idx]) continue;
+        candidates->emplace_back(this->type_def_idx[type_idx]);
+    }
+    std::sort(candidates->begin(), candidates->end());
+    return candidates;
+}
+
+std::shared_ptr<const std::vector<uint32_t>>
+DexItem::GetOpCodeSeedCandidates(const schema::MethodMatcher *matcher) {
+    if (!matcher || !matcher->op_codes() || !matcher->op_codes()->op_codes()) return nullptr;
+    if ((dex_flag.load(std::memory_order_acquire) & kOpCodeNgram) == 0) return nullptr;
+    auto op_codes = matcher->op_codes()->op_codes();
+    // the pattern matches contiguously, so every method it matches holds each of its 3-grams;
+    // windows covering a wildcard are skipped. op codes are narrowed like IsOpCodesMatched does
+    std::optional<std::pair<uint32_t, uint32_t>> best;
+    for (uint32_t i = 0; i + 3 <= op_codes->size(); ++i) {
+        auto op0 = op_codes->Get(i), op1 = op_codes->Get(i + 1), op2 = op_codes->Get(i + 2);
+        if (op0 < 0 || op1 < 0 || op2 < 0) continue;
+        auto key = (uint32_t) (uint8_t) op0 << 16 | (uint32_t) (uint8_t) op1 << 8 | (uint8_t) op2;
+        auto it = std::lower_bound(opcode_ngram_keys.begin(), opcode_ngram_keys.end(), key);
+        if (it == opcode_ngram_keys.end() || *it != key) {
+            return std::make_shared<std::vector<uint32_t>>();
+        }
+        auto pos = it - opcode_ngram_keys.begin();
+        auto first = opcode_ngram_offsets[pos], last = opcode_ngram_offsets[pos + 1];
+        if (!best || last - first < best->second - best->first) {
+            best.emplace(first, last);
+        }
+    }
+    if (!best) return nullptr;
+    return std::make_shared<std::vector<uint32_t>>(
+            opcode_ngram_postings.begin() + best->first,
+            opcode_ngram_postings.begin() + best->second);
+}
+
+std::shared_ptr<const std::vector<uint32_t>>
+DexItem::GetFindMethodCandidates(
+        const internal::IdSet *in_class_set,
+        const internal::IdSet *in_method_set,
+        const schema::MethodMatcher *matcher
+) {
+    std::shared_ptr<const std::vector<uint32_t>> seeds;
+    if (dexkit->IsQueryIndexEnabled()) {
+        seeds = IntersectCandidates(GetOpCodeSeedCandidates(matcher), GetReferenceSeedCandidates(matcher));
+        seeds = IntersectCandidates(std::move(seeds), GetMemberNameSeedCandidates(matcher));
+        seeds = IntersectCandidates(std::move(seeds), GetUsingNumberSeedCandidates(matcher));
+        seeds = IntersectCandidates(std::move(seeds), GetUsingStringSeedCandidates(matcher));
+    }
+    auto method_ids = this->reader.MethodIds();
+    std::shared_ptr<std::vector<uint32_t>> candidates;
+    if (in_method_set) {
+        auto end = std::lower_bound(in_method_set->ids.begin(), in_method_set->ids.end(), (uint32_t) method_ids.size());
+        candidates = std::make_shared<std::vector<uint32_t>>(in_method_set->ids.begin(), end);
+    } else if (in_class_set) {
+        // method_ids are sorted by defining class, every class owns one contiguous run
+        candidates = std::make_shared<std::vector<uint32_t>>();
+        for (auto type_idx: in_class_set->ids) {
+            if (type_idx >= this->type_def_flag.size() || !this->type_def_flag[type_idx]) continue;
+            auto first = std::lower_bound(
+                    method_ids.begin(), method_ids.end(), type_idx,
+                    [](const dex::MethodId &id, uint32_t class_idx) { return id.class_idx < class_idx; });
+            auto last = std::upper_bound(
+                    first, method_ids.end(), type_idx,
+                    [](uint32_t class_idx, const dex::MethodId &id) { return class_idx < id.class_idx; });
+            for (auto it = first; it != last; ++it) {
+                candidates->emplace_back((uint32_t) (it - method_ids.begin()));
+            }
+        }
+    }
+    return IntersectCandidates(std::move(candidates), std::move(seeds));
+}
+
+std::vector<uint32_t> DexItem::FindMethodRefs(std::string_view class_descriptor, std::string_view name) const {
+    std::vector<uint32_t> method_ids;
+    auto type_it = type_ids_map.find(class_descriptor);
+    if (type_it == type_ids_map.end()) return method_ids;
+    auto ids = this->reader.MethodIds();
+    auto [first, last] = EqualRangeByClass(ids, type_it->second,
+            [](const dex::MethodId &id, uint32_t class_idx) { return id.class_idx < class_idx; });
+    for (auto i = first; i < last; ++i) {
+        if (this->strings[ids[i].name_idx] == name) method_ids.emplace_back(i);
+    }
+    return method_ids;
+}
+
+std::vector<uint32_t> DexItem::FindFieldRefs(std::string_view class_descriptor, std::string_view name) const {
+    std::vector<uint32_t> field_ids;
+    auto type_it = type_ids_map.find(class_descriptor);
+    if (type_it == type_ids_map.end()) return field_ids;
+    auto ids = this->reader.FieldIds();
+    auto [first, last] = EqualRangeByClass(ids, type_it->second,
+            [](const dex::FieldId &id, uint32_t class_idx) { return id.class_idx < class_idx; });
+    for (auto i = first; i < last; ++i) {
+        if (this->strings[ids[i].name_idx] == name) field_ids.emplace_back(i);
+    }
+    return field_ids;
+}
+
+std::shared_ptr<const std::vector<uint32_t>>
+DexItem::GetReferenceSeedCandidates(const schema::MethodMatcher *matcher) {
+    auto seeds = internal::GetReferenceSeeds(matcher);
+    if (seeds.empty()) return nullptr;
+    // reverse edges of a reference live on the ref itself until BuildCrossRefAggregates moves
+    // them to the declaring dex, both places are read and only this dex's methods are kept
+    std::shared_ptr<const std::vector<uint32_t>> candidates;
+    auto add_seed = [&candidates](std::vector<uint32_t> &methods) {
+        std::sort(methods.begin(), methods.end());
+        methods.erase(std::unique(methods.begin(), methods.end()), methods.end());
+        candidates = IntersectCandidates(std::move(candidates), std::make_shared<std::vector<uint32_t>>(std::move(methods)));
+    };
+    auto collect_local = [this](const std::vector<std::pair<uint16_t, uint32_t>> &edges, std::vector<uint32_t> &methods) {
+        for (auto [edge_dex_id, method_idx]: edges) {
+            if (edge_dex_id == this->dex_id) methods.emplace_back(method_idx);
+        }
+    };
+    if (!seeds.using_fields.empty() && !field_get_method_ids.empty()) {
+        for (auto &seed: seeds.using_fields) {
+            std::vector<uint32_t> methods;
+            for (auto field_idx: FindFieldRefs(seed.class_descriptor, seed.name)) {
+                std::pair<DexItem *, uint32_t> targets[2] = {{this, field_idx}, {nullptr, 0}};
+                if (auto &cross_info = field_cross_info[field_idx]) {
+                    targets[1] = {dexkit->GetDexItem(cross_info->first), cross_info->second};
+                }
+                for (auto [target_dex, target_idx]: targets) {
+                    if (!target_dex) continue;
+                    if (seed.using_type != schema::UsingType::Put) {
+                        collect_local(target_dex->field_get_method_ids[target_idx], methods);
+                    }
+                    if (seed.using_type != schema::UsingType::Get) {
+                        collect_local(target_dex->field_put_method_ids[target_idx], methods);
+                    }
+                }
+            }
+            add_seed(methods);
+        }
+    }
+    if (!seeds.invoking_methods.empty() && !method_caller_ids.empty()) {
+        for (auto &seed: seeds.invoking_methods) {
+            std::vector<uint32_t> methods;
+            for (auto method_idx: FindMethodRefs(seed.class_descriptor, seed.name)) {
+                collect_local(method_caller_ids[method_idx], methods);
+                if (auto &cross_info = method_cross_info[method_idx]) {
+                    collect_local(dexkit->GetDexItem(cross_info->first)->method_caller_ids[cross_info->second], methods);
+                }
+            }
+            add_seed(methods);
+        }
+    }
+    if (!seeds.method_callers.empty() && !method_invoking_ids.empty()) {
+        auto dex_count = (uint16_t) dexkit->GetDexNum();
+        for (auto &seed: seeds.method_callers) {
+            // callers are method definitions, a candidate is invoked by one of them
+            std::vector<uint32_t> methods;
+            for (uint16_t caller_dex_id = 0; caller_dex_id < dex_count; ++caller_dex_id) {
+                auto caller_dex = dexkit->GetDexItem(caller_dex_id);
+                if (caller_dex->method_invoking_ids.empty()) continue;
+                for (auto caller_idx: caller_dex->FindMethodRefs(seed.class_descriptor, seed.name)) {
+                    for (auto invoke_idx: caller_dex->method_invoking_ids[caller_idx]) {
+                        if (caller_dex == this) methods.emplace_back(invoke_idx);
+                        auto &cross_info = caller_dex->method_cross_info[invoke_idx];
+                        if (cross_info && cross_info->first == this->dex_id) methods.emplace_back(cross_info->second);
+                    }
+                }
+            }
+            add_seed(methods);
+        }
+    }
+    return candidates;
+}
+
+std::shared_ptr<const std::vector<uint32_t>>
+DexItem::GetFindFieldCandidates(
+        const internal::IdSet *in_class_set,
+        const internal::IdSet *in_field_set,
+        const schema::FieldMatcher *matcher
+) {
+    auto seeds = dexkit->IsQueryIndexEnabled() ? GetMemberNameSeedCandidates(matcher) : nullptr;
+    auto field_ids = this->reader.FieldIds();
+    if (in_field_set) {
+        auto end = std::lower_bound(in_field_set->ids.begin(), in_field_set->ids.end(), (uint32_t) field_ids.size());
+        return IntersectCandidates(std::make_shared<std::vector<uint32_t>>(in_field_set->ids.begin(), end), std::move(seeds));
+    }
+    if (!in_class_set) return seeds;
+    // field_ids are sorted by defining class as well
+    auto candidates = std::make_shared<std::vector<uint32_t>>();
+    for (auto type_idx: in_class_set->ids) {
+        if (type_idx >= this->type_def_flag.size() || !this->type_def_flag[type_idx]) continue;
+        auto first = std::lower_bound(
+                field_ids.begin(), field_ids.end(), type_idx,
+                [](const dex::FieldId &id, uint32_t class_idx) { return id.class_idx < class_idx; });
+        auto last = std::upper_bound(
+                first, field_ids.end(), type_idx,
+                [](uint32_t class_idx, const dex::FieldId &id) { return class_idx < id.class_idx; });
+        for (auto it = first; it != last; ++it) {
+            candidates->emplace_back((uint32_t) (it - field_ids.begin()));
+        }
+    }
+    return IntersectCandidates(std::move(candidates), std::move(seeds));
+}
+
+std::shared_ptr<const std::vector<uint32_t>>
+DexItem::GetMemberNameSeedCandidates(const schema::MethodMatcher *matcher) {
+    if (!matcher || (dex_flag.load(std::memory_order_acquire) & kMemberNameIndex) == 0) return nullptr;
+    std::shared_ptr<const std::vector<uint32_t>> candidates;
+    if (auto name = internal::GetExactName(matcher->method_name())) {
+        auto ids = method_name_postings.Find(*name);
+        candidates = std::make_shared<std::vector<uint32_t>>(ids.begin(), ids.end());
+    }
+    auto shorties = internal::GetProtoShortySeeds(matcher);
+    if (!shorties.empty()) {
+        auto shorty_methods = std::make_shared<std::vector<uint32_t>>();
+        for (auto &shorty: shorties) {
+            auto ids = method_shorty_postings.Find(shorty);
+            shorty_methods->insert(shorty_methods->end(), ids.begin(), ids.end());
+        }
+        // one shorty per method, the lists are disjoint
+        std::sort(shorty_methods->begin(), shorty_methods->end());
+        candidates = IntersectCandidates(std::move(candidates), std::move(shorty_methods));
+    }
+    return candidates;
+}
+
+std::shared_ptr<const std::vector<uint32_t>>
+DexItem::GetMemberNameSeedCandidates(const schema::FieldMatcher *matcher) {
+    if (!matcher || (dex_flag.load(std::memory_order_acquire) & kMemberNameIndex) == 0) return nullptr;
+    auto name = internal::GetExactName(matcher->field_name());
+    if (!name) return nullptr;
+    auto ids = field_name_postings.Find(*name);
+    return std::make_shared<std::vector<uint32_t>>(ids.begin(), ids.end());
+}
+
+std::shared_ptr<const std::vector<uint32_t>>
+DexItem::GetUsingNumberSeedCandidates(const schema::MethodMatcher *matcher) {
+    if (!matcher || !matcher->using_numbers() || matcher->using_numbers()->size() == 0) return nullptr;
+    if ((dex_flag.load(std::memory_order_acquire) & kUsingNumberIndex) == 0) return nullptr;
+    // a matched method holds some constant equal to each requested one, start from the rarest
+    // and drop the ids missing from the postings of the others
+    std::vector<std::vector<std::span<const uint32_t>>> postings;
+    for (auto &number: internal::GetMatcherNumbers(matcher)) {
+        auto &lists = postings.emplace_back();
+        method_number_postings.Collect(number, lists);
+        if (lists.empty()) {
+            return std::make_shared<std::vector<uint32_t>>();
+        }
+    }
+    auto total_size = [](const std::vector<std::span<const uint32_t>> &lists) {
+        size_t size = 0;
+        for (auto &list: lists) size += list.size();
+        return size;
+    };
+    std::sort(postings.begin(), postings.end(), [&](auto &lhs, auto &rhs) {
+        return total_size(lhs) < total_size(rhs);
+    });
+    auto candidates = std::make_shared<std::vector<uint32_t>>();
+    for (auto &list: postings.front()) {
+        candidates->insert(candidates->end(), list.begin(), list.end());
+    }
+    std::sort(candidates->begin(), candidates->end());
+    candidates->erase(std::unique(candidates->begin(), candidates->end()), candidates->end());
+    for (size_t i = 1; i < postings.size() && !candidates->empty(); ++i) {
+        std::erase_if(*candidates, [&](uint32_t method_idx) {
+            return std::none_of(postings[i].begin(), postings[i].end(), [&](std::span<const uint32_t> list) {
+                return std::binary_search(list.begin(), list.end(), method_idx);
+            });
+        });
+    }
+    return candidates;
+}
+
+std::shared_ptr<const std::vector<uint32_t>>
+DexItem::GetUsingStringSeedCandidates(const schema::MethodMatcher *matcher) {
+    if (!matcher || !matcher->using_strings()) return nullptr;
+    if ((dex_flag.load(std::memory_order_acquire) & kStringIndex) == 0) return nullptr;
+    // every using_strings matcher is matched by some string of the method, so the method is
+    // listed by one of the strings each literal matcher resolves to
+    std::vector<std::shared_ptr<const std::vector<uint32_t>>> seeds;
+    for (auto string_matcher: *matcher->using_strings()) {
+        if (!string_matcher->value() || string_matcher->ignore_case()) continue;
+        auto value = string_matcher->value()->string_view();
+        auto match_type = string_matcher->match_type();
+        std::shared_ptr<const internal::Regex> regex;
+        if (match_type == schema::StringMatchType::Regex) {
+            // the strings holding its required literal, narrowed down to those the regex matches
+            regex = internal::GetCompiledRegex(string_matcher);
+            value = regex->GetLiteral().value;
+            match_type = regex->GetLiteral().match_type;
+        }
+        auto string_ids = string_suffix_array.Match(value, match_type);
+        if (!string_ids) continue;
+        if (regex && !regex->GetLiteral().exact) {
+            std::erase_if(*string_ids, [&](uint32_t string_idx) {
+                return !regex->Search(this->strings[string_idx]);
+            });
+        }
+        auto method_ids = std::make_shared<std::vector<uint32_t>>();
+        for (auto string_idx: *string_ids) {
+            method_ids->insert(method_ids->end(),
+                               string_method_ids.begin() + string_method_offsets[string_idx],
+                               string_method_ids.begin() + string_method_offsets[string_idx + 1]);
+        }
+        if (method_ids->empty()) {
+            return method_ids;
+        }
+        if (string_ids->size() > 1) {
+            std::sort(method_ids->begin(), method_ids->end());
+            method_ids->erase(std::unique(method_ids->begin(), method_ids->end()), method_ids->end());
+        }
+        seeds.emplace_back(std::move(method_ids));
+    }
+    std::sort(seeds.begin(), seeds.end(), [](auto &lhs, auto &rhs) {
+        return lhs->size() < rhs->size();
+    });
+    std::shared_ptr<const std::vector<uint32_t>> candidates;
+    for (auto &seed: seeds) {
+        candidates = IntersectCandidates(std::move(candidates), std::move(seed));
+        if (candidates->empty()) break;
+    }
+    return candidates;
+}
+
+std::vector<std::future<std::vector<uint32_t>>>
+DexItem::FindClass(
+        const schema::FindClass *query,
+        const internal::IdSet *in_class_set,
+        const internal::PackageFilter &package_filter,
+        IQueryExecutor &executor,
+        uint32_t slice_size,
+        QueryContext &query_context
+) {
+    auto candidates = GetFindClassCandidates(in_class_set, query->matcher());
+    uint32_t item_count = candidates ? candidates->size() : this->reader.ClassDefs().size();
+    return SubmitFindScan(executor, query_context, item_count, slice_size,
+            [this, query, in_class_set, &package_filter, candidates, &query_context](uint32_t start, uint32_t end) {
+                return FindClass(query, in_class_set, package_filter, candidates.get(), start, end, query_context);
+            }
+    );
+}
+
+std::vector<std::future<std::vector<uint32_t>>>
 DexItem::FindMethod(
         const schema::FindMethod *query,
-        const std::set<uint32_t> &in_class_set,
-        const std::set<uint32_t> &in_method_set,
-        trie::PackageTrie &packageTrie,
+        const internal::IdSet *in_class_set,
+        const internal::IdSet *in_method_set,
+        const internal::PackageFilter &package_filter,
         IQueryExecutor &executor,
         uint32_t slice_size,
         QueryContext &query_context
 ) {
-    std::vector<std::future<std::vector<MethodBean>>> futures;
-    uint32_t split_count;
-    auto should_stop_submission = query_context.IsEarlyExitEnabled();
-    if (slice_size > 0) {
-        split_count = (this->reader.MethodIds().size() + slice_size - 1) / slice_size;
-    } else {
-        split_count = 1;
-        slice_size = this->reader.MethodIds().size();
-    }
-    futures.reserve(split_count);
-    for (auto i = 0; i < split_count; ++i) {
-        if (should_stop_submission && executor.ShouldSkipTask()) break;
-        query_context.MarkTaskSubmitted();
-        futures.emplace_back(SubmitQueryTask(executor,
-                [this, query, &in_class_set, &in_method_set, &packageTrie, i, slice_size, &query_context] {
-                    auto task_scope = query_context.TrackTaskExecution();
-                    auto result = FindMethod(query, in_class_set, in_method_set, packageTrie, i * slice_size,
-                                             std::min((i + 1) * slice_size, (uint32_t) this->reader.MethodIds().size()),
-                                             query_context);
-                    query_context.MarkTaskCompleted();
-                    return result;
-                }
-        ));
-    }
-    return futures;
+    auto candidates = GetFindMethodCandidates(in_class_set, in_method_set, query->matcher());
+    uint32_t item_count = candidates ? candidates->size() : this->reader.MethodIds().size();
+    return SubmitFindScan(executor, query_context, item_count, slice_size,
+            [this, query, in_class_set, in_method_set, &package_filter, candidates, &query_context](uint32_t start, uint32_t end) {
+                return FindMethod(query, in_class_set, in_method_set, package_filter, candidates.get(), start, end, query_context);
+            }
+    );
 }
 
-std::vector<std::future<std::vector<FieldBean>>>
+std::vector<std::future<std::vector<uint32_t>>>
 DexItem::FindField(
         const schema::FindField *query,
-        const std::set<uint32_t> &in_class_set,
-        const std::set<uint32_t> &in_field_set,
-        trie::PackageTrie &packageTrie,
+        const internal::IdSet *in_class_set,
+        const internal::IdSet *in_field_set,
+        const internal::PackageFilter &package_filter,
         IQueryExecutor &executor,
         uint32_t slice_size,
         QueryContext &query_context
 ) {
-    std::vector<std::future<std::vector<FieldBean>>> futures;
-    uint32_t split_count;
-    auto should_stop_submission = query_context.IsEarlyExitEnabled();
-    if (slice_size > 0) {
-        split_count = (this->reader.FieldIds().size() + slice_size - 1) / slice_size;
-    } else {
-        split_count = 1;
-        slice_size = this->reader.FieldIds().size();
-    }
-    futures.reserve(split_count);
-    for (auto i = 0; i < split_count; ++i) {
-        if (should_stop_submission && executor.ShouldSkipTask()) break;
-        query_context.MarkTaskSubmitted();
-        futures.emplace_back(SubmitQueryTask(executor,
-                [this, query, &in_class_set, &in_field_set, &packageTrie, i, slice_size, &query_context] {
-                    auto task_scope = query_context.TrackTaskExecution();
-                    auto result = FindField(query, in_class_set, in_field_set, packageTrie, i * slice_size,
-                                            std::min((i + 1) * slice_size, (uint32_t) this->reader.FieldIds().size()),
-                                            query_context);
-                    query_context.MarkTaskCompleted();
-                    return result;
-                }
-        ));
-    }
-    return futures;
+    auto candidates = GetFindFieldCandidates(in_class_set, in_field_set, query->matcher());
+    uint32_t item_count = candidates ? candidates->size() : this->reader.FieldIds().size();
+    return SubmitFindScan(executor, query_context, item_count, slice_size,
+            [this, query, in_class_set, in_field_set, &package_filter, candidates, &query_context](uint32_t start, uint32_t end) {
+                return FindField(query, in_class_set, in_field_set, package_filter, candidates.get(), start, end, query_context);
+            }
+    );
 }
 
-std::vector<ClassBean>
+std::vector<uint32_t>
 DexItem::FindClass(
         const schema::FindClass *query,
-        const std::set<uint32_t> &in_class_set,
-        trie::PackageTrie &packageTrie,
+        const internal::IdSet *in_class_set,
+        const internal::PackageFilter &package_filter,
+        const std::vector<uint32_t> *candidates,
         uint32_t start,
         uint32_t end,
         QueryContext &query_context
 ) {
     auto query_binding = query_context.BindToCurrentThread();
+    auto package_mask = GetPackageTypeMask(package_filter);
     auto *prefilter_plan = internal::GetClassUsingStringsPrefilterPlan(query->matcher(), query_context);
 
     std::vector<uint32_t> find_result;
     auto try_match_class = [&](uint32_t i) {
         auto &class_def = this->reader.ClassDefs()[i];
-        if (query->in_classes() && !in_class_set.contains(class_def.class_idx)) return false;
-        if (query->search_packages() || query->exclude_packages()) {
-            auto hit = packageTrie.search(this->type_names[class_def.class_idx], query->ignore_packages_case());
-            if (query->exclude_packages() && (hit & 1)) return false;
-            if (query->search_packages() && !(hit >> 1)) return false;
-        }
+        if (in_class_set && !in_class_set->contains(class_def.class_idx)) return false;
+        if (package_mask && !package_mask->Test(class_def.class_idx)) return false;
         if (prefilter_plan && !MayMatchClassUsingStringsPrefilter(class_def.class_idx, *prefilter_plan)) return false;
         if (!IsClassMatched(class_def.class_idx, query->matcher())) return false;
         find_result.emplace_back(class_def.class_idx);
@@ -198,43 +761,36 @@ DexItem::FindClass(
     };
 
     if (query_context.IsEarlyExitEnabled()) {
-        ScanFindRange<true>(start, end, query_context, try_match_class);
+        ScanFindSlice<true>(start, end, candidates, query_context, try_match_class);
     } else {
-        ScanFindRange<false>(start, end, query_context, try_match_class);
+        ScanFindSlice<false>(start, end, candidates, query_context, try_match_class);
     }
 
-    std::vector<ClassBean> result;
-    result.reserve(find_result.size());
-    for (auto idx: find_result) {
-        result.emplace_back(GetClassBean(idx));
-    }
-    return result;
+    return find_result;
 }
 
-std::vector<MethodBean>
+std::vector<uint32_t>
 DexItem::FindMethod(
         const schema::FindMethod *query,
-        const std::set<uint32_t> &in_class_set,
-        const std::set<uint32_t> &in_method_set,
-        trie::PackageTrie &packageTrie,
+        const internal::IdSet *in_class_set,
+        const internal::IdSet *in_method_set,
+        const internal::PackageFilter &package_filter,
+        const std::vector<uint32_t> *candidates,
         uint32_t start,
         uint32_t end,
         QueryContext &query_context
 ) {
     auto query_binding = query_context.BindToCurrentThread();
+    auto package_mask = GetPackageTypeMask(package_filter);
     auto *prefilter_plan = internal::GetMethodUsingStringsPrefilterPlan(query->matcher(), query_context);
 
     std::vector<uint32_t> find_result;
     auto try_match_method = [&](uint32_t method_idx) {
         auto &method_def = this->reader.MethodIds()[method_idx];
         if (!this->type_def_flag[method_def.class_idx]) return false;
-        if (query->in_classes() && !in_class_set.contains(method_def.class_idx)) return false;
-        if (query->search_packages() || query->exclude_packages()) {
-            auto hit = packageTrie.search(this->type_names[method_def.class_idx], query->ignore_packages_case());
-            if (query->exclude_packages() && (hit & 1)) return false;
-            if (query->search_packages() && !(hit >> 1)) return false;
-        }
-        if (query->in_methods() && !in_method_set.contains(method_idx)) return false;
+        if (in_class_set && !in_class_set->contains(method_def.class_idx)) return false;
+        if (package_mask && !package_mask->Test(method_def.class_idx)) return false;
+        if (in_method_set && !in_method_set->contains(method_idx)) return false;
         if (prefilter_plan && !MayMatchMethodUsingStringsPrefilter(method_idx, *prefilter_plan)) return false;
         if (!IsMethodMatched(method_idx, query->matcher())) return false;
         find_result.emplace_back(method_idx);
@@ -242,83 +798,69 @@ DexItem::FindMethod(
     };
 
     if (query_context.IsEarlyExitEnabled()) {
-        ScanFindRange<true>(start, end, query_context, try_match_method);
+        ScanFindSlice<true>(start, end, candidates, query_context, try_match_method);
     } else {
-        ScanFindRange<false>(start, end, query_context, try_match_method);
+        ScanFindSlice<false>(start, end, candidates, query_context, try_match_method);
     }
 
-    std::vector<MethodBean> result;
-    result.reserve(find_result.size());
-    for (auto idx: find_result) {
-        result.emplace_back(GetMethodBean(idx));
-    }
-    return result;
+    return find_result;
 }
 
-std::vector<FieldBean>
+std::vector<uint32_t>
 DexItem::FindField(
         const schema::FindField *query,
-        const std::set<uint32_t> &in_class_set,
-        const std::set<uint32_t> &in_field_set,
-        trie::PackageTrie &packageTrie,
+        const internal::IdSet *in_class_set,
+        const internal::IdSet *in_field_set,
+        const internal::PackageFilter &package_filter,
+        const std::vector<uint32_t> *candidates,
         uint32_t start,
         uint32_t end,
         QueryContext &query_context
 ) {
     auto query_binding = query_context.BindToCurrentThread();
+    auto package_mask = GetPackageTypeMask(package_filter);
 
     std::vector<uint32_t> find_result;
     auto try_match_field = [&](uint32_t field_idx) {
         auto &field_def = this->reader.FieldIds()[field_idx];
         if (!this->type_def_flag[field_def.class_idx]) return false;
-        if (query->in_classes() && !in_class_set.contains(field_def.class_idx)) return false;
-        if (query->search_packages() || query->exclude_packages()) {
-            auto hit = packageTrie.search(this->type_names[field_def.class_idx], query->ignore_packages_case());
-            if (query->exclude_packages() && (hit & 1)) return false;
-            if (query->search_packages() && !(hit >> 1)) return false;
-        }
-        if (query->in_fields() && !in_field_set.contains(field_idx)) return false;
+        if (in_class_set && !in_class_set->contains(field_def.class_idx)) return false;
+        if (package_mask && !package_mask->Test(field_def.class_idx)) return false;
+        if (in_field_set && !in_field_set->contains(field_idx)) return false;
         if (!IsFieldMatched(field_idx, query->matcher())) return false;
         find_result.emplace_back(field_idx);
         return true;
     };
 
     if (query_context.IsEarlyExitEnabled()) {
-        ScanFindRange<true>(start, end, query_context, try_match_field);
+        ScanFindSlice<true>(start, end, candidates, query_context, try_match_field);
     } else {
-        ScanFindRange<false>(start, end, query_context, try_match_field);
+        ScanFindSlice<false>(start, end, candidates, query_context, try_match_field);
     }
 
-    std::vector<FieldBean> result;
-    result.reserve(find_result.size());
-    for (auto idx: find_result) {
-        result.emplace_back(GetFieldBean(idx));
-    }
-    return result;
+    return find_result;
 }
 
-std::vector<ClassBean>
+std::vector<uint32_t>
 DexItem::FindClass(
         const schema::FindClass *query,
-        const std::set<uint32_t> &in_class_set,
-        trie::PackageTrie &packageTrie,
+        const internal::IdSet *in_class_set,
+        const internal::PackageFilter &package_filter,
         uint32_t type_idx,
         QueryContext &query_context
 ) {
     auto query_binding = query_context.BindToCurrentThread();
     auto *prefilter_plan = internal::GetClassUsingStringsPrefilterPlan(query->matcher(), query_context);
 
-    if (query->in_classes() && !in_class_set.contains(type_idx)) {
+    if (in_class_set && !in_class_set->contains(type_idx)) {
         return {};
     }
 
-    std::vector<uint32_t> find_result;
-    if (query->search_packages() || query->exclude_packages()) {
-        auto hit = packageTrie.search(this->type_names[type_idx], query->ignore_packages_case());
-        if (query->exclude_packages() && (hit & 1)) return {};
-        if (query->search_packages() && !(hit >> 1)) return {};
+    if (!package_filter.empty() && !internal::IsTypeInPackageFilter(package_filter, this->type_names[type_idx])) {
+        return {};
     }
 
+    std::vector<uint32_t> find_result;
     if (prefilter_plan && !MayMatchClassUsingStringsPrefilter(type_idx, *prefilter_plan)) {
         return {};
     }
@@ -330,39 +872,32 @@ DexItem::FindClass(
         }
     }
 
-    std::vector<ClassBean> result;
-    result.reserve(find_result.size());
-    for (auto idx: find_result) {
-        result.emplace_back(GetClassBean(idx));
-    }
-    return result;
+    return find_result;
 }
 
-std::vector<MethodBean>
+std::vector<uint32_t>
 DexItem::FindMethod(
         const schema::FindMethod *query,
-        const std::set<uint32_t> &in_class_set,
-        const std::set<uint32_t> &in_method_set,
-        trie::PackageTrie &packageTrie,
+        const internal::IdSet *in_class_set,
+        const internal::IdSet *in_method_set,
+        const internal::PackageFilter &package_filter,
         uint32_t type_idx,
         QueryContext &query_context
 ) {
     auto query_binding = query_context.BindToCurrentThread();
     auto *prefilter_plan = internal::GetMethodUsingStringsPrefilterPlan(query->matcher(), query_context);
 
-    if (query->in_classes() && !in_class_set.contains(type_idx)) {
+    if (in_class_set && !in_class_set->contains(type_idx)) {
+        return {};
+    }
+
+    if (!package_filter.empty() && !internal::IsTypeInPackageFilter(package_filter, this->type_names[type_idx])) {
         return {};
     }
 
     std::vector<uint32_t> find_result;
     auto try_match_method = [&](uint32_t method_idx) {
-        auto &method_def = this->reader.MethodIds()[method_idx];
-        if (query->in_methods() && !in_method_set.contains(method_idx)) return false;
-        if (query->search_packages() || query->exclude_packages()) {
-            auto hit = packageTrie.search(this->type_names[method_def.class_idx], query->ignore_packages_case());
-            if (query->exclude_packages() && (hit & 1)) return false;
-            if (query->search_packages() && !(hit >> 1)) return false;
-        }
+        if (in_method_set && !in_method_set->contains(method_idx)) return false;
         if (prefilter_plan && !MayMatchMethodUsingStringsPrefilter(method_idx, *prefilter_plan)) return false;
         if (!IsMethodMatched(method_idx, query->matcher())) return false;
         find_result.emplace_back(method_idx);
@@ -374,38 +909,31 @@ DexItem::FindMethod(
         ScanFindItems<false>(this->class_method_ids[type_idx], query_context, try_match_method);
     }
 
-    std::vector<MethodBean> result;
-    result.reserve(find_result.size());
-    for (auto idx: find_result) {
-        result.emplace_back(GetMethodBean(idx));
-    }
-    return result;
+    return find_result;
 }
 
-std::vector<FieldBean>
+std::vector<uint32_t>
 DexItem::FindField(
         const schema::FindField *query,
-        const std::set<uint32_t> &in_class_set,
-        const std::set<uint32_t> &in_field_set,
-        trie::PackageTrie &packageTrie,
+        const internal::IdSet *in_class_set,
+        const internal::IdSet *in_field_set,
+        const internal::PackageFilter &package_filter,
         uint32_t type_idx,
         QueryContext &query_context
 ) {
     auto query_binding = query_context.BindToCurrentThread();
 
-    if (query->in_classes() && !in_class_set.contains(type_idx)) {
+    if (in_class_set && !in_class_set->contains(type_idx)) {
+        return {};
+    }
+
+    if (!package_filter.empty() && !internal::IsTypeInPackageFilter(package_filter, this->type_names[type_idx])) {
         return {};
     }
 
     std::vector<uint32_t> find_result;
     auto try_match_field = [&](uint32_t field_idx) {
-        auto &field_def = this->reader.FieldIds()[field_idx];
-        if (query->in_fields() && !in_field_set.contains(field_idx)) return false;
-        if (query->search_packages() || query->exclude_packages()) {
-            auto hit = packageTrie.search(this->type_names[field_def.class_idx], query->ignore_packages_case());
-            if (query->exclude_packages() && (hit & 1)) return false;
-            if (query->search_packages() && !(hit >> 1)) return false;
-        }
+        if (in_field_set && !in_field_set->contains(field_idx)) return false;
         if (!IsFieldMatched(field_idx, query->matcher())) return false;
         find_result.emplace_back(field_idx);
         return true;
@@ -416,12 +944,7 @@ DexItem::FindField(
         ScanFindItems<false>(this->class_field_ids[type_idx], query_context, try_match_field);
     }
 
-    std::vector<FieldBean> result;
-    result.reserve(find_result.size());
-    for (auto idx: find_result) {
-        result.emplace_back(GetFieldBean(idx));
-    }
-    return result;
+    return find_result;
 }
 
 }
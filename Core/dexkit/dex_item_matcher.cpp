@@ -19,6 +19,9 @@
 // <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
 
 #include "dex_item.h"
+#include "internal/compiled_matcher_cache.h"
+#include "internal/literal_prefilter.h"
+#include "internal/regex.h"
 #include "matcher_thread_cache_registry.h"
 #include "utils/dex_descriptor_util.h"
 
@@ -143,10 +146,19 @@ enum class MatcherCacheScope : uint8_t {
     MethodUsingStringsKeywords,
     UsingFieldMatchers,
     UsingNumbers,
+    TypeNameCandidates,
+    Regexes,
 };
 
 namespace {
 
+// trigram candidates of a class_name matcher, looked up once per dex and query
+struct TypeNameCandidatesSlots {
+    std::optional<std::string> key;
+    std::unique_ptr<std::once_flag[]> once;
+    std::unique_ptr<std::shared_ptr<const internal::TypeNameCandidates>[]> candidates;
+};
+
 template<typename T>
 static bool HasNonEmptyVector(const T *vector) {
     return vector != nullptr && vector->size() > 0;
@@ -199,6 +211,19 @@ static bool HasLogicalGroups(const schema::ClassMatcher *matcher) {
     );
 }
 
+// only the name is constrained, so the match does not depend on which dex declares the class
+static bool IsClassNameOnlyMatcher(const schema::ClassMatcher *matcher) {
+    return matcher->smali_source() == nullptr
+           && matcher->access_flags() == nullptr
+           && matcher->super_class() == nullptr
+           && matcher->interfaces() == nullptr
+           && matcher->annotations() == nullptr
+           && matcher->fields() == nullptr
+           && matcher->methods() == nullptr
+           && matcher->using_strings() == nullptr
+           && !HasLogicalGroups(matcher);
+}
+
 static bool HasLogicalGroups(const schema::MethodMatcher *matcher) {
     return matcher != nullptr && (
             HasNonEmptyVector(matcher->all_of())
@@ -216,7 +241,7 @@ static bool HasLogicalGroups(const schema::FieldMatcher *matcher) {
 }
 
 static bool CanUseKeywordUsingStringMatcher(const schema::StringMatcher *matcher) {
-    return matcher != nullptr && matcher->value() != nullptr;
+    return matcher != nullptr && matcher->value() != nullptr && matcher->match_type() != schema::StringMatchType::Regex;
 }
 
 static bool CanUseKeywordUsingStringsMatchers(
@@ -248,7 +273,11 @@ phmap::flat_hash_map<std::thread::id, std::vector<MatcherThreadLocalCacheSlot>>
     return registry;
 }
 
-constexpr size_t kPersistentUsingStringsCacheLimit = 32;
+// op code pattern with its kmp next table
+struct CompiledOpCodes {
+    std::vector<std::optional<uint8_t>> pattern;
+    std::vector<int> next;
+};
 
 struct NormalizedUsingStringMatcher {
     std::string value;
@@ -258,39 +287,87 @@ struct NormalizedUsingStringMatcher {
 
 struct PersistentUsingStringsKeywordsCache {
     using AcTrie = acdat::AhoCorasickDoubleArrayTrie<std::string_view>;
-    using MatchTypeMap = phmap::flat_hash_map<std::string_view, schema::StringMatchType>;
-    using StringSet = std::set<std::string_view>;
+
+    struct Keyword {
+        uint32_t bit = 0;
+        schema::StringMatchType match_type = schema::StringMatchType::Contains;
+    };
 
     std::vector<std::string> owned_keywords;
     std::shared_ptr<AcTrie> ac_trie = std::make_shared<AcTrie>();
-    std::shared_ptr<MatchTypeMap> match_type_map = std::make_shared<MatchTypeMap>();
-    std::shared_ptr<StringSet> real_keywords = std::make_shared<StringSet>();
+    // one bit per distinct keyword value, the last matcher of a value decides its match type
+    phmap::flat_hash_map<std::string_view, Keyword> keywords;
+    uint32_t empty_keyword_bit = UINT32_MAX;
+    internal::MultiLiteralPrefilter prefilter;
 };
 
-struct PersistentUsingStringsThreadCache {
-    struct Entry {
-        std::string key;
-        std::shared_ptr<PersistentUsingStringsKeywordsCache> value;
-    };
+// Keyword bits hit by the using strings fed so far, the scan of a string stops as soon as every
+// keyword is hit.
+class UsingStringsKeywordsHits {
+public:
+    explicit UsingStringsKeywordsHits(const PersistentUsingStringsKeywordsCache &cache)
+            : cache_(cache), remaining_(cache.keywords.size()) {
+        if (remaining_ > kInlineWords * 64) {
+            heap_words_.resize((remaining_ + 63) / 64);
+        }
+    }
 
-    template<typename Factory>
-    std::shared_ptr<PersistentUsingStringsKeywordsCache> GetOrCreate(std::string key, Factory &&factory) {
-        for (auto &entry: entries) {
-            if (entry.key == key) {
-                return entry.value;
-            }
+    [[nodiscard]] bool IsAllHit() const {
+        return remaining_ == 0;
+    }
+
+    // true once every keyword is hit
+    bool Feed(uint32_t string_idx, std::string_view str, uint32_t empty_string_idx) {
+        if (string_idx == empty_string_idx && cache_.empty_keyword_bit != UINT32_MAX) {
+            Set(cache_.empty_keyword_bit);
         }
-        if (entries.size() >= kPersistentUsingStringsCacheLimit) {
-            entries.erase(entries.begin());
+        if (remaining_ == 0 || !cache_.prefilter.MayContain(str)) {
+            return remaining_ == 0;
         }
-        entries.push_back(Entry{
-                .key = std::move(key),
-                .value = std::make_shared<PersistentUsingStringsKeywordsCache>(std::forward<Factory>(factory)()),
+        cache_.ac_trie->Scan(str, [&](int begin, int end, std::string_view value) {
+            auto &keyword = cache_.keywords.find(value)->second;
+            bool match;
+            switch (keyword.match_type) {
+                case schema::StringMatchType::Contains: match = true; break;
+                case schema::StringMatchType::StartWith: match = (begin == 0); break;
+                case schema::StringMatchType::EndWith: match = (end == str.size()); break;
+                case schema::StringMatchType::Equal: match = (begin == 0 && end == str.size()); break;
+                case schema::StringMatchType::SimilarRegex:
+                case schema::StringMatchType::Regex: abort();
+            }
+            if (match) {
+                Set(keyword.bit);
+            }
+            return remaining_ != 0;
         });
-        return entries.back().value;
+        return remaining_ == 0;
     }
 
-    std::vector<Entry> entries;
+private:
+    static constexpr size_t kInlineWords = 4;
+
+    const PersistentUsingStringsKeywordsCache &cache_;
+    size_t remaining_;
+    uint64_t inline_words_[kInlineWords] = {};
+    std::vector<uint64_t> heap_words_;
+
+    void Set(uint32_t bit) {
+        auto *words = heap_words_.empty() ? inline_words_ : heap_words_.data();
+        auto mask = uint64_t{1} << (bit % 64);
+        if ((words[bit / 64] & mask) == 0) {
+            words[bit / 64] |= mask;
+            --remaining_;
+        }
+    }
+};
+
+// keeps the artifact returned outside of a query alive until the thread's next lookup
+struct UsingStringsKeywordsKeepAlive {
+    std::shared_ptr<const PersistentUsingStringsKeywordsCache> value;
+};
+
+struct RegexKeepAlive {
+    std::shared_ptr<const internal::Regex> value;
 };
 
 static std::vector<NormalizedUsingStringMatcher> NormalizeUsingStringsMatchers(
@@ -354,43 +431,53 @@ static PersistentUsingStringsKeywordsCache BuildPersistentUsingStringsKeywordsCa
 ) {
     PersistentUsingStringsKeywordsCache cache;
     cache.owned_keywords.reserve(normalized.size());
-    cache.match_type_map->reserve(normalized.size());
+    cache.keywords.reserve(normalized.size());
 
     std::vector<std::pair<std::string_view, bool>> keywords;
+    std::vector<std::string_view> literals;
     keywords.reserve(normalized.size());
     for (const auto &item: normalized) {
         cache.owned_keywords.emplace_back(item.value);
         auto keyword = std::string_view(cache.owned_keywords.back());
         keywords.emplace_back(keyword, item.ignore_case);
-        cache.real_keywords->insert(keyword);
-        (*cache.match_type_map)[keyword] = item.match_type;
+        auto bit = static_cast<uint32_t>(cache.keywords.size());
+        auto [it, inserted] = cache.keywords.try_emplace(keyword, PersistentUsingStringsKeywordsCache::Keyword{bit});
+        it->second.match_type = item.match_type;
+        if (inserted && !keyword.empty()) {
+            literals.emplace_back(keyword);
+        }
+    }
+    if (auto it = cache.keywords.find(""); it != cache.keywords.end()) {
+        DEXKIT_CHECK(it->second.match_type == schema::StringMatchType::Equal);
+        cache.empty_keyword_bit = it->second.bit;
     }
     acdat::Builder<std::string_view>().Build(keywords, cache.ac_trie.get());
+    cache.prefilter = internal::MultiLiteralPrefilter(literals);
     return cache;
 }
 
-static std::shared_ptr<PersistentUsingStringsKeywordsCache> GetPersistentUsingStringsKeywordsCache(
+static size_t EstimateUsingStringsKeywordsBytes(const PersistentUsingStringsKeywordsCache &cache) {
+    size_t bytes = 0;
+    for (const auto &keyword: cache.owned_keywords) {
+        // trie base/check/fail arrays plus the keyword map slot
+        bytes += sizeof(std::string) + keyword.size() * 24 + 64;
+    }
+    return bytes + sizeof(internal::MultiLiteralPrefilter);
+}
+
+static std::shared_ptr<const PersistentUsingStringsKeywordsCache> GetPersistentUsingStringsKeywordsCache(
         const flatbuffers::Vector<flatbuffers::Offset<schema::StringMatcher>> *using_strings_matcher
 ) {
-    // Avoid direct non-trivial thread_local destruction on Windows DLL TLS
-    // teardown. Keep the TLS slot trivially destructible and free native-owned
-    // worker-thread instances through the registry when the pool shuts down.
-    thread_local PersistentUsingStringsThreadCache *cache = nullptr;
-    if (cache == nullptr) {
-        cache = new PersistentUsingStringsThreadCache();
-        RegisterMatcherThreadLocalCache(
-                std::this_thread::get_id(),
-                cache,
-                [](void *ptr) {
-                    delete reinterpret_cast<PersistentUsingStringsThreadCache *>(ptr);
-                }
-        );
-    }
     auto normalized = NormalizeUsingStringsMatchers(using_strings_matcher);
     auto key = BuildUsingStringsCacheKey(normalized);
-    return cache->GetOrCreate(std::move(key), [&]() {
-        return BuildPersistentUsingStringsKeywordsCache(normalized);
-    });
+    return internal::CompiledMatcherCache::Global().GetOrCreate<PersistentUsingStringsKeywordsCache>(
+            internal::CompiledMatcherKind::UsingStringsKeywords,
+            key,
+            [&]() {
+                return BuildPersistentUsingStringsKeywordsCache(normalized);
+            },
+            EstimateUsingStringsKeywordsBytes
+    );
 }
 
 } // namespace
@@ -470,7 +557,7 @@ static T *GetMatcherCache(MatcherCacheScope scope, std::uintptr_t key, Factory &
     return ptr;
 }
 
-static PersistentUsingStringsKeywordsCache *GetUsingStringsKeywordsCache(
+static const PersistentUsingStringsKeywordsCache *GetUsingStringsKeywordsCache(
         MatcherCacheScope scope,
         const flatbuffers::Vector<flatbuffers::Offset<schema::StringMatcher>> *using_strings_matcher
 ) {
@@ -479,9 +566,24 @@ static PersistentUsingStringsKeywordsCache *GetUsingStringsKeywordsCache(
     }
     DEXKIT_CHECK(CanUseKeywordUsingStringsMatchers(using_strings_matcher));
     if (QueryContext::Current() == nullptr) {
-        return GetPersistentUsingStringsKeywordsCache(using_strings_matcher).get();
-    }
-    auto *cache_ref = GetMatcherCache<std::shared_ptr<PersistentUsingStringsKeywordsCache>>(
+        // Avoid direct non-trivial thread_local destruction on Windows DLL TLS
+        // teardown. Keep the TLS slot trivially destructible and free native-owned
+        // worker-thread instances through the registry when the pool shuts down.
+        thread_local UsingStringsKeywordsKeepAlive *keep_alive = nullptr;
+        if (keep_alive == nullptr) {
+            keep_alive = new UsingStringsKeywordsKeepAlive();
+            RegisterMatcherThreadLocalCache(
+                    std::this_thread::get_id(),
+                    keep_alive,
+                    [](void *ptr) {
+                        delete reinterpret_cast<UsingStringsKeywordsKeepAlive *>(ptr);
+                    }
+            );
+        }
+        keep_alive->value = GetPersistentUsingStringsKeywordsCache(using_strings_matcher);
+        return keep_alive->value.get();
+    }
+    auto *cache_ref = GetMatcherCache<std::shared_ptr<const PersistentUsingStringsKeywordsCache>>(
             scope,
             POINT_CASE(using_strings_matcher),
             [&]() {
@@ -491,6 +593,32 @@ static PersistentUsingStringsKeywordsCache *GetUsingStringsKeywordsCache(
     return cache_ref->get();
 }
 
+static const internal::Regex *GetRegex(const schema::StringMatcher *matcher) {
+    if (QueryContext::Current() == nullptr) {
+        thread_local RegexKeepAlive *keep_alive = nullptr;
+        if (keep_alive == nullptr) {
+            keep_alive = new RegexKeepAlive();
+            RegisterMatcherThreadLocalCache(
+                    std::this_thread::get_id(),
+                    keep_alive,
+                    [](void *ptr) {
+                        delete reinterpret_cast<RegexKeepAlive *>(ptr);
+                    }
+            );
+        }
+        keep_alive->value = internal::GetCompiledRegex(matcher);
+        return keep_alive->value.get();
+    }
+    auto *regex_ref = GetMatcherCache<std::shared_ptr<const internal::Regex>>(
+            MatcherCacheScope::Regexes,
+            POINT_CASE(matcher),
+            [&]() {
+                return internal::GetCompiledRegex(matcher);
+            }
+    );
+    return regex_ref->get();
+}
+
 void RegisterMatcherThreadLocalCache(
         std::thread::id thread_id,
         void *cache,
@@ -551,6 +679,7 @@ static bool IsStringMatchedAtomic(std::string_view str, const schema::StringMatc
             condition = index != -1;
             break;
         }
+        case schema::StringMatchType::Regex: condition = GetRegex(matcher)->Search(str); break;
         case schema::StringMatchType::SimilarRegex: abort();
     }
     return condition;
@@ -711,49 +840,15 @@ bool DexItem::IsAnnotationUsingStringsMatched(const ir::Annotation *annotation,
             MatcherCacheScope::AnnotationUsingStringsKeywords,
             matcher->using_strings()
     );
-    auto &acTrie = keywords_cache->ac_trie;
-    auto &match_type_map = keywords_cache->match_type_map;
-    auto &real_keywords = keywords_cache->real_keywords;
 
-    auto using_empty_string_count = 0;
-    std::set<std::string_view> search_set;
+    UsingStringsKeywordsHits hits(*keywords_cache);
     auto using_strings = GetAnnotationUsingStrings(annotation);
     for (auto idx: using_strings) {
-        if (idx == this->empty_string_id) ++using_empty_string_count;
-        auto str = this->strings[idx];
-        auto hits = acTrie->ParseText(str);
-        for (auto &hit: hits) {
-            auto match_type = match_type_map->find(hit.value)->second;
-            bool match;
-            switch (match_type) {
-                case schema::StringMatchType::Contains: match = true; break;
-                case schema::StringMatchType::StartWith: match = (hit.begin == 0); break;
-                case schema::StringMatchType::EndWith: match = (hit.end == str.size()); break;
-                case schema::StringMatchType::Equal: match = (hit.begin == 0 && hit.end == str.size()); break;
-                case schema::StringMatchType::SimilarRegex: abort();
-            }
-            if (match) {
-                search_set.insert(hit.value);
-            }
-        }
-    }
-    if (match_type_map->contains("")) {
-        DEXKIT_CHECK((*match_type_map)[""] == schema::StringMatchType::Equal);
-        if (using_empty_string_count) {
-            search_set.insert("");
+        if (hits.Feed(idx, this->strings[idx], this->empty_string_id)) {
+            return true;
         }
     }
-    if (search_set.size() < real_keywords->size()) {
-        return false;
-    }
-    std::vector<std::string_view> unique_vec;
-    std::set_intersection(search_set.begin(), search_set.end(),
-                          real_keywords->begin(), real_keywords->end(),
-                          std::inserter(unique_vec, unique_vec.begin()));
-    if (unique_vec.size() != real_keywords->size()) {
-        return false;
-    }
-    return true;
+    return hits.IsAllHit();
 }
 
 bool DexItem::IsAnnotationsMatched(const ir::AnnotationSet *annotationSet, const schema::AnnotationsMatcher *matcher) {
@@ -964,7 +1059,7 @@ bool DexItem::IsClassMatched(uint32_t type_idx, const schema::ClassMatcher *matc
     if (!type_def_flag[type_idx]) {
         // try matched in declared dex
         auto &type_name = type_names[type_idx];
-        auto declared_info = dexkit->GetClassDeclaredPair(type_name);
+        auto declared_info = dexkit->GetClassDeclaredPair(type_name, this);
         if (declared_info.first) {
             return declared_info.first->IsClassMatched(declared_info.second, matcher);
         }
@@ -1028,6 +1123,14 @@ bool DexItem::IsTypeNameMatched(uint32_t type_idx, const schema::StringMatcher *
     auto type_name = this->type_names[type_idx];
     auto component_type_name = type_name.substr(type_array_count);
 
+    if (matcher->match_type() == schema::StringMatchType::Regex) {
+        // matched against the java name, primitives are named differently from their descriptor
+        if (component_type_name.size() > 1 && !IsTypeNameCandidate(type_idx, matcher)) {
+            return false;
+        }
+        return GetRegex(matcher)->Search(DescriptorToName(type_name));
+    }
+
     auto match_ptr = GetMatcherCache<std::pair<std::string_view, schema::StringMatchType>>(
             MatcherCacheScope::StringMatcherNormalized, POINT_CASE(matcher), [&]() {
                 auto match_str = matcher->value()->string_view();
@@ -1039,22 +1142,34 @@ bool DexItem::IsTypeNameMatched(uint32_t type_idx, const schema::StringMatcher *
     auto match_type = match_ptr->second;
 
     typedef std::pair<std::string, uint8_t> MatchPair;
-    auto ptr = GetMatcherCache<MatchPair>(MatcherCacheScope::TypeNameDescriptor, POINT_CASE(matcher->value()), [&]() {
-        auto array_count = 0;
-        auto find_index = match_str.find_first_of('[');
-        if (find_index != std::string_view::npos) {
-            array_count = (uint8_t) (match_str.size() - find_index) / 2;
-        }
-        auto match_name_type = match_str.substr(0, match_str.size() - array_count * 2);
-        bool start_flag = match_type == schema::StringMatchType::StartWith || match_type == schema::StringMatchType::Equal;
-        bool end_flag = match_type == schema::StringMatchType::EndWith || match_type == schema::StringMatchType::Equal;
-        auto match_name = NameToDescriptor(match_name_type, start_flag, end_flag);
-        return std::make_pair(match_name, static_cast<uint8_t>(array_count));
+    auto ptr = GetMatcherCache<std::shared_ptr<const MatchPair>>(MatcherCacheScope::TypeNameDescriptor, POINT_CASE(matcher->value()), [&]() {
+        std::string key(1, static_cast<char>(match_type));
+        key.append(match_str);
+        return internal::CompiledMatcherCache::Global().GetOrCreate<MatchPair>(
+                internal::CompiledMatcherKind::TypeNameDescriptor, key, [&]() {
+            auto array_count = 0;
+            auto find_index = match_str.find_first_of('[');
+            if (find_index != std::string_view::npos) {
+                array_count = (uint8_t) (match_str.size() - find_index) / 2;
+            }
+            auto match_name_type = match_str.substr(0, match_str.size() - array_count * 2);
+            bool start_flag = match_type == schema::StringMatchType::StartWith || match_type == schema::StringMatchType::Equal;
+            bool end_flag = match_type == schema::StringMatchType::EndWith || match_type == schema::StringMatchType::Equal;
+            auto match_name = NameToDescriptor(match_name_type, start_flag, end_flag);
+            return std::make_pair(match_name, static_cast<uint8_t>(array_count));
+        }, [](const MatchPair &pair) {
+            return pair.first.capacity();
+        });
     });
 
-    auto &match_pair = *ptr;
+    auto &match_pair = **ptr;
     auto &match_type_name = match_pair.first;
     auto &match_array_count = match_pair.second;
+
+    if (!IsTypeNameCandidate(type_idx, matcher)) {
+        return false;
+    }
+
     switch (match_type) {
         case schema::StringMatchType::StartWith:
             return kmp::starts_with(component_type_name, match_type_name, matcher->ignore_case())
@@ -1069,11 +1184,31 @@ bool DexItem::IsTypeNameMatched(uint32_t type_idx, const schema::StringMatcher *
             return kmp::FindIndex(component_type_name, match_type_name, matcher->ignore_case()) != -1
                    && match_array_count <= type_array_count;
         case schema::StringMatchType::SimilarRegex:
+        case schema::StringMatchType::Regex:
             abort();
     }
     return false;
 }
 
+bool DexItem::IsTypeNameCandidate(uint32_t type_idx, const schema::StringMatcher *matcher) {
+    auto slots = GetMatcherCache<TypeNameCandidatesSlots>(MatcherCacheScope::TypeNameCandidates, POINT_CASE(matcher), [&]() {
+        TypeNameCandidatesSlots slots;
+        slots.key = internal::GetTypeNameSearchKey(matcher);
+        auto dex_num = dexkit->GetDexNum();
+        slots.once = std::make_unique<std::once_flag[]>(dex_num);
+        slots.candidates = std::make_unique<std::shared_ptr<const internal::TypeNameCandidates>[]>(dex_num);
+        return slots;
+    });
+    if (!slots->key) {
+        return true;
+    }
+    std::call_once(slots->once[dex_id], [&]() {
+        slots->candidates[dex_id] = GetTypeNameCandidates(*slots->key);
+    });
+    auto &candidates = slots->candidates[dex_id];
+    return !candidates || candidates->mask[type_idx];
+}
+
 bool DexItem::IsClassAccessFlagsMatched(uint32_t type_idx, const schema::AccessFlagsMatcher *matcher) {
     if (matcher == nullptr) {
         return true;
@@ -1133,51 +1268,17 @@ bool DexItem::IsClassUsingStringsMatched(uint32_t type_idx, const schema::ClassM
             MatcherCacheScope::ClassUsingStringsKeywords,
             matcher->using_strings()
     );
-    auto &acTrie = keywords_cache->ac_trie;
-    auto &match_type_map = keywords_cache->match_type_map;
-    auto &real_keywords = keywords_cache->real_keywords;
 
-    auto using_empty_string_count = 0;
-    std::set<std::string_view> search_set;
+    UsingStringsKeywordsHits hits(*keywords_cache);
     for (auto method_idx: this->class_method_ids[type_idx]) {
         auto &using_strings = this->method_using_string_ids[method_idx];
         for (auto idx: using_strings) {
-            if (idx == this->empty_string_id) ++using_empty_string_count;
-            auto str = this->strings[idx];
-            auto hits = acTrie->ParseText(str);
-            for (auto &hit: hits) {
-                auto match_type = match_type_map->find(hit.value)->second;
-                bool match;
-                switch (match_type) {
-                    case schema::StringMatchType::Contains: match = true; break;
-                    case schema::StringMatchType::StartWith: match = (hit.begin == 0); break;
-                    case schema::StringMatchType::EndWith: match = (hit.end == str.size()); break;
-                    case schema::StringMatchType::Equal: match = (hit.begin == 0 && hit.end == str.size()); break;
-                    case schema::StringMatchType::SimilarRegex: abort();
-                }
-                if (match) {
-                    search_set.insert(hit.value);
-                }
+            if (hits.Feed(idx, this->strings[idx], this->empty_string_id)) {
+                return true;
             }
         }
     }
-    if (match_type_map->contains("")) {
-        DEXKIT_CHECK((*match_type_map)[""] == schema::StringMatchType::Equal);
-        if (using_empty_string_count) {
-            search_set.insert("");
-        }
-    }
-    if (search_set.size() < real_keywords->size()) {
-        return false;
-    }
-    std::vector<std::string_view> unique_vec;
-    std::set_intersection(search_set.begin(), search_set.end(),
-                          real_keywords->begin(), real_keywords->end(),
-                          std::inserter(unique_vec, unique_vec.begin()));
-    if (unique_vec.size() != real_keywords->size()) {
-        return false;
-    }
-    return true;
+    return hits.IsAllHit();
 }
 
 // NOLINTNEXTLINE
@@ -1186,6 +1287,11 @@ bool DexItem::IsSuperClassMatched(uint32_t type_idx, const schema::ClassMatcher
         return true;
     }
     auto super_class_idx = this->reader.ClassDefs()[this->type_def_idx[type_idx]].superclass_idx;
+    // the common superClass("...") form is answered from the type name of this dex, without
+    // resolving the declaring dex of the super class first
+    if (IsClassNameOnlyMatcher(matcher)) {
+        return IsTypeNameMatched(super_class_idx, matcher->class_name());
+    }
     return IsClassMatched(super_class_idx, matcher);
 }
 
@@ -1205,6 +1311,9 @@ bool DexItem::IsInterfacesMatched(uint32_t type_idx, const schema::InterfacesMat
     }
     if (matcher->interfaces()) {
         auto IsClassMatched = [this](uint32_t type_idx, const schema::ClassMatcher *matcher) {
+            if (IsClassNameOnlyMatcher(matcher)) {
+                return this->IsTypeNameMatched(type_idx, matcher->class_name());
+            }
             return this->IsClassMatched(type_idx, matcher);
         };
 
@@ -1474,27 +1583,34 @@ bool DexItem::IsOpCodesMatched(uint32_t method_idx, const schema::OpCodesMatcher
             return false;
         }
 
-        typedef std::vector<std::optional<uint8_t>> OpCodeMatcher;
-        auto ptr = GetMatcherCache<OpCodeMatcher>(MatcherCacheScope::OpCodeMatchers, POINT_CASE(matcher->op_codes()),
-                                                  [&]() {
-            auto vec = OpCodeMatcher{};
-            for (auto opcode : *matcher->op_codes()) {
-                if (opcode < 0) {
-                    vec.emplace_back(std::nullopt);
-                } else {
-                    vec.emplace_back(opcode);
+        auto ptr = GetMatcherCache<std::shared_ptr<const CompiledOpCodes>>(MatcherCacheScope::OpCodeMatchers, POINT_CASE(matcher->op_codes()),
+                                                                           [&]() {
+            auto op_codes = matcher->op_codes();
+            auto key = std::string_view(reinterpret_cast<const char *>(op_codes->data()), op_codes->size() * sizeof(int16_t));
+            return internal::CompiledMatcherCache::Global().GetOrCreate<CompiledOpCodes>(
+                    internal::CompiledMatcherKind::OpCodes, key, [&]() {
+                CompiledOpCodes compiled;
+                for (auto opcode : *op_codes) {
+                    if (opcode < 0) {
+                        compiled.pattern.emplace_back(std::nullopt);
+                    } else {
+                        compiled.pattern.emplace_back(opcode);
+                    }
                 }
-            }
-            return vec;
+                compiled.next = kmp::BuildNext(compiled.pattern);
+                return compiled;
+            }, [](const CompiledOpCodes &compiled) {
+                return compiled.pattern.capacity() * sizeof(std::optional<uint8_t>) + compiled.next.capacity() * sizeof(int);
+            });
         });
 
-        auto &matcher_opcodes = *ptr;
+        auto &matcher_opcodes = (*ptr)->pattern;
         if (matcher_opcodes.size() > op_code_size) {
             return false;
         }
 
         if (!matcher_opcodes.empty()) {
-            auto index = kmp::FindIndex(opt_opcodes.value(), matcher_opcodes);
+            auto index = kmp::FindIndex(opt_opcodes.value(), matcher_opcodes, (*ptr)->next);
             if (index == -1) {
                 return false;
             }
@@ -1541,49 +1657,15 @@ bool DexItem::IsMethodUsingStringsMatched(uint32_t method_idx, const schema::Met
             MatcherCacheScope::MethodUsingStringsKeywords,
             matcher->using_strings()
     );
-    auto &acTrie = keywords_cache->ac_trie;
-    auto &match_type_map = keywords_cache->match_type_map;
-    auto &real_keywords = keywords_cache->real_keywords;
 
-    auto using_empty_string_count = 0;
-    std::set<std::string_view> search_set;
+    UsingStringsKeywordsHits hits(*keywords_cache);
     auto &using_strings = this->method_using_string_ids[method_idx];
     for (auto idx: using_strings) {
-        if (idx == this->empty_string_id) ++using_empty_string_count;
-        auto str = this->strings[idx];
-        auto hits = acTrie->ParseText(str);
-        for (auto &hit: hits) {
-            auto match_type = match_type_map->find(hit.value)->second;
-            bool match;
-            switch (match_type) {
-                case schema::StringMatchType::Contains: match = true; break;
-                case schema::StringMatchType::StartWith: match = (hit.begin == 0); break;
-                case schema::StringMatchType::EndWith: match = (hit.end == str.size()); break;
-                case schema::StringMatchType::Equal: match = (hit.begin == 0 && hit.end == str.size()); break;
-                case schema::StringMatchType::SimilarRegex: abort();
-            }
-            if (match) {
-                search_set.insert(hit.value);
-            }
-        }
-    }
-    if (match_type_map->contains("")) {
-        DEXKIT_CHECK((*match_type_map)[""] == schema::StringMatchType::Equal);
-        if (using_empty_string_count) {
-            search_set.insert("");
+        if (hits.Feed(idx, this->strings[idx], this->empty_string_id)) {
+            return true;
         }
     }
-    if (search_set.size() < real_keywords->size()) {
-        return false;
-    }
-    std::vector<std::string_view> unique_vec;
-    std::set_intersection(search_set.begin(), search_set.end(),
-                          real_keywords->begin(), real_keywords->end(),
-                          std::inserter(unique_vec, unique_vec.begin()));
-    if (unique_vec.size() != real_keywords->size()) {
-        return false;
-    }
-    return true;
+    return hits.IsAllHit();
 }
 
 bool DexItem::IsMethodAnnotationMatched(uint32_t method_idx, const schema::AnnotationsMatcher *matcher) {
@@ -1637,60 +1719,7 @@ bool DexItem::IsUsingNumbersMatched(uint32_t method_idx, const schema::MethodMat
 
     typedef std::vector<EncodeNumber> Numbers;
     auto ptr = GetMatcherCache<Numbers>(MatcherCacheScope::UsingNumbers, POINT_CASE(matcher->using_numbers()), [&]() {
-        auto numbers = Numbers{};
-        auto types = matcher->using_numbers_type();
-        for (int i = 0; i < matcher->using_numbers()->size(); ++i) {
-            auto NumberMatcher = matcher->using_numbers()->Get(i);
-            auto type = types->Get(i);
-            EncodeNumber number{};
-            switch (type) {
-                case schema::Number::EncodeValueByte: {
-                    number = EncodeNumber{
-                            .type = BYTE,
-                            .value = {.L8 = matcher->using_numbers()->GetAs<schema::EncodeValueByte>(i)->value()}
-                    };
-                    break;
-                }
-                case schema::Number::EncodeValueShort: {
-                    number = EncodeNumber{
-                            .type = SHORT,
-                            .value = {.L16 = matcher->using_numbers()->GetAs<schema::EncodeValueShort>(i)->value()}
-                    };
-                    break;
-                }
-                case schema::Number::EncodeValueInt: {
-                    number = EncodeNumber{
-                            .type = INT,
-                            .value = {.L32 = {.int_value = matcher->using_numbers()->GetAs<schema::EncodeValueInt>(i)->value()}}
-                    };
-                    break;
-                }
-                case schema::Number::EncodeValueLong: {
-                    number = EncodeNumber{
-                            .type = LONG,
-                            .value = {.L64 = {.long_value = matcher->using_numbers()->GetAs<schema::EncodeValueLong>(i)->value()}}
-                    };
-                    break;
-                }
-                case schema::Number::EncodeValueFloat: {
-                    number = EncodeNumber{
-                            .type = FLOAT,
-                            .value = {.L32 = {.float_value = matcher->using_numbers()->GetAs<schema::EncodeValueFloat>(i)->value()}}
-                    };
-                    break;
-                }
-                case schema::Number::EncodeValueDouble: {
-                    number = EncodeNumber{
-                            .type = DOUBLE,
-                            .value = {.L64 = {.double_value = matcher->using_numbers()->GetAs<schema::EncodeValueDouble>(i)->value()}}
-                    };
-                    break;
-                }
-                default: abort();
-            }
-            numbers.push_back(number);
-        }
-        return numbers;
+        return internal::GetMatcherNumbers(matcher);
     });
 
     auto IsNumberMatched = [](EncodeNumber number, EncodeNumber matcher) {
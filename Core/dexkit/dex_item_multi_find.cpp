@@ -0,0 +1,159 @@
+// DexKit - An high-performance runtime parsing library for dex
+// implemented in C++.
+// Copyright (C) 2022-2023 LuckyPray
+// https://github.com/LuckyPray/DexKit
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+// <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+
+
+#include "dex_item.h"
+#include "internal/package_filter.h"
+#include "internal/using_strings_prefilter.h"
+
+namespace dexkit {
+
+std::vector<std::future<std::vector<std::vector<uint32_t>>>>
+DexItem::MultiFindClass(
+        std::vector<const schema::FindClass *> queries,
+        std::vector<const internal::PackageFilter *> package_filters,
+        IQueryExecutor &executor,
+        uint32_t slice_size,
+        QueryContext &query_context
+) {
+    std::vector<std::future<std::vector<std::vector<uint32_t>>>> futures;
+    auto shared_queries = std::make_shared<const std::vector<const schema::FindClass *>>(std::move(queries));
+    auto shared_filters = std::make_shared<const std::vector<const internal::PackageFilter *>>(std::move(package_filters));
+    uint32_t item_count = this->reader.ClassDefs().size();
+    if (slice_size == 0) {
+        slice_size = std::max<uint32_t>(item_count, 1);
+    }
+    uint32_t split_count = (item_count + slice_size - 1) / slice_size;
+    QueryTaskBatch batch(executor);
+    futures.reserve(split_count);
+    batch.Reserve(split_count);
+    for (uint32_t i = 0; i < split_count; ++i) {
+        query_context.MarkTaskSubmitted();
+        futures.emplace_back(batch.Add(
+                [this, shared_queries, shared_filters, i, slice_size, item_count, &query_context] {
+                    auto task_scope = query_context.TrackTaskExecution();
+                    auto result = MultiFindClass(*shared_queries, *shared_filters, i * slice_size,
+                                                 std::min((i + 1) * slice_size, item_count), query_context);
+                    query_context.MarkTaskCompleted();
+                    return result;
+                }
+        ));
+    }
+    batch.Submit();
+    return futures;
+}
+
+std::vector<std::future<std::vector<std::vector<uint32_t>>>>
+DexItem::MultiFindMethod(
+        std::vector<const schema::FindMethod *> queries,
+        std::vector<const internal::PackageFilter *> package_filters,
+        IQueryExecutor &executor,
+        uint32_t slice_size,
+        QueryContext &query_context
+) {
+    std::vector<std::future<std::vector<std::vector<uint32_t>>>> futures;
+    auto shared_queries = std::make_shared<const std::vector<const schema::FindMethod *>>(std::move(queries));
+    auto shared_filters = std::make_shared<const std::vector<const internal::PackageFilter *>>(std::move(package_filters));
+    uint32_t item_count = this->reader.MethodIds().size();
+    if (slice_size == 0) {
+        slice_size = std::max<uint32_t>(item_count, 1);
+    }
+    uint32_t split_count = (item_count + slice_size - 1) / slice_size;
+    QueryTaskBatch batch(executor);
+    futures.reserve(split_count);
+    batch.Reserve(split_count);
+    for (uint32_t i = 0; i < split_count; ++i) {
+        query_context.MarkTaskSubmitted();
+        futures.emplace_back(batch.Add(
+                [this, shared_queries, shared_filters, i, slice_size, item_count, &query_context] {
+                    auto task_scope = query_context.TrackTaskExecution();
+                    auto result = MultiFindMethod(*shared_queries, *shared_filters, i * slice_size,
+                                                  std::min((i + 1) * slice_size, item_count), query_context);
+                    query_context.MarkTaskCompleted();
+                    return result;
+                }
+        ));
+    }
+    batch.Submit();
+    return futures;
+}
+
+std::vector<std::vector<uint32_t>>
+DexItem::MultiFindClass(
+        const std::vector<const schema::FindClass *> &queries,
+        const std::vector<const internal::PackageFilter *> &package_filters,
+        uint32_t start,
+        uint32_t end,
+        QueryContext &query_context
+) {
+    auto query_binding = query_context.BindToCurrentThread();
+    auto query_count = queries.size();
+    std::vector<std::shared_ptr<const internal::PackageTypeMask>> package_masks(query_count);
+    std::vector<internal::UsingStringsPrefilterPlan *> prefilter_plans(query_count);
+    for (size_t q = 0; q < query_count; ++q) {
+        package_masks[q] = GetPackageTypeMask(*package_filters[q]);
+        prefilter_plans[q] = internal::GetClassUsingStringsPrefilterPlan(queries[q]->matcher(), query_context);
+    }
+
+    std::vector<std::vector<uint32_t>> find_results(query_count);
+    for (auto i = start; i < end; ++i) {
+        auto type_idx = this->reader.ClassDefs()[i].class_idx;
+        for (size_t q = 0; q < query_count; ++q) {
+            if (package_masks[q] && !package_masks[q]->Test(type_idx)) continue;
+            if (prefilter_plans[q] && !MayMatchClassUsingStringsPrefilter(type_idx, *prefilter_plans[q])) continue;
+            if (!IsClassMatched(type_idx, queries[q]->matcher())) continue;
+            find_results[q].emplace_back(type_idx);
+        }
+    }
+    return find_results;
+}
+
+std::vector<std::vector<uint32_t>>
+DexItem::MultiFindMethod(
+        const std::vector<const schema::FindMethod *> &queries,
+        const std::vector<const internal::PackageFilter *> &package_filters,
+        uint32_t start,
+        uint32_t end,
+        QueryContext &query_context
+) {
+    auto query_binding = query_context.BindToCurrentThread();
+    auto query_count = queries.size();
+    std::vector<std::shared_ptr<const internal::PackageTypeMask>> package_masks(query_count);
+    std::vector<internal::UsingStringsPrefilterPlan *> prefilter_plans(query_count);
+    for (size_t q = 0; q < query_count; ++q) {
+        package_masks[q] = GetPackageTypeMask(*package_filters[q]);
+        prefilter_plans[q] = internal::GetMethodUsingStringsPrefilterPlan(queries[q]->matcher(), query_context);
+    }
+
+    std::vector<std::vector<uint32_t>> find_results(query_count);
+    for (auto method_idx = start; method_idx < end; ++method_idx) {
+        auto class_idx = this->reader.MethodIds()[method_idx].class_idx;
+        if (!this->type_def_flag[class_idx]) continue;
+        for (size_t q = 0; q < query_count; ++q) {
+            if (package_masks[q] && !package_masks[q]->Test(class_idx)) continue;
+            if (prefilter_plans[q] && !MayMatchMethodUsingStringsPrefilter(method_idx, *prefilter_plans[q])) continue;
+            if (!IsMethodMatched(method_idx, queries[q]->matcher())) continue;
+            find_results[q].emplace_back(method_idx);
+        }
+    }
+    return find_results;
+}
+
+} // namespace dexkit
@@ -0,0 +1,181 @@
+// DexKit - An high-performance runtime parsing library for dex
+// implemented in C++.
+// Copyright (C) 2022-2023 LuckyPray
+// https://github.com/LuckyPray/DexKit
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+// <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+
+
+#include "dex_verifier.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <zlib.h>
+
+#include "slicer/dex_format.h"
+
+namespace dexkit {
+
+namespace {
+
+// large enough that the per-task overhead stays negligible next to the hashing
+constexpr size_t kChecksumChunkSize = 1 << 20;
+constexpr size_t kChecksumSkipSize = sizeof(dex::Header::magic) + sizeof(dex::Header::checksum);
+
+inline bool InRange(uint64_t off, uint64_t size, uint64_t limit) {
+    return off <= limit && size <= limit - off;
+}
+
+inline bool CheckSection(uint32_t count, uint32_t off, size_t item_size, size_t limit) {
+    if (count == 0) {
+        return true;
+    }
+    return off >= dex::Header::kV40Size && off % 4 == 0 && InRange(off, uint64_t(count) * item_size, limit);
+}
+
+struct ChecksumChunk {
+    size_t item_index;
+    const uint8_t *data;
+    size_t len;
+    uLong adler;
+};
+
+} // namespace
+
+bool VerifyDexHeader(const uint8_t *image, size_t image_len, uint32_t offset) {
+    if (!image || !InRange(offset, dex::Header::kV40Size, image_len)) {
+        return false;
+    }
+    auto header = reinterpret_cast<const dex::Header *>(image + offset);
+    auto version = dex::Header::GetVersion(header->magic);
+    if (memcmp(header->magic, "dex\n", 4) != 0
+        || version < dex::Header::kMinVersion || version > dex::Header::kMaxVersion) {
+        return false;
+    }
+    if (header->header_size != dex::Header::kV40Size && header->header_size != dex::Header::kV41Size) {
+        return false;
+    }
+    if (header->endian_tag != dex::kEndianConstant
+        || header->file_size < header->header_size
+        || !InRange(offset, header->file_size, image_len)
+        || !InRange(offset, header->header_size, image_len)) {
+        return false;
+    }
+    // offsets are relative to the container when this dex is part of a multi-dex container
+    auto container_off = header->ContainerOff();
+    auto container_size = header->ContainerSize();
+    if (container_off > offset || !InRange(offset - container_off, container_size, image_len)
+        || !InRange(container_off, header->file_size, container_size)) {
+        return false;
+    }
+    auto base = image + offset - container_off;
+    if (header->link_size != 0 || header->link_off != 0
+        || header->data_off % 4 != 0 || header->data_size % 4 != 0
+        || header->type_ids_size >= 65536 || header->proto_ids_size >= 65536) {
+        return false;
+    }
+    if (!CheckSection(header->string_ids_size, header->string_ids_off, sizeof(dex::StringId), container_size)
+        || !CheckSection(header->type_ids_size, header->type_ids_off, sizeof(dex::TypeId), container_size)
+        || !CheckSection(header->proto_ids_size, header->proto_ids_off, sizeof(dex::ProtoId), container_size)
+        || !CheckSection(header->field_ids_size, header->field_ids_off, sizeof(dex::FieldId), container_size)
+        || !CheckSection(header->method_ids_size, header->method_ids_off, sizeof(dex::MethodId), container_size)
+        || !CheckSection(header->class_defs_size, header->class_defs_off, sizeof(dex::ClassDef), container_size)) {
+        return false;
+    }
+    // data_off + data_size is not checked, same as slicer, some dex files in the wild have it slightly off
+    if (header->map_off < header->data_off || header->map_off % 4 != 0
+        || !InRange(header->map_off, sizeof(dex::u4), container_size)) {
+        return false;
+    }
+    auto map_list = reinterpret_cast<const dex::MapList *>(base + header->map_off);
+    if (map_list->size == 0
+        || !InRange(header->map_off + sizeof(dex::u4), uint64_t(map_list->size) * sizeof(dex::MapItem), container_size)) {
+        return false;
+    }
+    bool has_map_list = false;
+    uint32_t last_offset = 0;
+    for (uint32_t i = 0; i < map_list->size; ++i) {
+        auto &item = map_list->list[i];
+        if (item.offset < last_offset || item.offset >= container_size) {
+            return false;
+        }
+        last_offset = item.offset;
+        if (item.type == dex::kMapList) {
+            has_map_list = item.offset == header->map_off;
+        }
+    }
+    return has_map_list;
+}
+
+std::vector<DexVerifyResult> VerifyDexImages(
+        const std::vector<std::pair<std::shared_ptr<MemMap>, uint32_t>> &items,
+        ThreadPool &pool
+) {
+    std::vector<DexVerifyResult> results(items.size());
+    std::vector<ChecksumChunk> chunks;
+    for (size_t i = 0; i < items.size(); ++i) {
+        auto &[image, offset] = items[i];
+        if (!image || !VerifyDexHeader(image->data(), image->len(), offset)) {
+            continue;
+        }
+        results[i].valid = true;
+        auto header = reinterpret_cast<const dex::Header *>(image->data() + offset);
+        auto data = image->data() + offset + kChecksumSkipSize;
+        auto remaining = header->file_size - kChecksumSkipSize;
+        do {
+            auto len = std::min(remaining, kChecksumChunkSize);
+            chunks.push_back({i, data, len, 0});
+            data += len;
+            remaining -= len;
+        } while (remaining > 0);
+    }
+    if (chunks.size() == 1) {
+        auto &chunk = chunks.front();
+        chunk.adler = adler32(adler32(0L, Z_NULL, 0), chunk.data, chunk.len);
+    } else if (!chunks.empty()) {
+        std::vector<std::future<void>> futures;
+        futures.reserve(chunks.size());
+        for (auto &chunk: chunks) {
+            futures.emplace_back(pool.enqueue_priority([&chunk]() {
+                chunk.adler = adler32(adler32(0L, Z_NULL, 0), chunk.data, chunk.len);
+            }));
+        }
+        for (auto &future: futures) {
+            future.get();
+        }
+    }
+
+    // chunks of one item are contiguous and in order
+    for (size_t i = 0; i < chunks.size();) {
+        auto item_index = chunks[i].item_index;
+        auto adler = chunks[i].adler;
+        for (++i; i < chunks.size() && chunks[i].item_index == item_index; ++i) {
+            adler = adler32_combine(adler, chunks[i].adler, static_cast<z_off_t>(chunks[i].len));
+        }
+        auto &[image, offset] = items[item_index];
+        auto header = reinterpret_cast<const dex::Header *>(image->data() + offset);
+        results[item_index].checksum = static_cast<uint32_t>(adler);
+        // the checksum of a dex inside a container is not defined over file_size alone, only
+        // standalone dex files are compared against the header
+        if (header->ContainerSize() == header->file_size && header->checksum != results[item_index].checksum) {
+            results[item_index].valid = false;
+        }
+    }
+    return results;
+}
+
+} // namespace dexkit
@@ -24,6 +24,14 @@
 #include <algorithm>
 
 #include "zip_archive.h"
+#include "dex_verifier.h"
+#include "internal/batch_using_strings.h"
+#include "internal/class_hierarchy.h"
+#include "internal/id_set.h"
+#include "internal/package_filter.h"
+#include "internal/query_cache.h"
+#include "internal/reference_seed.h"
+#include "internal/result_serializer.h"
 #include "ThreadPool.h"
 #include "schema/querys_generated.h"
 #include "schema/results_generated.h"
@@ -65,6 +73,14 @@ static bool ConfigureFindFirstQuery(QueryContext &query_context, const QueryType
     return true;
 }
 
+static void ApplySchedulingOptions(QueryContext &query_context, const QueryOptions &options) {
+    if (options.priority.has_value()) {
+        query_context.SetQueryPriority(*options.priority);
+    }
+    query_context.SetQueryWeight(options.weight);
+    query_context.SetSlicePolicy(options.slice_policy);
+}
+
 static std::string NormalizeDeclaredClassLookupName(std::string_view class_name) {
     if (class_name.empty()) {
         return {};
@@ -75,6 +91,35 @@ static std::string NormalizeDeclaredClassLookupName(std::string_view class_name)
     return NameToDescriptor(class_name);
 }
 
+static bool HasDeclaredClassLookup(const schema::StringMatcher *class_name) {
+    return class_name && class_name->match_type() == schema::StringMatchType::Equal && !class_name->ignore_case();
+}
+
+// queries that Find* resolves without a full scan, or that are scoped to their own sources,
+// MultiFind* runs them on their own
+static bool HasDedicatedFindPath(const schema::FindClass *query) {
+    if (query->in_classes() || query->find_first() || query->source_ids()) {
+        return true;
+    }
+    auto matcher = query->matcher();
+    if (!internal::GetClassHierarchySeeds(matcher).empty()) {
+        return true;
+    }
+    return matcher && !HasComposite(matcher) && HasDeclaredClassLookup(matcher->class_name());
+}
+
+static bool HasDedicatedFindPath(const schema::FindMethod *query) {
+    if (query->in_classes() || query->in_methods() || query->find_first() || query->source_ids()) {
+        return true;
+    }
+    auto matcher = query->matcher();
+    if (AnalyzeMethodSeedFlags(matcher) != 0 || !internal::GetReferenceSeeds(matcher).empty()) {
+        return true;
+    }
+    return matcher && !HasComposite(matcher) && matcher->declaring_class()
+           && HasDeclaredClassLookup(matcher->declaring_class()->class_name());
+}
+
 static bool HasCompositeBatchUsingStringsMatchers(
         const flatbuffers::Vector<flatbuffers::Offset<schema::BatchUsingStringsMatcher>> *matchers
 ) {
@@ -87,7 +132,9 @@ static bool HasCompositeBatchUsingStringsMatchers(
             continue;
         }
         for (int j = 0; j < using_strings->size(); ++j) {
-            if (HasComposite(using_strings->Get(j))) {
+            // regex matchers have no keyword for the trie either
+            auto string_matcher = using_strings->Get(j);
+            if (HasComposite(string_matcher) || string_matcher->match_type() == schema::StringMatchType::Regex) {
                 return true;
             }
         }
@@ -95,21 +142,63 @@ static bool HasCompositeBatchUsingStringsMatchers(
     return false;
 }
 
+// first wave of a batch using-strings query: every dex in scope scans its string table in slices,
+// the slices of one dex are merged back in string order before the type slices are submitted
+static std::vector<internal::BatchStringHitMasks> ScanBatchStringHitMasks(
+        const std::vector<std::unique_ptr<DexItem>> &dex_items,
+        const std::vector<bool> &dex_scope,
+        acdat::AhoCorasickDoubleArrayTrie<std::string_view> &acTrie,
+        const internal::BatchUsingStringsPlan &plan,
+        IQueryExecutor &executor,
+        QueryContext &query_context
+) {
+    std::vector<internal::BatchStringHitMasks> dex_hit_masks(dex_items.size());
+    if (plan.empty()) {
+        return dex_hit_masks;
+    }
+    std::vector<std::vector<std::future<internal::BatchStringHitMasks>>> dex_futures(dex_items.size());
+    for (size_t i = 0; i < dex_items.size(); ++i) {
+        if (!dex_scope.empty() && !dex_scope[dex_items[i]->GetDexId()]) continue;
+        dex_futures[i] = dex_items[i]->ScanBatchStringHitMasks(acTrie, plan, executor, BATCH_SIZE * 4, query_context);
+    }
+    executor.OnSubmissionComplete();
+    for (size_t i = 0; i < dex_items.size(); ++i) {
+        if (dex_futures[i].empty()) continue;
+        std::vector<internal::BatchStringHitMasks> parts;
+        parts.reserve(dex_futures[i].size());
+        for (auto &f: dex_futures[i]) {
+            parts.emplace_back(f.get());
+        }
+        dex_hit_masks[i] = internal::MergeBatchStringHitMasks(std::move(parts));
+    }
+    return dex_hit_masks;
+}
+
 DexKit::QueryExecutionGuard::~QueryExecutionGuard() {
     if (owner_ != nullptr) {
         owner_->LeaveQueryExecution();
     }
 }
 
-DexKit::DexKit(std::string_view apk_path, int unzip_thread_num) {
+DexKit::DexKit() : query_result_cache_(std::make_unique<internal::QueryResultCache>()) {}
+
+DexKit::DexKit(std::string_view apk_path, int unzip_thread_num)
+        : query_result_cache_(std::make_unique<internal::QueryResultCache>()) {
     if (unzip_thread_num > 0) {
         _thread_num.store(NormalizeThreadNum(static_cast<uint32_t>(unzip_thread_num)), std::memory_order_release);
     }
     std::lock_guard lock(_mutex);
-    AddZipPath(apk_path, unzip_thread_num);
+    AddZipPath(apk_path);
     std::sort(dex_items.begin(), dex_items.end(), comp);
 }
 
+DexKit::~DexKit() {
+    std::lock_guard lock(string_index_mutex_);
+    if (string_index_build_.valid()) {
+        string_index_build_.wait();
+    }
+}
+
 void DexKit::SetThreadNum(int num) {
     auto thread_num = NormalizeThreadNum(num > 0 ? static_cast<uint32_t>(num) : 1U);
     _thread_num.store(thread_num, std::memory_order_release);
@@ -124,6 +213,45 @@ void DexKit::SetMaxConcurrentQueries(uint32_t max_concurrent_queries) {
     query_execution_cv.notify_all();
 }
 
+void DexKit::SetDexVerifyEnabled(bool enabled) {
+    dex_verify_enabled_.store(enabled, std::memory_order_release);
+}
+
+bool DexKit::IsDexVerifyEnabled() const {
+    return dex_verify_enabled_.load(std::memory_order_acquire);
+}
+
+void DexKit::SetQueryIndexEnabled(bool enabled) {
+    query_index_enabled_.store(enabled, std::memory_order_release);
+}
+
+bool DexKit::IsQueryIndexEnabled() const {
+    return query_index_enabled_.load(std::memory_order_acquire);
+}
+
+void DexKit::SetQueryResultCacheCapacity(size_t capacity_bytes) {
+    query_result_cache_->SetCapacity(capacity_bytes);
+}
+
+void DexKit::ClearQueryResultCache() {
+    query_result_cache_->Clear();
+}
+
+Error DexKit::SaveQueryResultCache(std::string_view path) {
+    auto execution_guard = EnterQueryExecution(0);
+    return query_result_cache_->Save(path, BuildQueryCacheFingerprint());
+}
+
+Error DexKit::LoadQueryResultCache(std::string_view path) {
+    auto execution_guard = EnterQueryExecution(0);
+    std::vector<internal::CachedDexBounds> dex_bounds;
+    dex_bounds.reserve(dex_items.size());
+    for (auto &dex_item: dex_items) {
+        dex_bounds.push_back({dex_item->GetTypeIdCount(), dex_item->GetMethodIdCount(), dex_item->GetFieldIdCount()});
+    }
+    return query_result_cache_->Load(path, BuildQueryCacheFingerprint(), dex_bounds);
+}
+
 #if DEXKIT_ENABLE_INTERNAL_METRICS
 void DexKit::SetQueryMetricsEnabled(bool enabled) {
     query_metrics_enabled_.store(enabled, std::memory_order_release);
@@ -170,10 +298,48 @@ void DexKit::ResetQueryMetricsHistory() {
 #endif
 
 Error DexKit::InitFullCache() {
-    auto execution_guard = EnterQueryExecution(UINT32_MAX);
+    auto execution_guard = EnterQueryExecution(UINT32_MAX & ~kStringIndex);
     return Error::SUCCESS;
 }
 
+Error DexKit::BuildStringIndex(bool background) {
+    if (!background) {
+        auto execution_guard = EnterQueryExecution(kStringIndex);
+        return Error::SUCCESS;
+    }
+    std::lock_guard lock(string_index_mutex_);
+    if (string_index_build_.valid()
+        && string_index_build_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return Error::SUCCESS;
+    }
+    // not on the shared pool: a warm up or AddDex waiting for pool tasks would starve behind it
+    string_index_build_ = std::async(std::launch::async, [this]() {
+        // one dex per execution, a pending warm up or AddDex only waits for a single build
+        for (size_t i = 0;; ++i) {
+            auto execution_guard = EnterQueryExecution(0);
+            if (i >= dex_items.size()) {
+                break;
+            }
+            auto dex_item = dex_items[i].get();
+            auto claimed_flags = dex_item->BeginInitCache(kStringIndex);
+            if (claimed_flags != 0) {
+                dex_item->InitCache(claimed_flags);
+                dex_item->FinishInitCache(claimed_flags);
+            }
+        }
+    });
+    return Error::SUCCESS;
+}
+
+size_t DexKit::GetStringIndexMemoryUsage() {
+    auto execution_guard = EnterQueryExecution(0);
+    size_t usage = 0;
+    for (auto &dex_item: dex_items) {
+        usage += dex_item->GetStringIndexMemoryUsage();
+    }
+    return usage;
+}
+
 DexKit::QueryExecutionGuard DexKit::EnterQueryExecution(uint32_t required_flags) {
     std::unique_lock lock(query_execution_mutex);
     uint64_t shared_pool_admission_ticket = 0;
@@ -360,20 +526,32 @@ std::unique_ptr<IQueryExecutor> DexKit::CreateQueryExecutor(QueryContext &query_
             query_context.GetQueryId(),
             query_context,
             query_context.GetQueryPriority(),
+            query_context.GetQueryWeight(),
             std::move(should_skip_task)
     );
 }
 
-std::shared_ptr<QueryScheduler> DexKit::GetOrCreateSharedQueryScheduler(uint32_t thread_num) const {
-    auto normalized_thread_num = NormalizeThreadNum(thread_num);
+std::shared_ptr<ThreadPool> DexKit::GetOrCreateSharedThreadPool() const {
+    auto normalized_thread_num = NormalizeThreadNum(_thread_num.load(std::memory_order_acquire));
     std::lock_guard lock(query_executor_mutex);
+    return GetOrCreateSharedThreadPoolLocked(normalized_thread_num);
+}
+
+std::shared_ptr<ThreadPool> DexKit::GetOrCreateSharedThreadPoolLocked(uint32_t normalized_thread_num) const {
     if (!shared_query_pool_ || shared_query_pool_thread_num_ != normalized_thread_num) {
         shared_query_scheduler_.reset();
         shared_query_pool_ = std::make_shared<ThreadPool>(normalized_thread_num);
         shared_query_pool_thread_num_ = normalized_thread_num;
     }
+    return shared_query_pool_;
+}
+
+std::shared_ptr<QueryScheduler> DexKit::GetOrCreateSharedQueryScheduler(uint32_t thread_num) const {
+    auto normalized_thread_num = NormalizeThreadNum(thread_num);
+    std::lock_guard lock(query_executor_mutex);
+    auto pool = GetOrCreateSharedThreadPoolLocked(normalized_thread_num);
     if (!shared_query_scheduler_) {
-        shared_query_scheduler_ = std::make_shared<QueryScheduler>(shared_query_pool_, normalized_thread_num);
+        shared_query_scheduler_ = std::make_shared<QueryScheduler>(std::move(pool), normalized_thread_num);
     }
     return shared_query_scheduler_;
 }
@@ -397,24 +575,202 @@ static inline std::vector<uint32_t> ParseLogicalDexOffsets(const std::shared_ptr
     return offs;
 }
 
+static inline std::string_view GetDexImageKey(const std::shared_ptr<MemMap> &image, uint32_t offset) {
+    const auto header = reinterpret_cast<const dex::Header *>(image->data() + offset);
+    // checksum, signature and file_size are contiguous in the header
+    auto begin = reinterpret_cast<const char *>(&header->checksum);
+    auto end = reinterpret_cast<const char *>(&header->file_size) + sizeof(header->file_size);
+    return {begin, static_cast<size_t>(end - begin)};
+}
+
+static inline std::string_view GetDexImageData(const MemMap &image, uint32_t offset) {
+    const auto header = reinterpret_cast<const dex::Header *>(image.data() + offset);
+    return {reinterpret_cast<const char *>(header), header->file_size};
+}
+
+Error DexKit::AddSource(std::vector<std::pair<std::shared_ptr<MemMap>, uint32_t>> &add_items, size_t image_begin) {
+    auto ret = Error::SUCCESS;
+    // verified before dedup so that header keys of accepted images can be trusted
+    std::vector<DexVerifyResult> verify_results;
+    if (dex_verify_enabled_.load(std::memory_order_acquire)) {
+        verify_results = VerifyDexImages(add_items, *GetOrCreateSharedThreadPool());
+    }
+    BeginExclusiveUpdate();
+    auto source_id = static_cast<uint32_t>(source_dex_ids.size());
+    auto &source = source_dex_ids.emplace_back();
+    const auto old_item_size = dex_items.size();
+    std::vector<std::pair<std::shared_ptr<MemMap>, uint32_t>> new_items;
+    std::vector<uint32_t> new_item_checksums;
+    for (size_t i = 0; i < add_items.size(); ++i) {
+        auto &[image, offset] = add_items[i];
+        if (!verify_results.empty() && !verify_results[i].valid) {
+            ret = Error::DEX_VERIFY_FAILED;
+            continue;
+        }
+        // header bytes are not checked unless verification is on, dumped dex files often carry
+        // zeroed or stale ones, so equal keys only dedup images with equal content
+        auto data = GetDexImageData(*image, offset);
+        auto &candidates = dex_image_dedup_map[GetDexImageKey(image, offset)];
+        auto candidate = std::find_if(candidates.begin(), candidates.end(), [&](uint16_t id) {
+            return id < old_item_size
+                   ? dex_items[id]->GetImageData() == data
+                   : GetDexImageData(*new_items[id - old_item_size].first, new_items[id - old_item_size].second) == data;
+        });
+        auto inserted = candidate == candidates.end();
+        auto dex_id = inserted ? static_cast<uint16_t>(old_item_size + new_items.size()) : *candidate;
+        if (inserted) {
+            candidates.emplace_back(dex_id);
+        }
+        if (std::find(source.begin(), source.end(), dex_id) != source.end()) {
+            continue;
+        }
+        source.emplace_back(dex_id);
+        if (inserted) {
+            new_items.emplace_back(image, offset);
+            if (!verify_results.empty()) {
+                new_item_checksums.emplace_back(verify_results[i].checksum);
+            }
+        } else {
+            dex_items[dex_id]->source_ids.emplace_back(source_id);
+        }
+    }
+    dex_items.resize(old_item_size + new_items.size());
+    if (new_items.size() == 1) {
+        auto &[image, offset] = new_items.front();
+        dex_items[old_item_size] = std::make_unique<DexItem>(old_item_size, image, offset, this);
+    } else if (!new_items.empty()) {
+        auto pool = GetOrCreateSharedThreadPool();
+        std::vector<std::future<void>> futures;
+        futures.reserve(new_items.size());
+        auto index = old_item_size;
+        for (auto &[image, offset]: new_items) {
+            futures.emplace_back(pool->enqueue_priority([this, &image, index, offset]() {
+                dex_items[index] = std::make_unique<DexItem>(index, image, offset, this);
+            }));
+            index++;
+        }
+        for (auto &future: futures) {
+            future.get();
+        }
+    }
+    for (auto i = old_item_size; i < dex_items.size(); ++i) {
+        dex_items[i]->source_ids.emplace_back(source_id);
+        if (!new_item_checksums.empty()) {
+            dex_items[i]->verified = true;
+            dex_items[i]->computed_checksum = new_item_checksums[i - old_item_size];
+        }
+    }
+    dex_cnt += new_items.size();
+    // cached keys name source ids, a source made only of already loaded dex files still changes
+    // what a scoped query (or one that named the source before it existed) returns
+    query_result_cache_->Clear();
+    if (!new_items.empty()) {
+        std::lock_guard hierarchy_lock(class_hierarchy_mutex_);
+        class_hierarchy_.reset();
+    }
+    WarmUpAddedDexItems(old_item_size);
+
+    // release images that only contain already loaded dex files
+    std::erase_if(images, [&, index = size_t(0)](const std::shared_ptr<MemMap> &image) mutable {
+        if (index++ < image_begin) {
+            return false;
+        }
+        return std::none_of(new_items.begin(), new_items.end(), [&image](const auto &item) {
+            return item.first == image;
+        });
+    });
+    FinishExclusiveUpdate();
+    return ret;
+}
+
+void DexKit::BeginExclusiveUpdate() {
+    std::unique_lock lock(query_execution_mutex);
+    query_execution_cv.wait(lock, [this] {
+        return !warmup_inflight && active_query_count == 0;
+    });
+    warmup_inflight = true;
+}
+
+void DexKit::FinishExclusiveUpdate() {
+    std::lock_guard lock(query_execution_mutex);
+    warmup_inflight = false;
+    query_execution_cv.notify_all();
+}
+
+void DexKit::WarmUpAddedDexItems(size_t first_added_dex_id) {
+    if (first_added_dex_id == 0 || first_added_dex_id >= dex_items.size()) {
+        return;
+    }
+    // bring the new dex items to the level every existing item already has
+    auto ready_flags = UINT32_MAX;
+    for (size_t i = 0; i < first_added_dex_id; ++i) {
+        ready_flags &= dex_items[i]->dex_flag.load(std::memory_order_acquire);
+    }
+    if (ready_flags == 0) {
+        return;
+    }
+    auto cross_ref_flags = cross_ref_aggregate_flag.load(std::memory_order_acquire) & ready_flags;
+    auto pool = GetOrCreateSharedThreadPool();
+    std::vector<std::future<void>> futures;
+    futures.reserve(dex_items.size());
+    for (auto i = first_added_dex_id; i < dex_items.size(); ++i) {
+        futures.emplace_back(pool->enqueue_priority([dex_item = dex_items[i].get(), ready_flags]() {
+            auto claimed_flags = dex_item->BeginInitCache(ready_flags);
+            if (claimed_flags != 0) {
+                dex_item->InitCache(claimed_flags);
+                dex_item->FinishInitCache(claimed_flags);
+            }
+        }));
+    }
+    for (auto &future: futures) {
+        future.get();
+    }
+    futures.clear();
+    if (cross_ref_flags == 0) {
+        return;
+    }
+
+    // new items link every external reference, existing items only retry the references
+    // that were unresolved so far; both only queue aggregate work for the new edges
+    for (auto &item: dex_items) {
+        futures.emplace_back(pool->enqueue_priority([dex_item = item.get(), cross_ref_flags]() {
+            auto claimed_flags = dex_item->BeginPutCrossRef(cross_ref_flags);
+            if (claimed_flags != 0) {
+                dex_item->PutCrossRef(claimed_flags);
+                dex_item->FinishPutCrossRef(claimed_flags);
+            } else {
+                dex_item->PutCrossRef(cross_ref_flags);
+            }
+        }));
+    }
+    for (auto &future: futures) {
+        future.get();
+    }
+    BuildCrossRefAggregates(cross_ref_flags);
+}
+
 Error DexKit::AddDex(uint8_t *data, size_t size) {
     std::lock_guard lock(_mutex);
     auto image = std::make_shared<MemMap>(data, size);
+    const auto old_size = images.size();
     images.emplace_back(image);
+    std::vector<std::pair<std::shared_ptr<MemMap>, uint32_t>> add_items;
     for (auto off : ParseLogicalDexOffsets(image)) {
-        dex_items.emplace_back(std::make_unique<DexItem>(dex_cnt++, image, off, this));
+        add_items.emplace_back(image, off);
     }
-    return Error::SUCCESS;
+    return AddSource(add_items, old_size);
 }
 
 Error DexKit::AddImage(std::unique_ptr<MemMap> dex_image) {
     std::lock_guard lock(_mutex);
     std::shared_ptr<MemMap> image = std::move(dex_image);
+    const auto old_size = images.size();
     images.emplace_back(image);
+    std::vector<std::pair<std::shared_ptr<MemMap>, uint32_t>> add_items;
     for (auto off : ParseLogicalDexOffsets(image)) {
-        dex_items.emplace_back(std::make_unique<DexItem>(dex_cnt++, image, off, this));
+        add_items.emplace_back(image, off);
     }
-    return Error::SUCCESS;
+    return AddSource(add_items, old_size);
 }
 
 Error DexKit::AddImage(std::vector<std::unique_ptr<MemMap>> dex_images) {
@@ -429,20 +785,7 @@ Error DexKit::AddImage(std::vector<std::unique_ptr<MemMap>> dex_images) {
             add_items.emplace_back(images[i], off);
         }
     }
-    const auto old_item_size = dex_items.size();
-    dex_items.resize(old_item_size + add_items.size());
-    {
-        ThreadPool pool(NormalizeThreadNum(_thread_num.load(std::memory_order_acquire)));
-        auto index = old_item_size;
-        for (auto &[image, offset]: add_items) {
-            pool.enqueue([this, &image, index, offset]() {
-                dex_items[index] = std::make_unique<DexItem>(index, std::move(image), offset, this);
-            });
-            index++;
-        }
-    }
-    dex_cnt += add_items.size();
-    return Error::SUCCESS;
+    return AddSource(add_items, old_size);
 }
 
 Error DexKit::AddZipPath(std::string_view apk_path, int unzip_thread_num) {
@@ -465,20 +808,35 @@ Error DexKit::AddZipPath(std::string_view apk_path, int unzip_thread_num) {
     const auto new_size = old_size + image_pairs.size();
     images.resize(new_size);
     {
-        auto thread_num = unzip_thread_num == 0
-                          ? NormalizeThreadNum(_thread_num.load(std::memory_order_acquire))
-                          : NormalizeThreadNum(static_cast<uint32_t>(unzip_thread_num));
-        ThreadPool pool(thread_num);
-        for (auto &dex_pair: image_pairs) {
-            pool.enqueue([this, &dex_pair, old_size, &zip_file]() {
-                auto dex_image = zip_file->GetUncompressData(*dex_pair.second);
-                auto ptr = std::make_unique<MemMap>(std::move(dex_image));
-                if (!ptr->ok()) {
-                    return;
-                }
-                auto idx = old_size + dex_pair.first - 1;
-                images[idx] = std::move(ptr);
-            });
+        auto unzip_task = [this, old_size, &zip_file](const std::pair<int, const Entry *> &dex_pair) {
+            auto dex_image = zip_file->GetUncompressData(*dex_pair.second);
+            auto ptr = std::make_unique<MemMap>(std::move(dex_image));
+            if (!ptr->ok()) {
+                return;
+            }
+            auto idx = old_size + dex_pair.first - 1;
+            images[idx] = std::move(ptr);
+        };
+        // an explicit unzip_thread_num keeps a dedicated pool of that size
+        if (unzip_thread_num > 0) {
+            ThreadPool pool(NormalizeThreadNum(static_cast<uint32_t>(unzip_thread_num)));
+            for (auto &dex_pair: image_pairs) {
+                pool.enqueue([&unzip_task, &dex_pair]() {
+                    unzip_task(dex_pair);
+                });
+            }
+        } else {
+            auto pool = GetOrCreateSharedThreadPool();
+            std::vector<std::future<void>> futures;
+            futures.reserve(image_pairs.size());
+            for (auto &dex_pair: image_pairs) {
+                futures.emplace_back(pool->enqueue_priority([&unzip_task, &dex_pair]() {
+                    unzip_task(dex_pair);
+                }));
+            }
+            for (auto &future: futures) {
+                future.get();
+            }
         }
     }
     std::vector<std::pair<std::shared_ptr<MemMap>, uint32_t>> add_items;
@@ -487,20 +845,7 @@ Error DexKit::AddZipPath(std::string_view apk_path, int unzip_thread_num) {
             add_items.emplace_back(images[i], off);
         }
     }
-    const auto old_item_size = dex_items.size();
-    dex_items.resize(old_item_size + add_items.size());
-    {
-        ThreadPool pool(NormalizeThreadNum(_thread_num.load(std::memory_order_acquire)));
-        auto index = old_item_size;
-        for (auto &[image, offset]: add_items) {
-            pool.enqueue([this, &image, index, offset]() {
-                dex_items[index] = std::make_unique<DexItem>(index, std::move(image), offset, this);
-            });
-            index++;
-        }
-    }
-    dex_cnt += add_items.size();
-    return Error::SUCCESS;
+    return AddSource(add_items, old_size);
 }
 
 Error DexKit::ExportDexFile(std::string_view path) const {
@@ -536,8 +881,97 @@ int DexKit::GetDexNum() const {
     return (int) dex_items.size();
 }
 
+int DexKit::GetSourceNum() const {
+    return (int) source_dex_ids.size();
+}
+
+std::vector<uint16_t> DexKit::GetSourceDexIds(uint32_t source_id) const {
+    if (source_id >= source_dex_ids.size()) {
+        return {};
+    }
+    return source_dex_ids[source_id];
+}
+
+std::vector<bool> DexKit::BuildDexScope(const QueryOptions &options) const {
+    if (options.source_ids.empty()) {
+        return {};
+    }
+    std::vector<bool> dex_scope(dex_items.size());
+    for (auto source_id: options.source_ids) {
+        if (source_id >= source_dex_ids.size()) {
+            continue;
+        }
+        for (auto dex_id: source_dex_ids[source_id]) {
+            dex_scope[dex_id] = true;
+        }
+    }
+    return dex_scope;
+}
+
+template<typename Query>
+QueryOptions DexKit::ApplyQuerySources(const Query *query, const QueryOptions &options) {
+    auto query_options = options;
+    if (auto source_ids = query->source_ids(); source_ids && source_ids->size() > 0) {
+        query_options.source_ids.assign(source_ids->begin(), source_ids->end());
+    }
+    return query_options;
+}
+
+template<typename Query>
+std::string DexKit::BuildQueryCacheKey(const Query *query, const QueryOptions &options) const {
+    if (!query_result_cache_->IsEnabled()) {
+        return {};
+    }
+    auto key = internal::CanonicalizeQuery(query);
+    auto source_ids = options.source_ids;
+    std::sort(source_ids.begin(), source_ids.end());
+    source_ids.erase(std::unique(source_ids.begin(), source_ids.end()), source_ids.end());
+    for (auto source_id: source_ids) {
+        key.append(reinterpret_cast<const char *>(&source_id), sizeof(source_id));
+    }
+    return key;
+}
+
+std::string DexKit::BuildQueryCacheFingerprint() const {
+    std::string fingerprint;
+    for (auto &dex_item: dex_items) {
+        auto checksum = dex_item->GetChecksum();
+        fingerprint.append(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
+        fingerprint.append(dex_item->GetSignature());
+    }
+    // keys scoped to source ids are only valid for the same source layout
+    for (auto &source: source_dex_ids) {
+        auto dex_count = static_cast<uint32_t>(source.size());
+        fingerprint.append(reinterpret_cast<const char *>(&dex_count), sizeof(dex_count));
+        fingerprint.append(reinterpret_cast<const char *>(source.data()), source.size() * sizeof(source[0]));
+    }
+    return fingerprint;
+}
+
+bool DexKit::LookupQueryCache(const std::string &key, std::vector<internal::DexHits> &hits) {
+    std::vector<internal::CachedDexHits> cached;
+    if (!query_result_cache_->Get(key, cached)) {
+        return false;
+    }
+    hits.reserve(cached.size());
+    for (auto &[dex_id, ids]: cached) {
+        hits.push_back({dex_items[dex_id].get(), std::move(ids)});
+    }
+    return true;
+}
+
+void DexKit::StoreQueryCache(std::string key, const std::vector<internal::DexHits> &hits) {
+    std::vector<internal::CachedDexHits> cached;
+    cached.reserve(hits.size());
+    for (auto &[dex, ids]: hits) {
+        cached.push_back({dex->GetDexId(), ids});
+    }
+    query_result_cache_->Put(std::move(key), std::move(cached));
+}
+
 std::unique_ptr<flatbuffers::FlatBufferBuilder>
-DexKit::FindClass(const schema::FindClass *query) {
+DexKit::FindClass(const schema::FindClass *query, const QueryOptions &base_options) {
+    auto options = ApplyQuerySources(query, base_options);
     QueryContext query_context(
             QueryKind::FindClass,
 #if DEXKIT_ENABLE_INTERNAL_METRICS
@@ -546,25 +980,58 @@ DexKit::FindClass(const schema::FindClass *query) {
             false
 #endif
     );
-    std::map<uint32_t, std::set<uint32_t>> dex_class_map;
-    if (query->in_classes()) {
-        for (auto encode_idx: *query->in_classes()) {
-            dex_class_map[encode_idx >> 32].insert(encode_idx & UINT32_MAX);
+    auto cache_key = BuildQueryCacheKey(query, options);
+    if (!cache_key.empty()) {
+        // cached hits need no warm-up, only a stable dex set
+        auto execution_guard = EnterQueryExecution(0);
+        std::vector<internal::DexHits> cached_result;
+        if (LookupQueryCache(cache_key, cached_result)) {
+            auto builder = internal::SerializeClassHits(cached_result);
+            query_context.MarkCompleted();
+#if DEXKIT_ENABLE_INTERNAL_METRICS
+            PublishLastQueryMetrics(query_context);
+            RecordQueryMetrics(query_context);
+#endif
+            return builder;
         }
     }
     auto analyze_ret = Analyze(query->matcher(), 1);
+    auto execution_guard = EnterQueryExecution(analyze_ret.need_flags);
+    auto dex_class_map = internal::BuildDexIdSets(query->in_classes(), dex_items.size());
+    auto dex_scope = BuildDexScope(options);
+
+    auto result = FindClassHits(query, std::move(analyze_ret), dex_class_map, dex_scope, options, query_context);
+
+    if (!cache_key.empty()) {
+        StoreQueryCache(std::move(cache_key), result);
+    }
+    auto builder = internal::SerializeClassHits(result);
+    query_context.MarkCompleted();
+#if DEXKIT_ENABLE_INTERNAL_METRICS
+    PublishLastQueryMetrics(query_context);
+    RecordQueryMetrics(query_context);
+#endif
+    return builder;
+}
+
+std::vector<internal::DexHits>
+DexKit::FindClassHits(
+        const schema::FindClass *query,
+        AnalyzeRet analyze_ret,
+        const std::vector<internal::IdSet> &dex_class_map,
+        const std::vector<bool> &dex_scope,
+        const QueryOptions &options,
+        QueryContext &query_context
+) {
     auto has_composite_matcher = HasComposite(query->matcher());
     if (has_composite_matcher) {
         analyze_ret.declare_class.clear();
     }
-    auto execution_guard = EnterQueryExecution(analyze_ret.need_flags);
-
-    trie::PackageTrie packageTrie;
-    // build package match trie
-    BuildPackagesMatchTrie(query->search_packages(), query->exclude_packages(), query->ignore_packages_case(), packageTrie);
+    auto package_filter = internal::BuildPackageFilter(query->search_packages(), query->exclude_packages(), query->ignore_packages_case());
 
     auto find_first = ConfigureFindFirstQuery(query_context, query);
-    std::vector<ClassBean> result;
+    ApplySchedulingOptions(query_context, options);
+    std::vector<internal::DexHits> result;
 
     // fast search declared class
     DexItem *fast_search_dex = nullptr;
@@ -572,12 +1039,14 @@ DexKit::FindClass(const schema::FindClass *query) {
         auto class_name = query->matcher()->class_name();
         if (class_name && class_name->match_type() == schema::StringMatchType::Equal && !class_name->ignore_case()) {
             auto declared_class_name = NormalizeDeclaredClassLookupName(class_name->value()->string_view());
-            auto [dex, type_idx] = GetClassDeclaredPair(declared_class_name);
+            auto [dex, type_idx] = GetClassDeclaredPair(declared_class_name, dex_scope);
             if (dex) {
                 fast_search_dex = dex;
-                auto &class_set = dex_class_map[dex->GetDexId()];
-                auto res = dex->FindClass(query, class_set, packageTrie, type_idx, query_context);
-                result.insert(result.end(), res.begin(), res.end());
+                auto class_set = internal::GetDexIdSet(dex_class_map, dex->GetDexId());
+                auto res = dex->FindClass(query, class_set, package_filter, type_idx, query_context);
+                if (!res.empty()) {
+                    result.push_back({dex, std::move(res)});
+                }
             }
         }
     }
@@ -586,14 +1055,17 @@ DexKit::FindClass(const schema::FindClass *query) {
 
     if (fast_search_dex == nullptr) {
         auto executor = CreateQueryExecutor(query_context);
-        std::vector<std::future<std::vector<ClassBean>>> futures;
+        std::vector<std::future<std::vector<uint32_t>>> futures;
+        std::vector<DexItem *> future_dexes;
         for (auto &dex_item: dex_items) {
             if (find_first && executor->ShouldSkipTask()) break;
-            auto &class_set = dex_class_map[dex_item->GetDexId()];
+            if (!dex_scope.empty() && !dex_scope[dex_item->GetDexId()]) continue;
+            auto class_set = internal::GetDexIdSet(dex_class_map, dex_item->GetDexId());
             if (has_composite_matcher || dex_item->CheckAllTypeNamesDeclared(analyze_ret.declare_class)) {
-                auto res = dex_item->FindClass(query, class_set, packageTrie, *executor, BATCH_SIZE / 2, query_context);
+                auto res = dex_item->FindClass(query, class_set, package_filter, *executor, BATCH_SIZE / 2, query_context);
                 for (auto &f: res) {
                     futures.emplace_back(std::move(f));
+                    future_dexes.emplace_back(dex_item.get());
                 }
             }
         }
@@ -605,7 +1077,7 @@ DexKit::FindClass(const schema::FindClass *query) {
         for (; future_index < futures.size(); ++future_index) {
             auto vec = futures[future_index].get();
             if (vec.empty()) continue;
-            result.insert(result.end(), vec.begin(), vec.end());
+            result.push_back({future_dexes[future_index], std::move(vec)});
             if (find_first) {
                 should_drain_pending_futures = true;
                 ++future_index;
@@ -621,25 +1093,12 @@ DexKit::FindClass(const schema::FindClass *query) {
         query_context.MarkWorkersCompleted();
     }
 
-    auto builder = std::make_unique<flatbuffers::FlatBufferBuilder>();
-    std::vector<flatbuffers::Offset<schema::ClassMeta>> offsets;
-    for (auto &bean: result) {
-        auto res = bean.CreateClassMeta(*builder);
-        builder->Finish(res);
-        offsets.emplace_back(res);
-    }
-    auto array_holder = schema::CreateClassMetaArrayHolder(*builder, builder->CreateVector(offsets));
-    builder->Finish(array_holder);
-    query_context.MarkCompleted();
-#if DEXKIT_ENABLE_INTERNAL_METRICS
-    PublishLastQueryMetrics(query_context);
-    RecordQueryMetrics(query_context);
-#endif
-    return builder;
+    return result;
 }
 
 std::unique_ptr<flatbuffers::FlatBufferBuilder>
-DexKit::FindMethod(const schema::FindMethod *query) {
+DexKit::FindMethod(const schema::FindMethod *query, const QueryOptions &base_options) {
+    auto options = ApplyQuerySources(query, base_options);
     QueryContext query_context(
             QueryKind::FindMethod,
 #if DEXKIT_ENABLE_INTERNAL_METRICS
@@ -648,31 +1107,71 @@ DexKit::FindMethod(const schema::FindMethod *query) {
             false
 #endif
     );
-    std::map<uint32_t, std::set<uint32_t>> dex_class_map;
-    std::map<uint32_t, std::set<uint32_t>> dex_method_map;
-    if (query->in_classes()) {
-        for (auto encode_idx: *query->in_classes()) {
-            dex_class_map[encode_idx >> 32].insert(encode_idx & UINT32_MAX);
-        }
-    }
-    if (query->in_methods()) {
-        for (auto encode_idx: *query->in_methods()) {
-            dex_method_map[encode_idx >> 32].insert(encode_idx & UINT32_MAX);
+    auto cache_key = BuildQueryCacheKey(query, options);
+    if (!cache_key.empty()) {
+        // cached hits need no warm-up, only a stable dex set
+        auto execution_guard = EnterQueryExecution(0);
+        std::vector<internal::DexHits> cached_result;
+        if (LookupQueryCache(cache_key, cached_result)) {
+            auto builder = internal::SerializeMethodHits(cached_result);
+            query_context.MarkCompleted();
+#if DEXKIT_ENABLE_INTERNAL_METRICS
+            PublishLastQueryMetrics(query_context);
+            RecordQueryMetrics(query_context);
+#endif
+            return builder;
         }
     }
     auto analyze_ret = Analyze(query->matcher(), 1);
+    analyze_ret.need_flags |= AnalyzeMethodSeedFlags(query->matcher());
+    auto execution_guard = EnterQueryExecution(analyze_ret.need_flags);
+    auto dex_class_map = internal::BuildDexIdSets(query->in_classes(), dex_items.size());
+    auto dex_method_map = internal::BuildDexIdSets(query->in_methods(), dex_items.size());
+    auto dex_scope = BuildDexScope(options);
+
+    auto result = FindMethodHits(query, std::move(analyze_ret), dex_class_map, dex_method_map, dex_scope, options, query_context);
+
+    if (!cache_key.empty()) {
+        StoreQueryCache(std::move(cache_key), result);
+    }
+    auto builder = internal::SerializeMethodHits(result);
+    query_context.MarkCompleted();
+#if DEXKIT_ENABLE_INTERNAL_METRICS
+    PublishLastQueryMetrics(query_context);
+    RecordQueryMetrics(query_context);
+#endif
+    return builder;
+}
+
+std::vector<internal::DexHits>
+DexKit::FindMethodHits(
+        const schema::FindMethod *query,
+        AnalyzeRet analyze_ret,
+        const std::vector<internal::IdSet> &dex_class_map,
+        const std::vector<internal::IdSet> &dex_method_map,
+        const std::vector<bool> &dex_scope,
+        const QueryOptions &options,
+        QueryContext &query_context
+) {
     auto has_composite_matcher = HasComposite(query->matcher());
     if (has_composite_matcher) {
         analyze_ret.declare_class.clear();
     }
-    auto execution_guard = EnterQueryExecution(analyze_ret.need_flags);
-
-    trie::PackageTrie packageTrie;
-    // build package match trie
-    BuildPackagesMatchTrie(query->search_packages(), query->exclude_packages(), query->ignore_packages_case(), packageTrie);
+    auto package_filter = internal::BuildPackageFilter(query->search_packages(), query->exclude_packages(), query->ignore_packages_case());
 
     auto find_first = ConfigureFindFirstQuery(query_context, query);
-    std::vector<MethodBean> result;
+    ApplySchedulingOptions(query_context, options);
+    std::vector<internal::DexHits> result;
+    // members reached from several dexes are only reported once
+    std::set<std::string_view> declared_set;
+    auto append_hits = [&result, &declared_set](DexItem *dex, std::vector<uint32_t> &&ids) {
+        std::erase_if(ids, [dex, &declared_set](uint32_t idx) {
+            return !declared_set.emplace(dex->GetMethodDescriptor(idx)).second;
+        });
+        if (!ids.empty()) {
+            result.push_back({dex, std::move(ids)});
+        }
+    };
 
     // fast search declared class
     DexItem *fast_search_dex = nullptr;
@@ -682,13 +1181,12 @@ DexKit::FindMethod(const schema::FindMethod *query) {
             auto class_name = declaring_class->class_name();
             if (class_name && class_name->match_type() == schema::StringMatchType::Equal && !class_name->ignore_case()) {
                 auto declared_class_name = NormalizeDeclaredClassLookupName(class_name->value()->string_view());
-                auto [dex, type_idx] = GetClassDeclaredPair(declared_class_name);
+                auto [dex, type_idx] = GetClassDeclaredPair(declared_class_name, dex_scope);
                 if (dex) {
                     fast_search_dex = dex;
-                    auto &class_set = dex_class_map[dex->GetDexId()];
-                    auto &method_set = dex_method_map[dex->GetDexId()];
-                    auto res = dex->FindMethod(query, class_set, method_set, packageTrie, type_idx, query_context);
-                    result.insert(result.end(), res.begin(), res.end());
+                    auto class_set = internal::GetDexIdSet(dex_class_map, dex->GetDexId());
+                    auto method_set = internal::GetDexIdSet(dex_method_map, dex->GetDexId());
+                    append_hits(dex, dex->FindMethod(query, class_set, method_set, package_filter, type_idx, query_context));
                 }
             }
         }
@@ -698,15 +1196,18 @@ DexKit::FindMethod(const schema::FindMethod *query) {
 
     if (fast_search_dex == nullptr) {
         auto executor = CreateQueryExecutor(query_context);
-        std::vector<std::future<std::vector<MethodBean>>> futures;
+        std::vector<std::future<std::vector<uint32_t>>> futures;
+        std::vector<DexItem *> future_dexes;
         for (auto &dex_item: dex_items) {
             if (find_first && executor->ShouldSkipTask()) break;
-            auto &class_set = dex_class_map[dex_item->GetDexId()];
-            auto &method_set = dex_method_map[dex_item->GetDexId()];
+            if (!dex_scope.empty() && !dex_scope[dex_item->GetDexId()]) continue;
+            auto class_set = internal::GetDexIdSet(dex_class_map, dex_item->GetDexId());
+            auto method_set = internal::GetDexIdSet(dex_method_map, dex_item->GetDexId());
             if (has_composite_matcher || dex_item->CheckAllTypeNamesDeclared(analyze_ret.declare_class)) {
-                auto res = dex_item->FindMethod(query, class_set, method_set, packageTrie, *executor, BATCH_SIZE, query_context);
+                auto res = dex_item->FindMethod(query, class_set, method_set, package_filter, *executor, BATCH_SIZE, query_context);
                 for (auto &f: res) {
                     futures.emplace_back(std::move(f));
+                    future_dexes.emplace_back(dex_item.get());
                 }
             }
         }
@@ -718,7 +1219,7 @@ DexKit::FindMethod(const schema::FindMethod *query) {
         for (; future_index < futures.size(); ++future_index) {
             auto vec = futures[future_index].get();
             if (vec.empty()) continue;
-            result.insert(result.end(), vec.begin(), vec.end());
+            append_hits(future_dexes[future_index], std::move(vec));
             if (find_first) {
                 should_drain_pending_futures = true;
                 ++future_index;
@@ -734,30 +1235,12 @@ DexKit::FindMethod(const schema::FindMethod *query) {
         query_context.MarkWorkersCompleted();
     }
 
-    auto builder = std::make_unique<flatbuffers::FlatBufferBuilder>();
-    std::vector<flatbuffers::Offset<schema::MethodMeta>> offsets;
-    std::set<std::string_view> declared_set;
-    for (auto &bean: result) {
-        if (declared_set.contains(bean.dex_descriptor)) {
-            continue;
-        }
-        declared_set.emplace(bean.dex_descriptor);
-        auto res = bean.CreateMethodMeta(*builder);
-        builder->Finish(res);
-        offsets.emplace_back(res);
-    }
-    auto array_holder = schema::CreateMethodMetaArrayHolder(*builder, builder->CreateVector(offsets));
-    builder->Finish(array_holder);
-    query_context.MarkCompleted();
-#if DEXKIT_ENABLE_INTERNAL_METRICS
-    PublishLastQueryMetrics(query_context);
-    RecordQueryMetrics(query_context);
-#endif
-    return builder;
+    return result;
 }
 
 std::unique_ptr<flatbuffers::FlatBufferBuilder>
-DexKit::FindField(const schema::FindField *query) {
+DexKit::FindField(const schema::FindField *query, const QueryOptions &base_options) {
+    auto options = ApplyQuerySources(query, base_options);
     QueryContext query_context(
             QueryKind::FindField,
 #if DEXKIT_ENABLE_INTERNAL_METRICS
@@ -766,31 +1249,71 @@ DexKit::FindField(const schema::FindField *query) {
             false
 #endif
     );
-    std::map<uint32_t, std::set<uint32_t>> dex_class_map;
-    std::map<uint32_t, std::set<uint32_t>> dex_field_map;
-    if (query->in_classes()) {
-        for (auto encode_idx: *query->in_classes()) {
-            dex_class_map[encode_idx >> 32].insert(encode_idx & UINT32_MAX);
-        }
-    }
-    if (query->in_fields()) {
-        for (auto encode_idx: *query->in_fields()) {
-            dex_field_map[encode_idx >> 32].insert(encode_idx & UINT32_MAX);
+    auto cache_key = BuildQueryCacheKey(query, options);
+    if (!cache_key.empty()) {
+        // cached hits need no warm-up, only a stable dex set
+        auto execution_guard = EnterQueryExecution(0);
+        std::vector<internal::DexHits> cached_result;
+        if (LookupQueryCache(cache_key, cached_result)) {
+            auto builder = internal::SerializeFieldHits(cached_result);
+            query_context.MarkCompleted();
+#if DEXKIT_ENABLE_INTERNAL_METRICS
+            PublishLastQueryMetrics(query_context);
+            RecordQueryMetrics(query_context);
+#endif
+            return builder;
         }
     }
     auto analyze_ret = Analyze(query->matcher(), 1);
+    analyze_ret.need_flags |= AnalyzeFieldSeedFlags(query->matcher());
+    auto execution_guard = EnterQueryExecution(analyze_ret.need_flags);
+    auto dex_class_map = internal::BuildDexIdSets(query->in_classes(), dex_items.size());
+    auto dex_field_map = internal::BuildDexIdSets(query->in_fields(), dex_items.size());
+    auto dex_scope = BuildDexScope(options);
+
+    auto result = FindFieldHits(query, std::move(analyze_ret), dex_class_map, dex_field_map, dex_scope, options, query_context);
+
+    if (!cache_key.empty()) {
+        StoreQueryCache(std::move(cache_key), result);
+    }
+    auto builder = internal::SerializeFieldHits(result);
+    query_context.MarkCompleted();
+#if DEXKIT_ENABLE_INTERNAL_METRICS
+    PublishLastQueryMetrics(query_context);
+    RecordQueryMetrics(query_context);
+#endif
+    return builder;
+}
+
+std::vector<internal::DexHits>
+DexKit::FindFieldHits(
+        const schema::FindField *query,
+        AnalyzeRet analyze_ret,
+        const std::vector<internal::IdSet> &dex_class_map,
+        const std::vector<internal::IdSet> &dex_field_map,
+        const std::vector<bool> &dex_scope,
+        const QueryOptions &options,
+        QueryContext &query_context
+) {
     auto has_composite_matcher = HasComposite(query->matcher());
     if (has_composite_matcher) {
         analyze_ret.declare_class.clear();
     }
-    auto execution_guard = EnterQueryExecution(analyze_ret.need_flags);
-
-    trie::PackageTrie packageTrie;
-    // build package match trie
-    BuildPackagesMatchTrie(query->search_packages(), query->exclude_packages(), query->ignore_packages_case(), packageTrie);
+    auto package_filter = internal::BuildPackageFilter(query->search_packages(), query->exclude_packages(), query->ignore_packages_case());
 
     auto find_first = ConfigureFindFirstQuery(query_context, query);
-    std::vector<FieldBean> result;
+    ApplySchedulingOptions(query_context, options);
+    std::vector<internal::DexHits> result;
+    // members reached from several dexes are only reported once
+    std::set<std::string_view> declared_set;
+    auto append_hits = [&result, &declared_set](DexItem *dex, std::vector<uint32_t> &&ids) {
+        std::erase_if(ids, [dex, &declared_set](uint32_t idx) {
+            return !declared_set.emplace(dex->GetFieldDescriptor(idx)).second;
+        });
+        if (!ids.empty()) {
+            result.push_back({dex, std::move(ids)});
+        }
+    };
 
     // fast search declared class
     DexItem *fast_search_dex = nullptr;
@@ -800,13 +1323,12 @@ DexKit::FindField(const schema::FindField *query) {
             auto class_name = declaring_class->class_name();
             if (class_name && class_name->match_type() == schema::StringMatchType::Equal && !class_name->ignore_case()) {
                 auto declared_class_name = NormalizeDeclaredClassLookupName(class_name->value()->string_view());
-                auto [dex, type_idx] = GetClassDeclaredPair(declared_class_name);
+                auto [dex, type_idx] = GetClassDeclaredPair(declared_class_name, dex_scope);
                 if (dex) {
                     fast_search_dex = dex;
-                    auto &class_set = dex_class_map[dex->GetDexId()];
-                    auto &field_set = dex_field_map[dex->GetDexId()];
-                    auto res = dex->FindField(query, class_set, field_set, packageTrie, type_idx, query_context);
-                    result.insert(result.end(), res.begin(), res.end());
+                    auto class_set = internal::GetDexIdSet(dex_class_map, dex->GetDexId());
+                    auto field_set = internal::GetDexIdSet(dex_field_map, dex->GetDexId());
+                    append_hits(dex, dex->FindField(query, class_set, field_set, package_filter, type_idx, query_context));
                 }
             }
         }
@@ -816,15 +1338,18 @@ DexKit::FindField(const schema::FindField *query) {
 
     if (fast_search_dex == nullptr) {
         auto executor = CreateQueryExecutor(query_context);
-        std::vector<std::future<std::vector<FieldBean>>> futures;
+        std::vector<std::future<std::vector<uint32_t>>> futures;
+        std::vector<DexItem *> future_dexes;
         for (auto &dex_item: dex_items) {
             if (find_first && executor->ShouldSkipTask()) break;
-            auto &class_set = dex_class_map[dex_item->GetDexId()];
-            auto &field_set = dex_field_map[dex_item->GetDexId()];
+            if (!dex_scope.empty() && !dex_scope[dex_item->GetDexId()]) continue;
+            auto class_set = internal::GetDexIdSet(dex_class_map, dex_item->GetDexId());
+            auto field_set = internal::GetDexIdSet(dex_field_map, dex_item->GetDexId());
             if (has_composite_matcher || dex_item->CheckAllTypeNamesDeclared(analyze_ret.declare_class)) {
-                auto res = dex_item->FindField(query, class_set, field_set, packageTrie, *executor, BATCH_SIZE, query_context);
+                auto res = dex_item->FindField(query, class_set, field_set, package_filter, *executor, BATCH_SIZE, query_context);
                 for (auto &f: res) {
                     futures.emplace_back(std::move(f));
+                    future_dexes.emplace_back(dex_item.get());
                 }
             }
         }
@@ -836,7 +1361,7 @@ DexKit::FindField(const schema::FindField *query) {
         for (; future_index < futures.size(); ++future_index) {
             auto vec = futures[future_index].get();
             if (vec.empty()) continue;
-            result.insert(result.end(), vec.begin(), vec.end());
+            append_hits(future_dexes[future_index], std::move(vec));
             if (find_first) {
                 should_drain_pending_futures = true;
                 ++future_index;
@@ -852,30 +1377,397 @@ DexKit::FindField(const schema::FindField *query) {
         query_context.MarkWorkersCompleted();
     }
 
-    auto builder = std::make_unique<flatbuffers::FlatBufferBuilder>();
-    std::vector<flatbuffers::Offset<schema::FieldMeta>> offsets;
-    std::set<std::string_view> declared_set;
-    for (auto &bean: result) {
-        if (declared_set.contains(bean.dex_descriptor)) {
+    return result;
+}
+
+std::vector<std::unique_ptr<flatbuffers::FlatBufferBuilder>>
+DexKit::MultiFindClass(const std::vector<const schema::FindClass *> &queries, const QueryOptions &options) {
+    std::vector<AnalyzeRet> analyze_rets(queries.size());
+    uint32_t need_flags = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        analyze_rets[i] = Analyze(queries[i]->matcher(), 1);
+        need_flags |= analyze_rets[i].need_flags;
+    }
+    auto execution_guard = EnterQueryExecution(need_flags);
+    auto dex_scope = BuildDexScope(options);
+
+    std::vector<std::vector<internal::DexHits>> results(queries.size());
+    std::vector<size_t> shared_indexes;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        auto query = queries[i];
+        if (!HasDedicatedFindPath(query)) {
+            shared_indexes.emplace_back(i);
             continue;
         }
-        declared_set.emplace(bean.dex_descriptor);
-        auto res = bean.CreateFieldMeta(*builder);
-        builder->Finish(res);
-        offsets.emplace_back(res);
+        QueryContext query_context(
+                QueryKind::FindClass,
+#if DEXKIT_ENABLE_INTERNAL_METRICS
+                query_metrics_enabled_.load(std::memory_order_acquire)
+#else
+                false
+#endif
+        );
+        auto dex_class_map = internal::BuildDexIdSets(query->in_classes(), dex_items.size());
+        auto query_scope = query->source_ids() ? BuildDexScope(ApplyQuerySources(query, options)) : dex_scope;
+        results[i] = FindClassHits(query, std::move(analyze_rets[i]), dex_class_map, query_scope, options, query_context);
+        query_context.MarkCompleted();
+#if DEXKIT_ENABLE_INTERNAL_METRICS
+        PublishLastQueryMetrics(query_context);
+        RecordQueryMetrics(query_context);
+#endif
     }
-    auto array_holder = schema::CreateFieldMetaArrayHolder(*builder, builder->CreateVector(offsets));
-    builder->Finish(array_holder);
-    query_context.MarkCompleted();
+
+    if (!shared_indexes.empty()) {
+        QueryContext query_context(
+                QueryKind::FindClass,
 #if DEXKIT_ENABLE_INTERNAL_METRICS
-    PublishLastQueryMetrics(query_context);
-    RecordQueryMetrics(query_context);
+                query_metrics_enabled_.load(std::memory_order_acquire)
+#else
+                false
 #endif
-    return builder;
+        );
+        ApplySchedulingOptions(query_context, options);
+        std::vector<internal::PackageFilter> package_filters;
+        std::vector<bool> has_composite_matchers;
+        package_filters.reserve(shared_indexes.size());
+        for (auto i: shared_indexes) {
+            auto query = queries[i];
+            package_filters.emplace_back(internal::BuildPackageFilter(
+                    query->search_packages(), query->exclude_packages(), query->ignore_packages_case()));
+            has_composite_matchers.push_back(HasComposite(query->matcher()));
+        }
+        query_context.MarkPreprocessCompleted();
+
+        auto executor = CreateQueryExecutor(query_context);
+        auto slice_size = std::max<uint32_t>(BATCH_SIZE / 2 / shared_indexes.size(), 64);
+        std::vector<std::future<std::vector<std::vector<uint32_t>>>> futures;
+        std::vector<DexItem *> future_dexes;
+        std::vector<std::shared_ptr<std::vector<size_t>>> future_query_indexes;
+        for (auto &dex_item: dex_items) {
+            if (!dex_scope.empty() && !dex_scope[dex_item->GetDexId()]) continue;
+            auto dex_query_indexes = std::make_shared<std::vector<size_t>>();
+            std::vector<const schema::FindClass *> dex_queries;
+            std::vector<const internal::PackageFilter *> dex_filters;
+            for (size_t k = 0; k < shared_indexes.size(); ++k) {
+                auto i = shared_indexes[k];
+                if (!has_composite_matchers[k] && !dex_item->CheckAllTypeNamesDeclared(analyze_rets[i].declare_class)) continue;
+                dex_query_indexes->emplace_back(i);
+                dex_queries.emplace_back(queries[i]);
+                dex_filters.emplace_back(&package_filters[k]);
+            }
+            if (dex_queries.empty()) continue;
+            auto res = dex_item->MultiFindClass(std::move(dex_queries), std::move(dex_filters), *executor, slice_size, query_context);
+            for (auto &f: res) {
+                futures.emplace_back(std::move(f));
+                future_dexes.emplace_back(dex_item.get());
+                future_query_indexes.emplace_back(dex_query_indexes);
+            }
+        }
+        executor->OnSubmissionComplete();
+        query_context.MarkSubmissionCompleted();
+
+        for (size_t future_index = 0; future_index < futures.size(); ++future_index) {
+            auto vecs = futures[future_index].get();
+            auto &query_indexes = *future_query_indexes[future_index];
+            for (size_t q = 0; q < vecs.size(); ++q) {
+                if (vecs[q].empty()) continue;
+                results[query_indexes[q]].push_back({future_dexes[future_index], std::move(vecs[q])});
+            }
+        }
+        query_context.MarkWorkersCompleted();
+        query_context.MarkCompleted();
+#if DEXKIT_ENABLE_INTERNAL_METRICS
+        PublishLastQueryMetrics(query_context);
+        RecordQueryMetrics(query_context);
+#endif
+    }
+
+    std::vector<std::unique_ptr<flatbuffers::FlatBufferBuilder>> builders;
+    builders.reserve(results.size());
+    for (auto &result: results) {
+        builders.emplace_back(internal::SerializeClassHits(result));
+    }
+    return builders;
+}
+
+std::vector<std::unique_ptr<flatbuffers::FlatBufferBuilder>>
+DexKit::MultiFindMethod(const std::vector<const schema::FindMethod *> &queries, const QueryOptions &options) {
+    std::vector<AnalyzeRet> analyze_rets(queries.size());
+    uint32_t need_flags = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        analyze_rets[i] = Analyze(queries[i]->matcher(), 1);
+        analyze_rets[i].need_flags |= AnalyzeMethodSeedFlags(queries[i]->matcher());
+        need_flags |= analyze_rets[i].need_flags;
+    }
+    auto execution_guard = EnterQueryExecution(need_flags);
+    auto dex_scope = BuildDexScope(options);
+
+    std::vector<std::vector<internal::DexHits>> results(queries.size());
+    std::vector<size_t> shared_indexes;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        auto query = queries[i];
+        if (!HasDedicatedFindPath(query)) {
+            shared_indexes.emplace_back(i);
+            continue;
+        }
+        QueryContext query_context(
+                QueryKind::FindMethod,
+#if DEXKIT_ENABLE_INTERNAL_METRICS
+                query_metrics_enabled_.load(std::memory_order_acquire)
+#else
+                false
+#endif
+        );
+        auto dex_class_map = internal::BuildDexIdSets(query->in_classes(), dex_items.size());
+        auto dex_method_map = internal::BuildDexIdSets(query->in_methods(), dex_items.size());
+        auto query_scope = query->source_ids() ? BuildDexScope(ApplyQuerySources(query, options)) : dex_scope;
+        results[i] = FindMethodHits(query, std::move(analyze_rets[i]), dex_class_map, dex_method_map, query_scope,
+                                    options, query_context);
+        query_context.MarkCompleted();
+#if DEXKIT_ENABLE_INTERNAL_METRICS
+        PublishLastQueryMetrics(query_context);
+        RecordQueryMetrics(query_context);
+#endif
+    }
+
+    if (!shared_indexes.empty()) {
+        QueryContext query_context(
+                QueryKind::FindMethod,
+#if DEXKIT_ENABLE_INTERNAL_METRICS
+                query_metrics_enabled_.load(std::memory_order_acquire)
+#else
+                false
+#endif
+        );
+        ApplySchedulingOptions(query_context, options);
+        std::vector<internal::PackageFilter> package_filters;
+        std::vector<bool> has_composite_matchers;
+        package_filters.reserve(shared_indexes.size());
+        for (auto i: shared_indexes) {
+            auto query = queries[i];
+            package_filters.emplace_back(internal::BuildPackageFilter(
+                    query->search_packages(), query->exclude_packages(), query->ignore_packages_case()));
+            has_composite_matchers.push_back(HasComposite(query->matcher()));
+        }
+        query_context.MarkPreprocessCompleted();
+
+        auto executor = CreateQueryExecutor(query_context);
+        auto slice_size = std::max<uint32_t>(BATCH_SIZE / shared_indexes.size(), 64);
+        std::vector<std::future<std::vector<std::vector<uint32_t>>>> futures;
+        std::vector<DexItem *> future_dexes;
+        std::vector<std::shared_ptr<std::vector<size_t>>> future_query_indexes;
+        for (auto &dex_item: dex_items) {
+            if (!dex_scope.empty() && !dex_scope[dex_item->GetDexId()]) continue;
+            auto dex_query_indexes = std::make_shared<std::vector<size_t>>();
+            std::vector<const schema::FindMethod *> dex_queries;
+            std::vector<const internal::PackageFilter *> dex_filters;
+            for (size_t k = 0; k < shared_indexes.size(); ++k) {
+                auto i = shared_indexes[k];
+                if (!has_composite_matchers[k] && !dex_item->CheckAllTypeNamesDeclared(analyze_rets[i].declare_class)) continue;
+                dex_query_indexes->emplace_back(i);
+                dex_queries.emplace_back(queries[i]);
+                dex_filters.emplace_back(&package_filters[k]);
+            }
+            if (dex_queries.empty()) continue;
+            auto res = dex_item->MultiFindMethod(std::move(dex_queries), std::move(dex_filters), *executor, slice_size, query_context);
+            for (auto &f: res) {
+                futures.emplace_back(std::move(f));
+                future_dexes.emplace_back(dex_item.get());
+                future_query_indexes.emplace_back(dex_query_indexes);
+            }
+        }
+        executor->OnSubmissionComplete();
+        query_context.MarkSubmissionCompleted();
+
+        // members reached from several dexes are only reported once per query
+        std::vector<std::set<std::string_view>> declared_sets(queries.size());
+        for (size_t future_index = 0; future_index < futures.size(); ++future_index) {
+            auto vecs = futures[future_index].get();
+            auto dex = future_dexes[future_index];
+            auto &query_indexes = *future_query_indexes[future_index];
+            for (size_t q = 0; q < vecs.size(); ++q) {
+                auto &declared_set = declared_sets[query_indexes[q]];
+                std::erase_if(vecs[q], [dex, &declared_set](uint32_t idx) {
+                    return !declared_set.emplace(dex->GetMethodDescriptor(idx)).second;
+                });
+                if (vecs[q].empty()) continue;
+                results[query_indexes[q]].push_back({dex, std::move(vecs[q])});
+            }
+        }
+        query_context.MarkWorkersCompleted();
+        query_context.MarkCompleted();
+#if DEXKIT_ENABLE_INTERNAL_METRICS
+        PublishLastQueryMetrics(query_context);
+        RecordQueryMetrics(query_context);
+#endif
+    }
+
+    std::vector<std::unique_ptr<flatbuffers::FlatBufferBuilder>> builders;
+    builders.reserve(results.size());
+    for (auto &result: results) {
+        builders.emplace_back(internal::SerializeMethodHits(result));
+    }
+    return builders;
+}
+
+Error DexKit::ExecuteQueryPipeline(
+        const schema::QueryPipeline *pipeline,
+        std::unique_ptr<flatbuffers::FlatBufferBuilder> &result,
+        const QueryOptions &options
+) {
+    auto stages = pipeline->stages();
+    if (stages == nullptr || stages->size() == 0) {
+        return Error::INVALID_QUERY_PIPELINE;
+    }
+    auto stage_count = (int32_t) stages->size();
+    auto output_stage = pipeline->output_stage() < 0 ? stage_count - 1 : pipeline->output_stage();
+    if (output_stage >= stage_count) {
+        return Error::INVALID_QUERY_PIPELINE;
+    }
+
+    std::vector<QueryKind> stage_kinds(stage_count);
+    std::vector<AnalyzeRet> stage_analyze_rets(stage_count);
+    uint32_t need_flags = 0;
+    for (int32_t i = 0; i < stage_count; ++i) {
+        auto stage = stages->Get(i);
+        auto query_count = (stage->find_class() != nullptr)
+                           + (stage->find_method() != nullptr)
+                           + (stage->find_field() != nullptr);
+        if (query_count != 1) {
+            return Error::INVALID_QUERY_PIPELINE;
+        }
+        auto is_earlier_stage = [i](int32_t from) { return from >= -1 && from < i; };
+        if (!is_earlier_stage(stage->in_classes_from())
+            || !is_earlier_stage(stage->in_methods_from())
+            || !is_earlier_stage(stage->in_fields_from())) {
+            return Error::INVALID_QUERY_PIPELINE;
+        }
+        if (stage->find_class()) {
+            stage_kinds[i] = QueryKind::FindClass;
+            stage_analyze_rets[i] = Analyze(stage->find_class()->matcher(), 1);
+        } else if (stage->find_method()) {
+            stage_kinds[i] = QueryKind::FindMethod;
+            stage_analyze_rets[i] = Analyze(stage->find_method()->matcher(), 1);
+            stage_analyze_rets[i].need_flags |= AnalyzeMethodSeedFlags(stage->find_method()->matcher());
+        } else {
+            stage_kinds[i] = QueryKind::FindField;
+            stage_analyze_rets[i] = Analyze(stage->find_field()->matcher(), 1);
+            stage_analyze_rets[i].need_flags |= AnalyzeFieldSeedFlags(stage->find_field()->matcher());
+        }
+        if (stage->in_methods_from() >= 0
+            && (stage_kinds[i] != QueryKind::FindMethod || stage_kinds[stage->in_methods_from()] != QueryKind::FindMethod)) {
+            return Error::INVALID_QUERY_PIPELINE;
+        }
+        if (stage->in_fields_from() >= 0
+            && (stage_kinds[i] != QueryKind::FindField || stage_kinds[stage->in_fields_from()] != QueryKind::FindField)) {
+            return Error::INVALID_QUERY_PIPELINE;
+        }
+        need_flags |= stage_analyze_rets[i].need_flags;
+    }
+
+    // stages the output does not depend on are skipped
+    std::vector<bool> needed_stages(stage_count);
+    needed_stages[output_stage] = true;
+    for (auto i = output_stage; i >= 0; --i) {
+        if (!needed_stages[i]) continue;
+        auto stage = stages->Get(i);
+        for (auto from: {stage->in_classes_from(), stage->in_methods_from(), stage->in_fields_from()}) {
+            if (from >= 0) needed_stages[from] = true;
+        }
+    }
+
+    auto execution_guard = EnterQueryExecution(need_flags);
+    std::vector<std::vector<internal::DexHits>> stage_hits(stage_count);
+    for (int32_t i = 0; i <= output_stage; ++i) {
+        if (!needed_stages[i]) continue;
+        auto stage = stages->Get(i);
+        QueryContext query_context(
+                stage_kinds[i],
+#if DEXKIT_ENABLE_INTERNAL_METRICS
+                query_metrics_enabled_.load(std::memory_order_acquire)
+#else
+                false
+#endif
+        );
+        auto build_class_sets = [&](const flatbuffers::Vector<int64_t> *in_classes) {
+            auto from = stage->in_classes_from();
+            if (from < 0) {
+                return internal::BuildDexIdSets(in_classes, dex_items.size());
+            }
+            return BuildStageIdSets(stage_hits[from], stage_kinds[from], true);
+        };
+        auto build_member_sets = [&](int32_t from, const flatbuffers::Vector<int64_t> *in_members) {
+            if (from < 0) {
+                return internal::BuildDexIdSets(in_members, dex_items.size());
+            }
+            return BuildStageIdSets(stage_hits[from], stage_kinds[from], false);
+        };
+        if (auto query = stage->find_class()) {
+            auto dex_class_map = build_class_sets(query->in_classes());
+            auto dex_scope = BuildDexScope(ApplyQuerySources(query, options));
+            stage_hits[i] = FindClassHits(query, std::move(stage_analyze_rets[i]), dex_class_map, dex_scope,
+                                          options, query_context);
+        } else if (auto query = stage->find_method()) {
+            auto dex_class_map = build_class_sets(query->in_classes());
+            auto dex_method_map = build_member_sets(stage->in_methods_from(), query->in_methods());
+            auto dex_scope = BuildDexScope(ApplyQuerySources(query, options));
+            stage_hits[i] = FindMethodHits(query, std::move(stage_analyze_rets[i]), dex_class_map, dex_method_map,
+                                           dex_scope, options, query_context);
+        } else if (auto query = stage->find_field()) {
+            auto dex_class_map = build_class_sets(query->in_classes());
+            auto dex_field_map = build_member_sets(stage->in_fields_from(), query->in_fields());
+            auto dex_scope = BuildDexScope(ApplyQuerySources(query, options));
+            stage_hits[i] = FindFieldHits(query, std::move(stage_analyze_rets[i]), dex_class_map, dex_field_map,
+                                          dex_scope, options, query_context);
+        }
+        query_context.MarkCompleted();
+#if DEXKIT_ENABLE_INTERNAL_METRICS
+        PublishLastQueryMetrics(query_context);
+        RecordQueryMetrics(query_context);
+#endif
+    }
+
+    switch (stage_kinds[output_stage]) {
+        case QueryKind::FindClass:
+            result = internal::SerializeClassHits(stage_hits[output_stage]);
+            break;
+        case QueryKind::FindMethod:
+            result = internal::SerializeMethodHits(stage_hits[output_stage]);
+            break;
+        default:
+            result = internal::SerializeFieldHits(stage_hits[output_stage]);
+            break;
+    }
+    return Error::SUCCESS;
+}
+
+std::vector<internal::IdSet>
+DexKit::BuildStageIdSets(const std::vector<internal::DexHits> &hits, QueryKind hit_kind, bool declaring_classes) const {
+    std::vector<std::vector<uint32_t>> dex_ids(dex_items.size());
+    for (auto &[dex, ids]: hits) {
+        auto &target = dex_ids[dex->GetDexId()];
+        if (!declaring_classes || hit_kind == QueryKind::FindClass) {
+            target.insert(target.end(), ids.begin(), ids.end());
+        } else if (hit_kind == QueryKind::FindMethod) {
+            for (auto method_idx: ids) {
+                target.emplace_back(dex->reader.MethodIds()[method_idx].class_idx);
+            }
+        } else {
+            for (auto field_idx: ids) {
+                target.emplace_back(dex->reader.FieldIds()[field_idx].class_idx);
+            }
+        }
+    }
+    std::vector<internal::IdSet> dex_id_sets;
+    dex_id_sets.reserve(dex_ids.size());
+    for (auto &ids: dex_ids) {
+        dex_id_sets.emplace_back(internal::BuildIdSet(std::move(ids)));
+    }
+    return dex_id_sets;
 }
 
 std::unique_ptr<flatbuffers::FlatBufferBuilder>
-DexKit::BatchFindClassUsingStrings(const schema::BatchFindClassUsingStrings *query) {
+DexKit::BatchFindClassUsingStrings(const schema::BatchFindClassUsingStrings *query, const QueryOptions &options) {
     QueryContext query_context(
             QueryKind::BatchFindClassUsingStrings,
 #if DEXKIT_ENABLE_INTERNAL_METRICS
@@ -885,31 +1777,28 @@ DexKit::BatchFindClassUsingStrings(const schema::BatchFindClassUsingStrings *que
 #endif
     );
     auto execution_guard = EnterQueryExecution(kUsingString);
-    std::map<uint32_t, std::set<uint32_t>> dex_class_map;
-    if (query->in_classes()) {
-        for (auto encode_idx: *query->in_classes()) {
-            dex_class_map[encode_idx >> 32].insert(encode_idx & UINT32_MAX);
-        }
-    }
+    auto dex_class_map = internal::BuildDexIdSets(query->in_classes(), dex_items.size());
+    auto dex_scope = BuildDexScope(options);
+    ApplySchedulingOptions(query_context, options);
 
-    trie::PackageTrie packageTrie;
-    // build package match trie
-    BuildPackagesMatchTrie(query->search_packages(), query->exclude_packages(), query->ignore_packages_case(), packageTrie);
+    auto package_filter = internal::BuildPackageFilter(query->search_packages(), query->exclude_packages(), query->ignore_packages_case());
 
     // build keywords trie
     std::vector<std::pair<std::string_view, bool>> keywords;
     phmap::flat_hash_map<std::string_view, schema::StringMatchType> match_type_map;
     std::map<std::string_view, std::set<std::string_view>> keywords_map;
+    internal::BatchUsingStringsPlan batch_plan;
     auto has_composite_matchers = HasCompositeBatchUsingStringsMatchers(query->matchers());
     if (!has_composite_matchers) {
         keywords_map = BuildBatchFindKeywordsMap(query->matchers(), keywords, match_type_map);
+        batch_plan = internal::BuildBatchUsingStringsPlan(keywords_map, match_type_map);
     }
     acdat::AhoCorasickDoubleArrayTrie<std::string_view> acTrie;
     if (!has_composite_matchers) {
         acdat::Builder<std::string_view>().Build(keywords, &acTrie);
     }
 
-    std::map<std::string_view, std::vector<ClassBean>> find_result_map;
+    internal::BatchDexHits find_result_map;
     // init find_result_map keys
     for (int i = 0; i < query->matchers()->size(); ++i) {
         auto matchers = query->matchers();
@@ -919,49 +1808,33 @@ DexKit::BatchFindClassUsingStrings(const schema::BatchFindClassUsingStrings *que
     }
     query_context.MarkPreprocessCompleted();
     auto executor = CreateQueryExecutor(query_context);
-    std::vector<std::future<std::vector<BatchFindClassItemBean>>> futures;
-    for (auto &dex_item: dex_items) {
-        auto &class_map = dex_class_map[dex_item->GetDexId()];
-        query_context.MarkTaskSubmitted();
-        futures.push_back(SubmitQueryTask(*executor, [&dex_item, &query, &acTrie, &keywords_map, &match_type_map, &class_map, &packageTrie,
-                                                      &query_context]() {
-            auto task_scope = query_context.TrackTaskExecution();
-            auto result = dex_item->BatchFindClassUsingStrings(query, acTrie, keywords_map, match_type_map, class_map,
-                                                               packageTrie, query_context);
-            query_context.MarkTaskCompleted();
-            return result;
-        }));
+    auto dex_hit_masks = ScanBatchStringHitMasks(dex_items, dex_scope, acTrie, batch_plan, *executor, query_context);
+    std::vector<std::future<std::vector<internal::BatchHits>>> futures;
+    std::vector<DexItem *> future_dexes;
+    for (size_t i = 0; i < dex_items.size(); ++i) {
+        auto &dex_item = dex_items[i];
+        if (!dex_scope.empty() && !dex_scope[dex_item->GetDexId()]) continue;
+        auto class_map = internal::GetDexIdSet(dex_class_map, dex_item->GetDexId());
+        auto res = dex_item->BatchFindClassUsingStrings(query, batch_plan, dex_hit_masks[i], class_map, package_filter,
+                                                        *executor, BATCH_SIZE / 2, query_context);
+        for (auto &f: res) {
+            futures.emplace_back(std::move(f));
+            future_dexes.emplace_back(dex_item.get());
+        }
     }
     executor->OnSubmissionComplete();
     query_context.MarkSubmissionCompleted();
 
     // fetch and merge result
-    for (auto &f: futures) {
-        auto items = f.get();
+    for (size_t i = 0; i < futures.size(); ++i) {
+        auto items = futures[i].get();
         for (auto &item: items) {
-            auto &beans = find_result_map[item.union_key];
-            beans.insert(beans.end(), item.classes.begin(), item.classes.end());
+            find_result_map[item.union_key].push_back({future_dexes[i], std::move(item.ids)});
         }
     }
     query_context.MarkWorkersCompleted();
 
-    std::vector<BatchFindClassItemBean> result;
-    for (auto &[key, value]: find_result_map) {
-        BatchFindClassItemBean bean;
-        bean.union_key = key;
-        bean.classes = value;
-        result.emplace_back(bean);
-    }
-
-    auto fbb = std::make_unique<flatbuffers::FlatBufferBuilder>();
-    std::vector<flatbuffers::Offset<schema::BatchClassMeta>> offsets;
-    for (auto &bean: result) {
-        auto res = bean.CreateBatchClassMeta(*fbb);
-        fbb->Finish(res);
-        offsets.emplace_back(res);
-    }
-    auto array_holder = schema::CreateBatchClassMetaArrayHolder(*fbb, fbb->CreateVector(offsets));
-    fbb->Finish(array_holder);
+    auto fbb = internal::SerializeBatchClassHits(find_result_map);
     query_context.MarkCompleted();
 #if DEXKIT_ENABLE_INTERNAL_METRICS
     PublishLastQueryMetrics(query_context);
@@ -971,7 +1844,7 @@ DexKit::BatchFindClassUsingStrings(const schema::BatchFindClassUsingStrings *que
 }
 
 std::unique_ptr<flatbuffers::FlatBufferBuilder>
-DexKit::BatchFindMethodUsingStrings(const schema::BatchFindMethodUsingStrings *query) {
+DexKit::BatchFindMethodUsingStrings(const schema::BatchFindMethodUsingStrings *query, const QueryOptions &options) {
     QueryContext query_context(
             QueryKind::BatchFindMethodUsingStrings,
 #if DEXKIT_ENABLE_INTERNAL_METRICS
@@ -981,37 +1854,29 @@ DexKit::BatchFindMethodUsingStrings(const schema::BatchFindMethodUsingStrings *q
 #endif
     );
     auto execution_guard = EnterQueryExecution(kUsingString);
-    std::map<uint32_t, std::set<uint32_t>> dex_class_map;
-    std::map<uint32_t, std::set<uint32_t>> dex_method_map;
-    if (query->in_classes()) {
-        for (auto encode_idx: *query->in_classes()) {
-            dex_class_map[encode_idx >> 32].insert(encode_idx & UINT32_MAX);
-        }
-    }
-    if (query->in_methods()) {
-        for (auto encode_idx: *query->in_methods()) {
-            dex_method_map[encode_idx >> 32].insert(encode_idx & UINT32_MAX);
-        }
-    }
+    auto dex_class_map = internal::BuildDexIdSets(query->in_classes(), dex_items.size());
+    auto dex_method_map = internal::BuildDexIdSets(query->in_methods(), dex_items.size());
+    auto dex_scope = BuildDexScope(options);
+    ApplySchedulingOptions(query_context, options);
 
-    trie::PackageTrie packageTrie;
-    // build package match trie
-    BuildPackagesMatchTrie(query->search_packages(), query->exclude_packages(), query->ignore_packages_case(), packageTrie);
+    auto package_filter = internal::BuildPackageFilter(query->search_packages(), query->exclude_packages(), query->ignore_packages_case());
 
     // build keywords trie
     std::vector<std::pair<std::string_view, bool>> keywords;
     phmap::flat_hash_map<std::string_view, schema::StringMatchType> match_type_map;
     std::map<std::string_view, std::set<std::string_view>> keywords_map;
+    internal::BatchUsingStringsPlan batch_plan;
     auto has_composite_matchers = HasCompositeBatchUsingStringsMatchers(query->matchers());
     if (!has_composite_matchers) {
         keywords_map = BuildBatchFindKeywordsMap(query->matchers(), keywords, match_type_map);
+        batch_plan = internal::BuildBatchUsingStringsPlan(keywords_map, match_type_map);
     }
     acdat::AhoCorasickDoubleArrayTrie<std::string_view> acTrie;
     if (!has_composite_matchers) {
         acdat::Builder<std::string_view>().Build(keywords, &acTrie);
     }
 
-    std::map<std::string_view, std::vector<MethodBean>> find_result_map;
+    internal::BatchDexHits find_result_map;
     // init find_result_map keys
     for (int i = 0; i < query->matchers()->size(); ++i) {
         auto matchers = query->matchers();
@@ -1021,50 +1886,34 @@ DexKit::BatchFindMethodUsingStrings(const schema::BatchFindMethodUsingStrings *q
     }
     query_context.MarkPreprocessCompleted();
     auto executor = CreateQueryExecutor(query_context);
-    std::vector<std::future<std::vector<BatchFindMethodItemBean>>> futures;
-    for (auto &dex_item: dex_items) {
-        auto &class_set = dex_class_map[dex_item->GetDexId()];
-        auto &method_set = dex_method_map[dex_item->GetDexId()];
-        query_context.MarkTaskSubmitted();
-        futures.push_back(SubmitQueryTask(*executor, [&dex_item, &query, &acTrie, &keywords_map, &match_type_map, &class_set, &method_set,
-                                                      &packageTrie, &query_context]() {
-            auto task_scope = query_context.TrackTaskExecution();
-            auto result = dex_item->BatchFindMethodUsingStrings(query, acTrie, keywords_map, match_type_map, class_set,
-                                                                method_set, packageTrie, query_context);
-            query_context.MarkTaskCompleted();
-            return result;
-        }));
+    auto dex_hit_masks = ScanBatchStringHitMasks(dex_items, dex_scope, acTrie, batch_plan, *executor, query_context);
+    std::vector<std::future<std::vector<internal::BatchHits>>> futures;
+    std::vector<DexItem *> future_dexes;
+    for (size_t i = 0; i < dex_items.size(); ++i) {
+        auto &dex_item = dex_items[i];
+        if (!dex_scope.empty() && !dex_scope[dex_item->GetDexId()]) continue;
+        auto class_set = internal::GetDexIdSet(dex_class_map, dex_item->GetDexId());
+        auto method_set = internal::GetDexIdSet(dex_method_map, dex_item->GetDexId());
+        auto res = dex_item->BatchFindMethodUsingStrings(query, batch_plan, dex_hit_masks[i], class_set, method_set,
+                                                         package_filter, *executor, BATCH_SIZE / 2, query_context);
+        for (auto &f: res) {
+            futures.emplace_back(std::move(f));
+            future_dexes.emplace_back(dex_item.get());
+        }
     }
     executor->OnSubmissionComplete();
     query_context.MarkSubmissionCompleted();
 
     // fetch and merge result
-    for (auto &f: futures) {
-        auto items = f.get();
+    for (size_t i = 0; i < futures.size(); ++i) {
+        auto items = futures[i].get();
         for (auto &item: items) {
-            auto &beans = find_result_map[item.union_key];
-            beans.insert(beans.end(), item.methods.begin(), item.methods.end());
+            find_result_map[item.union_key].push_back({future_dexes[i], std::move(item.ids)});
         }
     }
     query_context.MarkWorkersCompleted();
 
-    std::vector<BatchFindMethodItemBean> result;
-    for (auto &[key, value]: find_result_map) {
-        BatchFindMethodItemBean bean;
-        bean.union_key = key;
-        bean.methods = value;
-        result.emplace_back(bean);
-    }
-
-    auto fbb = std::make_unique<flatbuffers::FlatBufferBuilder>();
-    std::vector<flatbuffers::Offset<schema::BatchMethodMeta>> offsets;
-    for (auto &bean: result) {
-        auto res = bean.CreateBatchMethodMeta(*fbb);
-        fbb->Finish(res);
-        offsets.emplace_back(res);
-    }
-    auto array_holder = schema::CreateBatchMethodMetaArrayHolder(*fbb, fbb->CreateVector(offsets));
-    fbb->Finish(array_holder);
+    auto fbb = internal::SerializeBatchMethodHits(find_result_map);
     query_context.MarkCompleted();
 #if DEXKIT_ENABLE_INTERNAL_METRICS
     PublishLastQueryMetrics(query_context);
@@ -1073,6 +1922,49 @@ DexKit::BatchFindMethodUsingStrings(const schema::BatchFindMethodUsingStrings *q
     return fbb;
 }
 
+static std::vector<internal::DexHits>
+GroupClassHits(const internal::ClassHierarchy &hierarchy, const std::vector<uint32_t> &nodes, DexKit &dexkit) {
+    std::vector<std::pair<uint16_t, uint32_t>> declarations;
+    declarations.reserve(nodes.size());
+    for (auto node: nodes) {
+        declarations.emplace_back(hierarchy.GetDeclaration(node));
+    }
+    std::sort(declarations.begin(), declarations.end());
+    std::vector<internal::DexHits> hits;
+    for (auto [dex_id, type_idx]: declarations) {
+        if (dex_id == internal::ClassHierarchy::kNoDex) continue;
+        if (hits.empty() || hits.back().dex->GetDexId() != dex_id) {
+            hits.push_back({dexkit.GetDexItem(dex_id), {}});
+        }
+        hits.back().ids.emplace_back(type_idx);
+    }
+    return hits;
+}
+
+std::unique_ptr<flatbuffers::FlatBufferBuilder>
+DexKit::FindSubclasses(std::string_view class_descriptor, bool direct_only) {
+    auto execution_guard = EnterQueryExecution(0);
+    auto hierarchy = GetClassHierarchy();
+    std::vector<uint32_t> nodes;
+    auto node = hierarchy->FindNode(class_descriptor);
+    if (node != internal::ClassHierarchy::kNoNode) {
+        hierarchy->CollectSubclasses(node, direct_only, nodes);
+    }
+    return internal::SerializeClassHits(GroupClassHits(*hierarchy, nodes, *this));
+}
+
+std::unique_ptr<flatbuffers::FlatBufferBuilder>
+DexKit::FindImplementors(std::string_view interface_descriptor, bool direct_only) {
+    auto execution_guard = EnterQueryExecution(0);
+    auto hierarchy = GetClassHierarchy();
+    std::vector<uint32_t> nodes;
+    auto node = hierarchy->FindNode(interface_descriptor);
+    if (node != internal::ClassHierarchy::kNoNode) {
+        hierarchy->CollectImplementors(node, direct_only, nodes);
+    }
+    return internal::SerializeClassHits(GroupClassHits(*hierarchy, nodes, *this));
+}
+
 std::unique_ptr<flatbuffers::FlatBufferBuilder>
 DexKit::GetClassData(const std::string_view descriptor) {
     auto execution_guard = EnterQueryExecution(0);
@@ -1410,13 +2302,70 @@ std::pair<DexItem *, uint32_t> DexKit::GetClassDeclaredPair(std::string_view cla
     return {this->dex_items[class_info.first].get(), class_info.second};
 }
 
+std::pair<DexItem *, uint32_t> DexKit::GetClassDeclaredPair(std::string_view class_name, const DexItem *referrer) {
+    if (!this->class_declare_conflict_map.empty()) {
+        auto conflict = this->class_declare_conflict_map.find(class_name);
+        if (conflict != this->class_declare_conflict_map.end()) {
+            for (auto [dex_id, type_idx]: conflict->second) {
+                auto dex = this->dex_items[dex_id].get();
+                if (dex->SharesSourceWith(referrer)) {
+                    return {dex, type_idx};
+                }
+            }
+        }
+    }
+    return GetClassDeclaredPair(class_name);
+}
+
+std::pair<DexItem *, uint32_t> DexKit::GetClassDeclaredPair(std::string_view class_name, const std::vector<bool> &dex_scope) {
+    if (dex_scope.empty()) {
+        return GetClassDeclaredPair(class_name);
+    }
+    auto conflict = this->class_declare_conflict_map.find(class_name);
+    if (conflict != this->class_declare_conflict_map.end()) {
+        for (auto [dex_id, type_idx]: conflict->second) {
+            if (dex_scope[dex_id]) {
+                return {this->dex_items[dex_id].get(), type_idx};
+            }
+        }
+        return {nullptr, 0};
+    }
+    auto [dex, type_idx] = GetClassDeclaredPair(class_name);
+    if (dex == nullptr || !dex_scope[dex->GetDexId()]) {
+        return {nullptr, 0};
+    }
+    return {dex, type_idx};
+}
+
 DexItem *DexKit::GetDexItem(uint16_t dex_id) {
     return this->dex_items[dex_id].get();
 }
 
+std::shared_ptr<const internal::ClassHierarchy> DexKit::GetClassHierarchy() {
+    std::lock_guard lock(class_hierarchy_mutex_);
+    if (!class_hierarchy_) {
+        internal::ClassHierarchyBuilder builder;
+        for (auto &dex_item: dex_items) {
+            dex_item->CollectClassHierarchy(builder);
+        }
+        class_hierarchy_ = builder.Build();
+    }
+    return class_hierarchy_;
+}
+
 void DexKit::PutDeclaredClass(std::string_view class_name, uint16_t dex_id, uint32_t type_idx) {
     std::lock_guard lock(this->_put_class_mutex);
-    this->class_declare_dex_map[class_name] = {dex_id, type_idx};
+    auto [it, inserted] = this->class_declare_dex_map.try_emplace(class_name, dex_id, type_idx);
+    if (inserted) {
+        return;
+    }
+    auto &declared = this->class_declare_conflict_map[class_name];
+    if (declared.empty()) {
+        declared.emplace_back(it->second);
+    }
+    std::pair<uint16_t, uint32_t> class_info{dex_id, type_idx};
+    declared.insert(std::upper_bound(declared.begin(), declared.end(), class_info), class_info);
+    it->second = declared.front();
 }
 
 uint32_t DexKit::BeginBuildCrossRefAggregates(uint32_t aggregate_flags) {
@@ -1457,7 +2406,7 @@ void DexKit::WaitBuildCrossRefAggregates(uint32_t aggregate_flags) const {
 
 void DexKit::BuildCrossRefAggregates(uint32_t aggregate_flags) {
     DEXKIT_CHECK((aggregate_flags & ~(kCallerMethod | kRwFieldMethod)) == 0);
-    auto thread_num = NormalizeThreadNum(_thread_num.load(std::memory_order_acquire));
+    auto pool = GetOrCreateSharedThreadPool();
 
     if ((aggregate_flags & kCallerMethod) != 0) {
         struct MethodAggregateWorkItem {
@@ -1505,15 +2454,14 @@ void DexKit::BuildCrossRefAggregates(uint32_t aggregate_flags) {
                 ++target_count;
             }
         }
-        if (target_count > 1 && thread_num > 1) {
-            ThreadPool pool(std::min(static_cast<size_t>(thread_num), target_count));
+        if (target_count > 1 && pool->size() > 1) {
             std::vector<std::future<void>> futures;
             futures.reserve(target_count);
             for (uint16_t target_dex_id = 0; target_dex_id < work_items.size(); ++target_dex_id) {
                 if (work_items[target_dex_id].empty()) {
                     continue;
                 }
-                futures.emplace_back(pool.enqueue([aggregate_target_methods, target_dex_id]() {
+                futures.emplace_back(pool->enqueue_priority([&aggregate_target_methods, target_dex_id]() {
                     aggregate_target_methods(target_dex_id);
                 }));
             }
@@ -1599,15 +2547,14 @@ void DexKit::BuildCrossRefAggregates(uint32_t aggregate_flags) {
                 ++target_count;
             }
         }
-        if (target_count > 1 && thread_num > 1) {
-            ThreadPool pool(std::min(static_cast<size_t>(thread_num), target_count));
+        if (target_count > 1 && pool->size() > 1) {
             std::vector<std::future<void>> futures;
             futures.reserve(target_count);
             for (uint16_t target_dex_id = 0; target_dex_id < work_items.size(); ++target_dex_id) {
                 if (work_items[target_dex_id].empty()) {
                     continue;
                 }
-                futures.emplace_back(pool.enqueue([aggregate_target_fields, target_dex_id]() {
+                futures.emplace_back(pool->enqueue_priority([&aggregate_target_fields, target_dex_id]() {
                     aggregate_target_fields(target_dex_id);
                 }));
             }
@@ -1632,7 +2579,8 @@ void DexKit::BuildCrossRefAggregates(uint32_t aggregate_flags) {
 
 void DexKit::InitDexCache(uint32_t init_flags) {
     uint32_t cross_ref_flags = init_flags & (kCallerMethod | kRwFieldMethod);
-    auto thread_num = NormalizeThreadNum(_thread_num.load(std::memory_order_acquire));
+    auto pool = GetOrCreateSharedThreadPool();
+    std::vector<std::future<void>> futures;
     std::vector<std::pair<DexItem *, uint32_t>> init_jobs;
     init_jobs.reserve(dex_items.size());
     for (auto &dex_item: dex_items) {
@@ -1642,14 +2590,15 @@ void DexKit::InitDexCache(uint32_t init_flags) {
         }
     }
 
-    if (!init_jobs.empty()) {
-        ThreadPool pool(std::min(static_cast<size_t>(thread_num), init_jobs.size()));
-        for (auto &[dex_item, claimed_flags]: init_jobs) {
-            pool.enqueue([dex_item, claimed_flags]() {
-                dex_item->InitCache(claimed_flags);
-                dex_item->FinishInitCache(claimed_flags);
-            });
-        }
+    futures.reserve(init_jobs.size());
+    for (auto &[dex_item, claimed_flags]: init_jobs) {
+        futures.emplace_back(pool->enqueue_priority([dex_item, claimed_flags]() {
+            dex_item->InitCache(claimed_flags);
+            dex_item->FinishInitCache(claimed_flags);
+        }));
+    }
+    for (auto &future: futures) {
+        future.get();
     }
     for (auto &dex_item: dex_items) {
         dex_item->WaitInitCache(init_flags);
@@ -1667,14 +2616,16 @@ void DexKit::InitDexCache(uint32_t init_flags) {
             cross_ref_jobs.emplace_back(dex_item.get(), claimed_flags);
         }
     }
-    if (!cross_ref_jobs.empty()) {
-        ThreadPool pool(std::min(static_cast<size_t>(thread_num), cross_ref_jobs.size()));
-        for (auto &[dex_item, claimed_flags]: cross_ref_jobs) {
-            pool.enqueue([dex_item, claimed_flags]() {
-                dex_item->PutCrossRef(claimed_flags);
-                dex_item->FinishPutCrossRef(claimed_flags);
-            });
-        }
+    futures.clear();
+    futures.reserve(cross_ref_jobs.size());
+    for (auto &[dex_item, claimed_flags]: cross_ref_jobs) {
+        futures.emplace_back(pool->enqueue_priority([dex_item, claimed_flags]() {
+            dex_item->PutCrossRef(claimed_flags);
+            dex_item->FinishPutCrossRef(claimed_flags);
+        }));
+    }
+    for (auto &future: futures) {
+        future.get();
     }
     for (auto &dex_item: dex_items) {
         dex_item->WaitPutCrossRef(cross_ref_flags);
@@ -1688,45 +2639,6 @@ void DexKit::InitDexCache(uint32_t init_flags) {
     WaitBuildCrossRefAggregates(cross_ref_flags);
 }
 
-void DexKit::BuildPackagesMatchTrie(
-        const flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>> *search_packages,
-        const flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>> *exclude_packages,
-        const bool ignore_packages_case,
-        trie::PackageTrie &trie
-) {
-    std::vector<std::string> packages;
-    if (search_packages) {
-        for (auto i = 0; i < search_packages->size(); ++i) {
-            auto package = search_packages->Get(i);
-            std::string package_str(package->string_view());
-            std::replace(package_str.begin(), package_str.end(), '.', '/');
-            if (package_str[0] != 'L') {
-                package_str = "L" + package_str; // NOLINT
-            }
-            if (package_str.back() != '/') {
-                package_str += '/';
-            }
-            trie.insert(package_str, true, ignore_packages_case);
-            packages.emplace_back(std::move(package_str));
-        }
-    }
-    if (exclude_packages) {
-        for (auto i = 0; i < exclude_packages->size(); ++i) {
-            auto package = exclude_packages->Get(i);
-            std::string package_str(package->string_view());
-            std::replace(package_str.begin(), package_str.end(), '.', '/');
-            if (package_str[0] != 'L') {
-                package_str = "L" + package_str; // NOLINT
-            }
-            if (package_str.back() != '/') {
-                package_str += '/';
-            }
-            trie.insert(package_str, false, ignore_packages_case);
-            packages.emplace_back(std::move(package_str));
-        }
-    }
-}
-
 std::map<std::string_view, std::set<std::string_view>>
 DexKit::BuildBatchFindKeywordsMap(
         const flatbuffers::Vector<flatbuffers::Offset<dexkit::schema::BatchUsingStringsMatcher>> *matchers,
@@ -0,0 +1,65 @@
+// DexKit - An high-performance runtime parsing library for dex
+// implemented in C++.
+// Copyright (C) 2022-2023 LuckyPray
+// https://github.com/LuckyPray/DexKit
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+// <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+
+
+#include "internal/id_set.h"
+
+#include <algorithm>
+
+namespace dexkit {
+
+namespace internal {
+
+IdSet BuildIdSet(std::vector<uint32_t> ids) {
+    IdSet id_set;
+    if (ids.empty()) {
+        return id_set;
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    id_set.words.resize(ids.back() / 64 + 1);
+    for (auto id: ids) {
+        id_set.words[id / 64] |= 1ULL << (id % 64);
+    }
+    id_set.ids = std::move(ids);
+    return id_set;
+}
+
+std::vector<IdSet> BuildDexIdSets(const flatbuffers::Vector<int64_t> *encoded_ids, size_t dex_count) {
+    if (encoded_ids == nullptr) {
+        return {};
+    }
+    std::vector<std::vector<uint32_t>> dex_ids(dex_count);
+    for (auto encode_idx: *encoded_ids) {
+        auto dex_id = static_cast<uint64_t>(encode_idx) >> 32;
+        if (dex_id >= dex_count) continue;
+        dex_ids[dex_id].emplace_back(encode_idx & UINT32_MAX);
+    }
+    std::vector<IdSet> dex_id_sets;
+    dex_id_sets.reserve(dex_count);
+    for (auto &ids: dex_ids) {
+        dex_id_sets.emplace_back(BuildIdSet(std::move(ids)));
+    }
+    return dex_id_sets;
+}
+
+} // namespace internal
+
+} // namespace dexkit
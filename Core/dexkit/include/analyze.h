@@ -44,6 +44,13 @@ const uint32_t kMethodUsingField = 0x0800;
 const uint32_t kRwFieldMethod = 0x1000; // cross
 const uint32_t kOpSequence = 0x2000;
 const uint32_t kUsingNumber = 0x4000;
+// index
+const uint32_t kOpCodeNgram = 0x8000;
+const uint32_t kMemberNameIndex = 0x10000;
+const uint32_t kUsingNumberIndex = 0x20000;
+// opt-in, see DexKit::BuildStringIndex
+const uint32_t kStringIndex = 0x40000;
+const uint32_t kTypeNameIndex = 0x80000;
 
 struct AnalyzeRet {
     uint32_t need_flags = 0;
@@ -55,6 +62,10 @@ bool HasComposite(const schema::ClassMatcher *matcher);
 bool HasComposite(const schema::FieldMatcher *matcher);
 bool HasComposite(const schema::MethodMatcher *matcher);
 
+// indexes FindMethod/FindField can seed their candidates from, on top of what Analyze requires
+uint32_t AnalyzeMethodSeedFlags(const schema::MethodMatcher *matcher);
+uint32_t AnalyzeFieldSeedFlags(const schema::FieldMatcher *matcher);
+
 AnalyzeRet Analyze(const schema::ClassMatcher *matcher, int dex_depth);
 AnalyzeRet Analyze(const schema::FieldMatcher *matcher, int dex_depth);
 AnalyzeRet Analyze(const schema::MethodMatcher *matcher, int dex_depth);
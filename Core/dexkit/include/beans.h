@@ -144,24 +144,4 @@ public:
     CreateAnnotationElementMeta(flatbuffers::FlatBufferBuilder &fbb) const;
 };
 
-class BatchFindClassItemBean {
-public:
-    std::string_view union_key;
-    std::vector<ClassBean> classes;
-
-public:
-    flatbuffers::Offset<schema::BatchClassMeta>
-    CreateBatchClassMeta(flatbuffers::FlatBufferBuilder &fbb) const;
-};
-
-class BatchFindMethodItemBean {
-public:
-    std::string_view union_key;
-    std::vector<MethodBean> methods;
-
-public:
-    flatbuffers::Offset<schema::BatchMethodMeta>
-    CreateBatchMethodMeta(flatbuffers::FlatBufferBuilder &fbb) const;
-};
-
 }
\ No newline at end of file
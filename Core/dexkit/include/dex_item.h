@@ -38,10 +38,13 @@
 #include "acdat/Builder.h"
 #include "query_executor.h"
 #include "mmap.h"
-#include "package_trie.h"
 #include "query_context.h"
 #include "dexkit.h"
 #include "analyze.h"
+#include "internal/name_postings.h"
+#include "internal/number_postings.h"
+#include "internal/string_suffix_array.h"
+#include "internal/type_name_index.h"
 
 namespace dexkit {
 
@@ -49,6 +52,14 @@ class DexKit;
 
 namespace internal {
 struct UsingStringsPrefilterPlan;
+struct BatchUsingStringsPlan;
+struct BatchStringHitMasks;
+struct BatchHits;
+struct DexHits;
+struct PackageFilter;
+struct PackageTypeMask;
+struct IdSet;
+class ClassHierarchyBuilder;
 }
 
 class DexItem {
@@ -64,105 +75,212 @@ public:
     [[nodiscard]] MemMap *GetImage() const {
         return _image.get();
     }
+    // the bytes of this dex inside the image
+    [[nodiscard]] std::string_view GetImageData() const {
+        auto header = reader.Header();
+        return {reinterpret_cast<const char *>(header), header->file_size};
+    }
     [[nodiscard]] uint32_t GetDexId() const {
         return dex_id;
     }
+    [[nodiscard]] const std::vector<uint32_t> &GetSourceIds() const {
+        return source_ids;
+    }
+    [[nodiscard]] bool SharesSourceWith(const DexItem *other) const;
+    // true if the image passed DexKit::SetDexVerifyEnabled checks when it was added
+    [[nodiscard]] bool IsVerified() const {
+        return verified;
+    }
+    // adler32 of the dex, computed from the data for verified items, otherwise read from the header
+    [[nodiscard]] uint32_t GetChecksum() const {
+        return verified ? computed_checksum : reader.Header()->checksum;
+    }
+    [[nodiscard]] std::string_view GetSignature() const {
+        auto header = reader.Header();
+        return {reinterpret_cast<const char *>(header->signature), sizeof(header->signature)};
+    }
+    // bounds of the type (class), method and field ids a query can return for this dex
+    [[nodiscard]] uint32_t GetTypeIdCount() const {
+        return reader.Header()->type_ids_size;
+    }
+    [[nodiscard]] uint32_t GetMethodIdCount() const {
+        return reader.Header()->method_ids_size;
+    }
+    [[nodiscard]] uint32_t GetFieldIdCount() const {
+        return reader.Header()->field_ids_size;
+    }
+    // bytes held by the kStringIndex structures, 0 until they are built
+    [[nodiscard]] size_t GetStringIndexMemoryUsage() const;
 
-    std::vector<std::future<std::vector<ClassBean>>>
+    std::vector<std::future<std::vector<uint32_t>>>
     FindClass(
             const schema::FindClass *query,
-            const std::set<uint32_t> &in_class_set,
-            trie::PackageTrie &packageTrie,
+            const internal::IdSet *in_class_set,
+            const internal::PackageFilter &package_filter,
             IQueryExecutor &executor,
             uint32_t split_num,
             QueryContext &query_context
     );
-    std::vector<std::future<std::vector<MethodBean>>>
+    std::vector<std::future<std::vector<uint32_t>>>
     FindMethod(
             const schema::FindMethod *query,
-            const std::set<uint32_t> &in_class_set,
-            const std::set<uint32_t> &in_method_set,
-            trie::PackageTrie &packageTrie,
+            const internal::IdSet *in_class_set,
+            const internal::IdSet *in_method_set,
+            const internal::PackageFilter &package_filter,
             IQueryExecutor &executor,
             uint32_t split_num,
             QueryContext &query_context
     );
-    std::vector<std::future<std::vector<FieldBean>>>
+    std::vector<std::future<std::vector<uint32_t>>>
     FindField(
             const schema::FindField *query,
-            const std::set<uint32_t> &in_class_set,
-            const std::set<uint32_t> &in_field_set,
-            trie::PackageTrie &packageTrie,
+            const internal::IdSet *in_class_set,
+            const internal::IdSet *in_field_set,
+            const internal::PackageFilter &package_filter,
             IQueryExecutor &executor,
             uint32_t split_num,
             QueryContext &query_context
     );
-    std::vector<ClassBean> FindClass(
+    std::vector<uint32_t> FindClass(
             const schema::FindClass *query,
-            const std::set<uint32_t> &in_class_set,
-            trie::PackageTrie &packageTrie,
+            const internal::IdSet *in_class_set,
+            const internal::PackageFilter &package_filter,
+            const std::vector<uint32_t> *candidates,
             uint32_t start,
             uint32_t end,
             QueryContext &query_context
     );
-    std::vector<MethodBean> FindMethod(
+    std::vector<uint32_t> FindMethod(
             const schema::FindMethod *query,
-            const std::set<uint32_t> &in_class_set,
-            const std::set<uint32_t> &in_method_set,
-            trie::PackageTrie &packageTrie,
+            const internal::IdSet *in_class_set,
+            const internal::IdSet *in_method_set,
+            const internal::PackageFilter &package_filter,
+            const std::vector<uint32_t> *candidates,
             uint32_t start,
             uint32_t end,
             QueryContext &query_context
     );
-    std::vector<FieldBean> FindField(
+    std::vector<uint32_t> FindField(
             const schema::FindField *query,
-            const std::set<uint32_t> &in_class_set,
-            const std::set<uint32_t> &in_field_set,
-            trie::PackageTrie &packageTrie,
+            const internal::IdSet *in_class_set,
+            const internal::IdSet *in_field_set,
+            const internal::PackageFilter &package_filter,
+            const std::vector<uint32_t> *candidates,
             uint32_t start,
             uint32_t end,
             QueryContext &query_context
     );
-    std::vector<ClassBean> FindClass(
+    std::vector<uint32_t> FindClass(
             const schema::FindClass *query,
-            const std::set<uint32_t> &in_class_set,
-            trie::PackageTrie &packageTrie,
+            const internal::IdSet *in_class_set,
+            const internal::PackageFilter &package_filter,
             uint32_t type_idx,
             QueryContext &query_context
     );
-    std::vector<MethodBean> FindMethod(
+    std::vector<uint32_t> FindMethod(
             const schema::FindMethod *query,
-            const std::set<uint32_t> &in_class_set,
-            const std::set<uint32_t> &in_method_set,
-            trie::PackageTrie &packageTrie,
+            const internal::IdSet *in_class_set,
+            const internal::IdSet *in_method_set,
+            const internal::PackageFilter &package_filter,
             uint32_t type_idx,
             QueryContext &query_context
     );
-    std::vector<FieldBean> FindField(
+    std::vector<uint32_t> FindField(
             const schema::FindField *query,
-            const std::set<uint32_t> &in_class_set,
-            const std::set<uint32_t> &in_field_set,
-            trie::PackageTrie &packageTrie,
+            const internal::IdSet *in_class_set,
+            const internal::IdSet *in_field_set,
+            const internal::PackageFilter &package_filter,
             uint32_t type_idx,
             QueryContext &query_context
     );
-    std::vector<BatchFindClassItemBean> BatchFindClassUsingStrings(
-            const schema::BatchFindClassUsingStrings *query,
+    // evaluate several independent queries in one pass over the dex, results are per query
+    std::vector<std::future<std::vector<std::vector<uint32_t>>>>
+    MultiFindClass(
+            std::vector<const schema::FindClass *> queries,
+            std::vector<const internal::PackageFilter *> package_filters,
+            IQueryExecutor &executor,
+            uint32_t slice_size,
+            QueryContext &query_context
+    );
+    std::vector<std::future<std::vector<std::vector<uint32_t>>>>
+    MultiFindMethod(
+            std::vector<const schema::FindMethod *> queries,
+            std::vector<const internal::PackageFilter *> package_filters,
+            IQueryExecutor &executor,
+            uint32_t slice_size,
+            QueryContext &query_context
+    );
+    std::vector<std::vector<uint32_t>> MultiFindClass(
+            const std::vector<const schema::FindClass *> &queries,
+            const std::vector<const internal::PackageFilter *> &package_filters,
+            uint32_t start,
+            uint32_t end,
+            QueryContext &query_context
+    );
+    std::vector<std::vector<uint32_t>> MultiFindMethod(
+            const std::vector<const schema::FindMethod *> &queries,
+            const std::vector<const internal::PackageFilter *> &package_filters,
+            uint32_t start,
+            uint32_t end,
+            QueryContext &query_context
+    );
+    std::vector<std::future<internal::BatchStringHitMasks>>
+    ScanBatchStringHitMasks(
             acdat::AhoCorasickDoubleArrayTrie<std::string_view> &acTrie,
-            std::map<std::string_view, std::set<std::string_view>> &keywords_map,
-            phmap::flat_hash_map<std::string_view, schema::StringMatchType> &match_type_map,
-            std::set<uint32_t> &in_class_set,
-            trie::PackageTrie &packageTrie,
+            const internal::BatchUsingStringsPlan &plan,
+            IQueryExecutor &executor,
+            uint32_t slice_size,
+            QueryContext &query_context
+    );
+    std::vector<std::future<std::vector<internal::BatchHits>>>
+    BatchFindClassUsingStrings(
+            const schema::BatchFindClassUsingStrings *query,
+            const internal::BatchUsingStringsPlan &plan,
+            const internal::BatchStringHitMasks &hit_masks,
+            const internal::IdSet *in_class_set,
+            const internal::PackageFilter &package_filter,
+            IQueryExecutor &executor,
+            uint32_t slice_size,
             QueryContext &query_context
     );
-    std::vector<BatchFindMethodItemBean> BatchFindMethodUsingStrings(
+    std::vector<std::future<std::vector<internal::BatchHits>>>
+    BatchFindMethodUsingStrings(
             const schema::BatchFindMethodUsingStrings *query,
+            const internal::BatchUsingStringsPlan &plan,
+            const internal::BatchStringHitMasks &hit_masks,
+            const internal::IdSet *in_class_set,
+            const internal::IdSet *in_method_set,
+            const internal::PackageFilter &package_filter,
+            IQueryExecutor &executor,
+            uint32_t slice_size,
+            QueryContext &query_context
+    );
+    internal::BatchStringHitMasks ScanBatchStringHitMasks(
             acdat::AhoCorasickDoubleArrayTrie<std::string_view> &acTrie,
-            std::map<std::string_view, std::set<std::string_view>> &keywords_map,
-            phmap::flat_hash_map<std::string_view, schema::StringMatchType> &match_type_map,
-            std::set<uint32_t> &in_class_set,
-            std::set<uint32_t> &in_method_set,
-            trie::PackageTrie &packageTrie,
+            const internal::BatchUsingStringsPlan &plan,
+            uint32_t start,
+            uint32_t end,
+            QueryContext &query_context
+    );
+    std::vector<internal::BatchHits> BatchFindClassUsingStrings(
+            const schema::BatchFindClassUsingStrings *query,
+            const internal::BatchUsingStringsPlan &plan,
+            const internal::BatchStringHitMasks &hit_masks,
+            const internal::IdSet *in_class_set,
+            const internal::PackageFilter &package_filter,
+            uint32_t start,
+            uint32_t end,
+            QueryContext &query_context
+    );
+    std::vector<internal::BatchHits> BatchFindMethodUsingStrings(
+            const schema::BatchFindMethodUsingStrings *query,
+            const internal::BatchUsingStringsPlan &plan,
+            const internal::BatchStringHitMasks &hit_masks,
+            const internal::IdSet *in_class_set,
+            const internal::IdSet *in_method_set,
+            const internal::PackageFilter &package_filter,
+            uint32_t start,
+            uint32_t end,
             QueryContext &query_context
     );
 
@@ -170,6 +288,11 @@ public:
     MethodBean GetMethodBean(uint32_t method_idx);
     FieldBean GetFieldBean(uint32_t field_idx);
 
+    // write the metas straight from the index arrays, equivalent to Get*Bean(idx).Create*Meta(fbb)
+    flatbuffers::Offset<schema::ClassMeta> CreateClassMeta(flatbuffers::FlatBufferBuilder &fbb, uint32_t type_idx);
+    flatbuffers::Offset<schema::MethodMeta> CreateMethodMeta(flatbuffers::FlatBufferBuilder &fbb, uint32_t method_idx);
+    flatbuffers::Offset<schema::FieldMeta> CreateFieldMeta(flatbuffers::FlatBufferBuilder &fbb, uint32_t field_idx);
+
     std::optional<MethodBean> GetMethodBean(uint32_t type_idx, std::string_view method_descriptor);
     std::optional<FieldBean> GetFieldBean(uint32_t type_idx, std::string_view method_descriptor);
 
@@ -196,7 +319,11 @@ public:
     std::vector<MethodBean> FieldGetMethods(uint32_t field_idx);
     std::vector<MethodBean> FieldPutMethods(uint32_t field_idx);
 
+    // null when the filter accepts every type, masks are cached per distinct package list
+    std::shared_ptr<const internal::PackageTypeMask> GetPackageTypeMask(const internal::PackageFilter &filter);
+
     bool CheckAllTypeNamesDeclared(std::vector<std::string_view> &types);
+    void CollectClassHierarchy(internal::ClassHierarchyBuilder &builder) const;
     [[nodiscard]] bool NeedPutCrossRef(uint32_t need_cross_flag) const;
     void PutCrossRef(uint32_t put_cross_flag);
     [[nodiscard]] bool NeedInitCache(uint32_t need_flag) const;
@@ -213,6 +340,50 @@ private:
     void InitBaseCache();
     inline std::mutex &GetTypeDefMutex(uint32_t type_idx);
 
+    // restricted find queries only visit the listed members, null when the whole dex is scanned
+    std::shared_ptr<const std::vector<uint32_t>> GetFindClassCandidates(
+            const internal::IdSet *in_class_set,
+            const schema::ClassMatcher *matcher
+    );
+    // class defs naming every exact super class/interface of the matcher, null when it has none
+    std::shared_ptr<const std::vector<uint32_t>> GetClassHierarchySeedCandidates(const schema::ClassMatcher *matcher);
+    std::shared_ptr<const std::vector<uint32_t>> GetFindMethodCandidates(
+            const internal::IdSet *in_class_set,
+            const internal::IdSet *in_method_set,
+            const schema::MethodMatcher *matcher
+    );
+    // methods holding the rarest op code 3-gram of the matcher, null when it has none to seed from
+    std::shared_ptr<const std::vector<uint32_t>> GetOpCodeSeedCandidates(const schema::MethodMatcher *matcher);
+    // methods the reverse cross-ref indexes list for every exact using_field/invoking/caller
+    // reference of the matcher, null when it pins none
+    std::shared_ptr<const std::vector<uint32_t>> GetReferenceSeedCandidates(const schema::MethodMatcher *matcher);
+    // method/field ids of this dex with the given declaring class descriptor and name
+    [[nodiscard]] std::vector<uint32_t> FindMethodRefs(std::string_view class_descriptor, std::string_view name) const;
+    [[nodiscard]] std::vector<uint32_t> FindFieldRefs(std::string_view class_descriptor, std::string_view name) const;
+    void BuildOpCodeNgramIndex();
+    std::shared_ptr<const std::vector<uint32_t>> GetFindFieldCandidates(
+            const internal::IdSet *in_class_set,
+            const internal::IdSet *in_field_set,
+            const schema::FieldMatcher *matcher
+    );
+    // members carrying the exact name (and for methods the exact or derived proto shorty) of
+    // the matcher, null when nothing is exact
+    std::shared_ptr<const std::vector<uint32_t>> GetMemberNameSeedCandidates(const schema::MethodMatcher *matcher);
+    std::shared_ptr<const std::vector<uint32_t>> GetMemberNameSeedCandidates(const schema::FieldMatcher *matcher);
+    void BuildMemberNameIndex();
+    // methods that may use every using_numbers constant of the matcher, null when it has none
+    std::shared_ptr<const std::vector<uint32_t>> GetUsingNumberSeedCandidates(const schema::MethodMatcher *matcher);
+    void BuildUsingNumberIndex();
+    // methods using a string for every case sensitive literal (or regex with a required literal)
+    // using_strings matcher, null when the string index is not built or no matcher qualifies
+    std::shared_ptr<const std::vector<uint32_t>> GetUsingStringSeedCandidates(const schema::MethodMatcher *matcher);
+    void BuildStringIndex();
+    // types of this dex that may match a class_name with the given search key, cached per key.
+    // null when the type name index is not built
+    std::shared_ptr<const internal::TypeNameCandidates> GetTypeNameCandidates(const std::string &key);
+    // class defs whose name may match the class_name matcher, null when it has no search key
+    std::shared_ptr<const std::vector<uint32_t>> GetTypeNameSeedCandidates(const schema::ClassMatcher *matcher);
+
     std::string_view GetMethodDescriptor(uint32_t method_idx);
     std::string_view GetFieldDescriptor(uint32_t field_idx);
 
@@ -243,6 +414,8 @@ private:
 
     bool IsClassMatched(uint32_t type_idx, const schema::ClassMatcher *matcher);
     bool IsTypeNameMatched(uint32_t type_idx, const schema::StringMatcher *matcher);
+    // false when the trigram candidates of the class_name matcher rule the type out
+    bool IsTypeNameCandidate(uint32_t type_idx, const schema::StringMatcher *matcher);
     bool IsClassAccessFlagsMatched(uint32_t type_idx, const schema::AccessFlagsMatcher *matcher);
     bool IsClassSmaliSourceMatched(uint32_t type_idx, const schema::StringMatcher *matcher);
     bool IsClassUsingStringsMatched(uint32_t type_idx, const schema::ClassMatcher *matcher);
@@ -314,6 +487,10 @@ private:
     std::atomic<uint32_t> dex_cross_flag = 0;
     std::atomic<uint32_t> dex_flag = 0;
     uint32_t dex_id;
+    // sources that loaded this dex image, more than one when identical images are deduplicated
+    std::vector<uint32_t> source_ids;
+    bool verified = false;
+    uint32_t computed_checksum = 0;
     mutable std::mutex init_cache_state_mutex;
     mutable std::condition_variable init_cache_state_cv;
     uint32_t init_cache_inflight_flags = 0;
@@ -327,6 +504,11 @@ private:
     phmap::flat_hash_map<uint32_t /*field_id*/, schema::TargetElementType> target_element_map;
     phmap::flat_hash_map<uint32_t /*field_id*/, schema::RetentionPolicyType> retention_map;
 
+    std::mutex package_type_mask_mutex;
+    std::optional<bool> type_names_sorted;
+    // most recently used last
+    std::vector<std::pair<std::string, std::shared_ptr<const internal::PackageTypeMask>>> package_type_masks;
+
     // mutex hash pool
     std::unique_ptr<std::array<std::mutex, 32>> type_def_mutexes = std::make_unique<std::array<std::mutex, 32>>();
 
@@ -346,18 +528,39 @@ private:
     std::vector<std::optional<std::string>> method_descriptors;
     // stable base member indexes; after init only members declared in this dex stay here
     std::vector<std::vector<uint32_t /*method_id*/>> class_method_ids;
-    // one-shot worklists for cross-ref against members whose declaring class is outside this dex
-    std::vector<std::vector<uint32_t /*method_id*/>> pending_cross_ref_method_ids;
+    // types declared outside this dex whose referenced methods / fields are not linked yet, a
+    // flag stays set until the declaring class is found in some dex. The member ids are not
+    // kept, PutCrossRef reads them back from the sorted method_ids / field_ids
+    std::vector<bool> pending_cross_ref_method_types;
+    std::vector<bool> pending_cross_ref_field_types;
     std::vector<uint32_t /*access_flag*/> method_access_flags;
     std::vector<std::optional<std::string>> field_descriptors;
     std::vector<std::vector<uint32_t /*field_id*/>> class_field_ids;
-    std::vector<std::vector<uint32_t /*field_id*/>> pending_cross_ref_field_ids;
     std::vector<uint32_t /*access_flag*/> field_access_flags;
     std::vector<const dex::Code *> method_codes;
     // method parameter types
     std::vector<const dex::TypeList *> proto_type_list;
     std::unique_ptr<LazyMethodOpCodesSlot[]> lazy_method_opcode_slots;
     std::vector<std::optional<std::vector<uint8_t /*opcode*/>>> method_opcode_seq;
+    // op code 3-grams of every method with code, keyed by op0 << 16 | op1 << 8 | op2. the sorted
+    // method ids of opcode_ngram_keys[i] are postings[offsets[i], offsets[i + 1])
+    std::vector<uint32_t> opcode_ngram_keys;
+    std::vector<uint32_t> opcode_ngram_offsets;
+    std::vector<uint32_t> opcode_ngram_postings;
+    // method/field ids by name and method ids by proto shorty, built under kMemberNameIndex
+    internal::NamePostings method_name_postings;
+    internal::NamePostings field_name_postings;
+    internal::NamePostings method_shorty_postings;
+    // method ids by numeric constant, built under kUsingNumberIndex
+    internal::NumberPostings method_number_postings;
+    // string pool suffix array and the methods using each string id, built under kStringIndex
+    internal::StringSuffixArray string_suffix_array;
+    std::vector<uint32_t> string_method_offsets;
+    std::vector<uint32_t> string_method_ids;
+    // built under kTypeNameIndex
+    internal::TypeNameTrigramIndex type_name_trigram_index;
+    std::mutex type_name_candidates_mutex;
+    phmap::flat_hash_map<std::string, std::shared_ptr<const internal::TypeNameCandidates>> type_name_candidates;
     std::vector<ir::AnnotationSet *> class_annotations;
     std::vector<ir::AnnotationSet *> method_annotations;
     std::vector<ir::AnnotationSet *> field_annotations;
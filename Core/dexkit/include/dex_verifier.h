@@ -0,0 +1,50 @@
+// DexKit - An high-performance runtime parsing library for dex
+// implemented in C++.
+// Copyright (C) 2022-2023 LuckyPray
+// https://github.com/LuckyPray/DexKit
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+// <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "mmap.h"
+#include "ThreadPool.h"
+
+namespace dexkit {
+
+struct DexVerifyResult {
+    bool valid = false;
+    // adler32 over everything after magic and checksum, same range as header->checksum
+    uint32_t checksum = 0;
+};
+
+// check the header, section bounds and map_list of the logical dex at image + offset
+bool VerifyDexHeader(const uint8_t *image, size_t image_len, uint32_t offset);
+
+// verify every (image, offset) pair, checksums of large dex files are split into chunks
+// that are hashed in parallel and merged with adler32_combine
+std::vector<DexVerifyResult> VerifyDexImages(
+        const std::vector<std::pair<std::shared_ptr<MemMap>, uint32_t>> &items,
+        ThreadPool &pool
+);
+
+} // namespace dexkit
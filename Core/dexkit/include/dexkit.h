@@ -26,15 +26,16 @@
 #include <deque>
 #include <atomic>
 #include <condition_variable>
+#include <future>
 #include <memory>
 
 #include "flatbuffers/flatbuffers.h"
 #include "zip_archive.h"
 #include "dexkit_error.h"
 #include "dex_item.h"
-#include "package_trie.h"
 #include "analyze.h"
 #include "query_executor.h"
+#include "query_options.h"
 
 #define BATCH_SIZE 1000
 
@@ -42,6 +43,13 @@ namespace dexkit {
 
 class DexItem;
 
+namespace internal {
+struct DexHits;
+struct IdSet;
+class QueryResultCache;
+class ClassHierarchy;
+}
+
 class DexKit {
 public:
     class QueryExecutionGuard {
@@ -60,12 +68,29 @@ public:
     };
 
 
-    explicit DexKit() = default;
+    explicit DexKit();
     explicit DexKit(std::string_view apk_path, int unzip_thread_num = 0);
-    ~DexKit() = default;
+    ~DexKit();
 
     void SetThreadNum(int num);
     void SetMaxConcurrentQueries(uint32_t max_concurrent_queries);
+    // validate header/map_list bounds and the adler32 checksum of every dex added afterwards,
+    // images that fail are skipped and the Add* call returns DEX_VERIFY_FAILED
+    void SetDexVerifyEnabled(bool enabled);
+    [[nodiscard]] bool IsDexVerifyEnabled() const;
+    // Find* seed their candidates from the type name, member name, op code, number, string,
+    // reference and hierarchy indexes; when disabled every query scans its whole scope instead,
+    // the results are the same either way
+    void SetQueryIndexEnabled(bool enabled);
+    [[nodiscard]] bool IsQueryIndexEnabled() const;
+    // FindClass/FindMethod/FindField results are kept per canonical query until a source is added,
+    // bounded by an approximate byte size; 0 (the default) disables the cache
+    void SetQueryResultCacheCapacity(size_t capacity_bytes);
+    void ClearQueryResultCache();
+    // the file is bound to the checksum and signature of every loaded dex and to the dex ids of
+    // every source, loading it into a different dex set returns QUERY_CACHE_MISMATCH
+    [[nodiscard]] Error SaveQueryResultCache(std::string_view path);
+    Error LoadQueryResultCache(std::string_view path);
 #if DEXKIT_ENABLE_INTERNAL_METRICS
     void SetQueryMetricsEnabled(bool enabled);
     [[nodiscard]] QuerySchedulerMetricsSnapshot GetQuerySchedulerMetricsSnapshot() const;
@@ -74,19 +99,44 @@ public:
     [[nodiscard]] QueryMetricsHistorySnapshot GetQueryMetricsHistorySnapshot() const;
     void ResetQueryMetricsHistory();
 #endif
+    // builds every cache except the opt-in string index, see BuildStringIndex
     Error InitFullCache();
+    // builds a suffix array over the string pool of every loaded dex (and of dexes added later),
+    // case sensitive literal using_strings matchers of FindMethod then seed their candidates from
+    // it. in the background the call returns at once and the dexes are indexed one by one on a
+    // dedicated thread, queries scan as before until their dex is ready
+    Error BuildStringIndex(bool background = false);
+    // bytes held by the string indexes built so far
+    size_t GetStringIndexMemoryUsage();
     Error AddDex(uint8_t *data, size_t size);
     Error AddImage(std::unique_ptr<MemMap> dex_image);
     Error AddImage(std::vector<std::unique_ptr<MemMap>> dex_images);
     Error AddZipPath(std::string_view apk_path, int unzip_thread_num = 0);
     [[nodiscard]] Error ExportDexFile(std::string_view path) const;
     [[nodiscard]] int GetDexNum() const;
+    // every AddDex/AddImage/AddZipPath call registers one source, source ids follow the call order.
+    // identical dex images (same header checksum and signature) are loaded once and shared by sources.
+    [[nodiscard]] int GetSourceNum() const;
+    [[nodiscard]] std::vector<uint16_t> GetSourceDexIds(uint32_t source_id) const;
 
-    std::unique_ptr<flatbuffers::FlatBufferBuilder> FindClass(const schema::FindClass *query);
-    std::unique_ptr<flatbuffers::FlatBufferBuilder> FindMethod(const schema::FindMethod *query);
-    std::unique_ptr<flatbuffers::FlatBufferBuilder> FindField(const schema::FindField *query);
-    std::unique_ptr<flatbuffers::FlatBufferBuilder> BatchFindClassUsingStrings(const schema::BatchFindClassUsingStrings *query);
-    std::unique_ptr<flatbuffers::FlatBufferBuilder> BatchFindMethodUsingStrings(const schema::BatchFindMethodUsingStrings *query);
+    std::unique_ptr<flatbuffers::FlatBufferBuilder> FindClass(const schema::FindClass *query, const QueryOptions &options = {});
+    std::unique_ptr<flatbuffers::FlatBufferBuilder> FindMethod(const schema::FindMethod *query, const QueryOptions &options = {});
+    std::unique_ptr<flatbuffers::FlatBufferBuilder> FindField(const schema::FindField *query, const QueryOptions &options = {});
+    std::unique_ptr<flatbuffers::FlatBufferBuilder> BatchFindClassUsingStrings(const schema::BatchFindClassUsingStrings *query, const QueryOptions &options = {});
+    std::unique_ptr<flatbuffers::FlatBufferBuilder> BatchFindMethodUsingStrings(const schema::BatchFindMethodUsingStrings *query, const QueryOptions &options = {});
+    // independent queries sharing one scan per dex slice, results follow the query order. queries
+    // with in_* restrictions, find_first, an exact class lookup or a candidate seed (super class,
+    // interface, op code or exact field/method reference) still run on their own
+    std::vector<std::unique_ptr<flatbuffers::FlatBufferBuilder>> MultiFindClass(const std::vector<const schema::FindClass *> &queries, const QueryOptions &options = {});
+    std::vector<std::unique_ptr<flatbuffers::FlatBufferBuilder>> MultiFindMethod(const std::vector<const schema::FindMethod *> &queries, const QueryOptions &options = {});
+    // runs every stage under one query execution, intermediate results stay in per-dex id sets and
+    // only the output stage is serialized (as the result of the matching Find* call)
+    Error ExecuteQueryPipeline(const schema::QueryPipeline *pipeline, std::unique_ptr<flatbuffers::FlatBufferBuilder> &result, const QueryOptions &options = {});
+    // classes extending class_descriptor, transitively unless direct_only; the descriptor does not
+    // need to be declared by a loaded dex (e.g. Landroid/app/Activity;)
+    std::unique_ptr<flatbuffers::FlatBufferBuilder> FindSubclasses(std::string_view class_descriptor, bool direct_only = false);
+    // classes implementing interface_descriptor, unless direct_only also through super classes and sub interfaces
+    std::unique_ptr<flatbuffers::FlatBufferBuilder> FindImplementors(std::string_view interface_descriptor, bool direct_only = false);
 
     std::unique_ptr<flatbuffers::FlatBufferBuilder> GetClassData(std::string_view descriptor);
     std::unique_ptr<flatbuffers::FlatBufferBuilder> GetMethodData(std::string_view descriptor);
@@ -109,7 +159,13 @@ public:
     std::unique_ptr<flatbuffers::FlatBufferBuilder> FieldPutMethods(int64_t encode_field_id);
 
     std::pair<DexItem *, uint32_t> GetClassDeclaredPair(std::string_view class_name);
+    // prefer the declaration loaded by a source shared with referrer when several sources declare the class
+    std::pair<DexItem *, uint32_t> GetClassDeclaredPair(std::string_view class_name, const DexItem *referrer);
+    // only return declarations inside dex_scope, an empty scope accepts every dex
+    std::pair<DexItem *, uint32_t> GetClassDeclaredPair(std::string_view class_name, const std::vector<bool> &dex_scope);
     DexItem *GetDexItem(uint16_t dex_id);
+    // built on first use after the dex set changes, only valid inside a query execution
+    std::shared_ptr<const internal::ClassHierarchy> GetClassHierarchy();
     void PutDeclaredClass(std::string_view class_name, uint16_t dex_id, uint32_t type_idx);
 
 private:
@@ -126,6 +182,13 @@ private:
     std::atomic<uint32_t> dex_cnt = 0;
     std::atomic<uint32_t> _thread_num = std::thread::hardware_concurrency();
     std::atomic<uint32_t> max_concurrent_queries_ = 0;
+    std::atomic<bool> dex_verify_enabled_ = false;
+    std::atomic<bool> query_index_enabled_ = true;
+    std::unique_ptr<internal::QueryResultCache> query_result_cache_;
+    std::mutex class_hierarchy_mutex_;
+    std::shared_ptr<const internal::ClassHierarchy> class_hierarchy_;
+    std::mutex string_index_mutex_;
+    std::future<void> string_index_build_;
 #if DEXKIT_ENABLE_INTERNAL_METRICS
     std::atomic<bool> query_metrics_enabled_ = false;
 #endif
@@ -139,18 +202,74 @@ private:
 #endif
     std::vector<std::shared_ptr<MemMap>> images;
     std::vector<std::unique_ptr<DexItem>> dex_items;
+    std::vector<std::vector<uint16_t /*dex_id*/>> source_dex_ids;
+    // key: header bytes from checksum to file_size, points into the owning image. Images with
+    // equal keys but different content are kept apart.
+    phmap::flat_hash_map<std::string_view, std::vector<uint16_t /*dex_id*/>> dex_image_dedup_map;
+    // the lowest dex_id wins, same as runtime classpath order
     phmap::flat_hash_map<std::string_view, std::pair<uint16_t /*dex_id*/, uint32_t /*type_idx*/>> class_declare_dex_map;
+    // only classes declared by more than one dex, sorted by dex_id
+    phmap::flat_hash_map<std::string_view, std::vector<std::pair<uint16_t /*dex_id*/, uint32_t /*type_idx*/>>> class_declare_conflict_map;
     std::atomic<uint32_t> cross_ref_aggregate_flag = 0;
     mutable std::mutex cross_ref_aggregate_state_mutex;
     mutable std::condition_variable cross_ref_aggregate_state_cv;
     uint32_t cross_ref_aggregate_inflight_flags = 0;
 
+    Error AddSource(std::vector<std::pair<std::shared_ptr<MemMap>, uint32_t>> &add_items, size_t image_begin);
+    void BeginExclusiveUpdate();
+    void FinishExclusiveUpdate();
+    void WarmUpAddedDexItems(size_t first_added_dex_id);
+    [[nodiscard]] std::vector<bool> BuildDexScope(const QueryOptions &options) const;
+    // source_ids set on a FindClass/FindMethod/FindField query replace options.source_ids
+    template<typename Query>
+    [[nodiscard]] static QueryOptions ApplyQuerySources(const Query *query, const QueryOptions &options);
+    // empty when the result cache is disabled
+    template<typename Query>
+    [[nodiscard]] std::string BuildQueryCacheKey(const Query *query, const QueryOptions &options) const;
+    [[nodiscard]] std::string BuildQueryCacheFingerprint() const;
+    bool LookupQueryCache(const std::string &key, std::vector<internal::DexHits> &hits);
+    void StoreQueryCache(std::string key, const std::vector<internal::DexHits> &hits);
     void InitDexCache(uint32_t init_flags);
     [[nodiscard]] QueryExecutionGuard EnterQueryExecution(uint32_t required_flags);
     void LeaveQueryExecution();
     [[nodiscard]] bool NeedWarmUp(uint32_t init_flags) const;
+    // long-lived pool shared by queries and every internal parallel phase, sized by SetThreadNum
+    [[nodiscard]] std::shared_ptr<ThreadPool> GetOrCreateSharedThreadPool() const;
+    [[nodiscard]] std::shared_ptr<ThreadPool> GetOrCreateSharedThreadPoolLocked(uint32_t normalized_thread_num) const;
     [[nodiscard]] std::shared_ptr<QueryScheduler> GetOrCreateSharedQueryScheduler(uint32_t thread_num) const;
     [[nodiscard]] std::unique_ptr<IQueryExecutor> CreateQueryExecutor(QueryContext &query_context) const;
+    std::vector<internal::DexHits> FindClassHits(
+            const schema::FindClass *query,
+            AnalyzeRet analyze_ret,
+            const std::vector<internal::IdSet> &dex_class_map,
+            const std::vector<bool> &dex_scope,
+            const QueryOptions &options,
+            QueryContext &query_context
+    );
+    std::vector<internal::DexHits> FindMethodHits(
+            const schema::FindMethod *query,
+            AnalyzeRet analyze_ret,
+            const std::vector<internal::IdSet> &dex_class_map,
+            const std::vector<internal::IdSet> &dex_method_map,
+            const std::vector<bool> &dex_scope,
+            const QueryOptions &options,
+            QueryContext &query_context
+    );
+    std::vector<internal::DexHits> FindFieldHits(
+            const schema::FindField *query,
+            AnalyzeRet analyze_ret,
+            const std::vector<internal::IdSet> &dex_class_map,
+            const std::vector<internal::IdSet> &dex_field_map,
+            const std::vector<bool> &dex_scope,
+            const QueryOptions &options,
+            QueryContext &query_context
+    );
+    // declaring_classes maps method/field hits to the classes declaring them
+    [[nodiscard]] std::vector<internal::IdSet> BuildStageIdSets(
+            const std::vector<internal::DexHits> &hits,
+            QueryKind hit_kind,
+            bool declaring_classes
+    ) const;
 #if DEXKIT_ENABLE_INTERNAL_METRICS
     void RecordQueryMetrics(const QueryContext &query_context);
 #endif
@@ -163,13 +282,6 @@ private:
     static constexpr size_t kQueryMetricsHistoryCapacity = 256;
 #endif
 
-    static void BuildPackagesMatchTrie(
-            const flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>> *search_packages,
-            const flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>> *exclude_packages,
-            bool ignore_package_case,
-            trie::PackageTrie &trie
-    );
-
     static std::map<std::string_view, std::set<std::string_view>>
     BuildBatchFindKeywordsMap(
             const flatbuffers::Vector<flatbuffers::Offset<dexkit::schema::BatchUsingStringsMatcher>> *matchers,
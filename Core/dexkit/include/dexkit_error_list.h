@@ -30,7 +30,10 @@
     V(OPEN_ZIP_FILE_FAILED, "Open zip file failed") \
     V(OPEN_FILE_FAILED, "Open file failed") \
     V(ADD_DEX_AFTER_CROSS_BUILD, "Add dex after cross build")\
-    V(WRITE_FILE_INCOMPLETE, "Incomplete file written")
+    V(WRITE_FILE_INCOMPLETE, "Incomplete file written")\
+    V(DEX_VERIFY_FAILED, "Dex verify failed")\
+    V(INVALID_QUERY_PIPELINE, "Invalid query pipeline")\
+    V(QUERY_CACHE_MISMATCH, "Query cache file does not match the loaded dex")
 
 
 #endif //DEXKIT_ERROR_LIST_H
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string_view>
+#include <vector>
+
+#include "literal_prefilter.h"
+#include "parallel_hashmap/phmap.h"
+#include "schema/querys_generated.h"
+
+namespace dexkit {
+
+namespace internal {
+
+// Query-wide layout of the keyword masks used by BatchFind*UsingStrings. Every distinct keyword
+// owns one bit, a union key matches once all of its required bits are hit.
+struct BatchUsingStringsPlan {
+    phmap::flat_hash_map<std::string_view, uint32_t> keyword_bits;
+    std::vector<schema::StringMatchType> keyword_match_types;
+    uint32_t empty_keyword_bit = UINT32_MAX;
+    size_t mask_words = 0;
+    std::vector<std::string_view> union_keys;
+    // union_keys.size() * mask_words
+    std::vector<uint64_t> required_masks;
+    // every union key is filed under one of its keywords and only tested when that bit is hit
+    std::vector<std::vector<uint32_t>> anchored_keys;
+    // over the non-empty keywords, strings it rejects skip the trie
+    MultiLiteralPrefilter prefilter;
+
+    [[nodiscard]] bool empty() const {
+        return union_keys.empty();
+    }
+};
+
+// Keyword hits of the strings [first_string_idx, first_string_idx + mask_offsets.size()) of one dex,
+// strings without any hit share the kNoHit entry.
+struct BatchStringHitMasks {
+    static constexpr uint32_t kNoHit = UINT32_MAX;
+
+    uint32_t first_string_idx = 0;
+    std::vector<uint32_t> mask_offsets;
+    std::vector<uint64_t> masks;
+};
+
+BatchUsingStringsPlan BuildBatchUsingStringsPlan(
+        const std::map<std::string_view, std::set<std::string_view>> &keywords_map,
+        const phmap::flat_hash_map<std::string_view, schema::StringMatchType> &match_type_map
+);
+
+// Concatenates the per-slice scans of one dex, parts must be ordered by first_string_idx.
+BatchStringHitMasks MergeBatchStringHitMasks(std::vector<BatchStringHitMasks> &&parts);
+
+} // namespace internal
+
+} // namespace dexkit
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parallel_hashmap/phmap.h"
+#include "schema/querys_generated.h"
+
+namespace dexkit {
+
+namespace internal {
+
+class ClassHierarchyBuilder;
+
+// Program-wide inheritance index over every class declared by a loaded dex or referenced as a
+// super class/interface. A node takes its super class and interfaces from the declaration in the
+// lowest dex id, the one GetClassDeclaredPair(name) resolves; types that are only referenced
+// (framework classes) are roots. Nodes carry preorder intervals of the super class forest, so a
+// subclass test is two compares and the descendants of a node are one contiguous range.
+class ClassHierarchy {
+public:
+    static constexpr uint32_t kNoNode = UINT32_MAX;
+    static constexpr uint16_t kNoDex = UINT16_MAX;
+
+    [[nodiscard]] uint32_t FindNode(std::string_view descriptor) const;
+    [[nodiscard]] size_t NodeCount() const {
+        return descriptors_.size();
+    }
+    [[nodiscard]] bool IsInterface(uint32_t node) const {
+        return is_interface_[node];
+    }
+    // {kNoDex, 0} for types no loaded dex declares
+    [[nodiscard]] std::pair<uint16_t, uint32_t> GetDeclaration(uint32_t node) const {
+        return {declared_dex_[node], declared_type_idx_[node]};
+    }
+    // classes extending node, transitively unless direct_only; interfaces are not reported
+    void CollectSubclasses(uint32_t node, bool direct_only, std::vector<uint32_t> &nodes) const;
+    // classes implementing node, unless direct_only also through super classes and sub interfaces
+    void CollectImplementors(uint32_t node, bool direct_only, std::vector<uint32_t> &nodes) const;
+
+    // ascending class_def indexes of every class def in dex_id (declaring the class or not) whose
+    // super class / interface list names node
+    [[nodiscard]] std::span<const uint32_t> GetDirectSubclassDefs(uint32_t node, uint16_t dex_id) const;
+    [[nodiscard]] std::span<const uint32_t> GetDirectImplementorDefs(uint32_t node, uint16_t dex_id) const;
+
+private:
+    friend class ClassHierarchyBuilder;
+
+    struct DefEdges {
+        // per node ranges into dex_ids/def_idxs, sorted by (dex_id, class_def_idx)
+        std::vector<uint32_t> offsets;
+        std::vector<uint16_t> dex_ids;
+        std::vector<uint32_t> def_idxs;
+
+        [[nodiscard]] std::span<const uint32_t> Get(uint32_t node, uint16_t dex_id) const;
+    };
+
+    std::vector<std::string_view> descriptors_;
+    phmap::flat_hash_map<std::string_view, uint32_t> node_index_;
+    std::vector<uint16_t> declared_dex_;
+    std::vector<uint32_t> declared_type_idx_;
+    std::vector<bool> is_interface_;
+    // [begin, end) of the subtree of each node in preorder_
+    std::vector<uint32_t> preorder_begin_;
+    std::vector<uint32_t> preorder_end_;
+    std::vector<uint32_t> preorder_;
+    std::vector<uint32_t> child_offsets_;
+    std::vector<uint32_t> children_;
+    // nodes whose declaration directly lists the interface node
+    std::vector<uint32_t> implementor_offsets_;
+    std::vector<uint32_t> implementors_;
+    DefEdges subclass_defs_;
+    DefEdges implementor_defs_;
+};
+
+// Collects class defs dex by dex, dexes must be added in ascending dex id order.
+class ClassHierarchyBuilder {
+public:
+    void AddClassDef(uint16_t dex_id, uint32_t class_def_idx, uint32_t type_idx, std::string_view descriptor,
+                     std::string_view super_descriptor, bool is_interface);
+    // interface of the class def added last
+    void AddInterface(std::string_view interface_descriptor);
+    std::shared_ptr<const ClassHierarchy> Build();
+
+private:
+    struct DefEdge {
+        uint32_t node;
+        uint16_t dex_id;
+        uint32_t class_def_idx;
+    };
+
+    std::unique_ptr<ClassHierarchy> hierarchy_ = std::make_unique<ClassHierarchy>();
+    std::vector<uint32_t> parents_;
+    std::vector<std::pair<uint32_t /*interface*/, uint32_t /*node*/>> implementor_edges_;
+    std::vector<DefEdge> subclass_def_edges_;
+    std::vector<DefEdge> implementor_def_edges_;
+    uint32_t last_node_ = ClassHierarchy::kNoNode;
+    bool last_declares_ = false;
+    uint16_t last_dex_id_ = 0;
+    uint32_t last_class_def_idx_ = 0;
+
+    uint32_t GetOrAddNode(std::string_view descriptor);
+    static void BuildDefEdges(std::vector<DefEdge> &edges, size_t node_count, ClassHierarchy::DefEdges &out);
+};
+
+struct ClassHierarchySeed {
+    bool is_interface = false;
+    std::string descriptor;
+};
+
+// exact super class / interface names a class matched by matcher must declare itself, only
+// Equal class_name matchers without ignore_case qualify
+std::vector<ClassHierarchySeed> GetClassHierarchySeeds(const schema::ClassMatcher *matcher);
+
+} // namespace internal
+
+} // namespace dexkit
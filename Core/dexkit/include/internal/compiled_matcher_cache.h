@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "parallel_hashmap/phmap.h"
+
+namespace dexkit {
+
+namespace internal {
+
+enum class CompiledMatcherKind : uint8_t {
+    UsingStringsKeywords = 1,
+    TypeNameDescriptor,
+    OpCodes,
+    Regex,
+};
+
+// Process-wide immutable artifacts compiled from sub-matchers (keyword tries, descriptor
+// conversions, op code patterns, regexes), keyed by the canonical bytes of the sub-matcher so that
+// every query building an equal sub-matcher reuses them. Matcher paths only reach this once per
+// query and thread, the per-query GetMatcherCache memo holds the returned reference.
+class CompiledMatcherCache {
+public:
+    static constexpr size_t kDefaultCapacityBytes = 32 * 1024 * 1024;
+
+    static CompiledMatcherCache &Global();
+
+    // factory() builds the artifact, bytes_of(artifact) estimates its heap size for the bound
+    template<typename T, typename Factory, typename BytesOf>
+    std::shared_ptr<const T> GetOrCreate(CompiledMatcherKind kind, std::string_view key, Factory &&factory, BytesOf &&bytes_of) {
+        auto full_key = MakeKey(kind, key);
+        auto &shard = shards_[phmap::Hash<std::string>()(full_key) % kShardCount];
+        {
+            std::shared_lock lock(shard.mutex);
+            auto it = shard.entries.find(full_key);
+            if (it != shard.entries.end()) {
+                return std::static_pointer_cast<const T>(it->second.value);
+            }
+        }
+        // built outside the lock, a concurrent builder of the same key loses and adopts the winner
+        auto value = std::make_shared<const T>(factory());
+        auto bytes = sizeof(T) + full_key.size() * 2 + bytes_of(*value);
+        return std::static_pointer_cast<const T>(Insert(shard, std::move(full_key), value, bytes));
+    }
+
+    void SetCapacity(size_t capacity_bytes);
+    void Clear();
+
+private:
+    static constexpr size_t kShardCount = 16;
+
+    struct Entry {
+        std::shared_ptr<const void> value;
+        size_t bytes = 0;
+    };
+
+    struct Shard {
+        std::shared_mutex mutex;
+        phmap::flat_hash_map<std::string, Entry> entries;
+        // insertion order, evicted oldest first
+        std::deque<std::string> order;
+        size_t bytes = 0;
+    };
+
+    std::array<Shard, kShardCount> shards_;
+    std::atomic<size_t> shard_capacity_bytes_ = kDefaultCapacityBytes / kShardCount;
+
+    static std::string MakeKey(CompiledMatcherKind kind, std::string_view key);
+    std::shared_ptr<const void> Insert(Shard &shard, std::string key, std::shared_ptr<const void> value, size_t bytes);
+    static void EvictLocked(Shard &shard, size_t capacity_bytes);
+};
+
+} // namespace internal
+
+} // namespace dexkit
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "flatbuffers/flatbuffers.h"
+
+namespace dexkit {
+
+namespace internal {
+
+// in_classes/in_methods/in_fields restriction of one dex: sorted members for iteration and a
+// dense bitset for membership probes.
+struct IdSet {
+    std::vector<uint32_t> ids;
+    std::vector<uint64_t> words;
+
+    [[nodiscard]] bool contains(uint32_t id) const {
+        auto word_idx = id / 64;
+        return word_idx < words.size() && ((words[word_idx] >> (id % 64)) & 1);
+    }
+
+    [[nodiscard]] bool empty() const {
+        return ids.empty();
+    }
+};
+
+IdSet BuildIdSet(std::vector<uint32_t> ids);
+
+// indexed by dex id, encoded ids are (dex_id << 32 | idx); ids of unknown dexes are dropped.
+// empty when encoded_ids is null, i.e. the query has no restriction of this kind
+std::vector<IdSet> BuildDexIdSets(const flatbuffers::Vector<int64_t> *encoded_ids, size_t dex_count);
+
+// null when the query is not restricted
+inline const IdSet *GetDexIdSet(const std::vector<IdSet> &dex_id_sets, uint32_t dex_id) {
+    return dex_id_sets.empty() ? nullptr : &dex_id_sets[dex_id];
+}
+
+} // namespace internal
+
+} // namespace dexkit
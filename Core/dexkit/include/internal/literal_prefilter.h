@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace dexkit {
+
+namespace internal {
+
+// Teddy style multi-literal filter run before an Aho-Corasick scan. The literals are spread over 8
+// buckets and the first bytes of each one (up to 3, bounded by the shortest literal) are looked up
+// 16 positions at a time through nibble shuffles (SSSE3 / NEON), a scalar byte table walk covers
+// the rest. ASCII case is folded, so it never rejects a string any literal matches.
+class MultiLiteralPrefilter {
+public:
+    MultiLiteralPrefilter() = default;
+    // disabled when there are no literals, too many of them or an empty one
+    explicit MultiLiteralPrefilter(const std::vector<std::string_view> &literals);
+
+    [[nodiscard]] bool IsEnabled() const { return fingerprint_len_ > 0; }
+    // false only when str holds none of the literals, always true when disabled
+    [[nodiscard]] bool MayContain(std::string_view str) const;
+
+private:
+    static constexpr size_t kMaxFingerprint = 3;
+
+    uint32_t fingerprint_len_ = 0;
+    // bucket bits of every fingerprint byte, indexed by its low / high nibble
+    std::array<std::array<uint8_t, 16>, kMaxFingerprint> low_nibbles_{};
+    std::array<std::array<uint8_t, 16>, kMaxFingerprint> high_nibbles_{};
+    // bucket bits of every fingerprint byte value
+    std::array<std::array<uint8_t, 256>, kMaxFingerprint> bytes_{};
+
+    [[nodiscard]] bool MayContainAt(const uint8_t *p) const;
+};
+
+} // namespace internal
+
+} // namespace dexkit
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "parallel_hashmap/phmap.h"
+
+namespace dexkit {
+
+namespace internal {
+
+// Inverted index from a string (member name, proto shorty) to the ascending ids carrying it.
+struct NamePostings {
+    phmap::flat_hash_map<std::string_view, uint32_t> slots;
+    // ids of slot i are ids[offsets[i], offsets[i + 1])
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> ids;
+
+    [[nodiscard]] std::span<const uint32_t> Find(std::string_view key) const;
+};
+
+// key_of(id) for every id in [0, count), the keys must outlive the postings
+template<typename KeyOf>
+NamePostings BuildNamePostings(uint32_t count, KeyOf &&key_of) {
+    NamePostings postings;
+    std::vector<uint32_t> id_slots(count);
+    for (uint32_t id = 0; id < count; ++id) {
+        auto [it, inserted] = postings.slots.try_emplace(key_of(id), (uint32_t) postings.slots.size());
+        id_slots[id] = it->second;
+    }
+    postings.offsets.assign(postings.slots.size() + 1, 0);
+    for (auto slot: id_slots) {
+        ++postings.offsets[slot + 1];
+    }
+    for (size_t i = 0; i + 1 < postings.offsets.size(); ++i) {
+        postings.offsets[i + 1] += postings.offsets[i];
+    }
+    postings.ids.resize(count);
+    auto next = postings.offsets;
+    for (uint32_t id = 0; id < count; ++id) {
+        postings.ids[next[id_slots[id]]++] = id;
+    }
+    return postings;
+}
+
+} // namespace internal
+
+} // namespace dexkit
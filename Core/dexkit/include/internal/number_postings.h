@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+#include "schema/querys_generated.h"
+
+namespace dexkit {
+
+namespace internal {
+
+// Inverted index from the numeric constants of method code to the ascending method ids using
+// them. Integral matchers compare GetLongValue exactly, floating ones GetDoubleValue within EPS,
+// so every constant is posted under its long value and, unless it is a byte/short, under the
+// bucket of its double value.
+class NumberPostings {
+public:
+    // postings of the methods that may hold a constant number matches, at most three lists
+    void Collect(EncodeNumber number, std::vector<std::span<const uint32_t>> &lists) const;
+
+private:
+    friend class NumberPostingsBuilder;
+
+    struct Table {
+        // ids of keys[i] are ids[offsets[i], offsets[i + 1])
+        std::vector<int64_t> keys;
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> ids;
+
+        [[nodiscard]] std::span<const uint32_t> Find(int64_t key) const;
+    };
+
+    Table long_table_;
+    Table double_table_;
+};
+
+// Methods must be added in ascending id order.
+class NumberPostingsBuilder {
+public:
+    void Add(uint32_t method_idx, const std::vector<EncodeNumber> &numbers);
+    NumberPostings Build();
+
+private:
+    std::vector<std::pair<int64_t, uint32_t>> long_entries_;
+    std::vector<std::pair<int64_t, uint32_t>> double_entries_;
+    std::vector<int64_t> keys_;
+
+    static void BuildTable(std::vector<std::pair<int64_t, uint32_t>> &entries, NumberPostings::Table &table);
+};
+
+// |a - b| < EPS implies the buckets of a and b are at most one apart, nullopt for NaN
+std::optional<int64_t> GetDoubleBucket(double value);
+
+// using_numbers of the matcher as the EncodeNumbers IsUsingNumbersMatched compares against
+std::vector<EncodeNumber> GetMatcherNumbers(const schema::MethodMatcher *matcher);
+
+} // namespace internal
+
+} // namespace dexkit
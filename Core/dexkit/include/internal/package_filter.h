@@ -0,0 +1,75 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "flatbuffers/flatbuffers.h"
+
+namespace dexkit {
+
+namespace internal {
+
+// search_packages/exclude_packages of one query as descriptor prefixes, eg: "Lcom/example/".
+// Prefixes are folded to lower case when ignore_case is set.
+struct PackageFilter {
+    bool has_search_packages = false;
+    bool has_exclude_packages = false;
+    bool ignore_case = false;
+    std::vector<std::string> search_packages;
+    std::vector<std::string> exclude_packages;
+    // identical package lists share the per-dex type masks
+    std::string cache_key;
+
+    [[nodiscard]] bool empty() const {
+        return !has_search_packages && !has_exclude_packages;
+    }
+};
+
+// One bit per type id of a dex, set when the type passes the package filter.
+struct PackageTypeMask {
+    std::vector<uint64_t> words;
+
+    [[nodiscard]] bool Test(uint32_t type_idx) const {
+        return (words[type_idx / 64] >> (type_idx % 64)) & 1;
+    }
+};
+
+PackageFilter BuildPackageFilter(
+        const flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>> *search_packages,
+        const flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>> *exclude_packages,
+        bool ignore_case
+);
+
+// direct prefix test for a single descriptor, used where building the whole dex mask does not pay off
+bool IsTypeInPackageFilter(const PackageFilter &filter, std::string_view type_name);
+
+// type_names_sorted allows resolving every package as one contiguous range of descriptors
+PackageTypeMask BuildPackageTypeMask(
+        const PackageFilter &filter,
+        const std::vector<std::string_view> &type_names,
+        bool type_names_sorted
+);
+
+// first type id in [from, end) passing the filter, a null mask accepts every type
+inline uint32_t NextPackageType(const PackageTypeMask *mask, uint32_t from, uint32_t end) {
+    if (mask == nullptr || from >= end) {
+        return from;
+    }
+    auto word_idx = from / 64;
+    auto bits = mask->words[word_idx] & (~0ULL << (from % 64));
+    while (bits == 0) {
+        if (++word_idx * 64 >= end) {
+            return end;
+        }
+        bits = mask->words[word_idx];
+    }
+    auto type_idx = static_cast<uint32_t>(word_idx * 64 + std::countr_zero(bits));
+    return type_idx < end ? type_idx : end;
+}
+
+} // namespace internal
+
+} // namespace dexkit
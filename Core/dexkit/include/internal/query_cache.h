@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parallel_hashmap/phmap.h"
+#include "dexkit_error.h"
+#include "schema/querys_generated.h"
+
+namespace dexkit {
+
+namespace internal {
+
+// Byte key of the query semantics: lists the matchers treat as unordered (packages, in_* ids,
+// using_strings, all_of/any_of/none_of and every Hungarian matched list) are sorted, and
+// SimilarRegex strings are rewritten to the plain match type they stand for, so equivalent
+// queries built in a different order share one key.
+std::string CanonicalizeQuery(const schema::FindClass *query);
+
+std::string CanonicalizeQuery(const schema::FindMethod *query);
+
+std::string CanonicalizeQuery(const schema::FindField *query);
+
+struct CachedDexHits {
+    uint32_t dex_id = 0;
+    std::vector<uint32_t> ids;
+};
+
+// id counts of a loaded dex, indexed by dex id
+struct CachedDexBounds {
+    uint32_t type_id_count = 0;
+    uint32_t method_id_count = 0;
+    uint32_t field_id_count = 0;
+};
+
+// LRU of query results bounded by an approximate byte size, a capacity of 0 disables it.
+class QueryResultCache {
+public:
+    void SetCapacity(size_t capacity_bytes);
+    [[nodiscard]] bool IsEnabled() const;
+    [[nodiscard]] bool Get(const std::string &key, std::vector<CachedDexHits> &hits);
+    void Put(std::string key, std::vector<CachedDexHits> hits);
+    void Clear();
+
+    // fingerprint identifies the dex set the results belong to, Load rejects files written for
+    // another one; entries referencing a dex id or a class/method/field id outside dex_bounds
+    // are rejected as well
+    [[nodiscard]] Error Save(std::string_view path, std::string_view fingerprint) const;
+    Error Load(std::string_view path, std::string_view fingerprint, const std::vector<CachedDexBounds> &dex_bounds);
+
+private:
+    struct Entry {
+        std::string key;
+        std::vector<CachedDexHits> hits;
+        size_t bytes = 0;
+    };
+
+    mutable std::mutex mutex_;
+    size_t capacity_bytes_ = 0;
+    size_t size_bytes_ = 0;
+    // most recently used first
+    std::list<Entry> entries_;
+    phmap::flat_hash_map<std::string_view, std::list<Entry>::iterator> index_;
+
+    void PutLocked(std::string key, std::vector<CachedDexHits> hits);
+    void EvictLocked();
+};
+
+} // namespace internal
+
+} // namespace dexkit
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "schema/querys_generated.h"
+
+namespace dexkit {
+
+namespace internal {
+
+// the descriptor IsTypeNameMatched compares an Equal class_name against, nullopt unless the
+// matcher is Equal, case-sensitive and non-empty
+std::optional<std::string> GetExactTypeDescriptor(const schema::StringMatcher *matcher);
+
+// value of an Equal, case-sensitive name matcher
+std::optional<std::string_view> GetExactName(const schema::StringMatcher *matcher);
+
+// proto shorties a method matched by matcher can have: proto_shorty itself, or the shorties
+// spelled by fully exact parameter types (with every return type unless that is exact as well);
+// empty when neither pins it
+std::vector<std::string> GetProtoShortySeeds(const schema::MethodMatcher *matcher);
+
+// a field/method a matcher pins by exact declaring class and name
+struct MemberRefSeed {
+    std::string class_descriptor;
+    std::string_view name;
+    // using_fields only
+    schema::UsingType using_type = schema::UsingType::Any;
+};
+
+// required references of a method matcher that the reverse cross-ref indexes can resolve: every
+// listed using_field/invoking/caller matcher needs a distinct match, so each pinned one must hold
+struct ReferenceSeeds {
+    std::vector<MemberRefSeed> using_fields;
+    std::vector<MemberRefSeed> invoking_methods;
+    std::vector<MemberRefSeed> method_callers;
+
+    [[nodiscard]] bool empty() const {
+        return using_fields.empty() && invoking_methods.empty() && method_callers.empty();
+    }
+};
+
+ReferenceSeeds GetReferenceSeeds(const schema::MethodMatcher *matcher);
+
+} // namespace internal
+
+} // namespace dexkit
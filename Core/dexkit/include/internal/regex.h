@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "schema/querys_generated.h"
+
+namespace dexkit {
+
+namespace internal {
+
+// Plain string matcher every string a regex matches satisfies, value is empty when the regex
+// requires no literal.
+struct RegexLiteral {
+    std::string value;
+    schema::StringMatchType match_type = schema::StringMatchType::Contains;
+    // the regex matches exactly the strings the literal does
+    bool exact = false;
+};
+
+struct RegexProgram;
+class LazyRegexDfa;
+
+// Regular expression matched in linear time: the pattern compiles to a Thompson NFA whose DFA
+// states are built lazily on the first use of each transition and shared by all matching threads,
+// nothing is ever backtracked. Matches anywhere in the string unless anchored with '^' / '$',
+// ignore_case folds ASCII letters only, as kmp does.
+// Supported: literals and escapes (\t \n \xhh \uhhhh \Q...\E ...), '.', classes with ranges,
+// \d \w \s and their negations, groups, '|', greedy or lazy * + ? {n,m}, '^' and '$'. A pattern
+// outside of that never matches.
+class Regex {
+public:
+    Regex(std::string_view pattern, bool ignore_case);
+    Regex(Regex &&) noexcept;
+    ~Regex();
+
+    [[nodiscard]] bool IsValid() const { return valid_; }
+    [[nodiscard]] const RegexLiteral &GetLiteral() const { return literal_; }
+    // true when some substring of str matches
+    [[nodiscard]] bool Search(std::string_view str) const;
+    [[nodiscard]] size_t MemoryUsage() const;
+
+private:
+    bool valid_ = false;
+    bool ignore_case_;
+    RegexLiteral literal_;
+    // both null when the literal is exact
+    std::unique_ptr<const RegexProgram> program_;
+    std::unique_ptr<LazyRegexDfa> dfa_;
+};
+
+// compiled once per pattern and ignore_case, see CompiledMatcherCache
+std::shared_ptr<const Regex> GetCompiledRegex(const schema::StringMatcher *matcher);
+
+} // namespace internal
+
+} // namespace dexkit
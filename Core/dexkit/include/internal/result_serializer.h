@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "flatbuffers/flatbuffer_builder.h"
+
+namespace dexkit {
+
+class DexItem;
+
+namespace internal {
+
+// Query workers only report DexItem-local type/method/field indexes, the metas are written once
+// the query is merged.
+struct DexHits {
+    DexItem *dex = nullptr;
+    std::vector<uint32_t> ids;
+};
+
+struct BatchHits {
+    std::string_view union_key;
+    std::vector<uint32_t> ids;
+};
+
+using BatchDexHits = std::map<std::string_view, std::vector<DexHits>>;
+
+std::unique_ptr<flatbuffers::FlatBufferBuilder> SerializeClassHits(const std::vector<DexHits> &hits);
+
+std::unique_ptr<flatbuffers::FlatBufferBuilder> SerializeMethodHits(const std::vector<DexHits> &hits);
+
+std::unique_ptr<flatbuffers::FlatBufferBuilder> SerializeFieldHits(const std::vector<DexHits> &hits);
+
+std::unique_ptr<flatbuffers::FlatBufferBuilder> SerializeBatchClassHits(const BatchDexHits &hits);
+
+std::unique_ptr<flatbuffers::FlatBufferBuilder> SerializeBatchMethodHits(const BatchDexHits &hits);
+
+} // namespace internal
+
+} // namespace dexkit
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "schema/querys_generated.h"
+
+namespace dexkit {
+
+namespace internal {
+
+// Suffix array over a string pool joined with '\0' separators (MUTF-8 never holds a raw NUL),
+// built in linear time by SA-IS. The suffixes starting with a pattern are one contiguous range,
+// so any literal matcher resolves to its string ids with two binary searches.
+class StringSuffixArray {
+public:
+    StringSuffixArray() = default;
+    explicit StringSuffixArray(const std::vector<std::string_view> &strings);
+
+    // ascending ids of the strings matching value case sensitively, nullopt when the index can't
+    // answer it (empty or NUL holding value, SimilarRegex, Regex)
+    [[nodiscard]] std::optional<std::vector<uint32_t>> Match(std::string_view value, schema::StringMatchType match_type) const;
+    [[nodiscard]] size_t MemoryUsage() const;
+
+private:
+    std::string text_;
+    // text offset of every string, in string id order
+    std::vector<uint32_t> string_offsets_;
+    // sorted suffixes, separator positions excluded
+    std::vector<uint32_t> suffixes_;
+
+    [[nodiscard]] uint32_t GetStringId(uint32_t pos) const;
+};
+
+// s[n - 1] must be the unique smallest symbol 0, symbols are in [0, k)
+void BuildSuffixArray(const uint32_t *s, uint32_t *sa, uint32_t n, uint32_t k);
+
+} // namespace internal
+
+} // namespace dexkit
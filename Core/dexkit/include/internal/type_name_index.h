@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "schema/querys_generated.h"
+
+namespace dexkit {
+
+namespace internal {
+
+// Trigram postings over the ASCII lowercased component type names (array prefix stripped) of a
+// dex. A type name holding a substring holds each of its trigrams, so the intersection of their
+// postings is a superset of the types a substring class_name matcher accepts.
+class TypeNameTrigramIndex {
+public:
+    TypeNameTrigramIndex() = default;
+    TypeNameTrigramIndex(const std::vector<std::string_view> &type_names, const std::vector<uint8_t> &array_counts);
+
+    // ascending ids of the types holding every trigram of key, see GetTypeNameSearchKey
+    [[nodiscard]] std::vector<uint32_t> Find(std::string_view key) const;
+
+private:
+    // type ids of keys_[i] are postings_[offsets_[i], offsets_[i + 1])
+    std::vector<uint32_t> keys_;
+    std::vector<uint32_t> offsets_;
+    std::vector<uint32_t> postings_;
+};
+
+struct TypeNameCandidates {
+    std::vector<uint32_t> type_ids;
+    // indexed by type id
+    std::vector<bool> mask;
+};
+
+// lowercased descriptor fragment (as IsTypeNameMatched compares it) to look up, nullopt when it is
+// shorter than a trigram
+std::optional<std::string> GetTypeNameSearchKey(std::string_view descriptor_fragment);
+// nullopt as well for Equal matchers without ignore_case, those are cheaper to compare directly
+std::optional<std::string> GetTypeNameSearchKey(const schema::StringMatcher *matcher);
+
+} // namespace internal
+
+} // namespace dexkit
@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <cstdint>
@@ -44,9 +45,31 @@ enum class QueryKind : uint8_t {
 
 enum class QueryPriority : uint8_t {
     Normal = 0,
+    // interactive lookups, find_first queries use it by default
     LatencySensitive = 1,
+    // bulk scans that should not hold back the other classes
+    Background = 2,
 };
 
+// how Find* scans split a dex into tasks
+enum class SlicePolicy : uint8_t {
+    // a task per worker, each pulls chunks from a shared cursor until the dex is exhausted, chunks
+    // shrink as the range drains but stay large enough for the sampled per item cost
+    Guided = 0,
+    // a task per fixed size slice
+    Fixed = 1,
+};
+
+// share of the pool a query receives relative to the other running queries, see QueryScheduler
+inline uint32_t DefaultQueryWeight(QueryPriority priority) {
+    switch (priority) {
+        case QueryPriority::LatencySensitive: return 4;
+        case QueryPriority::Normal: return 2;
+        case QueryPriority::Background: return 1;
+    }
+    return 2;
+}
+
 struct QueryMetrics {
     std::chrono::steady_clock::time_point created_at = std::chrono::steady_clock::now();
     std::atomic<uint32_t> submitted_tasks = 0;
@@ -66,6 +89,8 @@ struct QueryMetrics {
     std::atomic<int64_t> submission_completed_ns = -1;
     std::atomic<int64_t> workers_completed_ns = -1;
     std::atomic<int64_t> completed_ns = -1;
+    std::atomic<uint32_t> scan_chunks = 0;
+    std::atomic<uint32_t> max_scan_chunk_items = 0;
 };
 
 struct QueryMetricsSnapshot {
@@ -86,6 +111,8 @@ struct QueryMetricsSnapshot {
     int64_t submission_completed_ns = -1;
     int64_t workers_completed_ns = -1;
     int64_t completed_ns = -1;
+    uint32_t scan_chunks = 0;
+    uint32_t max_scan_chunk_items = 0;
 };
 
 struct QueryMetricsRecord {
@@ -207,6 +234,42 @@ public:
         return priority_;
     }
 
+    // 0 uses DefaultQueryWeight of the priority
+    void SetQueryWeight(uint32_t weight) {
+        weight_ = weight;
+    }
+
+    [[nodiscard]] uint32_t GetQueryWeight() const {
+        return weight_;
+    }
+
+    void SetSlicePolicy(SlicePolicy policy) {
+        slice_policy_ = policy;
+    }
+
+    [[nodiscard]] SlicePolicy GetSlicePolicy() const {
+        return slice_policy_;
+    }
+
+    // average cost of matching one Find* scan item in ns, 0 until the first chunk completes
+    [[nodiscard]] uint32_t GetScanItemCostNs() const {
+        return scan_item_cost_ns_.load(std::memory_order_relaxed);
+    }
+
+    void MarkScanChunkCompleted(uint32_t item_count, int64_t runtime_ns) {
+        if (item_count > 0) {
+            auto sample = static_cast<uint32_t>(std::clamp<int64_t>(runtime_ns / item_count, 1, UINT32_MAX));
+            auto cost = scan_item_cost_ns_.load(std::memory_order_relaxed);
+            // racy moving average, a lost update only delays the estimate by a chunk
+            scan_item_cost_ns_.store(cost == 0 ? sample : (cost / 4) * 3 + sample / 4 + 1, std::memory_order_relaxed);
+        }
+#if DEXKIT_ENABLE_INTERNAL_METRICS
+        if (!metrics_enabled_) return;
+        metrics_.scan_chunks.fetch_add(1, std::memory_order_relaxed);
+        UpdateMax(metrics_.max_scan_chunk_items, item_count);
+#endif
+    }
+
     void EnableEarlyExit() {
         early_exit_enabled_.store(true, std::memory_order_relaxed);
     }
@@ -334,6 +397,8 @@ public:
         snapshot.submission_completed_ns = metrics_.submission_completed_ns.load(std::memory_order_relaxed);
         snapshot.workers_completed_ns = metrics_.workers_completed_ns.load(std::memory_order_relaxed);
         snapshot.completed_ns = metrics_.completed_ns.load(std::memory_order_relaxed);
+        snapshot.scan_chunks = metrics_.scan_chunks.load(std::memory_order_relaxed);
+        snapshot.max_scan_chunk_items = metrics_.max_scan_chunk_items.load(std::memory_order_relaxed);
         return snapshot;
 #else
         return {};
@@ -482,6 +547,9 @@ private:
     QueryKind kind_;
     uint64_t query_id_;
     QueryPriority priority_ = QueryPriority::Normal;
+    uint32_t weight_ = 0;
+    SlicePolicy slice_policy_ = SlicePolicy::Guided;
+    std::atomic<uint32_t> scan_item_cost_ns_ = 0;
 #if DEXKIT_ENABLE_INTERNAL_METRICS
     bool metrics_enabled_ = false;
 #endif
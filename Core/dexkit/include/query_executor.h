@@ -27,6 +27,7 @@
 #include <memory>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "ThreadPool.h"
 #include "query_scheduler.h"
@@ -37,7 +38,10 @@ class IQueryExecutor {
 public:
     virtual ~IQueryExecutor() = default;
     virtual void Submit(std::function<void()> task) = 0;
+    virtual void SubmitBatch(std::vector<std::function<void()>> tasks) = 0;
     virtual void OnSubmissionComplete() = 0;
+    // tasks the executor may run at once
+    [[nodiscard]] virtual size_t GetWorkerCount() const = 0;
     [[nodiscard]] virtual bool ShouldSkipTask() const = 0;
     [[nodiscard]] virtual std::function<bool()> GetShouldSkipTaskFn() const = 0;
 };
@@ -49,12 +53,13 @@ public:
             uint64_t query_id,
             QueryContext &query_context,
             QueryPriority query_priority,
+            uint32_t query_weight,
             std::function<bool()> should_skip_task = {}
     )
             : should_skip_task_(std::move(should_skip_task)),
               scheduler_(std::move(scheduler)),
               query_id_(query_id) {
-        scheduler_->AttachQuery(query_id_, query_priority, &query_context);
+        scheduler_->AttachQuery(query_id_, query_priority, query_weight, &query_context);
     }
 
     ~SharedThreadPoolQueryExecutor() override {
@@ -66,6 +71,10 @@ public:
         scheduler_->Submit(query_id_, std::move(task));
     }
 
+    void SubmitBatch(std::vector<std::function<void()>> tasks) override {
+        scheduler_->SubmitBatch(query_id_, std::move(tasks));
+    }
+
     void OnSubmissionComplete() override {
         if (submission_completed_) {
             return;
@@ -74,6 +83,10 @@ public:
         scheduler_->ActivateQuery(query_id_);
     }
 
+    [[nodiscard]] size_t GetWorkerCount() const override {
+        return scheduler_->GetWorkerCount();
+    }
+
     [[nodiscard]] bool ShouldSkipTask() const override {
         return should_skip_task_ && should_skip_task_();
     }
@@ -109,8 +122,8 @@ static auto BuildPackagedQueryTask(F &&task, std::function<bool()> should_skip_t
 }
 
 template<typename F>
-auto SubmitQueryTask(IQueryExecutor &executor, F &&task)
--> std::future<std::invoke_result_t<std::decay_t<F>>> {
+auto PackageQueryTask(IQueryExecutor &executor, F &&task)
+-> std::pair<std::future<std::invoke_result_t<std::decay_t<F>>>, std::function<void()>> {
     using ReturnType = std::invoke_result_t<std::decay_t<F>>;
     auto should_skip_task = executor.GetShouldSkipTaskFn();
     std::shared_ptr<std::packaged_task<ReturnType()>> task_ptr;
@@ -124,10 +137,59 @@ auto SubmitQueryTask(IQueryExecutor &executor, F &&task)
         );
     }
     auto future = task_ptr->get_future();
-    executor.Submit([task_ptr]() mutable {
+    return {std::move(future), [task_ptr]() mutable {
         (*task_ptr)();
-    });
-    return future;
+    }};
 }
 
+template<typename F>
+auto SubmitQueryTask(IQueryExecutor &executor, F &&task)
+-> std::future<std::invoke_result_t<std::decay_t<F>>> {
+    auto [future, packaged_task] = PackageQueryTask(executor, std::forward<F>(task));
+    executor.Submit(std::move(packaged_task));
+    return std::move(future);
+}
+
+// Collects the slice tasks of one query and hands them to the executor in a single call, so the
+// scheduler lock is taken once per slice list instead of once per slice.
+class QueryTaskBatch {
+public:
+    explicit QueryTaskBatch(IQueryExecutor &executor) : executor_(executor) {}
+
+    QueryTaskBatch(const QueryTaskBatch &) = delete;
+    QueryTaskBatch &operator=(const QueryTaskBatch &) = delete;
+
+    ~QueryTaskBatch() {
+        Submit();
+    }
+
+    void Reserve(size_t count) {
+        tasks_.reserve(count);
+    }
+
+    template<typename F>
+    auto Add(F &&task) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        auto [future, packaged_task] = PackageQueryTask(executor_, std::forward<F>(task));
+        tasks_.emplace_back(std::move(packaged_task));
+        return std::move(future);
+    }
+
+    // a task that reports its result by itself
+    void Push(std::function<void()> task) {
+        tasks_.emplace_back(std::move(task));
+    }
+
+    void Submit() {
+        if (tasks_.empty()) {
+            return;
+        }
+        executor_.SubmitBatch(std::move(tasks_));
+        tasks_.clear();
+    }
+
+private:
+    IQueryExecutor &executor_;
+    std::vector<std::function<void()>> tasks_;
+};
+
 } // namespace dexkit
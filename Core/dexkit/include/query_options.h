@@ -0,0 +1,46 @@
+// DexKit - An high-performance runtime parsing library for dex
+// implemented in C++.
+// Copyright (C) 2022-2023 LuckyPray
+// https://github.com/LuckyPray/DexKit
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+// <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "query_context.h"
+
+namespace dexkit {
+
+// Per-call options that are not part of the serialized query schema.
+struct QueryOptions {
+    // restrict the query to dex items loaded by these sources, see DexKit::GetSourceNum();
+    // empty means every loaded dex
+    std::vector<uint32_t> source_ids;
+    // scheduling class on the shared pool, unset keeps the default: LatencySensitive for
+    // find_first queries, Normal otherwise
+    std::optional<QueryPriority> priority;
+    // relative share of the pool among concurrent queries, 0 uses DefaultQueryWeight(priority)
+    uint32_t weight = 0;
+    // how FindClass / FindMethod / FindField split each dex into tasks
+    SlicePolicy slice_policy = SlicePolicy::Guided;
+};
+
+} // namespace dexkit
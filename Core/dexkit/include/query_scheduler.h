@@ -21,12 +21,16 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <cstdint>
 #include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <set>
+#include <tuple>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -39,8 +43,6 @@ namespace dexkit {
 struct QuerySchedulerMetricsSnapshot {
     size_t share_count_syncs = 0;
     size_t share_count_changes = 0;
-    size_t budget_rebalances = 0;
-    size_t runnable_queue_rebuilds = 0;
     size_t refill_rounds = 0;
     size_t dispatched_tasks = 0;
     size_t base_dispatched_tasks = 0;
@@ -55,13 +57,43 @@ public:
     QueryScheduler(std::shared_ptr<ThreadPool> pool, size_t worker_count)
             : pool_(std::move(pool)), worker_count_(std::max<size_t>(1, worker_count)) {}
 
-    void AttachQuery(uint64_t query_id, QueryPriority priority, QueryContext *query_context) {
-        std::lock_guard lock(mutex_);
-        auto &slot = query_slots_[query_id];
-        slot.query_id = query_id;
-        slot.priority = priority;
-        slot.query_context = query_context;
-        slot.attached = true;
+    [[nodiscard]] size_t GetWorkerCount() const {
+        return worker_count_;
+    }
+
+    // weight 0 uses the default weight of the priority class
+    void AttachQuery(uint64_t query_id, QueryPriority priority, uint32_t weight, QueryContext *query_context) {
+        std::vector<DispatchTask> dispatch_tasks;
+        bool stage_submissions;
+        {
+            std::lock_guard lock(mutex_);
+            auto &slot = query_slots_[query_id];
+            stage_submissions = !slot.activated;
+            RemoveFromQueueLocked(slot);
+            if (slot.visible) {
+                visible_query_weight_ -= slot.weight;
+            }
+            slot.query_id = query_id;
+            slot.priority = priority;
+            slot.weight = std::min(weight != 0 ? weight : DefaultQueryWeight(priority), kMaxQueryWeight);
+            slot.query_context = query_context;
+            slot.attached = true;
+            if (slot.visible) {
+                visible_query_weight_ += slot.weight;
+            }
+            UpdateVisibilityLocked(slot);
+            auto query_share = SyncQueryShareLocked();
+            // the caps of this slot follow its own priority and weight as well as the share
+            CapDispatchBudgetsLocked(slot, ComputeDispatchRoundPolicy(query_share));
+            ClassifySlotLocked(slot);
+            DispatchReadyTasksLocked(dispatch_tasks);
+        }
+        if (stage_submissions) {
+            auto &shard = SubmissionShardOf(query_id);
+            std::lock_guard lock(shard.mutex);
+            shard.staged.try_emplace(query_id);
+        }
+        EnqueueDispatchTasks(std::move(dispatch_tasks));
     }
 
     [[nodiscard]] QuerySchedulerMetricsSnapshot GetMetricsSnapshot() const {
@@ -70,8 +102,6 @@ public:
 #if DEXKIT_ENABLE_INTERNAL_METRICS
         snapshot.share_count_syncs = metrics_.share_count_syncs;
         snapshot.share_count_changes = metrics_.share_count_changes;
-        snapshot.budget_rebalances = metrics_.budget_rebalances;
-        snapshot.runnable_queue_rebuilds = metrics_.runnable_queue_rebuilds;
         snapshot.refill_rounds = metrics_.refill_rounds;
         snapshot.dispatched_tasks = metrics_.dispatched_tasks;
         snapshot.base_dispatched_tasks = metrics_.base_dispatched_tasks;
@@ -91,27 +121,32 @@ public:
     }
 
     void ActivateQuery(uint64_t query_id) {
+        auto staged = TakeStagedSubmission(query_id);
         std::vector<DispatchTask> dispatch_tasks;
         {
             std::lock_guard lock(mutex_);
             auto &slot = query_slots_[query_id];
             slot.query_id = query_id;
             slot.attached = true;
+            MergeStagedSubmissionLocked(slot, std::move(staged));
             if (!slot.activated) {
                 slot.activated = true;
                 slot.activation_sequence = next_activation_sequence_++;
             }
-            auto query_share_count = SyncQueryShareCountLocked();
+            UpdateVisibilityLocked(slot);
+            auto query_share = SyncQueryShareLocked();
+            ApplyBudgetEpochLocked(slot, ComputeDispatchRoundPolicy(query_share));
             if (!slot.pending_tasks.empty() && slot.TotalDispatchBudget() == 0) {
-                AssignDispatchBudgetsLocked(slot, query_share_count);
+                AssignDispatchBudgetsLocked(slot, query_share);
             }
-            TryEnqueueRunnableLocked(slot);
+            ClassifySlotLocked(slot);
             DispatchReadyTasksLocked(dispatch_tasks);
         }
         EnqueueDispatchTasks(std::move(dispatch_tasks));
     }
 
     void DetachQuery(uint64_t query_id) {
+        auto staged = TakeStagedSubmission(query_id);
         std::vector<DispatchTask> dispatch_tasks;
         {
             std::lock_guard lock(mutex_);
@@ -119,9 +154,12 @@ public:
             if (it == query_slots_.end()) {
                 return;
             }
+            // never activated, the tasks are kept like they were before the detach
+            MergeStagedSubmissionLocked(it->second, std::move(staged));
             it->second.attached = false;
             it->second.query_context = nullptr;
-            (void) SyncQueryShareCountLocked();
+            UpdateVisibilityLocked(it->second);
+            (void) SyncQueryShareLocked();
             TryEraseSlotLocked(it);
             DispatchReadyTasksLocked(dispatch_tasks);
         }
@@ -129,37 +167,86 @@ public:
     }
 
     void Submit(uint64_t query_id, std::function<void()> task) {
+        if (TryStageSubmission(query_id, [&](StagedSubmission &staged) {
+            staged.tasks.emplace_back(std::move(task));
+        })) {
+            return;
+        }
         std::vector<DispatchTask> dispatch_tasks;
         {
             std::lock_guard lock(mutex_);
-            auto &slot = query_slots_[query_id];
-            slot.query_id = query_id;
-            slot.attached = true;
-            slot.submission_started = true;
-            auto query_share_count = SyncQueryShareCountLocked();
+            auto &slot = BeginSubmissionLocked(query_id);
             auto was_idle = slot.pending_tasks.empty() && slot.in_flight == 0;
             slot.pending_tasks.emplace_back(std::move(task));
-            if (slot.activated && was_idle && slot.TotalDispatchBudget() == 0) {
-                AssignDispatchBudgetsLocked(slot, query_share_count);
+            EndSubmissionLocked(slot, was_idle, dispatch_tasks);
+        }
+        EnqueueDispatchTasks(std::move(dispatch_tasks));
+    }
+
+    // the whole slice list of a query under one lock
+    void SubmitBatch(uint64_t query_id, std::vector<std::function<void()>> tasks) {
+        if (tasks.empty()) {
+            return;
+        }
+        if (TryStageSubmission(query_id, [&](StagedSubmission &staged) {
+            if (staged.tasks.empty()) {
+                staged.tasks = std::move(tasks);
+                return;
             }
-            TryEnqueueRunnableLocked(slot);
-            DispatchReadyTasksLocked(dispatch_tasks);
+            for (auto &task: tasks) {
+                staged.tasks.emplace_back(std::move(task));
+            }
+        })) {
+            return;
+        }
+        std::vector<DispatchTask> dispatch_tasks;
+        {
+            std::lock_guard lock(mutex_);
+            auto &slot = BeginSubmissionLocked(query_id);
+            auto was_idle = slot.pending_tasks.empty() && slot.in_flight == 0;
+            for (auto &task: tasks) {
+                slot.pending_tasks.emplace_back(std::move(task));
+            }
+            EndSubmissionLocked(slot, was_idle, dispatch_tasks);
         }
         EnqueueDispatchTasks(std::move(dispatch_tasks));
     }
 
 private:
+    // where a slot with pending tasks waits, at most one place at a time
+    enum class SlotQueue : uint8_t {
+        None,
+        // base_runnable_queries_[queue_rank]
+        Base,
+        Bonus,
+        // has budget, but its in-flight limit is reached
+        Throttled,
+        // budget used up, waits for the next refill round
+        Refill,
+    };
+
+    // (base pass or last bonus sequence, activation sequence, query id)
+    using RunnableKey = std::tuple<uint64_t, uint64_t, uint64_t>;
+
     struct QuerySlot {
         uint64_t query_id = 0;
         QueryContext *query_context = nullptr;
         QueryPriority priority = QueryPriority::Normal;
+        uint32_t weight = 1;
         uint64_t activation_sequence = 0;
-        uint64_t last_base_dispatch_sequence = 0;
+        // stride scheduling pass, advances by kDispatchStride / weight on every base dispatch
+        uint64_t base_dispatch_pass = 0;
         uint64_t last_bonus_dispatch_sequence = 0;
+        // budget_epoch_ the budgets were last checked against the caps at
+        uint64_t budget_epoch = 0;
         bool attached = true;
         bool activated = false;
         bool submission_started = false;
-        bool queued = false;
+        // counted in the visible query share
+        bool visible = false;
+        SlotQueue queue = SlotQueue::None;
+        uint8_t queue_rank = 0;
+        RunnableKey queue_key{};
         size_t in_flight = 0;
         size_t base_dispatch_budget = 0;
         size_t bonus_dispatch_budget = 0;
@@ -174,8 +261,6 @@ private:
     struct QuerySchedulerMetricsState {
         size_t share_count_syncs = 0;
         size_t share_count_changes = 0;
-        size_t budget_rebalances = 0;
-        size_t runnable_queue_rebuilds = 0;
         size_t refill_rounds = 0;
         size_t dispatched_tasks = 0;
         size_t base_dispatched_tasks = 0;
@@ -186,18 +271,50 @@ private:
     };
 #endif
 
+    // tasks of a query that is attached but not activated yet, they can not be dispatched
+    struct StagedSubmission {
+        bool submission_started = false;
+        std::vector<std::function<void()>> tasks;
+    };
+
+    struct SubmissionShard {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, StagedSubmission> staged;
+    };
+
     struct DispatchTask {
         uint64_t query_id = 0;
         std::function<void()> task;
     };
 
+    struct QueryShare {
+        size_t query_count = 1;
+        uint64_t total_weight = 1;
+
+        [[nodiscard]] bool operator==(const QueryShare &other) const {
+            return query_count == other.query_count && total_weight == other.total_weight;
+        }
+    };
+
     struct DispatchRoundPolicy {
         size_t visible_query_share_count = 1;
-        size_t query_in_flight_limit = 1;
-        size_t base_dispatch_budget_cap = 1;
-        bool latency_sensitive_bonus_phase_enabled = false;
+        uint64_t visible_query_weight = 1;
     };
 
+    static constexpr uint64_t kDispatchStride = 1 << 20;
+    static constexpr uint32_t kMaxQueryWeight = 1 << 10;
+    static constexpr size_t kPriorityCount = 3;
+    static constexpr size_t kSubmissionShardCount = 16;
+
+    [[nodiscard]] static uint8_t PriorityRank(QueryPriority priority) {
+        switch (priority) {
+            case QueryPriority::LatencySensitive: return 2;
+            case QueryPriority::Normal: return 1;
+            case QueryPriority::Background: return 0;
+        }
+        return 1;
+    }
+
     using QuerySlotMap = std::unordered_map<uint64_t, QuerySlot>;
 
     class TaskCompletionGuard {
@@ -219,62 +336,52 @@ private:
         uint64_t query_id_ = 0;
     };
 
-    [[nodiscard]] size_t QueryInFlightLimitForActiveQueryCount(size_t active_query_count) const {
-        return std::max<size_t>(1, (worker_count_ + active_query_count - 1) / active_query_count);
-    }
-
-    [[nodiscard]] DispatchRoundPolicy ComputeDispatchRoundPolicy(size_t visible_query_share_count) const {
+    [[nodiscard]] DispatchRoundPolicy ComputeDispatchRoundPolicy(const QueryShare &query_share) const {
         DispatchRoundPolicy policy;
-        policy.visible_query_share_count = std::max<size_t>(1, visible_query_share_count);
-        policy.query_in_flight_limit = QueryInFlightLimitForActiveQueryCount(policy.visible_query_share_count);
-        if (policy.visible_query_share_count <= 1) {
-            policy.base_dispatch_budget_cap = worker_count_;
-            return policy;
-        }
-
-        // Base phase: every visible query first receives an equal share based on
-        // the current in-flight cap. Bonus phase: latency-sensitive queries may
-        // receive one extra share only after the common base phase is exhausted.
-        policy.base_dispatch_budget_cap = policy.query_in_flight_limit;
-        policy.latency_sensitive_bonus_phase_enabled = policy.base_dispatch_budget_cap < worker_count_;
+        policy.visible_query_share_count = std::max<size_t>(1, query_share.query_count);
+        policy.visible_query_weight = std::max<uint64_t>(1, query_share.total_weight);
         return policy;
     }
 
-    [[nodiscard]] size_t VisibleQueryShareCountLocked() const {
-        size_t visible_query_count = 0;
-        for (const auto &[query_id, slot]: query_slots_) {
-            (void) query_id;
-            if (!slot.attached) {
-                continue;
-            }
-            if (slot.activated) {
-                if (!slot.pending_tasks.empty() || slot.in_flight != 0) {
-                    ++visible_query_count;
-                }
-                continue;
-            }
-            if (slot.submission_started) {
-                ++visible_query_count;
-            }
+    // Every visible query may keep a weighted share of the workers in flight and receives
+    // the same amount as base budget per round, with equal weights this is an equal split.
+    [[nodiscard]] size_t QueryInFlightLimit(const QuerySlot &slot, const DispatchRoundPolicy &policy) const {
+        if (policy.visible_query_share_count <= 1) {
+            return worker_count_;
         }
-        return visible_query_count;
+        auto total_weight = std::max<uint64_t>(policy.visible_query_weight, slot.weight);
+        auto share = (worker_count_ * slot.weight + total_weight - 1) / total_weight;
+        return std::clamp<size_t>(share, 1, worker_count_);
     }
 
-    [[nodiscard]] size_t QueryShareCountLocked() const {
-        return std::max<size_t>(1, VisibleQueryShareCountLocked());
+    [[nodiscard]] size_t BaseDispatchBudgetCap(const QuerySlot &slot, const DispatchRoundPolicy &policy) const {
+        return QueryInFlightLimit(slot, policy);
     }
 
-    [[nodiscard]] bool IsRunnableCandidateLocked(const QuerySlot &slot, size_t query_in_flight_limit) const {
-        if (!slot.activated) {
-            return false;
-        }
-        if (slot.queued || slot.pending_tasks.empty()) {
-            return false;
+    // A query is visible while attached and either submitting or, once activated, holding
+    // pending or running tasks. The share is kept as running totals, every state change of a
+    // slot goes through here.
+    void UpdateVisibilityLocked(QuerySlot &slot) {
+        auto visible = slot.attached &&
+                       (slot.activated ? !slot.pending_tasks.empty() || slot.in_flight != 0 : slot.submission_started);
+        if (visible == slot.visible) {
+            return;
         }
-        if (slot.in_flight >= query_in_flight_limit) {
-            return false;
+        slot.visible = visible;
+        if (visible) {
+            ++visible_query_count_;
+            visible_query_weight_ += slot.weight;
+        } else {
+            --visible_query_count_;
+            visible_query_weight_ -= slot.weight;
         }
-        return slot.TotalDispatchBudget() != 0;
+    }
+
+    [[nodiscard]] QueryShare QueryShareLocked() const {
+        QueryShare query_share;
+        query_share.query_count = std::max<size_t>(1, visible_query_count_);
+        query_share.total_weight = std::max<uint64_t>(1, visible_query_weight_);
+        return query_share;
     }
 
     void UpdateMaxMetric(size_t &target, size_t value) {
@@ -285,211 +392,244 @@ private:
 
     void UpdateMaxRunnableQueueSizeLocked() {
 #if DEXKIT_ENABLE_INTERNAL_METRICS
-        UpdateMaxMetric(
-                metrics_.max_runnable_queue_size,
-                base_runnable_queries_.size() +
-                latency_sensitive_bonus_runnable_queries_.size()
-        );
+        UpdateMaxMetric(metrics_.max_runnable_queue_size, runnable_query_count_);
 #endif
     }
 
+    // Bonus phase: latency-sensitive queries may receive one extra share only after
+    // the common base phase is exhausted.
     [[nodiscard]] size_t BonusDispatchBudgetCap(const QuerySlot &slot, const DispatchRoundPolicy &policy) const {
-        if (!policy.latency_sensitive_bonus_phase_enabled) {
+        if (policy.visible_query_share_count <= 1 || BaseDispatchBudgetCap(slot, policy) >= worker_count_) {
             return 0;
         }
         return static_cast<size_t>(slot.priority == QueryPriority::LatencySensitive);
     }
 
-    void AssignDispatchBudgetsLocked(QuerySlot &slot, size_t query_share_count) {
-        auto policy = ComputeDispatchRoundPolicy(query_share_count);
-        slot.base_dispatch_budget = policy.base_dispatch_budget_cap;
+    void AssignDispatchBudgetsLocked(QuerySlot &slot, const QueryShare &query_share) {
+        auto policy = ComputeDispatchRoundPolicy(query_share);
+        slot.base_dispatch_budget = BaseDispatchBudgetCap(slot, policy);
         slot.bonus_dispatch_budget = BonusDispatchBudgetCap(slot, policy);
+        slot.budget_epoch = budget_epoch_;
+        // a query that was idle does not bank the rounds it missed
+        slot.base_dispatch_pass = std::max(slot.base_dispatch_pass, virtual_dispatch_pass_);
     }
 
-    void RebalanceDispatchBudgetsLocked(size_t query_share_count) {
-#if DEXKIT_ENABLE_INTERNAL_METRICS
-        ++metrics_.budget_rebalances;
-#endif
-        auto policy = ComputeDispatchRoundPolicy(query_share_count);
-        for (auto &[query_id, slot]: query_slots_) {
-            (void) query_id;
-            if (!slot.activated) {
-                continue;
-            }
-            if (slot.base_dispatch_budget > policy.base_dispatch_budget_cap) {
-                slot.base_dispatch_budget = policy.base_dispatch_budget_cap;
-            }
-            auto max_bonus_budget = BonusDispatchBudgetCap(slot, policy);
-            if (slot.bonus_dispatch_budget > max_bonus_budget) {
-                slot.bonus_dispatch_budget = max_bonus_budget;
-            }
+    // A share change bumps budget_epoch_ instead of walking every slot, the budgets of a slot
+    // are cut down to the caps of the current share the next time it is classified or popped.
+    void ApplyBudgetEpochLocked(QuerySlot &slot, const DispatchRoundPolicy &policy) {
+        if (slot.budget_epoch == budget_epoch_) {
+            return;
         }
+        CapDispatchBudgetsLocked(slot, policy);
     }
 
-    void RebuildRunnableQueuesLocked() {
-        base_runnable_queries_.clear();
-        latency_sensitive_bonus_runnable_queries_.clear();
-        for (auto &[query_id, slot]: query_slots_) {
-            (void) query_id;
-            slot.queued = false;
-        }
-        (void) CollectAndEnqueueRunnableCandidatesLocked(QueryInFlightLimitLocked());
-#if DEXKIT_ENABLE_INTERNAL_METRICS
-        ++metrics_.runnable_queue_rebuilds;
-#endif
-        UpdateMaxRunnableQueueSizeLocked();
+    void CapDispatchBudgetsLocked(QuerySlot &slot, const DispatchRoundPolicy &policy) {
+        slot.budget_epoch = budget_epoch_;
+        slot.base_dispatch_budget = std::min(slot.base_dispatch_budget, BaseDispatchBudgetCap(slot, policy));
+        slot.bonus_dispatch_budget = std::min(slot.bonus_dispatch_budget, BonusDispatchBudgetCap(slot, policy));
     }
 
-    [[nodiscard]] size_t SyncQueryShareCountLocked() {
+    [[nodiscard]] QueryShare SyncQueryShareLocked() {
 #if DEXKIT_ENABLE_INTERNAL_METRICS
         ++metrics_.share_count_syncs;
 #endif
-        auto query_share_count = QueryShareCountLocked();
+        auto query_share = QueryShareLocked();
 #if DEXKIT_ENABLE_INTERNAL_METRICS
-        UpdateMaxMetric(metrics_.max_visible_query_share_count, query_share_count);
-        if (query_share_count == last_query_share_count_) {
-            return query_share_count;
+        UpdateMaxMetric(metrics_.max_visible_query_share_count, query_share.query_count);
+#endif
+        if (query_share == last_query_share_) {
+            return query_share;
         }
-        last_query_share_count_ = query_share_count;
+        last_query_share_ = query_share;
+        ++budget_epoch_;
+#if DEXKIT_ENABLE_INTERNAL_METRICS
         ++metrics_.share_count_changes;
-#else
-        if (query_share_count == last_query_share_count_) {
-            return query_share_count;
-        }
-        last_query_share_count_ = query_share_count;
 #endif
-        RebalanceDispatchBudgetsLocked(query_share_count);
-        RebuildRunnableQueuesLocked();
-        return query_share_count;
+        // the in-flight limits moved, throttled queries may run again. Queued ones that went
+        // over their new limit are moved out when popped.
+        if (!throttled_queries_.empty()) {
+            std::vector<uint64_t> query_ids(throttled_queries_.begin(), throttled_queries_.end());
+            for (auto query_id: query_ids) {
+                ClassifySlotLocked(query_slots_.at(query_id));
+            }
+        }
+        return query_share;
     }
 
-    [[nodiscard]] size_t QueryInFlightLimitLocked() const {
-        return ComputeDispatchRoundPolicy(QueryShareCountLocked()).query_in_flight_limit;
+    [[nodiscard]] DispatchRoundPolicy CurrentDispatchRoundPolicyLocked() const {
+        return ComputeDispatchRoundPolicy(QueryShareLocked());
     }
 
     [[nodiscard]] bool HasRunnableQueriesLocked() const {
-        return !base_runnable_queries_.empty() ||
-               !latency_sensitive_bonus_runnable_queries_.empty();
+        return runnable_query_count_ != 0;
     }
 
-    [[nodiscard]] uint64_t PopRunnableQueryLocked() {
-        if (!base_runnable_queries_.empty()) {
-            auto query_id = base_runnable_queries_.front();
-            base_runnable_queries_.pop_front();
-            return query_id;
+    void RemoveFromQueueLocked(QuerySlot &slot) {
+        switch (slot.queue) {
+            case SlotQueue::None:
+                return;
+            case SlotQueue::Base:
+                base_runnable_queries_[slot.queue_rank].erase(slot.queue_key);
+                --runnable_query_count_;
+                break;
+            case SlotQueue::Bonus:
+                latency_sensitive_bonus_runnable_queries_.erase(slot.queue_key);
+                --runnable_query_count_;
+                break;
+            case SlotQueue::Throttled:
+                throttled_queries_.erase(slot.query_id);
+                break;
+            case SlotQueue::Refill:
+                refill_queries_.erase(slot.query_id);
+                break;
         }
-        auto query_id = latency_sensitive_bonus_runnable_queries_.front();
-        latency_sensitive_bonus_runnable_queries_.pop_front();
-        return query_id;
+        slot.queue = SlotQueue::None;
     }
 
-    void PushRunnableQueryLocked(const QuerySlot &slot) {
-        if (slot.base_dispatch_budget != 0) {
-            base_runnable_queries_.push_back(slot.query_id);
-            UpdateMaxRunnableQueueSizeLocked();
+    // Puts a slot where its state says it belongs, called after every change of a slot. Base
+    // runnable queries are ordered by (pass, activation, id) within their priority class, bonus
+    // ones by (last bonus dispatch, activation, id).
+    void ClassifySlotLocked(QuerySlot &slot) {
+        RemoveFromQueueLocked(slot);
+        if (!slot.activated || slot.pending_tasks.empty()) {
+            return;
+        }
+        auto policy = CurrentDispatchRoundPolicyLocked();
+        ApplyBudgetEpochLocked(slot, policy);
+        if (slot.TotalDispatchBudget() == 0) {
+            slot.queue = SlotQueue::Refill;
+            refill_queries_.insert(slot.query_id);
+            return;
+        }
+        if (slot.in_flight >= QueryInFlightLimit(slot, policy)) {
+            slot.queue = SlotQueue::Throttled;
+            throttled_queries_.insert(slot.query_id);
             return;
         }
-        latency_sensitive_bonus_runnable_queries_.push_back(slot.query_id);
+        if (slot.base_dispatch_budget != 0) {
+            slot.queue = SlotQueue::Base;
+            slot.queue_rank = PriorityRank(slot.priority);
+            slot.queue_key = {slot.base_dispatch_pass, slot.activation_sequence, slot.query_id};
+            base_runnable_queries_[slot.queue_rank].insert(slot.queue_key);
+        } else {
+            slot.queue = SlotQueue::Bonus;
+            slot.queue_key = {slot.last_bonus_dispatch_sequence, slot.activation_sequence, slot.query_id};
+            latency_sensitive_bonus_runnable_queries_.insert(slot.queue_key);
+        }
+        ++runnable_query_count_;
         UpdateMaxRunnableQueueSizeLocked();
     }
 
-    void InsertRunnableQueryOrderedLocked(const QuerySlot &slot) {
-        auto bonus_phase = slot.base_dispatch_budget == 0;
-        auto &queue = bonus_phase ? latency_sensitive_bonus_runnable_queries_ : base_runnable_queries_;
-        auto insert_it = queue.end();
-        for (auto it = queue.begin(); it != queue.end(); ++it) {
-            if (RunnableQueryLessLocked(slot.query_id, *it, bonus_phase)) {
-                insert_it = it;
-                break;
+    // lowest pass first over the heads of the priority classes, ties go to the more urgent one,
+    // the bonus queue only once every base queue is empty
+    [[nodiscard]] QuerySlot &PopRunnableQueryLocked() {
+        const std::set<RunnableKey> *queue = nullptr;
+        for (size_t rank = kPriorityCount; rank-- > 0;) {
+            auto &candidate = base_runnable_queries_[rank];
+            if (!candidate.empty() && (queue == nullptr || std::get<0>(*candidate.begin()) < std::get<0>(*queue->begin()))) {
+                queue = &candidate;
             }
         }
-        queue.insert(insert_it, slot.query_id);
-        UpdateMaxRunnableQueueSizeLocked();
+        if (queue == nullptr) {
+            queue = &latency_sensitive_bonus_runnable_queries_;
+        }
+        auto &slot = query_slots_.at(std::get<2>(*queue->begin()));
+        RemoveFromQueueLocked(slot);
+        return slot;
     }
 
-    [[nodiscard]] bool RunnableQueryLessLocked(uint64_t lhs_query_id, uint64_t rhs_query_id, bool bonus_phase) const {
-        const auto &lhs = query_slots_.at(lhs_query_id);
-        const auto &rhs = query_slots_.at(rhs_query_id);
-        auto lhs_dispatch_sequence = bonus_phase ? lhs.last_bonus_dispatch_sequence : lhs.last_base_dispatch_sequence;
-        auto rhs_dispatch_sequence = bonus_phase ? rhs.last_bonus_dispatch_sequence : rhs.last_base_dispatch_sequence;
-        return std::tie(lhs_dispatch_sequence, lhs.activation_sequence, lhs.query_id) <
-               std::tie(rhs_dispatch_sequence, rhs.activation_sequence, rhs.query_id);
-    }
+    bool RefillDispatchBudgetsLocked() {
+#if DEXKIT_ENABLE_INTERNAL_METRICS
+        ++metrics_.refill_rounds;
+#endif
+        auto query_share = SyncQueryShareLocked();
+        auto policy = ComputeDispatchRoundPolicy(query_share);
 
-    void EnqueueSortedRunnableQueriesLocked(std::vector<uint64_t> &query_ids, bool bonus_phase) {
-        std::sort(query_ids.begin(), query_ids.end(), [this, bonus_phase](uint64_t lhs_query_id, uint64_t rhs_query_id) {
-            return RunnableQueryLessLocked(lhs_query_id, rhs_query_id, bonus_phase);
-        });
+        std::vector<uint64_t> query_ids(refill_queries_.begin(), refill_queries_.end());
         for (auto query_id: query_ids) {
-            auto it = query_slots_.find(query_id);
-            if (it == query_slots_.end()) {
-                continue;
-            }
-            auto &slot = it->second;
-            if (slot.queued) {
+            auto &slot = query_slots_.at(query_id);
+            if (slot.in_flight >= QueryInFlightLimit(slot, policy)) {
                 continue;
             }
-            slot.queued = true;
-            PushRunnableQueryLocked(slot);
+            slot.base_dispatch_budget = BaseDispatchBudgetCap(slot, policy);
+            slot.bonus_dispatch_budget = BonusDispatchBudgetCap(slot, policy);
+            slot.budget_epoch = budget_epoch_;
+            ClassifySlotLocked(slot);
         }
+        return HasRunnableQueriesLocked();
     }
 
-    [[nodiscard]] bool CollectAndEnqueueRunnableCandidatesLocked(size_t query_in_flight_limit) {
-        std::vector<uint64_t> base_query_ids;
-        std::vector<uint64_t> bonus_query_ids;
-        for (auto &[query_id, slot]: query_slots_) {
-            (void) query_id;
-            if (!IsRunnableCandidateLocked(slot, query_in_flight_limit)) {
-                continue;
-            }
-            if (slot.base_dispatch_budget != 0) {
-                base_query_ids.push_back(slot.query_id);
-            } else {
-                bonus_query_ids.push_back(slot.query_id);
+    [[nodiscard]] SubmissionShard &SubmissionShardOf(uint64_t query_id) {
+        return submission_shards_[query_id % kSubmissionShardCount];
+    }
+
+    // Queries submit their slices before ActivateQuery and none of them runs until then, so the
+    // tasks wait in the shard of the query and only mutex_ is left out. The first submission
+    // still takes mutex_ once, a submitting query counts in the visible share. false when the
+    // query is not staging, it is activated or was never attached.
+    template<typename F>
+    bool TryStageSubmission(uint64_t query_id, F &&append) {
+        bool first_submission;
+        {
+            auto &shard = SubmissionShardOf(query_id);
+            std::lock_guard lock(shard.mutex);
+            auto it = shard.staged.find(query_id);
+            if (it == shard.staged.end()) {
+                return false;
             }
+            append(it->second);
+            first_submission = !it->second.submission_started;
+            it->second.submission_started = true;
         }
-        if (base_query_ids.empty() && bonus_query_ids.empty()) {
-            return false;
+        if (first_submission) {
+            std::vector<DispatchTask> dispatch_tasks;
+            {
+                std::lock_guard lock(mutex_);
+                auto &slot = BeginSubmissionLocked(query_id);
+                auto was_idle = slot.pending_tasks.empty() && slot.in_flight == 0;
+                EndSubmissionLocked(slot, was_idle, dispatch_tasks);
+            }
+            EnqueueDispatchTasks(std::move(dispatch_tasks));
         }
-        EnqueueSortedRunnableQueriesLocked(base_query_ids, false);
-        EnqueueSortedRunnableQueriesLocked(bonus_query_ids, true);
         return true;
     }
 
-    bool RefillDispatchBudgetsLocked() {
-#if DEXKIT_ENABLE_INTERNAL_METRICS
-        ++metrics_.refill_rounds;
-#endif
-        auto query_share_count = SyncQueryShareCountLocked();
-        auto policy = ComputeDispatchRoundPolicy(query_share_count);
-        auto query_in_flight_limit = policy.query_in_flight_limit;
+    StagedSubmission TakeStagedSubmission(uint64_t query_id) {
+        auto &shard = SubmissionShardOf(query_id);
+        std::lock_guard lock(shard.mutex);
+        auto it = shard.staged.find(query_id);
+        if (it == shard.staged.end()) {
+            return {};
+        }
+        auto staged = std::move(it->second);
+        shard.staged.erase(it);
+        return staged;
+    }
 
-        for (auto &[query_id, slot]: query_slots_) {
-            (void) query_id;
-            if (!slot.activated) {
-                continue;
-            }
-            if (slot.pending_tasks.empty()) {
-                continue;
-            }
-            if (slot.in_flight >= query_in_flight_limit) {
-                continue;
-            }
-            if (slot.TotalDispatchBudget() == 0) {
-                slot.base_dispatch_budget = policy.base_dispatch_budget_cap;
-                slot.bonus_dispatch_budget = BonusDispatchBudgetCap(slot, policy);
-            }
+    void MergeStagedSubmissionLocked(QuerySlot &slot, StagedSubmission staged) {
+        slot.submission_started |= staged.submission_started;
+        for (auto &task: staged.tasks) {
+            slot.pending_tasks.emplace_back(std::move(task));
         }
+    }
 
-        return CollectAndEnqueueRunnableCandidatesLocked(query_in_flight_limit);
+    QuerySlot &BeginSubmissionLocked(uint64_t query_id) {
+        auto &slot = query_slots_[query_id];
+        slot.query_id = query_id;
+        slot.attached = true;
+        slot.submission_started = true;
+        return slot;
     }
 
-    void TryEnqueueRunnableLocked(QuerySlot &slot) {
-        if (!IsRunnableCandidateLocked(slot, QueryInFlightLimitLocked())) {
-            return;
+    void EndSubmissionLocked(QuerySlot &slot, bool was_idle, std::vector<DispatchTask> &dispatch_tasks) {
+        UpdateVisibilityLocked(slot);
+        auto query_share = SyncQueryShareLocked();
+        ApplyBudgetEpochLocked(slot, ComputeDispatchRoundPolicy(query_share));
+        if (slot.activated && was_idle && slot.TotalDispatchBudget() == 0) {
+            AssignDispatchBudgetsLocked(slot, query_share);
         }
-        slot.queued = true;
-        InsertRunnableQueryOrderedLocked(slot);
+        ClassifySlotLocked(slot);
+        DispatchReadyTasksLocked(dispatch_tasks);
     }
 
     void TryEraseSlotLocked(QuerySlotMap::iterator it) {
@@ -502,6 +642,7 @@ private:
         if (it->second.in_flight != 0) {
             return;
         }
+        RemoveFromQueueLocked(it->second);
         query_slots_.erase(it);
     }
 
@@ -510,34 +651,27 @@ private:
             if (!HasRunnableQueriesLocked() && !RefillDispatchBudgetsLocked()) {
                 break;
             }
-            if (!HasRunnableQueriesLocked()) {
-                break;
-            }
 
-            auto query_id = PopRunnableQueryLocked();
+            auto &slot = PopRunnableQueryLocked();
+            auto query_id = slot.query_id;
 
-            auto it = query_slots_.find(query_id);
-            if (it == query_slots_.end()) {
-                continue;
-            }
-
-            auto &slot = it->second;
-            slot.queued = false;
-
-            auto query_in_flight_limit = QueryInFlightLimitLocked();
-            if (slot.pending_tasks.empty() || slot.in_flight >= query_in_flight_limit || slot.TotalDispatchBudget() == 0) {
-                TryEnqueueRunnableLocked(slot);
-                TryEraseSlotLocked(it);
+            auto query_share = QueryShareLocked();
+            auto policy = ComputeDispatchRoundPolicy(query_share);
+            ApplyBudgetEpochLocked(slot, policy);
+            if (slot.pending_tasks.empty() || slot.in_flight >= QueryInFlightLimit(slot, policy) || slot.TotalDispatchBudget() == 0) {
+                ClassifySlotLocked(slot);
+                TryEraseSlotLocked(query_slots_.find(query_id));
                 continue;
             }
 
             auto task = std::move(slot.pending_tasks.front());
             slot.pending_tasks.pop_front();
-            auto query_share_count = QueryShareCountLocked();
+            auto query_share_count = query_share.query_count;
             auto used_bonus_dispatch = slot.base_dispatch_budget == 0;
             if (!used_bonus_dispatch) {
                 --slot.base_dispatch_budget;
-                slot.last_base_dispatch_sequence = next_dispatch_sequence_++;
+                virtual_dispatch_pass_ = std::max(virtual_dispatch_pass_, slot.base_dispatch_pass);
+                slot.base_dispatch_pass += kDispatchStride / slot.weight;
             } else {
                 --slot.bonus_dispatch_budget;
                 slot.last_bonus_dispatch_sequence = next_dispatch_sequence_++;
@@ -560,7 +694,7 @@ private:
                         static_cast<uint32_t>(query_share_count)
                 );
             }
-            TryEnqueueRunnableLocked(slot);
+            ClassifySlotLocked(slot);
 
             dispatch_tasks.push_back(DispatchTask{query_id, std::move(task)});
         }
@@ -594,8 +728,9 @@ private:
                 if (slot.in_flight > 0) {
                     --slot.in_flight;
                 }
-                (void) SyncQueryShareCountLocked();
-                TryEnqueueRunnableLocked(slot);
+                UpdateVisibilityLocked(slot);
+                (void) SyncQueryShareLocked();
+                ClassifySlotLocked(slot);
                 TryEraseSlotLocked(it);
             }
 
@@ -607,15 +742,25 @@ private:
     std::shared_ptr<ThreadPool> pool_;
     size_t worker_count_;
     mutable std::mutex mutex_;
+    std::array<SubmissionShard, kSubmissionShardCount> submission_shards_;
     QuerySlotMap query_slots_;
-    std::deque<uint64_t> base_runnable_queries_;
-    std::deque<uint64_t> latency_sensitive_bonus_runnable_queries_;
+    // indexed by PriorityRank
+    std::array<std::set<RunnableKey>, kPriorityCount> base_runnable_queries_;
+    std::set<RunnableKey> latency_sensitive_bonus_runnable_queries_;
+    std::unordered_set<uint64_t> throttled_queries_;
+    std::unordered_set<uint64_t> refill_queries_;
+    size_t runnable_query_count_ = 0;
 #if DEXKIT_ENABLE_INTERNAL_METRICS
     QuerySchedulerMetricsState metrics_;
 #endif
     uint64_t next_activation_sequence_ = 1;
     uint64_t next_dispatch_sequence_ = 1;
-    size_t last_query_share_count_ = 1;
+    // pass of the latest base dispatch, queries that become runnable start from here
+    uint64_t virtual_dispatch_pass_ = 0;
+    QueryShare last_query_share_{};
+    uint64_t budget_epoch_ = 0;
+    size_t visible_query_count_ = 0;
+    uint64_t visible_query_weight_ = 0;
     size_t total_in_flight_ = 0;
 };
 
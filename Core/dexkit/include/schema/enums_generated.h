@@ -21,34 +21,37 @@ enum class StringMatchType : int8_t {
   StartWith = 1,
   EndWith = 2,
   SimilarRegex = 3,
-  Equal = 4
+  Equal = 4,
+  Regex = 5
 };
 
-inline const StringMatchType (&EnumValuesStringMatchType())[5] {
+inline const StringMatchType (&EnumValuesStringMatchType())[6] {
   static const StringMatchType values[] = {
     StringMatchType::Contains,
     StringMatchType::StartWith,
     StringMatchType::EndWith,
     StringMatchType::SimilarRegex,
-    StringMatchType::Equal
+    StringMatchType::Equal,
+    StringMatchType::Regex
   };
   return values;
 }
 
 inline const char * const *EnumNamesStringMatchType() {
-  static const char * const names[6] = {
+  static const char * const names[7] = {
     "Contains",
     "StartWith",
     "EndWith",
     "SimilarRegex",
     "Equal",
+    "Regex",
     nullptr
   };
   return names;
 }
 
 inline const char *EnumNameStringMatchType(StringMatchType e) {
-  if (::flatbuffers::IsOutRange(e, StringMatchType::Contains, StringMatchType::Equal)) return "";
+  if (::flatbuffers::IsOutRange(e, StringMatchType::Contains, StringMatchType::Regex)) return "";
   const size_t index = static_cast<size_t>(e);
   return EnumNamesStringMatchType()[index];
 }
@@ -333,6 +336,40 @@ inline const char *EnumNameAnnotationEncodeValueType(AnnotationEncodeValueType e
   return EnumNamesAnnotationEncodeValueType()[index];
 }
 
+enum class QueryPriority : int8_t {
+  Default = 0,
+  Background = 1,
+  Normal = 2,
+  LatencySensitive = 3
+};
+
+inline const QueryPriority (&EnumValuesQueryPriority())[4] {
+  static const QueryPriority values[] = {
+    QueryPriority::Default,
+    QueryPriority::Background,
+    QueryPriority::Normal,
+    QueryPriority::LatencySensitive
+  };
+  return values;
+}
+
+inline const char * const *EnumNamesQueryPriority() {
+  static const char * const names[5] = {
+    "Default",
+    "Background",
+    "Normal",
+    "LatencySensitive",
+    nullptr
+  };
+  return names;
+}
+
+inline const char *EnumNameQueryPriority(QueryPriority e) {
+  if (::flatbuffers::IsOutRange(e, QueryPriority::Default, QueryPriority::LatencySensitive)) return "";
+  const size_t index = static_cast<size_t>(e);
+  return EnumNamesQueryPriority()[index];
+}
+
 }  // namespace schema
 }  // namespace dexkit
 
@@ -33,6 +33,18 @@ struct BatchFindClassUsingStringsBuilder;
 struct BatchFindMethodUsingStrings;
 struct BatchFindMethodUsingStringsBuilder;
 
+struct QueryPipelineStage;
+struct QueryPipelineStageBuilder;
+
+struct QueryPipeline;
+struct QueryPipelineBuilder;
+
+struct MultiFindClass;
+struct MultiFindClassBuilder;
+
+struct MultiFindMethod;
+struct MultiFindMethodBuilder;
+
 struct FindClass FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
   typedef FindClassBuilder Builder;
   struct Traits;
@@ -42,7 +54,10 @@ struct FindClass FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
     VT_IGNORE_PACKAGES_CASE = 8,
     VT_IN_CLASSES = 10,
     VT_FIND_FIRST = 12,
-    VT_MATCHER = 14
+    VT_MATCHER = 14,
+    VT_PRIORITY = 16,
+    VT_WEIGHT = 18,
+    VT_SOURCE_IDS = 20
   };
   const ::flatbuffers::Vector<::flatbuffers::Offset<::flatbuffers::String>> *search_packages() const {
     return GetPointer<const ::flatbuffers::Vector<::flatbuffers::Offset<::flatbuffers::String>> *>(VT_SEARCH_PACKAGES);
@@ -62,6 +77,15 @@ struct FindClass FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
   const dexkit::schema::ClassMatcher *matcher() const {
     return GetPointer<const dexkit::schema::ClassMatcher *>(VT_MATCHER);
   }
+  dexkit::schema::QueryPriority priority() const {
+    return static_cast<dexkit::schema::QueryPriority>(GetField<int8_t>(VT_PRIORITY, 0));
+  }
+  uint32_t weight() const {
+    return GetField<uint32_t>(VT_WEIGHT, 0);
+  }
+  const ::flatbuffers::Vector<uint32_t> *source_ids() const {
+    return GetPointer<const ::flatbuffers::Vector<uint32_t> *>(VT_SOURCE_IDS);
+  }
   bool Verify(::flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyOffset(verifier, VT_SEARCH_PACKAGES) &&
@@ -76,6 +100,10 @@ struct FindClass FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
            VerifyField<uint8_t>(verifier, VT_FIND_FIRST, 1) &&
            VerifyOffset(verifier, VT_MATCHER) &&
            verifier.VerifyTable(matcher()) &&
+           VerifyField<int8_t>(verifier, VT_PRIORITY, 1) &&
+           VerifyField<uint32_t>(verifier, VT_WEIGHT, 4) &&
+           VerifyOffset(verifier, VT_SOURCE_IDS) &&
+           verifier.VerifyVector(source_ids()) &&
            verifier.EndTable();
   }
 };
@@ -102,6 +130,15 @@ struct FindClassBuilder {
   void add_matcher(::flatbuffers::Offset<dexkit::schema::ClassMatcher> matcher) {
     fbb_.AddOffset(FindClass::VT_MATCHER, matcher);
   }
+  void add_priority(dexkit::schema::QueryPriority priority) {
+    fbb_.AddElement<int8_t>(FindClass::VT_PRIORITY, static_cast<int8_t>(priority), 0);
+  }
+  void add_weight(uint32_t weight) {
+    fbb_.AddElement<uint32_t>(FindClass::VT_WEIGHT, weight, 0);
+  }
+  void add_source_ids(::flatbuffers::Offset<::flatbuffers::Vector<uint32_t>> source_ids) {
+    fbb_.AddOffset(FindClass::VT_SOURCE_IDS, source_ids);
+  }
   explicit FindClassBuilder(::flatbuffers::FlatBufferBuilder &_fbb)
         : fbb_(_fbb) {
     start_ = fbb_.StartTable();
@@ -120,12 +157,18 @@ inline ::flatbuffers::Offset<FindClass> CreateFindClass(
     bool ignore_packages_case = false,
     ::flatbuffers::Offset<::flatbuffers::Vector<int64_t>> in_classes = 0,
     bool find_first = false,
-    ::flatbuffers::Offset<dexkit::schema::ClassMatcher> matcher = 0) {
+    ::flatbuffers::Offset<dexkit::schema::ClassMatcher> matcher = 0,
+    dexkit::schema::QueryPriority priority = dexkit::schema::QueryPriority::Default,
+    uint32_t weight = 0,
+    ::flatbuffers::Offset<::flatbuffers::Vector<uint32_t>> source_ids = 0) {
   FindClassBuilder builder_(_fbb);
+  builder_.add_source_ids(source_ids);
+  builder_.add_weight(weight);
   builder_.add_matcher(matcher);
   builder_.add_in_classes(in_classes);
   builder_.add_exclude_packages(exclude_packages);
   builder_.add_search_packages(search_packages);
+  builder_.add_priority(priority);
   builder_.add_find_first(find_first);
   builder_.add_ignore_packages_case(ignore_packages_case);
   return builder_.Finish();
@@ -143,10 +186,14 @@ inline ::flatbuffers::Offset<FindClass> CreateFindClassDirect(
     bool ignore_packages_case = false,
     const std::vector<int64_t> *in_classes = nullptr,
     bool find_first = false,
-    ::flatbuffers::Offset<dexkit::schema::ClassMatcher> matcher = 0) {
+    ::flatbuffers::Offset<dexkit::schema::ClassMatcher> matcher = 0,
+    dexkit::schema::QueryPriority priority = dexkit::schema::QueryPriority::Default,
+    uint32_t weight = 0,
+    const std::vector<uint32_t> *source_ids = nullptr) {
   auto search_packages__ = search_packages ? _fbb.CreateVector<::flatbuffers::Offset<::flatbuffers::String>>(*search_packages) : 0;
   auto exclude_packages__ = exclude_packages ? _fbb.CreateVector<::flatbuffers::Offset<::flatbuffers::String>>(*exclude_packages) : 0;
   auto in_classes__ = in_classes ? _fbb.CreateVector<int64_t>(*in_classes) : 0;
+  auto source_ids__ = source_ids ? _fbb.CreateVector<uint32_t>(*source_ids) : 0;
   return dexkit::schema::CreateFindClass(
       _fbb,
       search_packages__,
@@ -154,7 +201,10 @@ inline ::flatbuffers::Offset<FindClass> CreateFindClassDirect(
       ignore_packages_case,
       in_classes__,
       find_first,
-      matcher);
+      matcher,
+      priority,
+      weight,
+      source_ids__);
 }
 
 struct FindMethod FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
@@ -167,7 +217,10 @@ struct FindMethod FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
     VT_IN_CLASSES = 10,
     VT_IN_METHODS = 12,
     VT_FIND_FIRST = 14,
-    VT_MATCHER = 16
+    VT_MATCHER = 16,
+    VT_PRIORITY = 18,
+    VT_WEIGHT = 20,
+    VT_SOURCE_IDS = 22
   };
   const ::flatbuffers::Vector<::flatbuffers::Offset<::flatbuffers::String>> *search_packages() const {
     return GetPointer<const ::flatbuffers::Vector<::flatbuffers::Offset<::flatbuffers::String>> *>(VT_SEARCH_PACKAGES);
@@ -190,6 +243,15 @@ struct FindMethod FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
   const dexkit::schema::MethodMatcher *matcher() const {
     return GetPointer<const dexkit::schema::MethodMatcher *>(VT_MATCHER);
   }
+  dexkit::schema::QueryPriority priority() const {
+    return static_cast<dexkit::schema::QueryPriority>(GetField<int8_t>(VT_PRIORITY, 0));
+  }
+  uint32_t weight() const {
+    return GetField<uint32_t>(VT_WEIGHT, 0);
+  }
+  const ::flatbuffers::Vector<uint32_t> *source_ids() const {
+    return GetPointer<const ::flatbuffers::Vector<uint32_t> *>(VT_SOURCE_IDS);
+  }
   bool Verify(::flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyOffset(verifier, VT_SEARCH_PACKAGES) &&
@@ -206,6 +268,10 @@ struct FindMethod FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
            VerifyField<uint8_t>(verifier, VT_FIND_FIRST, 1) &&
            VerifyOffset(verifier, VT_MATCHER) &&
            verifier.VerifyTable(matcher()) &&
+           VerifyField<int8_t>(verifier, VT_PRIORITY, 1) &&
+           VerifyField<uint32_t>(verifier, VT_WEIGHT, 4) &&
+           VerifyOffset(verifier, VT_SOURCE_IDS) &&
+           verifier.VerifyVector(source_ids()) &&
            verifier.EndTable();
   }
 };
@@ -235,6 +301,15 @@ struct FindMethodBuilder {
   void add_matcher(::flatbuffers::Offset<dexkit::schema::MethodMatcher> matcher) {
     fbb_.AddOffset(FindMethod::VT_MATCHER, matcher);
   }
+  void add_priority(dexkit::schema::QueryPriority priority) {
+    fbb_.AddElement<int8_t>(FindMethod::VT_PRIORITY, static_cast<int8_t>(priority), 0);
+  }
+  void add_weight(uint32_t weight) {
+    fbb_.AddElement<uint32_t>(FindMethod::VT_WEIGHT, weight, 0);
+  }
+  void add_source_ids(::flatbuffers::Offset<::flatbuffers::Vector<uint32_t>> source_ids) {
+    fbb_.AddOffset(FindMethod::VT_SOURCE_IDS, source_ids);
+  }
   explicit FindMethodBuilder(::flatbuffers::FlatBufferBuilder &_fbb)
         : fbb_(_fbb) {
     start_ = fbb_.StartTable();
@@ -254,13 +329,19 @@ inline ::flatbuffers::Offset<FindMethod> CreateFindMethod(
     ::flatbuffers::Offset<::flatbuffers::Vector<int64_t>> in_classes = 0,
     ::flatbuffers::Offset<::flatbuffers::Vector<int64_t>> in_methods = 0,
     bool find_first = false,
-    ::flatbuffers::Offset<dexkit::schema::MethodMatcher> matcher = 0) {
+    ::flatbuffers::Offset<dexkit::schema::MethodMatcher> matcher = 0,
+    dexkit::schema::QueryPriority priority = dexkit::schema::QueryPriority::Default,
+    uint32_t weight = 0,
+    ::flatbuffers::Offset<::flatbuffers::Vector<uint32_t>> source_ids = 0) {
   FindMethodBuilder builder_(_fbb);
+  builder_.add_source_ids(source_ids);
+  builder_.add_weight(weight);
   builder_.add_matcher(matcher);
   builder_.add_in_methods(in_methods);
   builder_.add_in_classes(in_classes);
   builder_.add_exclude_packages(exclude_packages);
   builder_.add_search_packages(search_packages);
+  builder_.add_priority(priority);
   builder_.add_find_first(find_first);
   builder_.add_ignore_packages_case(ignore_packages_case);
   return builder_.Finish();
@@ -279,11 +360,15 @@ inline ::flatbuffers::Offset<FindMethod> CreateFindMethodDirect(
     const std::vector<int64_t> *in_classes = nullptr,
     const std::vector<int64_t> *in_methods = nullptr,
     bool find_first = false,
-    ::flatbuffers::Offset<dexkit::schema::MethodMatcher> matcher = 0) {
+    ::flatbuffers::Offset<dexkit::schema::MethodMatcher> matcher = 0,
+    dexkit::schema::QueryPriority priority = dexkit::schema::QueryPriority::Default,
+    uint32_t weight = 0,
+    const std::vector<uint32_t> *source_ids = nullptr) {
   auto search_packages__ = search_packages ? _fbb.CreateVector<::flatbuffers::Offset<::flatbuffers::String>>(*search_packages) : 0;
   auto exclude_packages__ = exclude_packages ? _fbb.CreateVector<::flatbuffers::Offset<::flatbuffers::String>>(*exclude_packages) : 0;
   auto in_classes__ = in_classes ? _fbb.CreateVector<int64_t>(*in_classes) : 0;
   auto in_methods__ = in_methods ? _fbb.CreateVector<int64_t>(*in_methods) : 0;
+  auto source_ids__ = source_ids ? _fbb.CreateVector<uint32_t>(*source_ids) : 0;
   return dexkit::schema::CreateFindMethod(
       _fbb,
       search_packages__,
@@ -292,7 +377,10 @@ inline ::flatbuffers::Offset<FindMethod> CreateFindMethodDirect(
       in_classes__,
       in_methods__,
       find_first,
-      matcher);
+      matcher,
+      priority,
+      weight,
+      source_ids__);
 }
 
 struct FindField FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
@@ -305,7 +393,10 @@ struct FindField FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
     VT_IN_CLASSES = 10,
     VT_IN_FIELDS = 12,
     VT_FIND_FIRST = 14,
-    VT_MATCHER = 16
+    VT_MATCHER = 16,
+    VT_PRIORITY = 18,
+    VT_WEIGHT = 20,
+    VT_SOURCE_IDS = 22
   };
   const ::flatbuffers::Vector<::flatbuffers::Offset<::flatbuffers::String>> *search_packages() const {
     return GetPointer<const ::flatbuffers::Vector<::flatbuffers::Offset<::flatbuffers::String>> *>(VT_SEARCH_PACKAGES);
@@ -328,6 +419,15 @@ struct FindField FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
   const dexkit::schema::FieldMatcher *matcher() const {
     return GetPointer<const dexkit::schema::FieldMatcher *>(VT_MATCHER);
   }
+  dexkit::schema::QueryPriority priority() const {
+    return static_cast<dexkit::schema::QueryPriority>(GetField<int8_t>(VT_PRIORITY, 0));
+  }
+  uint32_t weight() const {
+    return GetField<uint32_t>(VT_WEIGHT, 0);
+  }
+  const ::flatbuffers::Vector<uint32_t> *source_ids() const {
+    return GetPointer<const ::flatbuffers::Vector<uint32_t> *>(VT_SOURCE_IDS);
+  }
   bool Verify(::flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyOffset(verifier, VT_SEARCH_PACKAGES) &&
@@ -344,6 +444,10 @@ struct FindField FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
            VerifyField<uint8_t>(verifier, VT_FIND_FIRST, 1) &&
            VerifyOffset(verifier, VT_MATCHER) &&
            verifier.VerifyTable(matcher()) &&
+           VerifyField<int8_t>(verifier, VT_PRIORITY, 1) &&
+           VerifyField<uint32_t>(verifier, VT_WEIGHT, 4) &&
+           VerifyOffset(verifier, VT_SOURCE_IDS) &&
+           verifier.VerifyVector(source_ids()) &&
            verifier.EndTable();
   }
 };
@@ -373,6 +477,15 @@ struct FindFieldBuilder {
   void add_matcher(::flatbuffers::Offset<dexkit::schema::FieldMatcher> matcher) {
     fbb_.AddOffset(FindField::VT_MATCHER, matcher);
   }
+  void add_priority(dexkit::schema::QueryPriority priority) {
+    fbb_.AddElement<int8_t>(FindField::VT_PRIORITY, static_cast<int8_t>(priority), 0);
+  }
+  void add_weight(uint32_t weight) {
+    fbb_.AddElement<uint32_t>(FindField::VT_WEIGHT, weight, 0);
+  }
+  void add_source_ids(::flatbuffers::Offset<::flatbuffers::Vector<uint32_t>> source_ids) {
+    fbb_.AddOffset(FindField::VT_SOURCE_IDS, source_ids);
+  }
   explicit FindFieldBuilder(::flatbuffers::FlatBufferBuilder &_fbb)
         : fbb_(_fbb) {
     start_ = fbb_.StartTable();
@@ -392,13 +505,19 @@ inline ::flatbuffers::Offset<FindField> CreateFindField(
     ::flatbuffers::Offset<::flatbuffers::Vector<int64_t>> in_classes = 0,
     ::flatbuffers::Offset<::flatbuffers::Vector<int64_t>> in_fields = 0,
     bool find_first = false,
-    ::flatbuffers::Offset<dexkit::schema::FieldMatcher> matcher = 0) {
+    ::flatbuffers::Offset<dexkit::schema::FieldMatcher> matcher = 0,
+    dexkit::schema::QueryPriority priority = dexkit::schema::QueryPriority::Default,
+    uint32_t weight = 0,
+    ::flatbuffers::Offset<::flatbuffers::Vector<uint32_t>> source_ids = 0) {
   FindFieldBuilder builder_(_fbb);
+  builder_.add_source_ids(source_ids);
+  builder_.add_weight(weight);
   builder_.add_matcher(matcher);
   builder_.add_in_fields(in_fields);
   builder_.add_in_classes(in_classes);
   builder_.add_exclude_packages(exclude_packages);
   builder_.add_search_packages(search_packages);
+  builder_.add_priority(priority);
   builder_.add_find_first(find_first);
   builder_.add_ignore_packages_case(ignore_packages_case);
   return builder_.Finish();
@@ -417,11 +536,15 @@ inline ::flatbuffers::Offset<FindField> CreateFindFieldDirect(
     const std::vector<int64_t> *in_classes = nullptr,
     const std::vector<int64_t> *in_fields = nullptr,
     bool find_first = false,
-    ::flatbuffers::Offset<dexkit::schema::FieldMatcher> matcher = 0) {
+    ::flatbuffers::Offset<dexkit::schema::FieldMatcher> matcher = 0,
+    dexkit::schema::QueryPriority priority = dexkit::schema::QueryPriority::Default,
+    uint32_t weight = 0,
+    const std::vector<uint32_t> *source_ids = nullptr) {
   auto search_packages__ = search_packages ? _fbb.CreateVector<::flatbuffers::Offset<::flatbuffers::String>>(*search_packages) : 0;
   auto exclude_packages__ = exclude_packages ? _fbb.CreateVector<::flatbuffers::Offset<::flatbuffers::String>>(*exclude_packages) : 0;
   auto in_classes__ = in_classes ? _fbb.CreateVector<int64_t>(*in_classes) : 0;
   auto in_fields__ = in_fields ? _fbb.CreateVector<int64_t>(*in_fields) : 0;
+  auto source_ids__ = source_ids ? _fbb.CreateVector<uint32_t>(*source_ids) : 0;
   return dexkit::schema::CreateFindField(
       _fbb,
       search_packages__,
@@ -430,7 +553,10 @@ inline ::flatbuffers::Offset<FindField> CreateFindFieldDirect(
       in_classes__,
       in_fields__,
       find_first,
-      matcher);
+      matcher,
+      priority,
+      weight,
+      source_ids__);
 }
 
 struct BatchFindClassUsingStrings FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
@@ -441,7 +567,9 @@ struct BatchFindClassUsingStrings FLATBUFFERS_FINAL_CLASS : private ::flatbuffer
     VT_EXCLUDE_PACKAGES = 6,
     VT_IGNORE_PACKAGES_CASE = 8,
     VT_IN_CLASSES = 10,
-    VT_MATCHERS = 12
+    VT_MATCHERS = 12,
+    VT_PRIORITY = 14,
+    VT_WEIGHT = 16
   };
   const ::flatbuffers::Vector<::flatbuffers::Offset<::flatbuffers::String>> *search_packages() const {
     return GetPointer<const ::flatbuffers::Vector<::flatbuffers::Offset<::flatbuffers::String>> *>(VT_SEARCH_PACKAGES);
@@ -458,6 +586,12 @@ struct BatchFindClassUsingStrings FLATBUFFERS_FINAL_CLASS : private ::flatbuffer
   const ::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::BatchUsingStringsMatcher>> *matchers() const {
     return GetPointer<const ::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::BatchUsingStringsMatcher>> *>(VT_MATCHERS);
   }
+  dexkit::schema::QueryPriority priority() const {
+    return static_cast<dexkit::schema::QueryPriority>(GetField<int8_t>(VT_PRIORITY, 0));
+  }
+  uint32_t weight() const {
+    return GetField<uint32_t>(VT_WEIGHT, 0);
+  }
   bool Verify(::flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyOffset(verifier, VT_SEARCH_PACKAGES) &&
@@ -472,6 +606,8 @@ struct BatchFindClassUsingStrings FLATBUFFERS_FINAL_CLASS : private ::flatbuffer
            VerifyOffset(verifier, VT_MATCHERS) &&
            verifier.VerifyVector(matchers()) &&
            verifier.VerifyVectorOfTables(matchers()) &&
+           VerifyField<int8_t>(verifier, VT_PRIORITY, 1) &&
+           VerifyField<uint32_t>(verifier, VT_WEIGHT, 4) &&
            verifier.EndTable();
   }
 };
@@ -495,6 +631,12 @@ struct BatchFindClassUsingStringsBuilder {
   void add_matchers(::flatbuffers::Offset<::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::BatchUsingStringsMatcher>>> matchers) {
     fbb_.AddOffset(BatchFindClassUsingStrings::VT_MATCHERS, matchers);
   }
+  void add_priority(dexkit::schema::QueryPriority priority) {
+    fbb_.AddElement<int8_t>(BatchFindClassUsingStrings::VT_PRIORITY, static_cast<int8_t>(priority), 0);
+  }
+  void add_weight(uint32_t weight) {
+    fbb_.AddElement<uint32_t>(BatchFindClassUsingStrings::VT_WEIGHT, weight, 0);
+  }
   explicit BatchFindClassUsingStringsBuilder(::flatbuffers::FlatBufferBuilder &_fbb)
         : fbb_(_fbb) {
     start_ = fbb_.StartTable();
@@ -512,12 +654,16 @@ inline ::flatbuffers::Offset<BatchFindClassUsingStrings> CreateBatchFindClassUsi
     ::flatbuffers::Offset<::flatbuffers::Vector<::flatbuffers::Offset<::flatbuffers::String>>> exclude_packages = 0,
     bool ignore_packages_case = false,
     ::flatbuffers::Offset<::flatbuffers::Vector<int64_t>> in_classes = 0,
-    ::flatbuffers::Offset<::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::BatchUsingStringsMatcher>>> matchers = 0) {
+    ::flatbuffers::Offset<::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::BatchUsingStringsMatcher>>> matchers = 0,
+    dexkit::schema::QueryPriority priority = dexkit::schema::QueryPriority::Default,
+    uint32_t weight = 0) {
   BatchFindClassUsingStringsBuilder builder_(_fbb);
+  builder_.add_weight(weight);
   builder_.add_matchers(matchers);
   builder_.add_in_classes(in_classes);
   builder_.add_exclude_packages(exclude_packages);
   builder_.add_search_packages(search_packages);
+  builder_.add_priority(priority);
   builder_.add_ignore_packages_case(ignore_packages_case);
   return builder_.Finish();
 }
@@ -533,7 +679,9 @@ inline ::flatbuffers::Offset<BatchFindClassUsingStrings> CreateBatchFindClassUsi
     const std::vector<::flatbuffers::Offset<::flatbuffers::String>> *exclude_packages = nullptr,
     bool ignore_packages_case = false,
     const std::vector<int64_t> *in_classes = nullptr,
-    const std::vector<::flatbuffers::Offset<dexkit::schema::BatchUsingStringsMatcher>> *matchers = nullptr) {
+    const std::vector<::flatbuffers::Offset<dexkit::schema::BatchUsingStringsMatcher>> *matchers = nullptr,
+    dexkit::schema::QueryPriority priority = dexkit::schema::QueryPriority::Default,
+    uint32_t weight = 0) {
   auto search_packages__ = search_packages ? _fbb.CreateVector<::flatbuffers::Offset<::flatbuffers::String>>(*search_packages) : 0;
   auto exclude_packages__ = exclude_packages ? _fbb.CreateVector<::flatbuffers::Offset<::flatbuffers::String>>(*exclude_packages) : 0;
   auto in_classes__ = in_classes ? _fbb.CreateVector<int64_t>(*in_classes) : 0;
@@ -544,7 +692,9 @@ inline ::flatbuffers::Offset<BatchFindClassUsingStrings> CreateBatchFindClassUsi
       exclude_packages__,
       ignore_packages_case,
       in_classes__,
-      matchers__);
+      matchers__,
+      priority,
+      weight);
 }
 
 struct BatchFindMethodUsingStrings FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
@@ -556,7 +706,9 @@ struct BatchFindMethodUsingStrings FLATBUFFERS_FINAL_CLASS : private ::flatbuffe
     VT_IGNORE_PACKAGES_CASE = 8,
     VT_IN_CLASSES = 10,
     VT_IN_METHODS = 12,
-    VT_MATCHERS = 14
+    VT_MATCHERS = 14,
+    VT_PRIORITY = 16,
+    VT_WEIGHT = 18
   };
   const ::flatbuffers::Vector<::flatbuffers::Offset<::flatbuffers::String>> *search_packages() const {
     return GetPointer<const ::flatbuffers::Vector<::flatbuffers::Offset<::flatbuffers::String>> *>(VT_SEARCH_PACKAGES);
@@ -576,6 +728,12 @@ struct BatchFindMethodUsingStrings FLATBUFFERS_FINAL_CLASS : private ::flatbuffe
   const ::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::BatchUsingStringsMatcher>> *matchers() const {
     return GetPointer<const ::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::BatchUsingStringsMatcher>> *>(VT_MATCHERS);
   }
+  dexkit::schema::QueryPriority priority() const {
+    return static_cast<dexkit::schema::QueryPriority>(GetField<int8_t>(VT_PRIORITY, 0));
+  }
+  uint32_t weight() const {
+    return GetField<uint32_t>(VT_WEIGHT, 0);
+  }
   bool Verify(::flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyOffset(verifier, VT_SEARCH_PACKAGES) &&
@@ -592,6 +750,8 @@ struct BatchFindMethodUsingStrings FLATBUFFERS_FINAL_CLASS : private ::flatbuffe
            VerifyOffset(verifier, VT_MATCHERS) &&
            verifier.VerifyVector(matchers()) &&
            verifier.VerifyVectorOfTables(matchers()) &&
+           VerifyField<int8_t>(verifier, VT_PRIORITY, 1) &&
+           VerifyField<uint32_t>(verifier, VT_WEIGHT, 4) &&
            verifier.EndTable();
   }
 };
@@ -618,6 +778,12 @@ struct BatchFindMethodUsingStringsBuilder {
   void add_matchers(::flatbuffers::Offset<::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::BatchUsingStringsMatcher>>> matchers) {
     fbb_.AddOffset(BatchFindMethodUsingStrings::VT_MATCHERS, matchers);
   }
+  void add_priority(dexkit::schema::QueryPriority priority) {
+    fbb_.AddElement<int8_t>(BatchFindMethodUsingStrings::VT_PRIORITY, static_cast<int8_t>(priority), 0);
+  }
+  void add_weight(uint32_t weight) {
+    fbb_.AddElement<uint32_t>(BatchFindMethodUsingStrings::VT_WEIGHT, weight, 0);
+  }
   explicit BatchFindMethodUsingStringsBuilder(::flatbuffers::FlatBufferBuilder &_fbb)
         : fbb_(_fbb) {
     start_ = fbb_.StartTable();
@@ -636,13 +802,17 @@ inline ::flatbuffers::Offset<BatchFindMethodUsingStrings> CreateBatchFindMethodU
     bool ignore_packages_case = false,
     ::flatbuffers::Offset<::flatbuffers::Vector<int64_t>> in_classes = 0,
     ::flatbuffers::Offset<::flatbuffers::Vector<int64_t>> in_methods = 0,
-    ::flatbuffers::Offset<::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::BatchUsingStringsMatcher>>> matchers = 0) {
+    ::flatbuffers::Offset<::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::BatchUsingStringsMatcher>>> matchers = 0,
+    dexkit::schema::QueryPriority priority = dexkit::schema::QueryPriority::Default,
+    uint32_t weight = 0) {
   BatchFindMethodUsingStringsBuilder builder_(_fbb);
+  builder_.add_weight(weight);
   builder_.add_matchers(matchers);
   builder_.add_in_methods(in_methods);
   builder_.add_in_classes(in_classes);
   builder_.add_exclude_packages(exclude_packages);
   builder_.add_search_packages(search_packages);
+  builder_.add_priority(priority);
   builder_.add_ignore_packages_case(ignore_packages_case);
   return builder_.Finish();
 }
@@ -659,7 +829,9 @@ inline ::flatbuffers::Offset<BatchFindMethodUsingStrings> CreateBatchFindMethodU
     bool ignore_packages_case = false,
     const std::vector<int64_t> *in_classes = nullptr,
     const std::vector<int64_t> *in_methods = nullptr,
-    const std::vector<::flatbuffers::Offset<dexkit::schema::BatchUsingStringsMatcher>> *matchers = nullptr) {
+    const std::vector<::flatbuffers::Offset<dexkit::schema::BatchUsingStringsMatcher>> *matchers = nullptr,
+    dexkit::schema::QueryPriority priority = dexkit::schema::QueryPriority::Default,
+    uint32_t weight = 0) {
   auto search_packages__ = search_packages ? _fbb.CreateVector<::flatbuffers::Offset<::flatbuffers::String>>(*search_packages) : 0;
   auto exclude_packages__ = exclude_packages ? _fbb.CreateVector<::flatbuffers::Offset<::flatbuffers::String>>(*exclude_packages) : 0;
   auto in_classes__ = in_classes ? _fbb.CreateVector<int64_t>(*in_classes) : 0;
@@ -672,7 +844,343 @@ inline ::flatbuffers::Offset<BatchFindMethodUsingStrings> CreateBatchFindMethodU
       ignore_packages_case,
       in_classes__,
       in_methods__,
-      matchers__);
+      matchers__,
+      priority,
+      weight);
+}
+
+struct QueryPipelineStage FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
+  typedef QueryPipelineStageBuilder Builder;
+  struct Traits;
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_FIND_CLASS = 4,
+    VT_FIND_METHOD = 6,
+    VT_FIND_FIELD = 8,
+    VT_IN_CLASSES_FROM = 10,
+    VT_IN_METHODS_FROM = 12,
+    VT_IN_FIELDS_FROM = 14
+  };
+  const dexkit::schema::FindClass *find_class() const {
+    return GetPointer<const dexkit::schema::FindClass *>(VT_FIND_CLASS);
+  }
+  const dexkit::schema::FindMethod *find_method() const {
+    return GetPointer<const dexkit::schema::FindMethod *>(VT_FIND_METHOD);
+  }
+  const dexkit::schema::FindField *find_field() const {
+    return GetPointer<const dexkit::schema::FindField *>(VT_FIND_FIELD);
+  }
+  int32_t in_classes_from() const {
+    return GetField<int32_t>(VT_IN_CLASSES_FROM, -1);
+  }
+  int32_t in_methods_from() const {
+    return GetField<int32_t>(VT_IN_METHODS_FROM, -1);
+  }
+  int32_t in_fields_from() const {
+    return GetField<int32_t>(VT_IN_FIELDS_FROM, -1);
+  }
+  bool Verify(::flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyOffset(verifier, VT_FIND_CLASS) &&
+           verifier.VerifyTable(find_class()) &&
+           VerifyOffset(verifier, VT_FIND_METHOD) &&
+           verifier.VerifyTable(find_method()) &&
+           VerifyOffset(verifier, VT_FIND_FIELD) &&
+           verifier.VerifyTable(find_field()) &&
+           VerifyField<int32_t>(verifier, VT_IN_CLASSES_FROM, 4) &&
+           VerifyField<int32_t>(verifier, VT_IN_METHODS_FROM, 4) &&
+           VerifyField<int32_t>(verifier, VT_IN_FIELDS_FROM, 4) &&
+           verifier.EndTable();
+  }
+};
+
+struct QueryPipelineStageBuilder {
+  typedef QueryPipelineStage Table;
+  ::flatbuffers::FlatBufferBuilder &fbb_;
+  ::flatbuffers::uoffset_t start_;
+  void add_find_class(::flatbuffers::Offset<dexkit::schema::FindClass> find_class) {
+    fbb_.AddOffset(QueryPipelineStage::VT_FIND_CLASS, find_class);
+  }
+  void add_find_method(::flatbuffers::Offset<dexkit::schema::FindMethod> find_method) {
+    fbb_.AddOffset(QueryPipelineStage::VT_FIND_METHOD, find_method);
+  }
+  void add_find_field(::flatbuffers::Offset<dexkit::schema::FindField> find_field) {
+    fbb_.AddOffset(QueryPipelineStage::VT_FIND_FIELD, find_field);
+  }
+  void add_in_classes_from(int32_t in_classes_from) {
+    fbb_.AddElement<int32_t>(QueryPipelineStage::VT_IN_CLASSES_FROM, in_classes_from, -1);
+  }
+  void add_in_methods_from(int32_t in_methods_from) {
+    fbb_.AddElement<int32_t>(QueryPipelineStage::VT_IN_METHODS_FROM, in_methods_from, -1);
+  }
+  void add_in_fields_from(int32_t in_fields_from) {
+    fbb_.AddElement<int32_t>(QueryPipelineStage::VT_IN_FIELDS_FROM, in_fields_from, -1);
+  }
+  explicit QueryPipelineStageBuilder(::flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  ::flatbuffers::Offset<QueryPipelineStage> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = ::flatbuffers::Offset<QueryPipelineStage>(end);
+    return o;
+  }
+};
+
+inline ::flatbuffers::Offset<QueryPipelineStage> CreateQueryPipelineStage(
+    ::flatbuffers::FlatBufferBuilder &_fbb,
+    ::flatbuffers::Offset<dexkit::schema::FindClass> find_class = 0,
+    ::flatbuffers::Offset<dexkit::schema::FindMethod> find_method = 0,
+    ::flatbuffers::Offset<dexkit::schema::FindField> find_field = 0,
+    int32_t in_classes_from = -1,
+    int32_t in_methods_from = -1,
+    int32_t in_fields_from = -1) {
+  QueryPipelineStageBuilder builder_(_fbb);
+  builder_.add_in_fields_from(in_fields_from);
+  builder_.add_in_methods_from(in_methods_from);
+  builder_.add_in_classes_from(in_classes_from);
+  builder_.add_find_field(find_field);
+  builder_.add_find_method(find_method);
+  builder_.add_find_class(find_class);
+  return builder_.Finish();
+}
+
+struct QueryPipelineStage::Traits {
+  using type = QueryPipelineStage;
+  static auto constexpr Create = CreateQueryPipelineStage;
+};
+
+struct QueryPipeline FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
+  typedef QueryPipelineBuilder Builder;
+  struct Traits;
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_STAGES = 4,
+    VT_OUTPUT_STAGE = 6
+  };
+  const ::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::QueryPipelineStage>> *stages() const {
+    return GetPointer<const ::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::QueryPipelineStage>> *>(VT_STAGES);
+  }
+  int32_t output_stage() const {
+    return GetField<int32_t>(VT_OUTPUT_STAGE, -1);
+  }
+  bool Verify(::flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyOffset(verifier, VT_STAGES) &&
+           verifier.VerifyVector(stages()) &&
+           verifier.VerifyVectorOfTables(stages()) &&
+           VerifyField<int32_t>(verifier, VT_OUTPUT_STAGE, 4) &&
+           verifier.EndTable();
+  }
+};
+
+struct QueryPipelineBuilder {
+  typedef QueryPipeline Table;
+  ::flatbuffers::FlatBufferBuilder &fbb_;
+  ::flatbuffers::uoffset_t start_;
+  void add_stages(::flatbuffers::Offset<::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::QueryPipelineStage>>> stages) {
+    fbb_.AddOffset(QueryPipeline::VT_STAGES, stages);
+  }
+  void add_output_stage(int32_t output_stage) {
+    fbb_.AddElement<int32_t>(QueryPipeline::VT_OUTPUT_STAGE, output_stage, -1);
+  }
+  explicit QueryPipelineBuilder(::flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  ::flatbuffers::Offset<QueryPipeline> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = ::flatbuffers::Offset<QueryPipeline>(end);
+    return o;
+  }
+};
+
+inline ::flatbuffers::Offset<QueryPipeline> CreateQueryPipeline(
+    ::flatbuffers::FlatBufferBuilder &_fbb,
+    ::flatbuffers::Offset<::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::QueryPipelineStage>>> stages = 0,
+    int32_t output_stage = -1) {
+  QueryPipelineBuilder builder_(_fbb);
+  builder_.add_output_stage(output_stage);
+  builder_.add_stages(stages);
+  return builder_.Finish();
+}
+
+struct QueryPipeline::Traits {
+  using type = QueryPipeline;
+  static auto constexpr Create = CreateQueryPipeline;
+};
+
+inline ::flatbuffers::Offset<QueryPipeline> CreateQueryPipelineDirect(
+    ::flatbuffers::FlatBufferBuilder &_fbb,
+    const std::vector<::flatbuffers::Offset<dexkit::schema::QueryPipelineStage>> *stages = nullptr,
+    int32_t output_stage = -1) {
+  auto stages__ = stages ? _fbb.CreateVector<::flatbuffers::Offset<dexkit::schema::QueryPipelineStage>>(*stages) : 0;
+  return dexkit::schema::CreateQueryPipeline(
+      _fbb,
+      stages__,
+      output_stage);
+}
+
+struct MultiFindClass FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
+  typedef MultiFindClassBuilder Builder;
+  struct Traits;
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_QUERIES = 4,
+    VT_PRIORITY = 6,
+    VT_WEIGHT = 8
+  };
+  const ::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::FindClass>> *queries() const {
+    return GetPointer<const ::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::FindClass>> *>(VT_QUERIES);
+  }
+  dexkit::schema::QueryPriority priority() const {
+    return static_cast<dexkit::schema::QueryPriority>(GetField<int8_t>(VT_PRIORITY, 0));
+  }
+  uint32_t weight() const {
+    return GetField<uint32_t>(VT_WEIGHT, 0);
+  }
+  bool Verify(::flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyOffset(verifier, VT_QUERIES) &&
+           verifier.VerifyVector(queries()) &&
+           verifier.VerifyVectorOfTables(queries()) &&
+           VerifyField<int8_t>(verifier, VT_PRIORITY, 1) &&
+           VerifyField<uint32_t>(verifier, VT_WEIGHT, 4) &&
+           verifier.EndTable();
+  }
+};
+
+struct MultiFindClassBuilder {
+  typedef MultiFindClass Table;
+  ::flatbuffers::FlatBufferBuilder &fbb_;
+  ::flatbuffers::uoffset_t start_;
+  void add_queries(::flatbuffers::Offset<::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::FindClass>>> queries) {
+    fbb_.AddOffset(MultiFindClass::VT_QUERIES, queries);
+  }
+  void add_priority(dexkit::schema::QueryPriority priority) {
+    fbb_.AddElement<int8_t>(MultiFindClass::VT_PRIORITY, static_cast<int8_t>(priority), 0);
+  }
+  void add_weight(uint32_t weight) {
+    fbb_.AddElement<uint32_t>(MultiFindClass::VT_WEIGHT, weight, 0);
+  }
+  explicit MultiFindClassBuilder(::flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  ::flatbuffers::Offset<MultiFindClass> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = ::flatbuffers::Offset<MultiFindClass>(end);
+    return o;
+  }
+};
+
+inline ::flatbuffers::Offset<MultiFindClass> CreateMultiFindClass(
+    ::flatbuffers::FlatBufferBuilder &_fbb,
+    ::flatbuffers::Offset<::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::FindClass>>> queries = 0,
+    dexkit::schema::QueryPriority priority = dexkit::schema::QueryPriority::Default,
+    uint32_t weight = 0) {
+  MultiFindClassBuilder builder_(_fbb);
+  builder_.add_weight(weight);
+  builder_.add_queries(queries);
+  builder_.add_priority(priority);
+  return builder_.Finish();
+}
+
+struct MultiFindClass::Traits {
+  using type = MultiFindClass;
+  static auto constexpr Create = CreateMultiFindClass;
+};
+
+inline ::flatbuffers::Offset<MultiFindClass> CreateMultiFindClassDirect(
+    ::flatbuffers::FlatBufferBuilder &_fbb,
+    const std::vector<::flatbuffers::Offset<dexkit::schema::FindClass>> *queries = nullptr,
+    dexkit::schema::QueryPriority priority = dexkit::schema::QueryPriority::Default,
+    uint32_t weight = 0) {
+  auto queries__ = queries ? _fbb.CreateVector<::flatbuffers::Offset<dexkit::schema::FindClass>>(*queries) : 0;
+  return dexkit::schema::CreateMultiFindClass(
+      _fbb,
+      queries__,
+      priority,
+      weight);
+}
+
+struct MultiFindMethod FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
+  typedef MultiFindMethodBuilder Builder;
+  struct Traits;
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_QUERIES = 4,
+    VT_PRIORITY = 6,
+    VT_WEIGHT = 8
+  };
+  const ::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::FindMethod>> *queries() const {
+    return GetPointer<const ::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::FindMethod>> *>(VT_QUERIES);
+  }
+  dexkit::schema::QueryPriority priority() const {
+    return static_cast<dexkit::schema::QueryPriority>(GetField<int8_t>(VT_PRIORITY, 0));
+  }
+  uint32_t weight() const {
+    return GetField<uint32_t>(VT_WEIGHT, 0);
+  }
+  bool Verify(::flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyOffset(verifier, VT_QUERIES) &&
+           verifier.VerifyVector(queries()) &&
+           verifier.VerifyVectorOfTables(queries()) &&
+           VerifyField<int8_t>(verifier, VT_PRIORITY, 1) &&
+           VerifyField<uint32_t>(verifier, VT_WEIGHT, 4) &&
+           verifier.EndTable();
+  }
+};
+
+struct MultiFindMethodBuilder {
+  typedef MultiFindMethod Table;
+  ::flatbuffers::FlatBufferBuilder &fbb_;
+  ::flatbuffers::uoffset_t start_;
+  void add_queries(::flatbuffers::Offset<::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::FindMethod>>> queries) {
+    fbb_.AddOffset(MultiFindMethod::VT_QUERIES, queries);
+  }
+  void add_priority(dexkit::schema::QueryPriority priority) {
+    fbb_.AddElement<int8_t>(MultiFindMethod::VT_PRIORITY, static_cast<int8_t>(priority), 0);
+  }
+  void add_weight(uint32_t weight) {
+    fbb_.AddElement<uint32_t>(MultiFindMethod::VT_WEIGHT, weight, 0);
+  }
+  explicit MultiFindMethodBuilder(::flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  ::flatbuffers::Offset<MultiFindMethod> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = ::flatbuffers::Offset<MultiFindMethod>(end);
+    return o;
+  }
+};
+
+inline ::flatbuffers::Offset<MultiFindMethod> CreateMultiFindMethod(
+    ::flatbuffers::FlatBufferBuilder &_fbb,
+    ::flatbuffers::Offset<::flatbuffers::Vector<::flatbuffers::Offset<dexkit::schema::FindMethod>>> queries = 0,
+    dexkit::schema::QueryPriority priority = dexkit::schema::QueryPriority::Default,
+    uint32_t weight = 0) {
+  MultiFindMethodBuilder builder_(_fbb);
+  builder_.add_weight(weight);
+  builder_.add_queries(queries);
+  builder_.add_priority(priority);
+  return builder_.Finish();
+}
+
+struct MultiFindMethod::Traits {
+  using type = MultiFindMethod;
+  static auto constexpr Create = CreateMultiFindMethod;
+};
+
+inline ::flatbuffers::Offset<MultiFindMethod> CreateMultiFindMethodDirect(
+    ::flatbuffers::FlatBufferBuilder &_fbb,
+    const std::vector<::flatbuffers::Offset<dexkit::schema::FindMethod>> *queries = nullptr,
+    dexkit::schema::QueryPriority priority = dexkit::schema::QueryPriority::Default,
+    uint32_t weight = 0) {
+  auto queries__ = queries ? _fbb.CreateVector<::flatbuffers::Offset<dexkit::schema::FindMethod>>(*queries) : 0;
+  return dexkit::schema::CreateMultiFindMethod(
+      _fbb,
+      queries__,
+      priority,
+      weight);
 }
 
 }  // namespace schema
@@ -39,9 +39,14 @@ static void FindNext(const std::vector<uint8_t> &data, const std::vector<std::op
     }
 }
 
-static int FindIndex(const std::vector<uint8_t> &data, const std::vector<std::optional<uint8_t>> &find) {
+// next only depends on find, callers matching one pattern repeatedly build it once
+static std::vector<int> BuildNext(const std::vector<std::optional<uint8_t>> &find) {
     std::vector<int> next(find.size() + 5);
-    FindNext(data, find, next);
+    FindNext({}, find, next);
+    return next;
+}
+
+static int FindIndex(const std::vector<uint8_t> &data, const std::vector<std::optional<uint8_t>> &find, const std::vector<int> &next) {
     int i = 0, j = 0;
     int data_len = (int) data.size();
     int find_len = (int) find.size();
@@ -58,6 +63,10 @@ static int FindIndex(const std::vector<uint8_t> &data, const std::vector<std::op
     return -1;
 }
 
+static int FindIndex(const std::vector<uint8_t> &data, const std::vector<std::optional<uint8_t>> &find) {
+    return FindIndex(data, find, BuildNext(find));
+}
+
 inline char GetIgnoreCaseChar(char c, bool ignore_case = false) {
     if (ignore_case) {
         if (c >= 'A' && c <= 'Z') {
@@ -0,0 +1,166 @@
+// DexKit - An high-performance runtime parsing library for dex
+// implemented in C++.
+// Copyright (C) 2022-2023 LuckyPray
+// https://github.com/LuckyPray/DexKit
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+// <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+
+
+#include "internal/literal_prefilter.h"
+
+#include <algorithm>
+#include <string>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define DEXKIT_LITERAL_PREFILTER_SSSE3
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define DEXKIT_LITERAL_PREFILTER_NEON
+#endif
+
+namespace dexkit {
+
+namespace internal {
+
+namespace {
+
+constexpr size_t kBucketCount = 8;
+// past that nearly every bucket bit is set and the filter stops rejecting anything
+constexpr size_t kMaxLiterals = 64;
+constexpr size_t kBlockSize = 16;
+
+uint8_t ToLower(uint8_t c) {
+    return c >= 'A' && c <= 'Z' ? c + 32 : c;
+}
+
+uint8_t ToUpper(uint8_t c) {
+    return c >= 'a' && c <= 'z' ? c - 32 : c;
+}
+
+} // namespace
+
+MultiLiteralPrefilter::MultiLiteralPrefilter(const std::vector<std::string_view> &literals) {
+    if (literals.empty() || literals.size() > kMaxLiterals) {
+        return;
+    }
+    size_t fingerprint_len = kMaxFingerprint;
+    for (auto literal: literals) {
+        fingerprint_len = std::min(fingerprint_len, literal.size());
+    }
+    if (fingerprint_len == 0) {
+        return;
+    }
+
+    std::vector<std::string> fingerprints;
+    fingerprints.reserve(literals.size());
+    for (auto literal: literals) {
+        std::string fingerprint(literal.substr(0, fingerprint_len));
+        for (auto &c: fingerprint) {
+            c = static_cast<char>(ToLower(static_cast<uint8_t>(c)));
+        }
+        fingerprints.emplace_back(std::move(fingerprint));
+    }
+    // neighbouring fingerprints share a bucket, so a bucket's bits mostly stand for one prefix
+    std::sort(fingerprints.begin(), fingerprints.end());
+    fingerprints.erase(std::unique(fingerprints.begin(), fingerprints.end()), fingerprints.end());
+    for (size_t i = 0; i < fingerprints.size(); ++i) {
+        auto bucket_bit = static_cast<uint8_t>(1u << (i * kBucketCount / fingerprints.size()));
+        for (size_t k = 0; k < fingerprint_len; ++k) {
+            auto lower = static_cast<uint8_t>(fingerprints[i][k]);
+            for (auto c: {lower, ToUpper(lower)}) {
+                low_nibbles_[k][c & 0xf] |= bucket_bit;
+                high_nibbles_[k][c >> 4] |= bucket_bit;
+                bytes_[k][c] |= bucket_bit;
+            }
+        }
+    }
+    fingerprint_len_ = static_cast<uint32_t>(fingerprint_len);
+}
+
+bool MultiLiteralPrefilter::MayContainAt(const uint8_t *p) const {
+    uint8_t buckets = bytes_[0][p[0]];
+    for (size_t k = 1; buckets != 0 && k < fingerprint_len_; ++k) {
+        buckets &= bytes_[k][p[k]];
+    }
+    return buckets != 0;
+}
+
+bool MultiLiteralPrefilter::MayContain(std::string_view str) const {
+    if (fingerprint_len_ == 0) {
+        return true;
+    }
+    if (str.size() < fingerprint_len_) {
+        return false;
+    }
+    auto data = reinterpret_cast<const uint8_t *>(str.data());
+    // candidate start positions are [0, end)
+    auto end = str.size() - fingerprint_len_ + 1;
+    size_t pos = 0;
+#if defined(DEXKIT_LITERAL_PREFILTER_SSSE3)
+    if (end >= kBlockSize) {
+        const auto nibble_mask = _mm_set1_epi8(0x0f);
+        __m128i low_tables[kMaxFingerprint], high_tables[kMaxFingerprint];
+        for (size_t k = 0; k < fingerprint_len_; ++k) {
+            low_tables[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(low_nibbles_[k].data()));
+            high_tables[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(high_nibbles_[k].data()));
+        }
+        for (; pos + kBlockSize <= end; pos += kBlockSize) {
+            auto buckets = _mm_set1_epi8(-1);
+            for (size_t k = 0; k < fingerprint_len_; ++k) {
+                auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos + k));
+                auto low = _mm_shuffle_epi8(low_tables[k], _mm_and_si128(block, nibble_mask));
+                auto high = _mm_shuffle_epi8(high_tables[k], _mm_and_si128(_mm_srli_epi16(block, 4), nibble_mask));
+                buckets = _mm_and_si128(buckets, _mm_and_si128(low, high));
+            }
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(buckets, _mm_setzero_si128())) != 0xffff) {
+                return true;
+            }
+        }
+    }
+#elif defined(DEXKIT_LITERAL_PREFILTER_NEON)
+    if (end >= kBlockSize) {
+        const auto nibble_mask = vdupq_n_u8(0x0f);
+        uint8x16_t low_tables[kMaxFingerprint], high_tables[kMaxFingerprint];
+        for (size_t k = 0; k < fingerprint_len_; ++k) {
+            low_tables[k] = vld1q_u8(low_nibbles_[k].data());
+            high_tables[k] = vld1q_u8(high_nibbles_[k].data());
+        }
+        for (; pos + kBlockSize <= end; pos += kBlockSize) {
+            auto buckets = vdupq_n_u8(0xff);
+            for (size_t k = 0; k < fingerprint_len_; ++k) {
+                auto block = vld1q_u8(data + pos + k);
+                auto low = vqtbl1q_u8(low_tables[k], vandq_u8(block, nibble_mask));
+                auto high = vqtbl1q_u8(high_tables[k], vshrq_n_u8(block, 4));
+                buckets = vandq_u8(buckets, vandq_u8(low, high));
+            }
+            if (vmaxvq_u8(buckets) != 0) {
+                return true;
+            }
+        }
+    }
+#endif
+    for (; pos < end; ++pos) {
+        if (MayContainAt(data + pos)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace internal
+
+} // namespace dexkit
@@ -0,0 +1,187 @@
+// DexKit - An high-performance runtime parsing library for dex
+// implemented in C++.
+// Copyright (C) 2022-2023 LuckyPray
+// https://github.com/LuckyPray/DexKit
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+// <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+
+
+#include "internal/number_postings.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace dexkit {
+
+namespace internal {
+
+namespace {
+
+// every double at or beyond 2^52 is an integer, two of them closer than EPS are equal
+constexpr double kHugeDouble = 0x1p52;
+constexpr int64_t kHugeBucket = INT64_MAX;
+// scaling by a power of two is exact, buckets are 1/1024 wide
+constexpr double kBucketScale = 1024.0;
+
+} // namespace
+
+std::optional<int64_t> GetDoubleBucket(double value) {
+    if (std::isnan(value)) {
+        return std::nullopt;
+    }
+    if (std::abs(value) >= kHugeDouble) {
+        return kHugeBucket;
+    }
+    return (int64_t) std::floor(value * kBucketScale);
+}
+
+std::span<const uint32_t> NumberPostings::Table::Find(int64_t key) const {
+    auto it = std::lower_bound(keys.begin(), keys.end(), key);
+    if (it == keys.end() || *it != key) {
+        return {};
+    }
+    auto pos = it - keys.begin();
+    return {ids.data() + offsets[pos], offsets[pos + 1] - offsets[pos]};
+}
+
+void NumberPostings::Collect(EncodeNumber number, std::vector<std::span<const uint32_t>> &lists) const {
+    auto push = [&lists](std::span<const uint32_t> ids) {
+        if (!ids.empty()) lists.emplace_back(ids);
+    };
+    if (number.type < FLOAT) {
+        push(long_table_.Find(GetLongValue(number)));
+        return;
+    }
+    auto bucket = GetDoubleBucket(GetDoubleValue(number));
+    if (!bucket) {
+        return;
+    }
+    if (*bucket == kHugeBucket) {
+        push(double_table_.Find(kHugeBucket));
+        return;
+    }
+    for (auto key = *bucket - 1; key <= *bucket + 1; ++key) {
+        push(double_table_.Find(key));
+    }
+}
+
+void NumberPostingsBuilder::Add(uint32_t method_idx, const std::vector<EncodeNumber> &numbers) {
+    auto add_unique = [this, method_idx](std::vector<std::pair<int64_t, uint32_t>> &entries) {
+        std::sort(keys_.begin(), keys_.end());
+        keys_.erase(std::unique(keys_.begin(), keys_.end()), keys_.end());
+        for (auto key: keys_) {
+            entries.emplace_back(key, method_idx);
+        }
+        keys_.clear();
+    };
+    for (auto &number: numbers) {
+        keys_.emplace_back(GetLongValue(number));
+    }
+    add_unique(long_entries_);
+    // GetDoubleValue of a byte/short is NaN, it never matches a floating matcher
+    for (auto &number: numbers) {
+        if (number.type < INT) continue;
+        if (auto bucket = GetDoubleBucket(GetDoubleValue(number))) {
+            keys_.emplace_back(*bucket);
+        }
+    }
+    add_unique(double_entries_);
+}
+
+NumberPostings NumberPostingsBuilder::Build() {
+    NumberPostings postings;
+    BuildTable(long_entries_, postings.long_table_);
+    BuildTable(double_entries_, postings.double_table_);
+    return postings;
+}
+
+void NumberPostingsBuilder::BuildTable(std::vector<std::pair<int64_t, uint32_t>> &entries, NumberPostings::Table &table) {
+    std::sort(entries.begin(), entries.end());
+    table.ids.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (table.keys.empty() || table.keys.back() != entries[i].first) {
+            table.keys.emplace_back(entries[i].first);
+            table.offsets.emplace_back(i);
+        }
+        table.ids[i] = entries[i].second;
+    }
+    table.offsets.emplace_back(entries.size());
+    entries.clear();
+    entries.shrink_to_fit();
+}
+
+std::vector<EncodeNumber> GetMatcherNumbers(const schema::MethodMatcher *matcher) {
+    std::vector<EncodeNumber> numbers;
+    auto values = matcher->using_numbers();
+    if (values == nullptr) {
+        return numbers;
+    }
+    auto types = matcher->using_numbers_type();
+    for (int i = 0; i < values->size(); ++i) {
+        EncodeNumber number{};
+        switch (types->Get(i)) {
+            case schema::Number::EncodeValueByte: {
+                number = EncodeNumber{
+                        .type = BYTE,
+                        .value = {.L8 = values->GetAs<schema::EncodeValueByte>(i)->value()}
+                };
+                break;
+            }
+            case schema::Number::EncodeValueShort: {
+                number = EncodeNumber{
+                        .type = SHORT,
+                        .value = {.L16 = values->GetAs<schema::EncodeValueShort>(i)->value()}
+                };
+                break;
+            }
+            case schema::Number::EncodeValueInt: {
+                number = EncodeNumber{
+                        .type = INT,
+                        .value = {.L32 = {.int_value = values->GetAs<schema::EncodeValueInt>(i)->value()}}
+                };
+                break;
+            }
+            case schema::Number::EncodeValueLong: {
+                number = EncodeNumber{
+                        .type = LONG,
+                        .value = {.L64 = {.long_value = values->GetAs<schema::EncodeValueLong>(i)->value()}}
+                };
+                break;
+            }
+            case schema::Number::EncodeValueFloat: {
+                number = EncodeNumber{
+                        .type = FLOAT,
+                        .value = {.L32 = {.float_value = values->GetAs<schema::EncodeValueFloat>(i)->value()}}
+                };
+                break;
+            }
+            case schema::Number::EncodeValueDouble: {
+                number = EncodeNumber{
+                        .type = DOUBLE,
+                        .value = {.L64 = {.double_value = values->GetAs<schema::EncodeValueDouble>(i)->value()}}
+                };
+                break;
+            }
+            default: abort();
+        }
+        numbers.push_back(number);
+    }
+    return numbers;
+}
+
+} // namespace internal
+
+} // namespace dexkit
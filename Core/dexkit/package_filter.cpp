@@ -0,0 +1,175 @@
+// DexKit - An high-performance runtime parsing library for dex
+// implemented in C++.
+// Copyright (C) 2022-2023 LuckyPray
+// https://github.com/LuckyPray/DexKit
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+// <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+
+
+#include "internal/package_filter.h"
+#include "package_trie.h"
+
+#include <algorithm>
+
+namespace dexkit {
+
+namespace internal {
+
+namespace {
+
+std::string NormalizePackage(std::string_view package, bool ignore_case) {
+    std::string package_str(package);
+    std::replace(package_str.begin(), package_str.end(), '.', '/');
+    if (package_str.empty() || package_str[0] != 'L') {
+        package_str = "L" + package_str; // NOLINT
+    }
+    if (package_str.back() != '/') {
+        package_str += '/';
+    }
+    if (ignore_case) {
+        for (auto &c: package_str) {
+            c = c >= 'A' && c <= 'Z' ? (char) (c + 32) : c;
+        }
+    }
+    return package_str;
+}
+
+void MarkPackageRange(std::vector<uint64_t> &words, const std::vector<std::string_view> &type_names, std::string_view package) {
+    auto it = std::lower_bound(type_names.begin(), type_names.end(), package);
+    for (; it != type_names.end() && it->starts_with(package); ++it) {
+        auto type_idx = static_cast<size_t>(it - type_names.begin());
+        words[type_idx / 64] |= 1ULL << (type_idx % 64);
+    }
+}
+
+bool StartsWithPackage(std::string_view type_name, std::string_view package, bool ignore_case) {
+    if (type_name.size() < package.size()) {
+        return false;
+    }
+    if (!ignore_case) {
+        return type_name.starts_with(package);
+    }
+    for (size_t i = 0; i < package.size(); ++i) {
+        auto c = type_name[i];
+        c = c >= 'A' && c <= 'Z' ? (char) (c + 32) : c;
+        if (c != package[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool IsTypeInPackageFilter(const PackageFilter &filter, std::string_view type_name) {
+    for (auto &package: filter.exclude_packages) {
+        if (StartsWithPackage(type_name, package, filter.ignore_case)) {
+            return false;
+        }
+    }
+    if (!filter.has_search_packages) {
+        return true;
+    }
+    for (auto &package: filter.search_packages) {
+        if (StartsWithPackage(type_name, package, filter.ignore_case)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+PackageFilter BuildPackageFilter(
+        const flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>> *search_packages,
+        const flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>> *exclude_packages,
+        bool ignore_case
+) {
+    PackageFilter filter;
+    filter.has_search_packages = search_packages != nullptr;
+    filter.has_exclude_packages = exclude_packages != nullptr;
+    filter.ignore_case = ignore_case;
+    if (search_packages) {
+        for (auto i = 0; i < search_packages->size(); ++i) {
+            filter.search_packages.emplace_back(NormalizePackage(search_packages->Get(i)->string_view(), ignore_case));
+        }
+        std::sort(filter.search_packages.begin(), filter.search_packages.end());
+    }
+    if (exclude_packages) {
+        for (auto i = 0; i < exclude_packages->size(); ++i) {
+            filter.exclude_packages.emplace_back(NormalizePackage(exclude_packages->Get(i)->string_view(), ignore_case));
+        }
+        std::sort(filter.exclude_packages.begin(), filter.exclude_packages.end());
+    }
+    // descriptors never contain ';' or '\n', so they are safe separators
+    filter.cache_key.push_back(filter.ignore_case ? 'i' : 'c');
+    filter.cache_key.push_back(filter.has_search_packages ? 's' : '-');
+    for (auto &package: filter.search_packages) {
+        filter.cache_key.append(package).push_back(';');
+    }
+    filter.cache_key.push_back('\n');
+    filter.cache_key.push_back(filter.has_exclude_packages ? 'e' : '-');
+    for (auto &package: filter.exclude_packages) {
+        filter.cache_key.append(package).push_back(';');
+    }
+    return filter;
+}
+
+PackageTypeMask BuildPackageTypeMask(
+        const PackageFilter &filter,
+        const std::vector<std::string_view> &type_names,
+        bool type_names_sorted
+) {
+    auto word_count = (type_names.size() + 63) / 64;
+    std::vector<uint64_t> search_words(word_count, filter.has_search_packages ? 0 : ~0ULL);
+    std::vector<uint64_t> exclude_words(word_count, 0);
+    if (type_names_sorted && !filter.ignore_case) {
+        for (auto &package: filter.search_packages) {
+            MarkPackageRange(search_words, type_names, package);
+        }
+        for (auto &package: filter.exclude_packages) {
+            MarkPackageRange(exclude_words, type_names, package);
+        }
+    } else {
+        trie::PackageTrie trie;
+        for (auto &package: filter.search_packages) {
+            trie.insert(package, true, filter.ignore_case);
+        }
+        for (auto &package: filter.exclude_packages) {
+            trie.insert(package, false, filter.ignore_case);
+        }
+        for (size_t type_idx = 0; type_idx < type_names.size(); ++type_idx) {
+            auto hit = trie.search(type_names[type_idx], filter.ignore_case);
+            if (hit >> 1) {
+                search_words[type_idx / 64] |= 1ULL << (type_idx % 64);
+            }
+            if (hit & 1) {
+                exclude_words[type_idx / 64] |= 1ULL << (type_idx % 64);
+            }
+        }
+    }
+    PackageTypeMask mask;
+    mask.words.resize(word_count);
+    for (size_t i = 0; i < word_count; ++i) {
+        mask.words[i] = search_words[i] & ~exclude_words[i];
+    }
+    if (type_names.size() % 64 != 0) {
+        mask.words.back() &= (1ULL << (type_names.size() % 64)) - 1;
+    }
+    return mask;
+}
+
+} // namespace internal
+
+} // namespace dexkit
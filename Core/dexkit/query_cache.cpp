@@ -0,0 +1,734 @@
+// DexKit - An high-performance runtime parsing library for dex
+// implemented in C++.
+// Copyright (C) 2022-2023 LuckyPray
+// https://github.com/LuckyPray/DexKit
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+// <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+
+
+#include "internal/query_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace dexkit {
+
+namespace internal {
+
+namespace {
+
+enum class QueryKeyKind : uint8_t {
+    FindClass = 1,
+    FindMethod,
+    FindField,
+};
+
+template<typename T>
+void PutScalar(std::string &out, T value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void PutBytes(std::string &out, std::string_view bytes) {
+    PutScalar<uint32_t>(out, static_cast<uint32_t>(bytes.size()));
+    out.append(bytes);
+}
+
+// absent tables and vectors are kept apart from empty ones, the matchers do not always treat
+// them the same
+bool PutPresence(std::string &out, const void *ptr) {
+    PutScalar<uint8_t>(out, ptr != nullptr);
+    return ptr != nullptr;
+}
+
+void PutString(std::string &out, const flatbuffers::String *str) {
+    if (PutPresence(out, str)) {
+        PutBytes(out, str->string_view());
+    }
+}
+
+template<typename T, typename Encode>
+void PutOrderedList(std::string &out, const flatbuffers::Vector<T> *vec, Encode &&encode) {
+    if (!PutPresence(out, vec)) {
+        return;
+    }
+    PutScalar<uint32_t>(out, vec->size());
+    for (flatbuffers::uoffset_t i = 0; i < vec->size(); ++i) {
+        encode(out, i);
+    }
+}
+
+template<typename T, typename Encode>
+void PutUnorderedList(std::string &out, const flatbuffers::Vector<T> *vec, Encode &&encode) {
+    if (!PutPresence(out, vec)) {
+        return;
+    }
+    std::vector<std::string> items(vec->size());
+    for (flatbuffers::uoffset_t i = 0; i < vec->size(); ++i) {
+        encode(items[i], i);
+    }
+    std::sort(items.begin(), items.end());
+    PutScalar<uint32_t>(out, vec->size());
+    for (auto &item: items) {
+        PutBytes(out, item);
+    }
+}
+
+template<typename T>
+void PutIdList(std::string &out, const flatbuffers::Vector<T> *vec) {
+    if (!PutPresence(out, vec)) {
+        return;
+    }
+    std::vector<T> ids(vec->begin(), vec->end());
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    PutScalar<uint32_t>(out, static_cast<uint32_t>(ids.size()));
+    for (auto id: ids) {
+        PutScalar(out, id);
+    }
+}
+
+void PutStringList(std::string &out, const flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>> *vec) {
+    PutUnorderedList(out, vec, [vec](std::string &item, flatbuffers::uoffset_t i) {
+        PutString(item, vec->Get(i));
+    });
+}
+
+// same rewrite as ConvertSimilarRegex
+void PutStringMatcher(std::string &out, const schema::StringMatcher *matcher) {
+    if (!PutPresence(out, matcher)) {
+        return;
+    }
+    auto match_type = matcher->match_type();
+    PutScalar<uint8_t>(out, matcher->ignore_case());
+    if (!PutPresence(out, matcher->value())) {
+        PutScalar(out, match_type);
+        return;
+    }
+    auto value = matcher->value()->string_view();
+    if (match_type == schema::StringMatchType::SimilarRegex) {
+        match_type = schema::StringMatchType::Contains;
+        size_t left = 0, right = value.size();
+        if (value.starts_with('^')) {
+            left = 1;
+            match_type = schema::StringMatchType::StartWith;
+        }
+        if (value.size() > left && value.ends_with('$')) {
+            right = value.size() - 1;
+            match_type = match_type == schema::StringMatchType::StartWith
+                         ? schema::StringMatchType::Equal
+                         : schema::StringMatchType::EndWith;
+        }
+        value = value.substr(left, right - left);
+    }
+    PutScalar(out, match_type);
+    PutBytes(out, value);
+}
+
+void PutStringMatcherList(std::string &out, const flatbuffers::Vector<flatbuffers::Offset<schema::StringMatcher>> *vec) {
+    PutUnorderedList(out, vec, [vec](std::string &item, flatbuffers::uoffset_t i) {
+        PutStringMatcher(item, vec->Get(i));
+    });
+}
+
+void PutIntRange(std::string &out, const schema::IntRange *range) {
+    if (PutPresence(out, range)) {
+        PutScalar(out, range->min());
+        PutScalar(out, range->max());
+    }
+}
+
+void PutAccessFlagsMatcher(std::string &out, const schema::AccessFlagsMatcher *matcher) {
+    if (PutPresence(out, matcher)) {
+        PutScalar(out, matcher->flags());
+        PutScalar(out, matcher->match_type());
+    }
+}
+
+void PutTargetElementTypesMatcher(std::string &out, const schema::TargetElementTypesMatcher *matcher) {
+    if (!PutPresence(out, matcher)) {
+        return;
+    }
+    PutUnorderedList(out, matcher->types(), [types = matcher->types()](std::string &item, flatbuffers::uoffset_t i) {
+        PutScalar(item, types->Get(i));
+    });
+    PutScalar(out, matcher->match_type());
+}
+
+void PutClassMatcher(std::string &out, const schema::ClassMatcher *matcher);
+
+void PutMethodMatcher(std::string &out, const schema::MethodMatcher *matcher);
+
+void PutFieldMatcher(std::string &out, const schema::FieldMatcher *matcher);
+
+void PutAnnotationMatcher(std::string &out, const schema::AnnotationMatcher *matcher);
+
+void PutAnnotationEncodeArrayMatcher(std::string &out, const schema::AnnotationEncodeArrayMatcher *matcher);
+
+template<typename Matcher, typename Encode>
+void PutMatcherList(std::string &out, const flatbuffers::Vector<flatbuffers::Offset<Matcher>> *vec, Encode encode) {
+    PutUnorderedList(out, vec, [vec, encode](std::string &item, flatbuffers::uoffset_t i) {
+        encode(item, vec->Get(i));
+    });
+}
+
+void PutAnnotationEncodeValueMatcher(std::string &out, schema::AnnotationEncodeValueMatcher type, const void *value) {
+    PutScalar(out, type);
+    if (!PutPresence(out, value)) {
+        return;
+    }
+    switch (type) {
+        case schema::AnnotationEncodeValueMatcher::NONE:
+            break;
+        case schema::AnnotationEncodeValueMatcher::EncodeValueByte:
+            PutScalar(out, static_cast<const schema::EncodeValueByte *>(value)->value());
+            break;
+        case schema::AnnotationEncodeValueMatcher::EncodeValueShort:
+            PutScalar(out, static_cast<const schema::EncodeValueShort *>(value)->value());
+            break;
+        case schema::AnnotationEncodeValueMatcher::EncodeValueChar:
+            PutScalar(out, static_cast<const schema::EncodeValueChar *>(value)->value());
+            break;
+        case schema::AnnotationEncodeValueMatcher::EncodeValueInt:
+            PutScalar(out, static_cast<const schema::EncodeValueInt *>(value)->value());
+            break;
+        case schema::AnnotationEncodeValueMatcher::EncodeValueLong:
+            PutScalar(out, static_cast<const schema::EncodeValueLong *>(value)->value());
+            break;
+        case schema::AnnotationEncodeValueMatcher::EncodeValueFloat:
+            PutScalar(out, static_cast<const schema::EncodeValueFloat *>(value)->value());
+            break;
+        case schema::AnnotationEncodeValueMatcher::EncodeValueDouble:
+            PutScalar(out, static_cast<const schema::EncodeValueDouble *>(value)->value());
+            break;
+        case schema::AnnotationEncodeValueMatcher::StringMatcher:
+            PutStringMatcher(out, static_cast<const schema::StringMatcher *>(value));
+            break;
+        case schema::AnnotationEncodeValueMatcher::ClassMatcher:
+            PutClassMatcher(out, static_cast<const schema::ClassMatcher *>(value));
+            break;
+        case schema::AnnotationEncodeValueMatcher::MethodMatcher:
+            PutMethodMatcher(out, static_cast<const schema::MethodMatcher *>(value));
+            break;
+        case schema::AnnotationEncodeValueMatcher::FieldMatcher:
+            PutFieldMatcher(out, static_cast<const schema::FieldMatcher *>(value));
+            break;
+        case schema::AnnotationEncodeValueMatcher::AnnotationEncodeArrayMatcher:
+            PutAnnotationEncodeArrayMatcher(out, static_cast<const schema::AnnotationEncodeArrayMatcher *>(value));
+            break;
+        case schema::AnnotationEncodeValueMatcher::AnnotationMatcher:
+            PutAnnotationMatcher(out, static_cast<const schema::AnnotationMatcher *>(value));
+            break;
+        case schema::AnnotationEncodeValueMatcher::EncodeValueNull:
+            PutScalar(out, static_cast<const schema::EncodeValueNull *>(value)->value());
+            break;
+        case schema::AnnotationEncodeValueMatcher::EncodeValueBoolean:
+            PutScalar<uint8_t>(out, static_cast<const schema::EncodeValueBoolean *>(value)->value());
+            break;
+    }
+}
+
+void PutAnnotationEncodeArrayMatcher(std::string &out, const schema::AnnotationEncodeArrayMatcher *matcher) {
+    if (!PutPresence(out, matcher)) {
+        return;
+    }
+    auto types = matcher->values_type();
+    auto values = matcher->values();
+    PutPresence(out, types);
+    PutUnorderedList(out, values, [types, values](std::string &item, flatbuffers::uoffset_t i) {
+        auto type = types && i < types->size() ? types->Get(i) : schema::AnnotationEncodeValueMatcher::NONE;
+        PutAnnotationEncodeValueMatcher(item, type, values->Get(i));
+    });
+    PutScalar(out, matcher->match_type());
+    PutIntRange(out, matcher->value_count());
+}
+
+void PutAnnotationElementMatcher(std::string &out, const schema::AnnotationElementMatcher *matcher) {
+    if (PutPresence(out, matcher)) {
+        PutStringMatcher(out, matcher->name());
+        PutAnnotationEncodeValueMatcher(out, matcher->value_type(), matcher->value());
+    }
+}
+
+void PutAnnotationElementsMatcher(std::string &out, const schema::AnnotationElementsMatcher *matcher) {
+    if (PutPresence(out, matcher)) {
+        PutMatcherList(out, matcher->elements(), PutAnnotationElementMatcher);
+        PutScalar(out, matcher->match_type());
+        PutIntRange(out, matcher->element_count());
+    }
+}
+
+void PutAnnotationMatcher(std::string &out, const schema::AnnotationMatcher *matcher) {
+    if (PutPresence(out, matcher)) {
+        PutClassMatcher(out, matcher->type());
+        PutTargetElementTypesMatcher(out, matcher->target_element_types());
+        PutScalar(out, matcher->policy());
+        PutAnnotationElementsMatcher(out, matcher->elements());
+        PutStringMatcherList(out, matcher->using_strings());
+    }
+}
+
+void PutAnnotationsMatcher(std::string &out, const schema::AnnotationsMatcher *matcher) {
+    if (PutPresence(out, matcher)) {
+        PutMatcherList(out, matcher->annotations(), PutAnnotationMatcher);
+        PutScalar(out, matcher->match_type());
+        PutIntRange(out, matcher->annotation_count());
+    }
+}
+
+void PutParameterMatcher(std::string &out, const schema::ParameterMatcher *matcher) {
+    if (PutPresence(out, matcher)) {
+        PutAnnotationsMatcher(out, matcher->annotations());
+        PutClassMatcher(out, matcher->parameter_type());
+    }
+}
+
+// parameters are positional
+void PutParametersMatcher(std::string &out, const schema::ParametersMatcher *matcher) {
+    if (!PutPresence(out, matcher)) {
+        return;
+    }
+    PutOrderedList(out, matcher->parameters(), [parameters = matcher->parameters()](std::string &item, flatbuffers::uoffset_t i) {
+        PutParameterMatcher(item, parameters->Get(i));
+    });
+    PutIntRange(out, matcher->parameter_count());
+}
+
+void PutOpCodesMatcher(std::string &out, const schema::OpCodesMatcher *matcher) {
+    if (!PutPresence(out, matcher)) {
+        return;
+    }
+    PutOrderedList(out, matcher->op_codes(), [op_codes = matcher->op_codes()](std::string &item, flatbuffers::uoffset_t i) {
+        PutScalar(item, op_codes->Get(i));
+    });
+    PutScalar(out, matcher->match_type());
+    PutIntRange(out, matcher->op_code_count());
+}
+
+void PutUsingFieldMatcher(std::string &out, const schema::UsingFieldMatcher *matcher) {
+    if (PutPresence(out, matcher)) {
+        PutFieldMatcher(out, matcher->field());
+        PutScalar(out, matcher->using_type());
+    }
+}
+
+void PutNumber(std::string &out, schema::Number type, const void *value) {
+    PutScalar(out, type);
+    if (!PutPresence(out, value)) {
+        return;
+    }
+    switch (type) {
+        case schema::Number::NONE:
+            break;
+        case schema::Number::EncodeValueByte:
+            PutScalar(out, static_cast<const schema::EncodeValueByte *>(value)->value());
+            break;
+        case schema::Number::EncodeValueShort:
+            PutScalar(out, static_cast<const schema::EncodeValueShort *>(value)->value());
+            break;
+        case schema::Number::EncodeValueInt:
+            PutScalar(out, static_cast<const schema::EncodeValueInt *>(value)->value());
+            break;
+        case schema::Number::EncodeValueLong:
+            PutScalar(out, static_cast<const schema::EncodeValueLong *>(value)->value());
+            break;
+        case schema::Number::EncodeValueFloat:
+            PutScalar(out, static_cast<const schema::EncodeValueFloat *>(value)->value());
+            break;
+        case schema::Number::EncodeValueDouble:
+            PutScalar(out, static_cast<const schema::EncodeValueDouble *>(value)->value());
+            break;
+    }
+}
+
+void PutMethodsMatcher(std::string &out, const schema::MethodsMatcher *matcher) {
+    if (PutPresence(out, matcher)) {
+        PutMatcherList(out, matcher->methods(), PutMethodMatcher);
+        PutScalar(out, matcher->match_type());
+        PutIntRange(out, matcher->method_count());
+    }
+}
+
+void PutFieldsMatcher(std::string &out, const schema::FieldsMatcher *matcher) {
+    if (PutPresence(out, matcher)) {
+        PutMatcherList(out, matcher->fields(), PutFieldMatcher);
+        PutScalar(out, matcher->match_type());
+        PutIntRange(out, matcher->field_count());
+    }
+}
+
+void PutInterfacesMatcher(std::string &out, const schema::InterfacesMatcher *matcher) {
+    if (PutPresence(out, matcher)) {
+        PutMatcherList(out, matcher->interfaces(), PutClassMatcher);
+        PutScalar(out, matcher->match_type());
+        PutIntRange(out, matcher->interface_count());
+    }
+}
+
+void PutMethodMatcher(std::string &out, const schema::MethodMatcher *matcher) {
+    if (!PutPresence(out, matcher)) {
+        return;
+    }
+    PutStringMatcher(out, matcher->method_name());
+    PutAccessFlagsMatcher(out, matcher->access_flags());
+    PutClassMatcher(out, matcher->declaring_class());
+    PutClassMatcher(out, matcher->return_type());
+    PutParametersMatcher(out, matcher->parameters());
+    PutAnnotationsMatcher(out, matcher->annotations());
+    PutOpCodesMatcher(out, matcher->op_codes());
+    PutStringMatcherList(out, matcher->using_strings());
+    PutMatcherList(out, matcher->using_fields(), PutUsingFieldMatcher);
+    auto number_types = matcher->using_numbers_type();
+    auto numbers = matcher->using_numbers();
+    PutPresence(out, number_types);
+    PutUnorderedList(out, numbers, [number_types, numbers](std::string &item, flatbuffers::uoffset_t i) {
+        auto type = number_types && i < number_types->size() ? number_types->Get(i) : schema::Number::NONE;
+        PutNumber(item, type, numbers->Get(i));
+    });
+    PutMethodsMatcher(out, matcher->invoking_methods());
+    PutMethodsMatcher(out, matcher->method_callers());
+    PutString(out, matcher->proto_shorty());
+    PutMatcherList(out, matcher->all_of(), PutMethodMatcher);
+    PutMatcherList(out, matcher->any_of(), PutMethodMatcher);
+    PutMatcherList(out, matcher->none_of(), PutMethodMatcher);
+}
+
+void PutFieldMatcher(std::string &out, const schema::FieldMatcher *matcher) {
+    if (!PutPresence(out, matcher)) {
+        return;
+    }
+    PutStringMatcher(out, matcher->field_name());
+    PutAccessFlagsMatcher(out, matcher->access_flags());
+    PutClassMatcher(out, matcher->declaring_class());
+    PutClassMatcher(out, matcher->type_class());
+    PutAnnotationsMatcher(out, matcher->annotations());
+    PutMethodsMatcher(out, matcher->get_methods());
+    PutMethodsMatcher(out, matcher->put_methods());
+    PutMatcherList(out, matcher->all_of(), PutFieldMatcher);
+    PutMatcherList(out, matcher->any_of(), PutFieldMatcher);
+    PutMatcherList(out, matcher->none_of(), PutFieldMatcher);
+}
+
+void PutClassMatcher(std::string &out, const schema::ClassMatcher *matcher) {
+    if (!PutPresence(out, matcher)) {
+        return;
+    }
+    PutStringMatcher(out, matcher->smali_source());
+    PutStringMatcher(out, matcher->class_name());
+    PutAccessFlagsMatcher(out, matcher->access_flags());
+    PutClassMatcher(out, matcher->super_class());
+    PutInterfacesMatcher(out, matcher->interfaces());
+    PutAnnotationsMatcher(out, matcher->annotations());
+    PutFieldsMatcher(out, matcher->fields());
+    PutMethodsMatcher(out, matcher->methods());
+    PutStringMatcherList(out, matcher->using_strings());
+    PutMatcherList(out, matcher->all_of(), PutClassMatcher);
+    PutMatcherList(out, matcher->any_of(), PutClassMatcher);
+    PutMatcherList(out, matcher->none_of(), PutClassMatcher);
+}
+
+template<typename Query>
+std::string CanonicalizeQueryHeader(QueryKeyKind kind, const Query *query) {
+    std::string out;
+    PutScalar(out, kind);
+    PutStringList(out, query->search_packages());
+    PutStringList(out, query->exclude_packages());
+    PutScalar<uint8_t>(out, query->ignore_packages_case());
+    PutIdList(out, query->in_classes());
+    PutScalar<uint8_t>(out, query->find_first());
+    return out;
+}
+
+// the id count bounding the results of a kind, nullptr for unknown kinds
+uint32_t CachedDexBounds::*GetIdBound(QueryKeyKind kind) {
+    switch (kind) {
+        case QueryKeyKind::FindClass: return &CachedDexBounds::type_id_count;
+        case QueryKeyKind::FindMethod: return &CachedDexBounds::method_id_count;
+        case QueryKeyKind::FindField: return &CachedDexBounds::field_id_count;
+    }
+    return nullptr;
+}
+
+// every entry also pays for its list node and index slot
+constexpr size_t kEntryOverheadBytes = 96;
+
+size_t EntryBytes(const std::string &key, const std::vector<CachedDexHits> &hits) {
+    auto bytes = kEntryOverheadBytes + key.size();
+    for (auto &dex_hits: hits) {
+        bytes += sizeof(CachedDexHits) + dex_hits.ids.size() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+constexpr char kCacheFileMagic[4] = {'D', 'K', 'Q', 'C'};
+constexpr uint32_t kCacheFileVersion = 1;
+
+class CacheFileWriter {
+public:
+    explicit CacheFileWriter(FILE *fp) : fp_(fp) {}
+
+    template<typename T>
+    void Scalar(T value) {
+        Bytes(&value, sizeof(T));
+    }
+
+    void Bytes(const void *data, size_t size) {
+        if (ok_ && size != 0 && fwrite(data, 1, size, fp_) != size) {
+            ok_ = false;
+        }
+    }
+
+    void String(std::string_view str) {
+        Scalar<uint32_t>(static_cast<uint32_t>(str.size()));
+        Bytes(str.data(), str.size());
+    }
+
+    [[nodiscard]] bool ok() const {
+        return ok_;
+    }
+
+private:
+    FILE *fp_;
+    bool ok_ = true;
+};
+
+class CacheFileReader {
+public:
+    CacheFileReader(FILE *fp, size_t size) : fp_(fp), remaining_(size) {}
+
+    template<typename T>
+    T Scalar() {
+        T value{};
+        Bytes(&value, sizeof(T));
+        return value;
+    }
+
+    void Bytes(void *data, size_t size) {
+        if (ok_ && size > remaining_) {
+            ok_ = false;
+        }
+        if (ok_ && size != 0 && fread(data, 1, size, fp_) != size) {
+            ok_ = false;
+        }
+        remaining_ -= ok_ ? size : 0;
+    }
+
+    std::string String() {
+        auto size = Scalar<uint32_t>();
+        std::string str;
+        if (ok_ && size <= remaining_) {
+            str.resize(size);
+            Bytes(str.data(), size);
+        } else {
+            ok_ = false;
+        }
+        return str;
+    }
+
+    [[nodiscard]] size_t remaining() const {
+        return remaining_;
+    }
+
+    [[nodiscard]] bool ok() const {
+        return ok_;
+    }
+
+private:
+    FILE *fp_;
+    size_t remaining_;
+    bool ok_ = true;
+};
+
+} // namespace
+
+std::string CanonicalizeQuery(const schema::FindClass *query) {
+    auto out = CanonicalizeQueryHeader(QueryKeyKind::FindClass, query);
+    PutClassMatcher(out, query->matcher());
+    return out;
+}
+
+std::string CanonicalizeQuery(const schema::FindMethod *query) {
+    auto out = CanonicalizeQueryHeader(QueryKeyKind::FindMethod, query);
+    PutIdList(out, query->in_methods());
+    PutMethodMatcher(out, query->matcher());
+    return out;
+}
+
+std::string CanonicalizeQuery(const schema::FindField *query) {
+    auto out = CanonicalizeQueryHeader(QueryKeyKind::FindField, query);
+    PutIdList(out, query->in_fields());
+    PutFieldMatcher(out, query->matcher());
+    return out;
+}
+
+void QueryResultCache::SetCapacity(size_t capacity_bytes) {
+    std::lock_guard lock(mutex_);
+    capacity_bytes_ = capacity_bytes;
+    EvictLocked();
+}
+
+bool QueryResultCache::IsEnabled() const {
+    std::lock_guard lock(mutex_);
+    return capacity_bytes_ != 0;
+}
+
+bool QueryResultCache::Get(const std::string &key, std::vector<CachedDexHits> &hits) {
+    std::lock_guard lock(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        return false;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    hits = it->second->hits;
+    return true;
+}
+
+void QueryResultCache::Put(std::string key, std::vector<CachedDexHits> hits) {
+    std::lock_guard lock(mutex_);
+    PutLocked(std::move(key), std::move(hits));
+}
+
+void QueryResultCache::Clear() {
+    std::lock_guard lock(mutex_);
+    index_.clear();
+    entries_.clear();
+    size_bytes_ = 0;
+}
+
+void QueryResultCache::PutLocked(std::string key, std::vector<CachedDexHits> hits) {
+    auto bytes = EntryBytes(key, hits);
+    if (bytes > capacity_bytes_) {
+        return;
+    }
+    if (auto it = index_.find(key); it != index_.end()) {
+        size_bytes_ -= it->second->bytes;
+        entries_.erase(it->second);
+        index_.erase(it);
+    }
+    entries_.push_front({std::move(key), std::move(hits), bytes});
+    index_.emplace(entries_.front().key, entries_.begin());
+    size_bytes_ += bytes;
+    EvictLocked();
+}
+
+void QueryResultCache::EvictLocked() {
+    while (size_bytes_ > capacity_bytes_ && !entries_.empty()) {
+        auto &entry = entries_.back();
+        size_bytes_ -= entry.bytes;
+        index_.erase(entry.key);
+        entries_.pop_back();
+    }
+}
+
+Error QueryResultCache::Save(std::string_view path, std::string_view fingerprint) const {
+    FILE *fp = fopen(std::string(path).c_str(), "wb");
+    if (fp == nullptr) {
+        return Error::OPEN_FILE_FAILED;
+    }
+    CacheFileWriter writer(fp);
+    {
+        std::lock_guard lock(mutex_);
+        writer.Bytes(kCacheFileMagic, sizeof(kCacheFileMagic));
+        writer.Scalar(kCacheFileVersion);
+        writer.String(fingerprint);
+        writer.Scalar<uint32_t>(static_cast<uint32_t>(entries_.size()));
+        // least recently used first, so that Load restores the same order
+        for (auto it = entries_.rbegin(); it != entries_.rend(); ++it) {
+            writer.String(it->key);
+            writer.Scalar<uint32_t>(static_cast<uint32_t>(it->hits.size()));
+            for (auto &dex_hits: it->hits) {
+                writer.Scalar(dex_hits.dex_id);
+                writer.Scalar<uint32_t>(static_cast<uint32_t>(dex_hits.ids.size()));
+                writer.Bytes(dex_hits.ids.data(), dex_hits.ids.size() * sizeof(uint32_t));
+            }
+        }
+    }
+    auto ok = writer.ok();
+    ok = fclose(fp) == 0 && ok;
+    return ok ? Error::SUCCESS : Error::WRITE_FILE_INCOMPLETE;
+}
+
+Error QueryResultCache::Load(std::string_view path, std::string_view fingerprint, const std::vector<CachedDexBounds> &dex_bounds) {
+    FILE *fp = fopen(std::string(path).c_str(), "rb");
+    if (fp == nullptr) {
+        return Error::FILE_NOT_FOUND;
+    }
+    fseek(fp, 0, SEEK_END);
+    auto file_size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    CacheFileReader reader(fp, file_size > 0 ? static_cast<size_t>(file_size) : 0);
+    char magic[sizeof(kCacheFileMagic)];
+    reader.Bytes(magic, sizeof(magic));
+    auto version = reader.Scalar<uint32_t>();
+    auto file_fingerprint = reader.String();
+    if (!reader.ok()
+        || memcmp(magic, kCacheFileMagic, sizeof(magic)) != 0
+        || version != kCacheFileVersion
+        || file_fingerprint != fingerprint) {
+        fclose(fp);
+        return Error::QUERY_CACHE_MISMATCH;
+    }
+    std::vector<std::pair<std::string, std::vector<CachedDexHits>>> loaded;
+    auto entry_count = reader.Scalar<uint32_t>();
+    for (uint32_t i = 0; reader.ok() && i < entry_count; ++i) {
+        auto key = reader.String();
+        if (!reader.ok() || key.empty()) {
+            fclose(fp);
+            return Error::QUERY_CACHE_MISMATCH;
+        }
+        // the ids are only dereferenced on a hit, so every one is checked against its dex here
+        auto id_bound = GetIdBound(static_cast<QueryKeyKind>(key[0]));
+        if (id_bound == nullptr) {
+            fclose(fp);
+            return Error::QUERY_CACHE_MISMATCH;
+        }
+        std::vector<CachedDexHits> hits;
+        auto dex_hits_count = reader.Scalar<uint32_t>();
+        for (uint32_t j = 0; reader.ok() && j < dex_hits_count; ++j) {
+            auto &dex_hits = hits.emplace_back();
+            dex_hits.dex_id = reader.Scalar<uint32_t>();
+            auto id_count = reader.Scalar<uint32_t>();
+            if (!reader.ok() || dex_hits.dex_id >= dex_bounds.size() || id_count > reader.remaining() / sizeof(uint32_t)) {
+                fclose(fp);
+                return Error::QUERY_CACHE_MISMATCH;
+            }
+            dex_hits.ids.resize(id_count);
+            reader.Bytes(dex_hits.ids.data(), id_count * sizeof(uint32_t));
+            auto id_limit = dex_bounds[dex_hits.dex_id].*id_bound;
+            if (!reader.ok() || std::any_of(dex_hits.ids.begin(), dex_hits.ids.end(), [id_limit](uint32_t id) {
+                return id >= id_limit;
+            })) {
+                fclose(fp);
+                return Error::QUERY_CACHE_MISMATCH;
+            }
+        }
+        loaded.emplace_back(std::move(key), std::move(hits));
+    }
+    auto ok = reader.ok();
+    fclose(fp);
+    if (!ok) {
+        return Error::QUERY_CACHE_MISMATCH;
+    }
+    std::lock_guard lock(mutex_);
+    for (auto &[key, hits]: loaded) {
+        PutLocked(std::move(key), std::move(hits));
+    }
+    return Error::SUCCESS;
+}
+
+} // namespace internal
+
+} // namespace dexkit
@@ -0,0 +1,124 @@
+// DexKit - An high-performance runtime parsing library for dex
+// implemented in C++.
+// Copyright (C) 2022-2023 LuckyPray
+// https://github.com/LuckyPray/DexKit
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+// <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+
+
+#include "internal/reference_seed.h"
+
+#include "utils/dex_descriptor_util.h"
+
+namespace dexkit {
+
+namespace internal {
+
+namespace {
+
+// shorty character of a type descriptor, arrays are passed as references
+char GetShortyChar(std::string_view descriptor) {
+    return descriptor.front() == '[' ? 'L' : descriptor.front();
+}
+
+template<typename Matcher>
+std::optional<MemberRefSeed> GetMemberRefSeed(const Matcher *matcher, const schema::StringMatcher *name_matcher) {
+    if (!matcher || !matcher->declaring_class()) return std::nullopt;
+    auto class_descriptor = GetExactTypeDescriptor(matcher->declaring_class()->class_name());
+    auto name = GetExactName(name_matcher);
+    if (!class_descriptor || !name) return std::nullopt;
+    return MemberRefSeed{std::move(*class_descriptor), *name};
+}
+
+void AddMethodSeeds(const schema::MethodsMatcher *matcher, std::vector<MemberRefSeed> &seeds) {
+    if (!matcher || !matcher->methods()) return;
+    for (auto method_matcher: *matcher->methods()) {
+        if (auto seed = GetMemberRefSeed(method_matcher, method_matcher->method_name())) {
+            seeds.emplace_back(std::move(*seed));
+        }
+    }
+}
+
+} // namespace
+
+std::optional<std::string> GetExactTypeDescriptor(const schema::StringMatcher *matcher) {
+    if (!matcher || matcher->match_type() != schema::StringMatchType::Equal || matcher->ignore_case()) {
+        return std::nullopt;
+    }
+    if (!matcher->value() || matcher->value()->size() == 0) {
+        return std::nullopt;
+    }
+    auto value = matcher->value()->string_view();
+    size_t array_count = 0;
+    auto find_index = value.find_first_of('[');
+    if (find_index != std::string_view::npos) {
+        array_count = (uint8_t) (value.size() - find_index) / 2;
+    }
+    auto name = value.substr(0, value.size() - array_count * 2);
+    return std::string(array_count, '[') + NameToDescriptor(name, true, true);
+}
+
+std::optional<std::string_view> GetExactName(const schema::StringMatcher *matcher) {
+    if (!matcher || !matcher->value()) return std::nullopt;
+    if (matcher->match_type() != schema::StringMatchType::Equal || matcher->ignore_case()) return std::nullopt;
+    return matcher->value()->string_view();
+}
+
+std::vector<std::string> GetProtoShortySeeds(const schema::MethodMatcher *matcher) {
+    if (!matcher) return {};
+    if (matcher->proto_shorty()) {
+        return {matcher->proto_shorty()->str()};
+    }
+    if (!matcher->parameters() || !matcher->parameters()->parameters()) return {};
+    std::string parameters_shorty;
+    for (auto parameter_matcher: *matcher->parameters()->parameters()) {
+        auto type = parameter_matcher->parameter_type();
+        auto descriptor = type ? GetExactTypeDescriptor(type->class_name()) : std::nullopt;
+        if (!descriptor) return {};
+        parameters_shorty.push_back(GetShortyChar(*descriptor));
+    }
+    std::vector<std::string> shorties;
+    auto return_descriptor = matcher->return_type() ? GetExactTypeDescriptor(matcher->return_type()->class_name()) : std::nullopt;
+    if (return_descriptor) {
+        shorties.emplace_back(GetShortyChar(*return_descriptor) + parameters_shorty);
+    } else {
+        for (auto return_shorty: std::string_view("VZBSCIJFDL")) {
+            shorties.emplace_back(return_shorty + parameters_shorty);
+        }
+    }
+    return shorties;
+}
+
+ReferenceSeeds GetReferenceSeeds(const schema::MethodMatcher *matcher) {
+    ReferenceSeeds seeds;
+    if (!matcher) return seeds;
+    if (matcher->using_fields()) {
+        for (auto using_field: *matcher->using_fields()) {
+            auto field_matcher = using_field->field();
+            if (auto seed = GetMemberRefSeed(field_matcher, field_matcher ? field_matcher->field_name() : nullptr)) {
+                seed->using_type = using_field->using_type();
+                seeds.using_fields.emplace_back(std::move(*seed));
+            }
+        }
+    }
+    AddMethodSeeds(matcher->invoking_methods(), seeds.invoking_methods);
+    AddMethodSeeds(matcher->method_callers(), seeds.method_callers);
+    return seeds;
+}
+
+} // namespace internal
+
+} // namespace dexkit
@@ -0,0 +1,1071 @@
+// DexKit - An high-performance runtime parsing library for dex
+// implemented in C++.
+// Copyright (C) 2022-2023 LuckyPray
+// https://github.com/LuckyPray/DexKit
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+// <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+
+
+#include "internal/regex.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cctype>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "parallel_hashmap/phmap.h"
+#include "string_match.h"
+#include "internal/compiled_matcher_cache.h"
+
+namespace dexkit {
+
+namespace internal {
+
+namespace {
+
+constexpr uint32_t kInfinite = UINT32_MAX;
+constexpr uint32_t kMaxRepeat = 1000;
+constexpr uint32_t kMaxDepth = 1000;
+constexpr uint32_t kMaxNfaStates = 1 << 16;
+constexpr size_t kMaxExactLiteral = 1024;
+
+using ByteSet = std::bitset<256>;
+
+struct Node {
+    enum class Kind : uint8_t {
+        Empty,
+        Bytes,
+        Concat,
+        Alternate,
+        Repeat,
+        Begin,
+        End,
+    };
+
+    Kind kind = Kind::Empty;
+    ByteSet bytes;
+    // the only byte of bytes (up to case), -1 if there are more
+    int literal = -1;
+    std::vector<uint32_t> children;
+    uint32_t min = 0;
+    uint32_t max = 0;
+};
+
+inline bool IsLowerAscii(uint32_t c) {
+    return c >= 'a' && c <= 'z';
+}
+
+inline bool IsUpperAscii(uint32_t c) {
+    return c >= 'A' && c <= 'Z';
+}
+
+inline int GetHexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+inline size_t GetUtf8Length(uint8_t lead) {
+    if (lead < 0x80) return 1;
+    if ((lead & 0xE0) == 0xC0) return 2;
+    if ((lead & 0xF0) == 0xE0) return 3;
+    if ((lead & 0xF8) == 0xF0) return 4;
+    return 1;
+}
+
+// dex strings are MUTF-8: U+0000 takes two bytes and surrogates are encoded one by one
+std::string EncodeModifiedUtf8(uint32_t code_point) {
+    std::string result;
+    if (code_point != 0 && code_point < 0x80) {
+        result.push_back((char) code_point);
+    } else if (code_point < 0x800) {
+        result.push_back((char) (0xC0 | (code_point >> 6)));
+        result.push_back((char) (0x80 | (code_point & 0x3F)));
+    } else {
+        result.push_back((char) (0xE0 | (code_point >> 12)));
+        result.push_back((char) (0x80 | ((code_point >> 6) & 0x3F)));
+        result.push_back((char) (0x80 | (code_point & 0x3F)));
+    }
+    return result;
+}
+
+class Parser {
+public:
+    std::vector<Node> nodes;
+
+    Parser(std::string_view pattern, bool ignore_case) : pattern_(pattern), ignore_case_(ignore_case) {}
+
+    // root node, nullopt for a pattern outside of the supported syntax
+    std::optional<uint32_t> Parse() {
+        auto root = ParseAlternate();
+        if (!root || pos_ != pattern_.size()) {
+            return std::nullopt;
+        }
+        return root;
+    }
+
+private:
+    std::string_view pattern_;
+    size_t pos_ = 0;
+    bool ignore_case_;
+    uint32_t depth_ = 0;
+
+    // a class member, either an ASCII byte or the encoding of a wider char
+    struct ClassItem {
+        int byte = -1;
+        std::string chars;
+    };
+
+    [[nodiscard]] bool AtEnd() const {
+        return pos_ >= pattern_.size();
+    }
+
+    [[nodiscard]] char Peek() const {
+        return pattern_[pos_];
+    }
+
+    uint32_t AddNode(Node node) {
+        nodes.emplace_back(std::move(node));
+        return (uint32_t) nodes.size() - 1;
+    }
+
+    uint32_t AddNode(Node::Kind kind, std::vector<uint32_t> children = {}) {
+        Node node;
+        node.kind = kind;
+        node.children = std::move(children);
+        return AddNode(std::move(node));
+    }
+
+    uint32_t AddBytes(ByteSet bytes) {
+        if (ignore_case_) {
+            for (uint32_t c = 'a'; c <= 'z'; ++c) {
+                if (bytes[c] || bytes[c - 32]) {
+                    bytes.set(c);
+                    bytes.set(c - 32);
+                }
+            }
+        }
+        Node node;
+        node.kind = Node::Kind::Bytes;
+        node.bytes = bytes;
+        auto count = bytes.count();
+        if (count == 1 || (count == 2 && ignore_case_)) {
+            size_t first = 0;
+            while (!bytes[first]) ++first;
+            if (count == 1) {
+                node.literal = (int) first;
+            } else if (IsUpperAscii(first) && bytes[first + 32]) {
+                node.literal = (int) first + 32;
+            }
+        }
+        return AddNode(std::move(node));
+    }
+
+    uint32_t AddByteRange(uint8_t lo, uint8_t hi) {
+        ByteSet bytes;
+        for (uint32_t c = lo; c <= hi; ++c) bytes.set(c);
+        return AddBytes(bytes);
+    }
+
+    uint32_t AddChars(std::string_view chars) {
+        if (chars.size() == 1) {
+            return AddBytes(ByteSet().set((uint8_t) chars[0]));
+        }
+        std::vector<uint32_t> children;
+        for (auto c: chars) {
+            children.emplace_back(AddBytes(ByteSet().set((uint8_t) c)));
+        }
+        return AddNode(Node::Kind::Concat, std::move(children));
+    }
+
+    // any char encoded in more than one byte
+    uint32_t AddWideChar() {
+        std::vector<uint32_t> alternatives;
+        for (uint32_t length = 2; length <= 4; ++length) {
+            std::vector<uint32_t> sequence;
+            uint8_t lead_lo = length == 2 ? 0xC0 : length == 3 ? 0xE0 : 0xF0;
+            uint8_t lead_hi = length == 2 ? 0xDF : length == 3 ? 0xEF : 0xF7;
+            sequence.emplace_back(AddByteRange(lead_lo, lead_hi));
+            for (uint32_t i = 1; i < length; ++i) {
+                sequence.emplace_back(AddByteRange(0x80, 0xBF));
+            }
+            alternatives.emplace_back(AddNode(Node::Kind::Concat, std::move(sequence)));
+        }
+        return AddNode(Node::Kind::Alternate, std::move(alternatives));
+    }
+
+    uint32_t AddClass(ByteSet ascii, const std::vector<std::string> &wide_chars, bool any_wide_char) {
+        std::vector<uint32_t> alternatives;
+        if (ascii.any() || (wide_chars.empty() && !any_wide_char)) {
+            alternatives.emplace_back(AddBytes(ascii));
+        }
+        if (any_wide_char) {
+            alternatives.emplace_back(AddWideChar());
+        } else {
+            for (auto &chars: wide_chars) {
+                alternatives.emplace_back(AddChars(chars));
+            }
+        }
+        if (alternatives.size() == 1) {
+            return alternatives[0];
+        }
+        return AddNode(Node::Kind::Alternate, std::move(alternatives));
+    }
+
+    std::optional<uint32_t> ParseAlternate() {
+        if (++depth_ > kMaxDepth) {
+            return std::nullopt;
+        }
+        std::vector<uint32_t> branches;
+        while (true) {
+            auto branch = ParseConcat();
+            if (!branch) return std::nullopt;
+            branches.emplace_back(*branch);
+            if (AtEnd() || Peek() != '|') break;
+            ++pos_;
+        }
+        --depth_;
+        if (branches.size() == 1) {
+            return branches[0];
+        }
+        return AddNode(Node::Kind::Alternate, std::move(branches));
+    }
+
+    std::optional<uint32_t> ParseConcat() {
+        std::vector<uint32_t> items;
+        while (!AtEnd() && Peek() != '|' && Peek() != ')') {
+            auto item = ParseRepeat();
+            if (!item) return std::nullopt;
+            items.emplace_back(*item);
+        }
+        if (items.empty()) {
+            return AddNode(Node::Kind::Empty);
+        }
+        if (items.size() == 1) {
+            return items[0];
+        }
+        return AddNode(Node::Kind::Concat, std::move(items));
+    }
+
+    static bool IsQuantifier(char c) {
+        return c == '*' || c == '+' || c == '?' || c == '{';
+    }
+
+    bool ParseNumber(uint32_t &value) {
+        if (AtEnd() || !std::isdigit((uint8_t) Peek())) {
+            return false;
+        }
+        value = 0;
+        while (!AtEnd() && std::isdigit((uint8_t) Peek())) {
+            value = value * 10 + (Peek() - '0');
+            if (value > kMaxRepeat) return false;
+            ++pos_;
+        }
+        return true;
+    }
+
+    bool ParseBound(uint32_t &min, uint32_t &max) {
+        ++pos_;
+        if (!ParseNumber(min)) return false;
+        max = min;
+        if (!AtEnd() && Peek() == ',') {
+            ++pos_;
+            max = kInfinite;
+            if (!AtEnd() && Peek() != '}' && !ParseNumber(max)) return false;
+        }
+        if (AtEnd() || Peek() != '}' || min > max) return false;
+        ++pos_;
+        return true;
+    }
+
+    std::optional<uint32_t> ParseRepeat() {
+        auto atom = ParseAtom();
+        if (!atom || AtEnd() || !IsQuantifier(Peek())) {
+            return atom;
+        }
+        uint32_t min, max;
+        switch (Peek()) {
+            case '*': min = 0, max = kInfinite, ++pos_; break;
+            case '+': min = 1, max = kInfinite, ++pos_; break;
+            case '?': min = 0, max = 1, ++pos_; break;
+            default: if (!ParseBound(min, max)) return std::nullopt;
+        }
+        // a lazy quantifier accepts the same strings, possessive or stacked ones are unsupported
+        if (!AtEnd() && Peek() == '?') ++pos_;
+        if (!AtEnd() && IsQuantifier(Peek())) {
+            return std::nullopt;
+        }
+        Node node;
+        node.kind = Node::Kind::Repeat;
+        node.children = {*atom};
+        node.min = min;
+        node.max = max;
+        return AddNode(std::move(node));
+    }
+
+    std::optional<uint32_t> ParseAtom() {
+        switch (Peek()) {
+            case '(': {
+                ++pos_;
+                if (pattern_.substr(pos_).starts_with("?:")) {
+                    pos_ += 2;
+                } else if (!AtEnd() && Peek() == '?') {
+                    // lookaround, named groups and inline flags
+                    return std::nullopt;
+                }
+                auto inner = ParseAlternate();
+                if (!inner || AtEnd() || Peek() != ')') {
+                    return std::nullopt;
+                }
+                ++pos_;
+                return inner;
+            }
+            case '[': return ParseClass();
+            case '.': {
+                ++pos_;
+                auto ascii = ByteSet();
+                for (uint32_t c = 0; c < 0x80; ++c) ascii.set(c);
+                ascii.reset('\n');
+                return AddClass(ascii, {}, true);
+            }
+            case '^': ++pos_; return AddNode(Node::Kind::Begin);
+            case '$': ++pos_; return AddNode(Node::Kind::End);
+            case '\\': return ParseEscape();
+            case '*':
+            case '+':
+            case '?':
+            case '{':
+                return std::nullopt;
+            default: {
+                auto length = std::min(GetUtf8Length((uint8_t) Peek()), pattern_.size() - pos_);
+                auto chars = pattern_.substr(pos_, length);
+                pos_ += length;
+                return AddChars(chars);
+            }
+        }
+    }
+
+    // \d \w \s and their negations, nullopt for other escapes
+    static std::optional<std::pair<ByteSet, bool>> GetShorthandClass(char c) {
+        ByteSet bytes;
+        switch (c) {
+            case 'd': case 'D':
+                for (uint32_t i = '0'; i <= '9'; ++i) bytes.set(i);
+                break;
+            case 'w': case 'W':
+                for (uint32_t i = 0; i < 0x80; ++i) {
+                    if (std::isalnum((int) i) || i == '_') bytes.set(i);
+                }
+                break;
+            case 's': case 'S':
+                for (auto space: {' ', '\t', '\n', '\x0B', '\f', '\r'}) bytes.set((uint8_t) space);
+                break;
+            default:
+                return std::nullopt;
+        }
+        bool negated = std::isupper((uint8_t) c);
+        if (negated) {
+            for (uint32_t i = 0; i < 0x80; ++i) bytes.flip(i);
+        }
+        return std::make_pair(bytes, negated);
+    }
+
+    // the char an escape other than a shorthand class stands for, pos_ is past the backslash
+    std::optional<std::string> ParseEscapedChar() {
+        if (AtEnd()) return std::nullopt;
+        auto c = Peek();
+        ++pos_;
+        switch (c) {
+            case 't': return "\t";
+            case 'n': return "\n";
+            case 'r': return "\r";
+            case 'f': return "\f";
+            case 'a': return "\a";
+            case 'e': return "\x1B";
+            case 'x':
+            case 'u': {
+                size_t digits = c == 'x' ? 2 : 4;
+                if (pattern_.size() - pos_ < digits) return std::nullopt;
+                uint32_t code_point = 0;
+                for (size_t i = 0; i < digits; ++i) {
+                    auto value = GetHexValue(pattern_[pos_ + i]);
+                    if (value < 0) return std::nullopt;
+                    code_point = code_point << 4 | value;
+                }
+                pos_ += digits;
+                return EncodeModifiedUtf8(code_point);
+            }
+            default:
+                break;
+        }
+        if (std::isalnum((uint8_t) c)) {
+            // back references, boundaries, unicode classes
+            return std::nullopt;
+        }
+        auto length = std::min(GetUtf8Length((uint8_t) c), pattern_.size() - pos_ + 1);
+        auto chars = pattern_.substr(pos_ - 1, length);
+        pos_ += length - 1;
+        return std::string(chars);
+    }
+
+    std::optional<uint32_t> ParseEscape() {
+        ++pos_;
+        if (AtEnd()) return std::nullopt;
+        if (auto shorthand = GetShorthandClass(Peek())) {
+            ++pos_;
+            return AddClass(shorthand->first, {}, shorthand->second);
+        }
+        if (Peek() == 'Q') {
+            auto end = pattern_.find("\\E", pos_ + 1);
+            auto quoted = pattern_.substr(pos_ + 1, end == std::string_view::npos ? std::string_view::npos : end - pos_ - 1);
+            pos_ = end == std::string_view::npos ? pattern_.size() : end + 2;
+            if (quoted.empty()) {
+                return AddNode(Node::Kind::Empty);
+            }
+            return AddChars(quoted);
+        }
+        auto chars = ParseEscapedChar();
+        if (!chars) return std::nullopt;
+        return AddChars(*chars);
+    }
+
+    std::optional<ClassItem> ParseClassItem(ByteSet &ascii, bool &any_wide_char) {
+        if (Peek() == '\\') {
+            ++pos_;
+            if (AtEnd()) return std::nullopt;
+            if (auto shorthand = GetShorthandClass(Peek())) {
+                ++pos_;
+                ascii |= shorthand->first;
+                any_wide_char |= shorthand->second;
+                return ClassItem{};
+            }
+            auto chars = ParseEscapedChar();
+            if (!chars) return std::nullopt;
+            if (chars->size() == 1) {
+                return ClassItem{.byte = (uint8_t) (*chars)[0], .chars = {}};
+            }
+            return ClassItem{.byte = -1, .chars = std::move(*chars)};
+        }
+        if (Peek() == '[' || pattern_.substr(pos_).starts_with("&&")) {
+            // nested classes and intersections
+            return std::nullopt;
+        }
+        auto length = std::min(GetUtf8Length((uint8_t) Peek()), pattern_.size() - pos_);
+        auto chars = pattern_.substr(pos_, length);
+        pos_ += length;
+        if (length == 1) {
+            return ClassItem{.byte = (uint8_t) chars[0], .chars = {}};
+        }
+        return ClassItem{.byte = -1, .chars = std::string(chars)};
+    }
+
+    std::optional<uint32_t> ParseClass() {
+        ++pos_;
+        bool negated = !AtEnd() && Peek() == '^';
+        if (negated) ++pos_;
+        ByteSet ascii;
+        std::vector<std::string> wide_chars;
+        bool any_wide_char = false;
+        for (bool first = true;; first = false) {
+            if (AtEnd()) return std::nullopt;
+            if (Peek() == ']' && !first) {
+                ++pos_;
+                break;
+            }
+            auto item = ParseClassItem(ascii, any_wide_char);
+            if (!item) return std::nullopt;
+            bool is_range = !AtEnd() && Peek() == '-' && pos_ + 1 < pattern_.size() && pattern_[pos_ + 1] != ']';
+            if (is_range) {
+                ++pos_;
+                auto hi = ParseClassItem(ascii, any_wide_char);
+                // ranges are limited to ASCII
+                if (!hi || item->byte < 0 || hi->byte < 0 || item->byte > hi->byte) return std::nullopt;
+                for (auto c = item->byte; c <= hi->byte; ++c) ascii.set(c);
+            } else if (item->byte >= 0) {
+                ascii.set(item->byte);
+            } else if (!item->chars.empty()) {
+                wide_chars.emplace_back(std::move(item->chars));
+            }
+        }
+        if (negated) {
+            if (!wide_chars.empty()) return std::nullopt;
+            if (ignore_case_) {
+                for (uint32_t c = 'a'; c <= 'z'; ++c) {
+                    if (ascii[c] || ascii[c - 32]) {
+                        ascii.set(c);
+                        ascii.set(c - 32);
+                    }
+                }
+            }
+            for (uint32_t c = 0; c < 0x80; ++c) ascii.flip(c);
+            any_wide_char = !any_wide_char;
+        }
+        return AddClass(ascii, wide_chars, any_wide_char);
+    }
+};
+
+struct LiteralInfo {
+    // the only string the node matches
+    std::optional<std::string> exact;
+    // substring of every string the node matches
+    std::string required;
+};
+
+class LiteralAnalyzer {
+public:
+    explicit LiteralAnalyzer(const std::vector<Node> &nodes) : nodes_(nodes) {}
+
+    LiteralInfo Analyze(uint32_t id) {
+        auto &node = nodes_[id];
+        LiteralInfo info;
+        switch (node.kind) {
+            case Node::Kind::Empty:
+                info.exact.emplace();
+                break;
+            case Node::Kind::Bytes:
+                if (node.literal >= 0) {
+                    info.exact.emplace(1, (char) node.literal);
+                    info.required = *info.exact;
+                }
+                break;
+            case Node::Kind::Concat:
+                return AnalyzeConcat(node.children);
+            case Node::Kind::Alternate: {
+                auto first = Analyze(node.children[0]);
+                bool same = first.exact.has_value();
+                for (size_t i = 1; same && i < node.children.size(); ++i) {
+                    same = Analyze(node.children[i]).exact == first.exact;
+                }
+                if (same) return first;
+                break;
+            }
+            case Node::Kind::Repeat: {
+                auto child = Analyze(node.children[0]);
+                if (child.exact && node.min == node.max && child.exact->size() * node.min <= kMaxExactLiteral) {
+                    info.exact.emplace();
+                    for (uint32_t i = 0; i < node.min; ++i) info.exact->append(*child.exact);
+                    info.required = *info.exact;
+                } else if (node.min > 0) {
+                    info.required = child.exact ? *child.exact : child.required;
+                }
+                break;
+            }
+            case Node::Kind::Begin:
+            case Node::Kind::End:
+                break;
+        }
+        return info;
+    }
+
+    LiteralInfo AnalyzeConcat(std::span<const uint32_t> children) {
+        LiteralInfo info;
+        std::string run;
+        bool all_exact = true;
+        auto keep = [&info](const std::string &literal) {
+            if (literal.size() > info.required.size()) info.required = literal;
+        };
+        for (auto id: children) {
+            auto child = Analyze(id);
+            if (child.exact) {
+                run.append(*child.exact);
+                continue;
+            }
+            all_exact = false;
+            keep(run);
+            run.clear();
+            keep(child.required);
+        }
+        if (all_exact) {
+            info.exact = run;
+        }
+        keep(run);
+        return info;
+    }
+
+    // leading (or trailing) exact children, concatenated
+    std::string GetExactRun(std::span<const uint32_t> children, bool from_back) {
+        std::string run;
+        for (size_t i = 0; i < children.size(); ++i) {
+            auto child = Analyze(children[from_back ? children.size() - 1 - i : i]);
+            if (!child.exact) break;
+            run = from_back ? *child.exact + run : run + *child.exact;
+        }
+        return run;
+    }
+
+private:
+    const std::vector<Node> &nodes_;
+};
+
+RegexLiteral GetRegexLiteral(const std::vector<Node> &nodes, uint32_t root) {
+    std::vector<uint32_t> items;
+    if (nodes[root].kind == Node::Kind::Concat) {
+        items = nodes[root].children;
+    } else {
+        items.emplace_back(root);
+    }
+    bool begin = !items.empty() && nodes[items.front()].kind == Node::Kind::Begin;
+    bool end = items.size() > (begin ? 1 : 0) && nodes[items.back()].kind == Node::Kind::End;
+    auto inner = std::span<const uint32_t>(items).subspan(begin ? 1 : 0, items.size() - (begin ? 1 : 0) - (end ? 1 : 0));
+
+    LiteralAnalyzer analyzer(nodes);
+    auto info = analyzer.AnalyzeConcat(inner);
+    RegexLiteral literal;
+    if (info.exact) {
+        literal.value = std::move(*info.exact);
+        literal.match_type = begin && end ? schema::StringMatchType::Equal
+                           : begin ? schema::StringMatchType::StartWith
+                           : end ? schema::StringMatchType::EndWith
+                           : schema::StringMatchType::Contains;
+        literal.exact = true;
+        return literal;
+    }
+    literal.value = std::move(info.required);
+    if (begin) {
+        auto prefix = analyzer.GetExactRun(inner, false);
+        if (!prefix.empty() && prefix.size() >= literal.value.size()) {
+            literal.value = std::move(prefix);
+            literal.match_type = schema::StringMatchType::StartWith;
+        }
+    }
+    if (end) {
+        auto suffix = analyzer.GetExactRun(inner, true);
+        if (suffix.size() > literal.value.size()) {
+            literal.value = std::move(suffix);
+            literal.match_type = schema::StringMatchType::EndWith;
+        }
+    }
+    return literal;
+}
+
+} // namespace
+
+struct RegexProgram {
+    struct State {
+        enum Op : uint8_t {
+            kByte,
+            kSplit,
+            kBegin,
+            kEnd,
+            kMatch,
+        };
+
+        Op op;
+        uint32_t out = 0;
+        // second branch of kSplit, byte set of kByte
+        uint32_t arg = 0;
+    };
+
+    std::vector<State> states;
+    std::vector<ByteSet> byte_sets;
+    uint32_t start = 0;
+    // bytes no byte set tells apart share a class, DFA rows are indexed by it
+    std::array<uint8_t, 256> byte_classes{};
+    std::vector<uint8_t> class_bytes;
+
+    [[nodiscard]] size_t MemoryUsage() const {
+        return states.capacity() * sizeof(State) + byte_sets.capacity() * sizeof(ByteSet) + class_bytes.capacity();
+    }
+};
+
+namespace {
+
+using State = RegexProgram::State;
+
+class Compiler {
+public:
+    Compiler(const std::vector<Node> &nodes, RegexProgram &program) : nodes_(nodes), program_(program) {}
+
+    // Thompson construction, back to front: returns the entry state of id continuing at next
+    std::optional<uint32_t> Compile(uint32_t id, uint32_t next) {
+        if (program_.states.size() > kMaxNfaStates) {
+            return std::nullopt;
+        }
+        auto &node = nodes_[id];
+        switch (node.kind) {
+            case Node::Kind::Empty:
+                return next;
+            case Node::Kind::Bytes:
+                program_.byte_sets.emplace_back(node.bytes);
+                return AddState(State::kByte, next, (uint32_t) program_.byte_sets.size() - 1);
+            case Node::Kind::Concat:
+                for (auto it = node.children.rbegin(); it != node.children.rend(); ++it) {
+                    auto entry = Compile(*it, next);
+                    if (!entry) return std::nullopt;
+                    next = *entry;
+                }
+                return next;
+            case Node::Kind::Alternate: {
+                auto entry = Compile(node.children.back(), next);
+                for (auto i = (int) node.children.size() - 2; entry && i >= 0; --i) {
+                    auto branch = Compile(node.children[i], next);
+                    if (!branch) return std::nullopt;
+                    entry = AddState(State::kSplit, *branch, *entry);
+                }
+                return entry;
+            }
+            case Node::Kind::Repeat: {
+                auto child = node.children[0];
+                std::optional<uint32_t> entry = next;
+                if (node.max == kInfinite) {
+                    auto loop = AddState(State::kSplit, 0, next);
+                    auto body = Compile(child, loop);
+                    if (!body) return std::nullopt;
+                    program_.states[loop].out = *body;
+                    entry = loop;
+                } else {
+                    // x{0,k} as (x(x(x)?)?)?
+                    for (uint32_t i = node.min; entry && i < node.max; ++i) {
+                        auto body = Compile(child, *entry);
+                        if (!body) return std::nullopt;
+                        entry = AddState(State::kSplit, *body, next);
+                    }
+                }
+                for (uint32_t i = 0; entry && i < node.min; ++i) {
+                    entry = Compile(child, *entry);
+                }
+                return entry;
+            }
+            case Node::Kind::Begin:
+                return AddState(State::kBegin, next);
+            case Node::Kind::End:
+                return AddState(State::kEnd, next);
+        }
+        return std::nullopt;
+    }
+
+private:
+    const std::vector<Node> &nodes_;
+    RegexProgram &program_;
+
+    uint32_t AddState(State::Op op, uint32_t out, uint32_t arg = 0) {
+        program_.states.emplace_back(State{op, out, arg});
+        return (uint32_t) program_.states.size() - 1;
+    }
+};
+
+void BuildByteClasses(RegexProgram &program) {
+    ByteSet boundaries;
+    for (auto &bytes: program.byte_sets) {
+        for (uint32_t c = 1; c < 256; ++c) {
+            if (bytes[c] != bytes[c - 1]) boundaries.set(c);
+        }
+    }
+    uint8_t byte_class = 0;
+    program.class_bytes.emplace_back(0);
+    for (uint32_t c = 1; c < 256; ++c) {
+        if (boundaries[c]) {
+            ++byte_class;
+            program.class_bytes.emplace_back((uint8_t) c);
+        }
+        program.byte_classes[c] = byte_class;
+    }
+}
+
+// NFA state set under construction, marks are generation stamped so they never need clearing
+struct ClosureBuilder {
+    const RegexProgram &program;
+    std::vector<uint32_t> marks;
+    std::vector<uint32_t> stack;
+    uint32_t generation = 0;
+    // kByte states, and kEnd states waiting for the end of the input
+    std::vector<uint32_t> set;
+    bool match = false;
+
+    explicit ClosureBuilder(const RegexProgram &program) : program(program), marks(program.states.size(), 0) {}
+
+    void Reset() {
+        ++generation;
+        set.clear();
+        match = false;
+    }
+
+    void Add(uint32_t from, bool at_begin, bool at_end) {
+        stack.emplace_back(from);
+        while (!stack.empty()) {
+            auto id = stack.back();
+            stack.pop_back();
+            if (marks[id] == generation) continue;
+            marks[id] = generation;
+            auto &state = program.states[id];
+            switch (state.op) {
+                case State::kByte:
+                    set.emplace_back(id);
+                    break;
+                case State::kSplit:
+                    stack.emplace_back(state.arg);
+                    stack.emplace_back(state.out);
+                    break;
+                case State::kBegin:
+                    if (at_begin) stack.emplace_back(state.out);
+                    break;
+                case State::kEnd:
+                    if (at_end) {
+                        stack.emplace_back(state.out);
+                    } else {
+                        set.emplace_back(id);
+                    }
+                    break;
+                case State::kMatch:
+                    match = true;
+                    break;
+            }
+        }
+    }
+
+    // states after consuming byte from states, plus the unanchored restart at the next position
+    void Step(std::span<const uint32_t> states, uint8_t byte) {
+        Reset();
+        for (auto id: states) {
+            auto &state = program.states[id];
+            if (state.op == State::kByte && program.byte_sets[state.arg][byte]) {
+                Add(state.out, false, false);
+            }
+        }
+        Add(program.start, false, false);
+    }
+
+    bool MatchesAtEnd(std::span<const uint32_t> states, bool at_begin) {
+        Reset();
+        for (auto id: states) {
+            if (program.states[id].op == State::kEnd) {
+                Add(program.states[id].out, at_begin, true);
+            }
+        }
+        return match;
+    }
+};
+
+} // namespace
+
+// Transitions are published with release stores once their target row is complete, so matching
+// threads read them without locking and only take the mutex to build a missing one. States are
+// never evicted: once kMaxStates exist or the memory limit is reached, the remaining input is
+// matched by NFA simulation. The limit is fixed up front, so the cache can charge it on insert.
+class LazyRegexDfa {
+public:
+    static constexpr uint32_t kUnknown = 0;
+    static constexpr uint32_t kMatched = 1;
+    static constexpr uint32_t kDead = 2;
+    static constexpr uint32_t kOverflow = 3;
+
+    explicit LazyRegexDfa(const RegexProgram &program)
+            : program_(program),
+              row_size_((uint32_t) program.class_bytes.size() + 1),
+              chunks_(std::make_unique<std::unique_ptr<std::atomic<uint32_t>[]>[]>(kMaxStates / kRowsPerChunk)),
+              builder_(program) {
+        builder_.Reset();
+        builder_.Add(program.start, true, false);
+        start_ = Intern(true);
+        // the start state is always built, whatever it costs
+        auto max_memory = kMaxStates / kRowsPerChunk * ChunkMemory() + kMaxStates * SetMemory(program.states.size());
+        memory_limit_ = std::max(memory_used_, std::min(kMaxMemory, max_memory));
+    }
+
+    [[nodiscard]] bool Search(std::string_view str) const {
+        auto entry = start_;
+        for (size_t i = 0; i < str.size(); ++i) {
+            if (entry < 4) break;
+            auto id = (entry >> 2) - 1;
+            auto byte_class = program_.byte_classes[(uint8_t) str[i]];
+            auto next = GetRow(id)[byte_class].load(std::memory_order_acquire);
+            if (next == kUnknown) {
+                next = Build(id, byte_class);
+            }
+            if (next == kOverflow) {
+                return Simulate(id, str.substr(i));
+            }
+            entry = next;
+        }
+        if (entry < 4) {
+            return entry == kMatched;
+        }
+        return GetRow((entry >> 2) - 1)[row_size_ - 1].load(std::memory_order_relaxed) == kMatched;
+    }
+
+    // the most the states may ever take, not what they take now
+    [[nodiscard]] size_t MemoryUsage() const {
+        return sizeof(LazyRegexDfa) + (kMaxStates / kRowsPerChunk) * sizeof(void *) + memory_limit_;
+    }
+
+private:
+    static constexpr uint32_t kMaxStates = 1024;
+    static constexpr uint32_t kRowsPerChunk = 16;
+    static constexpr size_t kMaxMemory = 256 << 10;
+
+    const RegexProgram &program_;
+    // transitions by byte class, then whether the input may end here
+    const uint32_t row_size_;
+    std::unique_ptr<std::unique_ptr<std::atomic<uint32_t>[]>[]> chunks_;
+    uint32_t start_;
+    size_t memory_limit_ = SIZE_MAX;
+
+    mutable std::mutex mutex_;
+    mutable size_t memory_used_ = 0;
+    mutable ClosureBuilder builder_;
+    mutable std::vector<std::vector<uint32_t>> sets_;
+    mutable phmap::flat_hash_map<std::string, uint32_t> ids_;
+
+    [[nodiscard]] std::atomic<uint32_t> *GetRow(uint32_t id) const {
+        return chunks_[id / kRowsPerChunk].get() + (id % kRowsPerChunk) * row_size_;
+    }
+
+    [[nodiscard]] size_t ChunkMemory() const {
+        return kRowsPerChunk * row_size_ * sizeof(uint32_t);
+    }
+
+    // the set, its key and the map entry
+    [[nodiscard]] static size_t SetMemory(size_t set_size) {
+        return set_size * sizeof(uint32_t) * 3;
+    }
+
+    // entry of the builder's set, mutex held (or still constructing). Whether the input may end
+    // in a state depends on being at the beginning ('$^'), so the start state is keyed apart.
+    uint32_t Intern(bool at_begin) const {
+        if (builder_.match) return kMatched;
+        if (builder_.set.empty()) return kDead;
+        auto &set = builder_.set;
+        std::sort(set.begin(), set.end());
+        std::string key(reinterpret_cast<const char *>(set.data()), set.size() * sizeof(uint32_t));
+        key.push_back((char) at_begin);
+        auto it = ids_.find(key);
+        if (it != ids_.end()) {
+            return (it->second + 1) << 2;
+        }
+        auto id = (uint32_t) sets_.size();
+        if (id == kMaxStates) {
+            return kOverflow;
+        }
+        auto &chunk = chunks_[id / kRowsPerChunk];
+        auto memory = SetMemory(set.size()) + (chunk ? 0 : ChunkMemory());
+        if (memory_used_ + memory > memory_limit_) {
+            return kOverflow;
+        }
+        memory_used_ += memory;
+        if (!chunk) {
+            chunk = std::make_unique<std::atomic<uint32_t>[]>(kRowsPerChunk * row_size_);
+        }
+        sets_.emplace_back(set);
+        ids_.emplace(std::move(key), id);
+        auto matches_at_end = builder_.MatchesAtEnd(sets_.back(), at_begin);
+        GetRow(id)[row_size_ - 1].store(matches_at_end ? kMatched : kDead, std::memory_order_relaxed);
+        return (id + 1) << 2;
+    }
+
+    uint32_t Build(uint32_t id, uint8_t byte_class) const {
+        std::lock_guard lock(mutex_);
+        auto &slot = GetRow(id)[byte_class];
+        auto entry = slot.load(std::memory_order_relaxed);
+        if (entry != kUnknown) {
+            return entry;
+        }
+        builder_.Step(sets_[id], program_.class_bytes[byte_class]);
+        entry = Intern(false);
+        slot.store(entry, std::memory_order_release);
+        return entry;
+    }
+
+    bool Simulate(uint32_t id, std::string_view rest) const {
+        std::vector<uint32_t> states;
+        {
+            std::lock_guard lock(mutex_);
+            states = sets_[id];
+        }
+        ClosureBuilder builder(program_);
+        for (auto c: rest) {
+            builder.Step(states, (uint8_t) c);
+            if (builder.match) return true;
+            states.swap(builder.set);
+        }
+        return builder.MatchesAtEnd(states, false);
+    }
+};
+
+Regex::Regex(std::string_view pattern, bool ignore_case) : ignore_case_(ignore_case) {
+    Parser parser(pattern, ignore_case);
+    auto root = parser.Parse();
+    if (!root) {
+        return;
+    }
+    literal_ = GetRegexLiteral(parser.nodes, *root);
+    if (literal_.exact) {
+        valid_ = true;
+        return;
+    }
+    auto program = std::make_unique<RegexProgram>();
+    program->states.emplace_back(State{State::kMatch});
+    auto start = Compiler(parser.nodes, *program).Compile(*root, 0);
+    if (!start || program->states.size() > kMaxNfaStates) {
+        literal_ = {};
+        return;
+    }
+    program->start = *start;
+    BuildByteClasses(*program);
+    program_ = std::move(program);
+    dfa_ = std::make_unique<LazyRegexDfa>(*program_);
+    valid_ = true;
+}
+
+Regex::Regex(Regex &&) noexcept = default;
+
+Regex::~Regex() = default;
+
+bool Regex::Search(std::string_view str) const {
+    if (!valid_) {
+        return false;
+    }
+    if (literal_.exact) {
+        auto &value = literal_.value;
+        switch (literal_.match_type) {
+            case schema::StringMatchType::Contains: return kmp::FindIndex(str, value, ignore_case_) != -1;
+            case schema::StringMatchType::StartWith: return kmp::starts_with(str, value, ignore_case_);
+            case schema::StringMatchType::EndWith: return kmp::ends_with(str, value, ignore_case_);
+            case schema::StringMatchType::Equal: return kmp::equals(str, value, ignore_case_);
+            default: return false;
+        }
+    }
+    return dfa_->Search(str);
+}
+
+size_t Regex::MemoryUsage() const {
+    size_t bytes = literal_.value.capacity();
+    if (program_) bytes += program_->MemoryUsage();
+    if (dfa_) bytes += dfa_->MemoryUsage();
+    return bytes;
+}
+
+std::shared_ptr<const Regex> GetCompiledRegex(const schema::StringMatcher *matcher) {
+    auto pattern = matcher->value() ? matcher->value()->string_view() : std::string_view();
+    std::string key(1, (char) matcher->ignore_case());
+    key.append(pattern);
+    return CompiledMatcherCache::Global().GetOrCreate<Regex>(
+            CompiledMatcherKind::Regex, key, [&]() {
+                return Regex(pattern, matcher->ignore_case());
+            }, [](const Regex &regex) {
+                return regex.MemoryUsage();
+            });
+}
+
+} // namespace internal
+
+} // namespace dexkit
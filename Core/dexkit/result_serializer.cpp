@@ -0,0 +1,140 @@
+// DexKit - An high-performance runtime parsing library for dex
+// implemented in C++.
+// Copyright (C) 2022-2023 LuckyPray
+// https://github.com/LuckyPray/DexKit
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+// <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+
+
+#include "dex_item.h"
+#include "internal/result_serializer.h"
+
+#include <algorithm>
+
+namespace dexkit {
+
+namespace internal {
+
+namespace {
+
+// rough size of one meta with its descriptor and id vectors, only used to pre-size the builder
+constexpr size_t kEstimatedMetaSize = 128;
+
+size_t CountHits(const std::vector<DexHits> &hits) {
+    size_t count = 0;
+    for (auto &dex_hits: hits) {
+        count += dex_hits.ids.size();
+    }
+    return count;
+}
+
+std::unique_ptr<flatbuffers::FlatBufferBuilder> MakeBuilder(size_t hit_count) {
+    return std::make_unique<flatbuffers::FlatBufferBuilder>(std::max<size_t>(1024, hit_count * kEstimatedMetaSize));
+}
+
+flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<schema::ClassMeta>>>
+WriteClassMetas(flatbuffers::FlatBufferBuilder &fbb, const std::vector<DexHits> &hits, size_t hit_count) {
+    std::vector<flatbuffers::Offset<schema::ClassMeta>> offsets;
+    offsets.reserve(hit_count);
+    for (auto &[dex, ids]: hits) {
+        for (auto type_idx: ids) {
+            offsets.emplace_back(dex->CreateClassMeta(fbb, type_idx));
+        }
+    }
+    return fbb.CreateVector(offsets);
+}
+
+flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<schema::MethodMeta>>>
+WriteMethodMetas(flatbuffers::FlatBufferBuilder &fbb, const std::vector<DexHits> &hits, size_t hit_count) {
+    std::vector<flatbuffers::Offset<schema::MethodMeta>> offsets;
+    offsets.reserve(hit_count);
+    for (auto &[dex, ids]: hits) {
+        for (auto method_idx: ids) {
+            offsets.emplace_back(dex->CreateMethodMeta(fbb, method_idx));
+        }
+    }
+    return fbb.CreateVector(offsets);
+}
+
+} // namespace
+
+std::unique_ptr<flatbuffers::FlatBufferBuilder> SerializeClassHits(const std::vector<DexHits> &hits) {
+    auto hit_count = CountHits(hits);
+    auto fbb = MakeBuilder(hit_count);
+    auto metas = WriteClassMetas(*fbb, hits, hit_count);
+    fbb->Finish(schema::CreateClassMetaArrayHolder(*fbb, metas));
+    return fbb;
+}
+
+std::unique_ptr<flatbuffers::FlatBufferBuilder> SerializeMethodHits(const std::vector<DexHits> &hits) {
+    auto hit_count = CountHits(hits);
+    auto fbb = MakeBuilder(hit_count);
+    auto metas = WriteMethodMetas(*fbb, hits, hit_count);
+    fbb->Finish(schema::CreateMethodMetaArrayHolder(*fbb, metas));
+    return fbb;
+}
+
+std::unique_ptr<flatbuffers::FlatBufferBuilder> SerializeFieldHits(const std::vector<DexHits> &hits) {
+    auto hit_count = CountHits(hits);
+    auto fbb = MakeBuilder(hit_count);
+    std::vector<flatbuffers::Offset<schema::FieldMeta>> offsets;
+    offsets.reserve(hit_count);
+    for (auto &[dex, ids]: hits) {
+        for (auto field_idx: ids) {
+            offsets.emplace_back(dex->CreateFieldMeta(*fbb, field_idx));
+        }
+    }
+    fbb->Finish(schema::CreateFieldMetaArrayHolder(*fbb, fbb->CreateVector(offsets)));
+    return fbb;
+}
+
+std::unique_ptr<flatbuffers::FlatBufferBuilder> SerializeBatchClassHits(const BatchDexHits &hits) {
+    size_t hit_count = 0;
+    for (auto &[key, dex_hits]: hits) {
+        hit_count += CountHits(dex_hits);
+    }
+    auto fbb = MakeBuilder(hit_count);
+    std::vector<flatbuffers::Offset<schema::BatchClassMeta>> offsets;
+    offsets.reserve(hits.size());
+    for (auto &[key, dex_hits]: hits) {
+        auto union_key = fbb->CreateString(key);
+        auto metas = WriteClassMetas(*fbb, dex_hits, CountHits(dex_hits));
+        offsets.emplace_back(schema::CreateBatchClassMeta(*fbb, union_key, metas));
+    }
+    fbb->Finish(schema::CreateBatchClassMetaArrayHolder(*fbb, fbb->CreateVector(offsets)));
+    return fbb;
+}
+
+std::unique_ptr<flatbuffers::FlatBufferBuilder> SerializeBatchMethodHits(const BatchDexHits &hits) {
+    size_t hit_count = 0;
+    for (auto &[key, dex_hits]: hits) {
+        hit_count += CountHits(dex_hits);
+    }
+    auto fbb = MakeBuilder(hit_count);
+    std::vector<flatbuffers::Offset<schema::BatchMethodMeta>> offsets;
+    offsets.reserve(hits.size());
+    for (auto &[key, dex_hits]: hits) {
+        auto union_key = fbb->CreateString(key);
+        auto metas = WriteMethodMetas(*fbb, dex_hits, CountHits(dex_hits));
+        offsets.emplace_back(schema::CreateBatchMethodMeta(*fbb, union_key, metas));
+    }
+    fbb->Finish(schema::CreateBatchMethodMetaArrayHolder(*fbb, fbb->CreateVector(offsets)));
+    return fbb;
+}
+
+} // namespace internal
+
+} // namespace dexkit
@@ -0,0 +1,223 @@
+// DexKit - An high-performance runtime parsing library for dex
+// implemented in C++.
+// Copyright (C) 2022-2023 LuckyPray
+// https://github.com/LuckyPray/DexKit
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+// <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+
+
+#include "internal/string_suffix_array.h"
+
+#include <algorithm>
+
+namespace dexkit {
+
+namespace internal {
+
+namespace {
+
+constexpr uint32_t kEmpty = UINT32_MAX;
+constexpr char kSeparator = '\0';
+// sentinel 0, separator 1, bytes from 2
+constexpr uint32_t kTextAlphabetSize = 258;
+
+void GetBuckets(const uint32_t *s, uint32_t n, std::vector<uint32_t> &buckets, bool end) {
+    std::fill(buckets.begin(), buckets.end(), 0);
+    for (uint32_t i = 0; i < n; ++i) {
+        ++buckets[s[i]];
+    }
+    uint32_t sum = 0;
+    for (auto &bucket: buckets) {
+        sum += bucket;
+        bucket = end ? sum : sum - bucket;
+    }
+}
+
+// s_type[i]: suffix i is smaller than suffix i + 1
+inline bool IsLms(const std::vector<bool> &s_type, uint32_t i) {
+    return i > 0 && s_type[i] && !s_type[i - 1];
+}
+
+void InduceSort(const uint32_t *s, uint32_t *sa, uint32_t n, const std::vector<bool> &s_type, std::vector<uint32_t> &buckets) {
+    GetBuckets(s, n, buckets, false);
+    for (uint32_t i = 0; i < n; ++i) {
+        if (sa[i] == kEmpty || sa[i] == 0) continue;
+        auto j = sa[i] - 1;
+        if (!s_type[j]) sa[buckets[s[j]]++] = j;
+    }
+    GetBuckets(s, n, buckets, true);
+    for (uint32_t i = n; i-- > 0;) {
+        if (sa[i] == kEmpty || sa[i] == 0) continue;
+        auto j = sa[i] - 1;
+        if (s_type[j]) sa[--buckets[s[j]]] = j;
+    }
+}
+
+} // namespace
+
+void BuildSuffixArray(const uint32_t *s, uint32_t *sa, uint32_t n, uint32_t k) {
+    if (n == 1) {
+        sa[0] = 0;
+        return;
+    }
+    std::vector<bool> s_type(n);
+    s_type[n - 1] = true;
+    for (uint32_t i = n - 1; i-- > 0;) {
+        s_type[i] = s[i] < s[i + 1] || (s[i] == s[i + 1] && s_type[i + 1]);
+    }
+    std::vector<uint32_t> buckets(k);
+
+    // sort the LMS substrings by inducing from their bucket ends
+    GetBuckets(s, n, buckets, true);
+    std::fill(sa, sa + n, kEmpty);
+    for (uint32_t i = 1; i < n; ++i) {
+        if (IsLms(s_type, i)) sa[--buckets[s[i]]] = i;
+    }
+    InduceSort(s, sa, n, s_type, buckets);
+
+    uint32_t n1 = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        if (IsLms(s_type, sa[i])) sa[n1++] = sa[i];
+    }
+    // name the LMS substrings, equal substrings share a name
+    std::fill(sa + n1, sa + n, kEmpty);
+    uint32_t name = 0, prev = kEmpty;
+    for (uint32_t i = 0; i < n1; ++i) {
+        auto pos = sa[i];
+        bool diff = false;
+        for (uint32_t d = 0;; ++d) {
+            if (prev == kEmpty || s[pos + d] != s[prev + d] || s_type[pos + d] != s_type[prev + d]) {
+                diff = true;
+                break;
+            }
+            if (d > 0 && (IsLms(s_type, pos + d) || IsLms(s_type, prev + d))) {
+                break;
+            }
+        }
+        if (diff) {
+            ++name;
+            prev = pos;
+        }
+        sa[n1 + pos / 2] = name - 1;
+    }
+    for (uint32_t i = n, j = n; i-- > n1;) {
+        if (sa[i] != kEmpty) sa[--j] = sa[i];
+    }
+
+    // sort the reduced string, recursing while names repeat
+    auto s1 = sa + n - n1;
+    if (name < n1) {
+        BuildSuffixArray(s1, sa, n1, name);
+    } else {
+        for (uint32_t i = 0; i < n1; ++i) sa[s1[i]] = i;
+    }
+
+    // induce the full order from the sorted LMS suffixes
+    for (uint32_t i = 1, j = 0; i < n; ++i) {
+        if (IsLms(s_type, i)) s1[j++] = i;
+    }
+    for (uint32_t i = 0; i < n1; ++i) {
+        sa[i] = s1[sa[i]];
+    }
+    std::fill(sa + n1, sa + n, kEmpty);
+    GetBuckets(s, n, buckets, true);
+    for (uint32_t i = n1; i-- > 0;) {
+        auto j = sa[i];
+        sa[i] = kEmpty;
+        sa[--buckets[s[j]]] = j;
+    }
+    InduceSort(s, sa, n, s_type, buckets);
+}
+
+StringSuffixArray::StringSuffixArray(const std::vector<std::string_view> &strings) {
+    size_t text_size = 0;
+    for (auto str: strings) {
+        text_size += str.size() + 1;
+    }
+    text_.reserve(text_size);
+    string_offsets_.reserve(strings.size());
+    for (auto str: strings) {
+        string_offsets_.emplace_back((uint32_t) text_.size());
+        text_.append(str);
+        text_.push_back(kSeparator);
+    }
+
+    auto n = (uint32_t) text_.size() + 1;
+    std::vector<uint32_t> s(n);
+    for (uint32_t i = 0; i + 1 < n; ++i) {
+        s[i] = text_[i] == kSeparator ? 1 : (uint32_t) (uint8_t) text_[i] + 2;
+    }
+    s[n - 1] = 0;
+    std::vector<uint32_t> sa(n);
+    BuildSuffixArray(s.data(), sa.data(), n, kTextAlphabetSize);
+    s.clear();
+    s.shrink_to_fit();
+
+    // suffixes starting with a separator (and the sentinel) sort first
+    auto first = std::find_if(sa.begin(), sa.end(), [this](uint32_t pos) {
+        return pos < text_.size() && text_[pos] != kSeparator;
+    });
+    suffixes_.assign(first, sa.end());
+}
+
+uint32_t StringSuffixArray::GetStringId(uint32_t pos) const {
+    return (uint32_t) (std::upper_bound(string_offsets_.begin(), string_offsets_.end(), pos) - string_offsets_.begin() - 1);
+}
+
+std::optional<std::vector<uint32_t>>
+StringSuffixArray::Match(std::string_view value, schema::StringMatchType match_type) const {
+    if (value.empty() || value.find(kSeparator) != std::string_view::npos) {
+        return std::nullopt;
+    }
+    if (match_type == schema::StringMatchType::SimilarRegex || match_type == schema::StringMatchType::Regex) {
+        return std::nullopt;
+    }
+    std::string_view text = text_;
+    auto first = std::lower_bound(suffixes_.begin(), suffixes_.end(), value, [&](uint32_t pos, std::string_view value) {
+        return text.substr(pos, value.size()) < value;
+    });
+    auto last = std::upper_bound(first, suffixes_.end(), value, [&](std::string_view value, uint32_t pos) {
+        return value < text.substr(pos, value.size());
+    });
+    std::vector<uint32_t> ids;
+    for (auto it = first; it != last; ++it) {
+        auto pos = *it;
+        auto id = GetStringId(pos);
+        bool match = false;
+        switch (match_type) {
+            case schema::StringMatchType::Contains: match = true; break;
+            case schema::StringMatchType::StartWith: match = pos == string_offsets_[id]; break;
+            case schema::StringMatchType::EndWith: match = text[pos + value.size()] == kSeparator; break;
+            case schema::StringMatchType::Equal: match = pos == string_offsets_[id] && text[pos + value.size()] == kSeparator; break;
+            case schema::StringMatchType::SimilarRegex:
+            case schema::StringMatchType::Regex: break;
+        }
+        if (match) ids.emplace_back(id);
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+
+size_t StringSuffixArray::MemoryUsage() const {
+    return text_.capacity()
+           + string_offsets_.capacity() * sizeof(uint32_t)
+           + suffixes_.capacity() * sizeof(uint32_t);
+}
+
+} // namespace internal
+
+} // namespace dexkit
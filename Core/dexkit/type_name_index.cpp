@@ -0,0 +1,158 @@
+// DexKit - An high-performance runtime parsing library for dex
+// implemented in C++.
+// Copyright (C) 2022-2023 LuckyPray
+// https://github.com/LuckyPray/DexKit
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see
+// <https://www.gnu.org/licenses/>.
+// <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+
+
+#include "internal/type_name_index.h"
+
+#include <algorithm>
+#include <span>
+
+#include "internal/regex.h"
+#include "utils/dex_descriptor_util.h"
+
+namespace dexkit {
+
+namespace internal {
+
+namespace {
+
+inline uint8_t ToLowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? (uint8_t) (c + 32) : (uint8_t) c;
+}
+
+inline uint32_t GetTrigram(std::string_view str, size_t pos) {
+    return (uint32_t) ToLowerAscii(str[pos]) << 16 | (uint32_t) ToLowerAscii(str[pos + 1]) << 8 | ToLowerAscii(str[pos + 2]);
+}
+
+} // namespace
+
+TypeNameTrigramIndex::TypeNameTrigramIndex(
+        const std::vector<std::string_view> &type_names,
+        const std::vector<uint8_t> &array_counts
+) {
+    std::vector<uint64_t> entries;
+    std::vector<uint32_t> grams;
+    for (uint32_t type_idx = 0; type_idx < type_names.size(); ++type_idx) {
+        auto name = type_names[type_idx].substr(array_counts[type_idx]);
+        if (name.size() < 3) continue;
+        grams.clear();
+        for (size_t i = 0; i + 3 <= name.size(); ++i) {
+            grams.emplace_back(GetTrigram(name, i));
+        }
+        std::sort(grams.begin(), grams.end());
+        grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+        for (auto gram: grams) {
+            entries.emplace_back((uint64_t) gram << 32 | type_idx);
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+    postings_.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        auto gram = (uint32_t) (entries[i] >> 32);
+        if (keys_.empty() || keys_.back() != gram) {
+            keys_.emplace_back(gram);
+            offsets_.emplace_back(i);
+        }
+        postings_[i] = (uint32_t) entries[i];
+    }
+    offsets_.emplace_back(entries.size());
+}
+
+std::vector<uint32_t> TypeNameTrigramIndex::Find(std::string_view key) const {
+    std::vector<std::span<const uint32_t>> lists;
+    for (size_t i = 0; i + 3 <= key.size(); ++i) {
+        auto gram = GetTrigram(key, i);
+        auto it = std::lower_bound(keys_.begin(), keys_.end(), gram);
+        if (it == keys_.end() || *it != gram) {
+            return {};
+        }
+        auto pos = it - keys_.begin();
+        lists.emplace_back(postings_.data() + offsets_[pos], offsets_[pos + 1] - offsets_[pos]);
+    }
+    std::sort(lists.begin(), lists.end(), [](auto &lhs, auto &rhs) {
+        return lhs.size() < rhs.size();
+    });
+    std::vector<uint32_t> type_ids(lists.front().begin(), lists.front().end());
+    for (size_t i = 1; i < lists.size() && !type_ids.empty(); ++i) {
+        std::erase_if(type_ids, [&](uint32_t type_idx) {
+            return !std::binary_search(lists[i].begin(), lists[i].end(), type_idx);
+        });
+    }
+    return type_ids;
+}
+
+std::optional<std::string> GetTypeNameSearchKey(std::string_view descriptor_fragment) {
+    if (descriptor_fragment.size() < 3) {
+        return std::nullopt;
+    }
+    std::string key(descriptor_fragment.size(), '\0');
+    std::transform(descriptor_fragment.begin(), descriptor_fragment.end(), key.begin(), [](char c) {
+        return (char) ToLowerAscii(c);
+    });
+    return key;
+}
+
+std::optional<std::string> GetTypeNameSearchKey(const schema::StringMatcher *matcher) {
+    if (!matcher || !matcher->value() || matcher->value()->size() == 0) {
+        return std::nullopt;
+    }
+    auto value = matcher->value()->string_view();
+    auto match_type = matcher->match_type();
+    if (match_type == schema::StringMatchType::Regex) {
+        // the regex matches java names, whose class part is the descriptor's with '/' for '.'
+        auto literal = GetCompiledRegex(matcher)->GetLiteral().value;
+        if (literal.find_first_of("[]") != std::string::npos) {
+            return std::nullopt;
+        }
+        std::replace(literal.begin(), literal.end(), '.', '/');
+        return GetTypeNameSearchKey(literal);
+    }
+    // same rewrite as ConvertSimilarRegex
+    if (match_type == schema::StringMatchType::SimilarRegex) {
+        match_type = schema::StringMatchType::Contains;
+        if (value.starts_with('^')) {
+            value = value.substr(1);
+            match_type = schema::StringMatchType::StartWith;
+        }
+        if (value.ends_with('$')) {
+            value = value.substr(0, value.size() - 1);
+            match_type = match_type == schema::StringMatchType::StartWith
+                         ? schema::StringMatchType::Equal
+                         : schema::StringMatchType::EndWith;
+        }
+    }
+    if (match_type == schema::StringMatchType::Equal && !matcher->ignore_case()) {
+        return std::nullopt;
+    }
+    // same descriptor fragment as the TypeNameDescriptor matcher cache of IsTypeNameMatched
+    size_t array_count = 0;
+    auto find_index = value.find_first_of('[');
+    if (find_index != std::string_view::npos) {
+        array_count = (uint8_t) (value.size() - find_index) / 2;
+    }
+    auto name = value.substr(0, value.size() - array_count * 2);
+    bool start_flag = match_type == schema::StringMatchType::StartWith || match_type == schema::StringMatchType::Equal;
+    bool end_flag = match_type == schema::StringMatchType::EndWith || match_type == schema::StringMatchType::Equal;
+    return GetTypeNameSearchKey(NameToDescriptor(name, start_flag, end_flag));
+}
+
+} // namespace internal
+
+} // namespace dexkit
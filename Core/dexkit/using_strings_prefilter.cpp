@@ -19,6 +19,8 @@
 // <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
 
 #include "dex_item.h"
+#include "internal/literal_prefilter.h"
+#include "internal/regex.h"
 #include "internal/using_strings_prefilter.h"
 
 #include <bit>
@@ -55,6 +57,8 @@ struct UsingStringsPrefilterPlan {
     AcTrie ignore_case_trie;
     phmap::flat_hash_map<std::string_view, uint64_t> case_sensitive_keyword_masks;
     phmap::flat_hash_map<std::string_view, uint64_t> ignore_case_keyword_masks;
+    // over the values of both tries, strings it rejects skip them
+    MultiLiteralPrefilter literal_prefilter;
     uint64_t all_atom_mask = 0;
     uint64_t empty_equal_atom_mask = 0;
     int root_node_index = -1;
@@ -129,6 +133,13 @@ uint64_t TryAddPrefilterAtomBit(
 
     auto value = matcher->value()->string_view();
     auto match_type = matcher->match_type();
+    std::shared_ptr<const Regex> regex;
+    if (match_type == schema::StringMatchType::Regex) {
+        // any string the regex matches also matches its required literal
+        regex = GetCompiledRegex(matcher);
+        value = regex->GetLiteral().value;
+        match_type = regex->GetLiteral().match_type;
+    }
     NormalizeStringMatcherValue(value, match_type);
 
     if (value.empty() && match_type != schema::StringMatchType::Equal) {
@@ -275,13 +286,16 @@ UsingStringsPrefilterPlan BuildUsingStringsPrefilterPlan(const Matcher *matcher)
 
     std::vector<std::pair<std::string_view, bool>> case_sensitive_keywords;
     std::vector<std::pair<std::string_view, bool>> ignore_case_keywords;
+    std::vector<std::string_view> literals;
     case_sensitive_keywords.reserve(plan.atoms.size());
     ignore_case_keywords.reserve(plan.atoms.size());
+    literals.reserve(plan.atoms.size());
     for (const auto &atom: plan.atoms) {
         if (atom.value.empty()) {
             continue;
         }
         auto keyword = std::string_view(atom.value);
+        literals.emplace_back(keyword);
         if (atom.ignore_case) {
             ignore_case_keywords.emplace_back(keyword, true);
             plan.ignore_case_keyword_masks[keyword] |= atom.bit;
@@ -296,6 +310,7 @@ UsingStringsPrefilterPlan BuildUsingStringsPrefilterPlan(const Matcher *matcher)
     if (!ignore_case_keywords.empty()) {
         acdat::Builder<std::string_view>().Build(ignore_case_keywords, &plan.ignore_case_trie);
     }
+    plan.literal_prefilter = MultiLiteralPrefilter(literals);
     return plan;
 }
 
@@ -347,39 +362,41 @@ bool EvaluateUsingStringsPrefilterNode(
 
 void AccumulateUsingStringsPrefilterMatches(
         std::string_view str,
-        acdat::AhoCorasickDoubleArrayTrie<std::string_view> &trie,
+        const acdat::AhoCorasickDoubleArrayTrie<std::string_view> &trie,
         const phmap::flat_hash_map<std::string_view, uint64_t> &keyword_masks,
         const std::vector<UsingStringsPrefilterAtom> &atoms,
+        uint64_t trie_atom_mask,
         uint64_t &matched_bits
 ) {
     if (keyword_masks.empty()) {
         return;
     }
-    std::function<void(int, int, std::string_view)> callback =
-            [&](int begin, int end, std::string_view keyword) {
-                auto it = keyword_masks.find(keyword);
-                if (it == keyword_masks.end()) {
-                    return;
-                }
-                auto remaining = it->second & ~matched_bits;
-                while (remaining != 0) {
-                    auto atom_index = static_cast<size_t>(std::countr_zero(remaining));
-                    auto &atom = atoms[atom_index];
-                    bool match = false;
-                    switch (atom.match_type) {
-                        case schema::StringMatchType::Contains: match = true; break;
-                        case schema::StringMatchType::StartWith: match = (begin == 0); break;
-                        case schema::StringMatchType::EndWith: match = (end == str.size()); break;
-                        case schema::StringMatchType::Equal: match = (begin == 0 && end == str.size()); break;
-                        case schema::StringMatchType::SimilarRegex: abort();
-                    }
-                    if (match) {
-                        matched_bits |= atom.bit;
-                    }
-                    remaining &= (remaining - 1);
-                }
-            };
-    trie.ParseText(str, callback);
+    trie.Scan(str, [&](int begin, int end, std::string_view keyword) {
+        auto it = keyword_masks.find(keyword);
+        if (it == keyword_masks.end()) {
+            return true;
+        }
+        auto remaining = it->second & ~matched_bits;
+        while (remaining != 0) {
+            auto atom_index = static_cast<size_t>(std::countr_zero(remaining));
+            auto &atom = atoms[atom_index];
+            bool match = false;
+            switch (atom.match_type) {
+                case schema::StringMatchType::Contains: match = true; break;
+                case schema::StringMatchType::StartWith: match = (begin == 0); break;
+                case schema::StringMatchType::EndWith: match = (end == str.size()); break;
+                case schema::StringMatchType::Equal: match = (begin == 0 && end == str.size()); break;
+                case schema::StringMatchType::SimilarRegex:
+                case schema::StringMatchType::Regex: abort();
+            }
+            if (match) {
+                matched_bits |= atom.bit;
+            }
+            remaining &= (remaining - 1);
+        }
+        // nothing left for the tries to find
+        return (matched_bits & trie_atom_mask) != trie_atom_mask;
+    });
 }
 
 template<typename EnumerateStringsFn>
@@ -389,16 +406,21 @@ bool MayMatchUsingStringsPrefilter(
 ) {
     uint64_t matched_bits = 0;
     bool has_empty_string = false;
+    auto trie_atom_mask = plan.all_atom_mask & ~plan.empty_equal_atom_mask;
 
     auto visit_string = [&](std::string_view str) {
         if (str.empty()) {
             has_empty_string = true;
         }
+        if (!plan.literal_prefilter.MayContain(str)) {
+            return false;
+        }
         AccumulateUsingStringsPrefilterMatches(
                 str,
                 plan.case_sensitive_trie,
                 plan.case_sensitive_keyword_masks,
                 plan.atoms,
+                trie_atom_mask,
                 matched_bits
         );
         AccumulateUsingStringsPrefilterMatches(
@@ -406,6 +428,7 @@ bool MayMatchUsingStringsPrefilter(
                 plan.ignore_case_trie,
                 plan.ignore_case_keyword_masks,
                 plan.atoms,
+                trie_atom_mask,
                 matched_bits
         );
         return EvaluateUsingStringsPrefilterNode(plan, plan.root_node_index, matched_bits);
@@ -460,7 +483,7 @@ bool DexItem::MayMatchClassUsingStringsPrefilter(
     DexItem *scan_dex = this;
     auto scan_type_idx = type_idx;
     if (!scan_dex->type_def_flag[scan_type_idx]) {
-        auto [declared_dex, declared_type_idx] = this->dexkit->GetClassDeclaredPair(this->type_names[type_idx]);
+        auto [declared_dex, declared_type_idx] = this->dexkit->GetClassDeclaredPair(this->type_names[type_idx], this);
         if (declared_dex == nullptr) {
             return false;
         }
@@ -34,6 +34,15 @@ public:
 
     void ParseText(std::string_view text, std::function<void(int, int, V)> &callback, bool ignoreCase = false);
 
+    /**
+     * allocation free ParseText, visitor(begin, end, value) is inlined into the walk
+     *
+     * @param visitor returns false to stop the scan
+     * @return false when the visitor stopped the scan
+     */
+    template<typename Visitor>
+    bool Scan(std::string_view text, Visitor &&visitor, bool ignoreCase = false) const;
+
 //    void ParseText(std::string_view text, std::function<bool(int, int, V)> callback, bool ignoreCase = false);
 
     bool Matches(std::string_view text, bool ignoreCase = false);
@@ -73,7 +82,7 @@ private:
      * @param character
      * @return
      */
-    int GetState(int currentState, uint8_t c);
+    int GetState(int currentState, uint8_t c) const;
 
     void StoreEmits(std::string_view, int position, int currentState, bool ignoreCase, std::vector<Hit<V>> &collectedEmits);
 
@@ -84,7 +93,7 @@ private:
 protected:
     int Transition(int current, uint8_t c);
 
-    int TransitionWithRoot(int nodePos, uint8_t c);
+    int TransitionWithRoot(int nodePos, uint8_t c) const;
 };
 
 template<typename V>
@@ -110,11 +119,10 @@ void AhoCorasickDoubleArrayTrie<V>::ParseText(std::string_view text, std::functi
     const char *p = text.data();
     while (text_len-- > 0) {
         currentState = GetState(currentState, *p++);
-        auto hitArray = output[currentState];
+        const auto &hitArray = output[currentState];
         if (!hitArray.empty()) {
-            for (int &hit: hitArray) {
-                auto vec = v[hit];
-                for (auto &[item, itemIgnore]: vec) {
+            for (int hit: hitArray) {
+                for (auto &[item, itemIgnore]: v[hit]) {
                     if (itemIgnore || ignoreCase || item == std::string_view(text.substr(position - l[hit], l[hit]))) {
                         callback(position - l[hit], position, item);
                     }
@@ -125,6 +133,34 @@ void AhoCorasickDoubleArrayTrie<V>::ParseText(std::string_view text, std::functi
     }
 }
 
+template<typename V>
+template<typename Visitor>
+bool AhoCorasickDoubleArrayTrie<V>::Scan(std::string_view text, Visitor &&visitor, bool ignoreCase) const {
+    if (base.empty()) {
+        return true;
+    }
+    int position = 1;
+    int currentState = 0;
+    int text_len = (int) text.length();
+    const char *p = text.data();
+    while (text_len-- > 0) {
+        currentState = GetState(currentState, *p++);
+        const auto &hitArray = output[currentState];
+        for (int hit: hitArray) {
+            int begin = position - l[hit];
+            for (auto &[item, itemIgnore]: v[hit]) {
+                if (itemIgnore || ignoreCase || item == text.substr(begin, l[hit])) {
+                    if (!visitor(begin, position, item)) {
+                        return false;
+                    }
+                }
+            }
+        }
+        ++position;
+    }
+    return true;
+}
+
 //template<typename V>
 //void AhoCorasickDoubleArrayTrie<V>::ParseText(std::string_view text, std::function<bool(int, int, V)> callback, bool ignoreCase) {
 //    int position = 1;
@@ -190,7 +226,7 @@ Hit<V> AhoCorasickDoubleArrayTrie<V>::FindFirst(std::string_view text, bool igno
 }
 
 template<typename V>
-int AhoCorasickDoubleArrayTrie<V>::GetState(int currentState, uint8_t ch) {
+int AhoCorasickDoubleArrayTrie<V>::GetState(int currentState, uint8_t ch) const {
     int newCurrentState = TransitionWithRoot(currentState, ch);  // 先按success跳转
     while (newCurrentState == -1) // 跳转失败的话，按failure跳转
     {
@@ -225,11 +261,10 @@ bool AhoCorasickDoubleArrayTrie<V>::Set(const char *key, std::vector<V> value) {
 
 template<typename V>
 void AhoCorasickDoubleArrayTrie<V>::StoreEmits(std::string_view text, int position, int currentState, bool ignoreCase, std::vector<Hit<V>> &collectedEmits) {
-    auto hitArray = output[currentState];
+    const auto &hitArray = output[currentState];
     if (!hitArray.empty()) {
-        for (int &hit: hitArray) {
-            auto vec = v[hit];
-            for (auto &[item, itemIgnore]: vec) {
+        for (int hit: hitArray) {
+            for (auto &[item, itemIgnore]: v[hit]) {
                 if (itemIgnore || ignoreCase || item == std::string_view(text.substr(position - l[hit], l[hit]))) {
                     collectedEmits.push_back(Hit<V>(position - l[hit], position, item));
                 }
@@ -256,7 +291,7 @@ int AhoCorasickDoubleArrayTrie<V>::Transition(int current, uint8_t c) {
 }
 
 template<typename V>
-int AhoCorasickDoubleArrayTrie<V>::TransitionWithRoot(int nodePos, uint8_t c) {
+int AhoCorasickDoubleArrayTrie<V>::TransitionWithRoot(int nodePos, uint8_t c) const {
     c = c >= 'A' && c <= 'Z' ? c + 32 : c;
     int b = base[nodePos];
     int p;
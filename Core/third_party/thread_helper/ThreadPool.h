@@ -40,57 +40,98 @@ public:
     auto enqueue(F &&f, Args &&... args)
     -> std::future<typename std::invoke_result<F, Args...>::type>;
 
+    // tasks on the priority lane are picked before any queued normal task
+    template<class F, class... Args>
+    auto enqueue_priority(F &&f, Args &&... args)
+    -> std::future<typename std::invoke_result<F, Args...>::type>;
+
+    [[nodiscard]] size_t size() const { return workers.size(); }
+
     ~ThreadPool();
 
 private:
+    // shared with the workers so that a worker can outlive the pool, see ~ThreadPool
+    struct State {
+        // the task queues
+        std::queue<std::function<void()> > tasks;
+        std::queue<std::function<void()> > priority_tasks;
+        // synchronization
+        std::mutex queue_mutex;
+        std::condition_variable condition;
+        bool stop = false;
+        std::thread::id detached_worker;
+    };
+
+    template<class F, class... Args>
+    auto enqueue_task(bool priority, F &&f, Args &&... args)
+    -> std::future<typename std::invoke_result<F, Args...>::type>;
+
     // need to keep track of threads so we can join them
     std::vector<std::thread> workers;
-    // the task queue
-    std::queue<std::function<void()> > tasks;
-    // synchronization
-    std::mutex queue_mutex;
-    std::condition_variable condition;
-    bool stop;
+    std::shared_ptr<State> state;
     std::function<bool()> should_skip_task;
     std::vector<std::thread::id> _thread_ids;
 };
 
 // the constructor just launches some amount of workers
 inline ThreadPool::ThreadPool(size_t threads, std::function<bool()> should_skip_task)
-        : stop(false), should_skip_task(std::move(should_skip_task)) {
+        : state(std::make_shared<State>()), should_skip_task(std::move(should_skip_task)) {
     workers.reserve(threads);
     _thread_ids.resize(threads);
     for (size_t i = 0; i < threads; ++i)
         workers.emplace_back(
-                [this, i] {
-                    this->_thread_ids[i] = std::this_thread::get_id();
+                [state = this->state] {
                     for (;;) {
                         std::function<void()> task;
 
                         {
-                            std::unique_lock lock(this->queue_mutex);
-                            this->condition.wait(lock, [this] { return this->stop || !this->tasks.empty(); });
-                            if (this->stop && this->tasks.empty())
+                            std::unique_lock lock(state->queue_mutex);
+                            state->condition.wait(lock, [&state] {
+                                return state->stop || !state->priority_tasks.empty() || !state->tasks.empty();
+                            });
+                            if (!state->priority_tasks.empty()) {
+                                task = std::move(state->priority_tasks.front());
+                                state->priority_tasks.pop();
+                            } else if (!state->tasks.empty()) {
+                                task = std::move(state->tasks.front());
+                                state->tasks.pop();
+                            } else {
+                                if (state->detached_worker == std::this_thread::get_id())
+                                    dexkit::ReleaseMatcherThreadLocalCaches({state->detached_worker});
                                 return;
-                            task = std::move(this->tasks.front());
-                            this->tasks.pop();
+                            }
                         }
 
                         task();
                     }
                 }
         );
+    for (size_t i = 0; i < threads; ++i)
+        _thread_ids[i] = workers[i].get_id();
 }
 
 // add new work item to the pool
 template<class F, class... Args>
 auto ThreadPool::enqueue(F &&f, Args &&... args)
+-> std::future<typename std::invoke_result<F, Args...>::type> {
+    return enqueue_task(false, std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+template<class F, class... Args>
+auto ThreadPool::enqueue_priority(F &&f, Args &&... args)
+-> std::future<typename std::invoke_result<F, Args...>::type> {
+    return enqueue_task(true, std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+template<class F, class... Args>
+auto ThreadPool::enqueue_task(bool priority, F &&f, Args &&... args)
 -> std::future<typename std::invoke_result<F, Args...>::type> {
     using return_type = typename std::invoke_result<F, Args...>::type;
 
     auto task = std::make_shared<std::packaged_task<return_type()> >(
-            [f = std::forward<F>(f), args = std::make_tuple(std::forward<Args>(args)...), this]() mutable {
-                if (this->should_skip_task && this->should_skip_task()) {
+            [f = std::forward<F>(f), args = std::make_tuple(std::forward<Args>(args)...),
+             should_skip_task = this->should_skip_task]() mutable {
+                if (should_skip_task && should_skip_task()) {
                     if constexpr (std::is_same_v<return_type, void>) return;
                     return return_type();
                 }
@@ -100,29 +141,40 @@ auto ThreadPool::enqueue(F &&f, Args &&... args)
 
     std::future<return_type> res = task->get_future();
     {
-        std::unique_lock lock(queue_mutex);
+        std::unique_lock lock(state->queue_mutex);
 
         // don't allow enqueueing after stopping the pool
-        if (stop)
+        if (state->stop)
             abort();
 //            throw std::runtime_error("enqueue on stopped thread_pool");
 
-        tasks.emplace([task]() {
+        (priority ? state->priority_tasks : state->tasks).emplace([task]() {
             (*task)();
         });
     }
-    condition.notify_one();
+    state->condition.notify_one();
     return res;
 }
 
 // the destructor joins all threads
 inline ThreadPool::~ThreadPool() {
+    // the last owner of a long-lived pool can be released by a task running on the pool itself,
+    // that worker can't join itself, it is detached and exits on its own once the queues are drained
+    auto self_id = std::this_thread::get_id();
     {
-        std::unique_lock lock(queue_mutex);
-        stop = true;
+        std::unique_lock lock(state->queue_mutex);
+        state->stop = true;
+        for (auto &worker: workers)
+            if (worker.get_id() == self_id)
+                state->detached_worker = self_id;
+    }
+    state->condition.notify_all();
+    for (std::thread &worker: workers) {
+        if (worker.get_id() == self_id)
+            worker.detach();
+        else
+            worker.join();
     }
-    condition.notify_all();
-    for (std::thread &worker: workers)
-        worker.join();
+    std::erase(_thread_ids, state->detached_worker);
     dexkit::ReleaseMatcherThreadLocalCaches(_thread_ids);
 }
@@ -2,6 +2,7 @@ package org.luckypray.dexkit
 
 import org.junit.Test
 import org.luckypray.dexkit.annotations.DexKitExperimentalApi
+import org.luckypray.dexkit.query.enums.QueryPriority
 import java.io.File
 import java.util.concurrent.CountDownLatch
 import java.util.concurrent.Executors
@@ -72,6 +73,7 @@ class UnitMetricsTest {
             assert(metrics.maxTotalInFlight > 0)
             assert(metrics.maxVisibleQueryShareCount >= 2)
             assert(metrics.shareCountSyncs > 0)
+            assert(metrics.shareCountChanges in 1..metrics.shareCountSyncs)
         }
     }
 
@@ -102,6 +104,7 @@ class UnitMetricsTest {
             assert(afterReset.baseDispatchedTasks == 0L)
             assert(afterReset.bonusDispatchedTasks == 0L)
             assert(afterReset.shareCountSyncs == 0L)
+            assert(afterReset.shareCountChanges == 0L)
             assert(afterReset.maxTotalInFlight == 0L)
             assert(afterReset.maxVisibleQueryShareCount == 0L)
             assert(afterReset.maxRunnableQueueSize == 0L)
@@ -141,6 +144,8 @@ class UnitMetricsTest {
             assert(metrics.submissionCompletedNs >= metrics.preprocessCompletedNs)
             assert(metrics.workersCompletedNs >= metrics.submissionCompletedNs)
             assert(metrics.completedNs >= metrics.workersCompletedNs)
+            assert(metrics.scanChunks > 0)
+            assert(metrics.maxScanChunkItems > 0)
         }
     }
 
@@ -734,4 +739,154 @@ class UnitMetricsTest {
             assert(afterReset.records.isEmpty())
         }
     }
+
+    @OptIn(DexKitExperimentalApi::class)
+    @Test
+    fun testPriorityClassesOnSharedScheduler() {
+        DexKitBridge.create(demoApkPath).use { parallelBridge ->
+            parallelBridge.setThreadNum(2)
+            parallelBridge.setMaxConcurrentQueries(3)
+            parallelBridge.setQueryMetricsEnabled(true)
+            parallelBridge.resetQueryMetricsHistory()
+
+            val priorities = listOf(
+                QueryPriority.Background to 1,
+                QueryPriority.Normal to 4,
+                QueryPriority.LatencySensitive to 1,
+            )
+            val start = CountDownLatch(1)
+            val executor = Executors.newFixedThreadPool(priorities.size)
+            try {
+                val futures = priorities.map { (priority, weight) ->
+                    executor.submit<Unit> {
+                        start.await(10, TimeUnit.SECONDS)
+                        val result = parallelBridge.findMethod {
+                            priority(priority)
+                            weight(weight)
+                            excludePackages("org.luckypray.dexkit.demo.hook")
+                            matcher {
+                                usingNumbers(114514)
+                            }
+                        }
+                        assert(result.size == 2)
+                    }
+                }
+                start.countDown()
+                futures.forEach { it.get(60, TimeUnit.SECONDS) }
+            } finally {
+                executor.shutdownNow()
+            }
+
+            val history = parallelBridge.getQueryMetricsHistorySnapshot()
+            println(history)
+            assert(history.records.size == priorities.size)
+
+            val recordsByPriority = history.records.associateBy { it.priority }
+            assert(recordsByPriority.keys == QueryMetricsPriority.values().toSet())
+            history.records.forEach { record ->
+                assert(record.metrics.completedTasks == record.metrics.submittedTasks)
+                assert(record.metrics.baseDispatchedTasks > 0)
+                assert(record.metrics.maxInFlight <= 2L)
+            }
+            // bonus dispatches are reserved for the latency-sensitive class
+            assert(recordsByPriority.getValue(QueryMetricsPriority.BACKGROUND).metrics.bonusDispatchedTasks == 0L)
+            assert(recordsByPriority.getValue(QueryMetricsPriority.NORMAL).metrics.bonusDispatchedTasks == 0L)
+        }
+    }
+
+    @OptIn(DexKitExperimentalApi::class)
+    private fun runNormalAndLatencySensitiveQueries(parallelBridge: DexKitBridge) {
+        val start = CountDownLatch(1)
+        val executor = Executors.newFixedThreadPool(2)
+        try {
+            val futures = listOf(
+                executor.submit<Unit> {
+                    start.await(10, TimeUnit.SECONDS)
+                    val result = parallelBridge.findMethod {
+                        excludePackages("org.luckypray.dexkit.demo.hook")
+                        matcher {
+                            usingNumbers(114514)
+                        }
+                    }
+                    assert(result.size == 2)
+                },
+                executor.submit<Unit> {
+                    start.await(10, TimeUnit.SECONDS)
+                    val result = parallelBridge.findMethod {
+                        findFirst = true
+                        excludePackages("org.luckypray.dexkit.demo.hook")
+                        matcher {
+                            usingNumbers(114514)
+                        }
+                    }
+                    assert(result.size == 1)
+                }
+            )
+            start.countDown()
+            futures.forEach { it.get(60, TimeUnit.SECONDS) }
+        } finally {
+            executor.shutdownNow()
+        }
+    }
+
+    @OptIn(DexKitExperimentalApi::class)
+    @Test
+    fun testSchedulerBaseAndBonusBudgets() {
+        DexKitBridge.create(demoApkPath).use { parallelBridge ->
+            parallelBridge.setThreadNum(2)
+            parallelBridge.setMaxConcurrentQueries(2)
+            parallelBridge.setQueryMetricsEnabled(true)
+
+            // a query running alone owns every worker, there is no share to add a bonus to
+            parallelBridge.resetSchedulerMetrics()
+            parallelBridge.resetQueryMetricsHistory()
+            val result = parallelBridge.findMethod {
+                findFirst = true
+                excludePackages("org.luckypray.dexkit.demo.hook")
+                matcher {
+                    usingNumbers(114514)
+                }
+            }
+            assert(result.size == 1)
+            val alone = parallelBridge.getSchedulerMetricsSnapshot()
+            assert(alone.dispatchedTasks > 0)
+            assert(alone.bonusDispatchedTasks == 0L)
+            assert(alone.baseDispatchedTasks == alone.dispatchedTasks)
+            assert(alone.maxTotalInFlight <= 2L)
+
+            // only latency-sensitive queries receive bonus dispatches, never over the workers
+            parallelBridge.resetSchedulerMetrics()
+            parallelBridge.resetQueryMetricsHistory()
+            runNormalAndLatencySensitiveQueries(parallelBridge)
+            val shared = parallelBridge.getSchedulerMetricsSnapshot()
+            val history = parallelBridge.getQueryMetricsHistorySnapshot()
+            println(shared)
+            println(history)
+            assert(history.records.size == 2)
+            assert(shared.baseDispatchedTasks + shared.bonusDispatchedTasks == shared.dispatchedTasks)
+            assert(shared.maxTotalInFlight <= 2L)
+            history.records.forEach { record ->
+                assert(record.metrics.maxInFlight <= 2L)
+                if (record.priority != QueryMetricsPriority.LATENCY_SENSITIVE) {
+                    assert(record.metrics.bonusDispatchedTasks == 0L)
+                }
+            }
+            assert(history.records.sumOf { it.metrics.bonusDispatchedTasks } == shared.bonusDispatchedTasks)
+
+            // with a single worker the base share already covers all of it, so no bonus either
+            parallelBridge.setThreadNum(1)
+            parallelBridge.resetSchedulerMetrics()
+            parallelBridge.resetQueryMetricsHistory()
+            runNormalAndLatencySensitiveQueries(parallelBridge)
+            val single = parallelBridge.getSchedulerMetricsSnapshot()
+            println(single)
+            assert(single.dispatchedTasks > 0)
+            assert(single.bonusDispatchedTasks == 0L)
+            assert(single.maxTotalInFlight == 1L)
+            parallelBridge.getQueryMetricsHistorySnapshot().records.forEach { record ->
+                assert(record.metrics.bonusDispatchedTasks == 0L)
+                assert(record.metrics.baseDispatchedTasks == record.metrics.dispatchedTasks)
+            }
+        }
+    }
 }
@@ -57,9 +57,11 @@ data class QueryMetricsSnapshot(
     val submissionCompletedNs: Long,
     val workersCompletedNs: Long,
     val completedNs: Long,
+    val scanChunks: Long,
+    val maxScanChunkItems: Long,
 ) {
     internal companion object {
-        const val NATIVE_SIZE = 17
+        const val NATIVE_SIZE = 19
 
         fun fromNative(values: LongArray): QueryMetricsSnapshot {
             require(values.size == NATIVE_SIZE) {
@@ -90,6 +92,8 @@ data class QueryMetricsSnapshot(
                 submissionCompletedNs = values[offset + 14],
                 workersCompletedNs = values[offset + 15],
                 completedNs = values[offset + 16],
+                scanChunks = values[offset + 17],
+                maxScanChunkItems = values[offset + 18],
             )
         }
     }
@@ -171,6 +175,7 @@ enum class QueryMetricsKind(internal val nativeValue: Long) {
 enum class QueryMetricsPriority(internal val nativeValue: Long) {
     NORMAL(0),
     LATENCY_SENSITIVE(1),
+    BACKGROUND(2),
     ;
 
     internal companion object {
@@ -185,8 +190,6 @@ enum class QueryMetricsPriority(internal val nativeValue: Long) {
 data class SchedulerMetricsSnapshot(
     val shareCountSyncs: Long,
     val shareCountChanges: Long,
-    val budgetRebalances: Long,
-    val runnableQueueRebuilds: Long,
     val refillRounds: Long,
     val dispatchedTasks: Long,
     val baseDispatchedTasks: Long,
@@ -196,7 +199,7 @@ data class SchedulerMetricsSnapshot(
     val maxRunnableQueueSize: Long,
 ) {
     internal companion object {
-        const val NATIVE_SIZE = 11
+        const val NATIVE_SIZE = 9
 
         fun fromNative(values: LongArray): SchedulerMetricsSnapshot {
             require(values.size == NATIVE_SIZE) {
@@ -205,15 +208,13 @@ data class SchedulerMetricsSnapshot(
             return SchedulerMetricsSnapshot(
                 shareCountSyncs = values[0],
                 shareCountChanges = values[1],
-                budgetRebalances = values[2],
-                runnableQueueRebuilds = values[3],
-                refillRounds = values[4],
-                dispatchedTasks = values[5],
-                baseDispatchedTasks = values[6],
-                bonusDispatchedTasks = values[7],
-                maxTotalInFlight = values[8],
-                maxVisibleQueryShareCount = values[9],
-                maxRunnableQueueSize = values[10],
+                refillRounds = values[2],
+                dispatchedTasks = values[3],
+                baseDispatchedTasks = values[4],
+                bonusDispatchedTasks = values[5],
+                maxTotalInFlight = values[6],
+                maxVisibleQueryShareCount = values[7],
+                maxRunnableQueueSize = values[8],
             )
         }
     }
@@ -22,22 +22,20 @@ DEXKIT_JNI jlongArray
 Java_org_luckypray_dexkit_InternalMetricsBridge_nativeGetSchedulerMetrics(JNIEnv *env, jclass clazz,
                                                                           jlong native_ptr
 ) {
-    constexpr jsize kSchedulerMetricCount = 11;
+    constexpr jsize kSchedulerMetricCount = 9;
     jlong values[kSchedulerMetricCount] = {};
     if (native_ptr) {
         auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
         auto snapshot = dexkit->GetQuerySchedulerMetricsSnapshot();
         values[0] = static_cast<jlong>(snapshot.share_count_syncs);
         values[1] = static_cast<jlong>(snapshot.share_count_changes);
-        values[2] = static_cast<jlong>(snapshot.budget_rebalances);
-        values[3] = static_cast<jlong>(snapshot.runnable_queue_rebuilds);
-        values[4] = static_cast<jlong>(snapshot.refill_rounds);
-        values[5] = static_cast<jlong>(snapshot.dispatched_tasks);
-        values[6] = static_cast<jlong>(snapshot.base_dispatched_tasks);
-        values[7] = static_cast<jlong>(snapshot.bonus_dispatched_tasks);
-        values[8] = static_cast<jlong>(snapshot.max_total_in_flight);
-        values[9] = static_cast<jlong>(snapshot.max_visible_query_share_count);
-        values[10] = static_cast<jlong>(snapshot.max_runnable_queue_size);
+        values[2] = static_cast<jlong>(snapshot.refill_rounds);
+        values[3] = static_cast<jlong>(snapshot.dispatched_tasks);
+        values[4] = static_cast<jlong>(snapshot.base_dispatched_tasks);
+        values[5] = static_cast<jlong>(snapshot.bonus_dispatched_tasks);
+        values[6] = static_cast<jlong>(snapshot.max_total_in_flight);
+        values[7] = static_cast<jlong>(snapshot.max_visible_query_share_count);
+        values[8] = static_cast<jlong>(snapshot.max_runnable_queue_size);
     }
     auto ret = env->NewLongArray(kSchedulerMetricCount);
     if (ret != nullptr) {
@@ -50,7 +48,7 @@ DEXKIT_JNI jlongArray
 Java_org_luckypray_dexkit_InternalMetricsBridge_nativeGetLastQueryMetrics(JNIEnv *env, jclass clazz,
                                                                           jlong native_ptr
 ) {
-    constexpr jsize kQueryMetricCount = 17;
+    constexpr jsize kQueryMetricCount = 19;
     jlong values[kQueryMetricCount] = {};
     if (native_ptr) {
         auto snapshot = dexkit::DexKit::GetLastQueryMetricsSnapshot();
@@ -71,6 +69,8 @@ Java_org_luckypray_dexkit_InternalMetricsBridge_nativeGetLastQueryMetrics(JNIEnv
         values[14] = static_cast<jlong>(snapshot.submission_completed_ns);
         values[15] = static_cast<jlong>(snapshot.workers_completed_ns);
         values[16] = static_cast<jlong>(snapshot.completed_ns);
+        values[17] = static_cast<jlong>(snapshot.scan_chunks);
+        values[18] = static_cast<jlong>(snapshot.max_scan_chunk_items);
     }
     auto ret = env->NewLongArray(kQueryMetricCount);
     if (ret != nullptr) {
@@ -83,7 +83,7 @@ DEXKIT_JNI jlongArray
 Java_org_luckypray_dexkit_InternalMetricsBridge_nativeGetQueryMetricsHistory(JNIEnv *env, jclass clazz,
                                                                              jlong native_ptr
 ) {
-    constexpr jsize kQueryMetricCount = 17;
+    constexpr jsize kQueryMetricCount = 19;
     constexpr jsize kQueryMetricsHistoryHeaderSize = 2;
     constexpr jsize kQueryMetricsHistoryRecordStride = 2 + kQueryMetricCount;
 
@@ -116,6 +116,8 @@ Java_org_luckypray_dexkit_InternalMetricsBridge_nativeGetQueryMetricsHistory(JNI
             values[offset++] = static_cast<jlong>(record.metrics.submission_completed_ns);
             values[offset++] = static_cast<jlong>(record.metrics.workers_completed_ns);
             values[offset++] = static_cast<jlong>(record.metrics.completed_ns);
+            values[offset++] = static_cast<jlong>(record.metrics.scan_chunks);
+            values[offset++] = static_cast<jlong>(record.metrics.max_scan_chunk_items);
         }
     }
     auto ret = env->NewLongArray(static_cast<jsize>(values.size()));
@@ -20,6 +20,7 @@
 
 #include <jni.h>
 #include "dexkit.h"
+#include "dex_verifier.h"
 #include "jni_helper.h"
 
 #define TAG "DexKit"
@@ -54,6 +55,27 @@ const T *From(const void *buf) {
     return ::flatbuffers::GetRoot<T>(buf);
 }
 
+// scheduling fields travel inside the serialized query, Default keeps DexKit's choice
+template<typename Query>
+dexkit::QueryOptions GetQueryOptions(const Query *query) {
+    dexkit::QueryOptions options;
+    switch (query->priority()) {
+        case dexkit::schema::QueryPriority::Background:
+            options.priority = dexkit::QueryPriority::Background;
+            break;
+        case dexkit::schema::QueryPriority::Normal:
+            options.priority = dexkit::QueryPriority::Normal;
+            break;
+        case dexkit::schema::QueryPriority::LatencySensitive:
+            options.priority = dexkit::QueryPriority::LatencySensitive;
+            break;
+        default:
+            break;
+    }
+    options.weight = query->weight();
+    return options;
+}
+
 using dexkit::Error;
 
 void throwException(JNIEnv *env, const char *msg) {
@@ -141,7 +163,8 @@ void init(JNIEnv *env) {
 DEXKIT_JNI jlong
 Java_org_luckypray_dexkit_DexKitBridge_nativeInitDexKitByClassLoader(JNIEnv *env, jclass clazz,
                                                                      jobject class_loader,
-                                                                     jboolean use_memory_dex_file) {
+                                                                     jboolean use_memory_dex_file,
+                                                                     jboolean verify_dex) {
     if (!class_loader) {
         return 0;
     }
@@ -154,6 +177,7 @@ Java_org_luckypray_dexkit_DexKitBridge_nativeInitDexKitByClassLoader(JNIEnv *env
         return 0;
     LOGD("elements size -> %d", env->GetArrayLength(elements));
     auto dexkit = new dexkit::DexKit();
+    dexkit->SetDexVerifyEnabled(verify_dex);
     for (auto i = 0, len = env->GetArrayLength(elements); i < len; ++i) {
         auto element = env->GetObjectArrayElement(elements, i);
         if (!element) continue;
@@ -179,7 +203,6 @@ Java_org_luckypray_dexkit_DexKitBridge_nativeInitDexKitByClassLoader(JNIEnv *env
                 // in a14-r29+ size_ is unused
                 auto header = reinterpret_cast<const struct dex::Header *>(dex_file->begin_);
                 if (dex_file->size_ && dex_file->size_ != header->file_size) {
-                    // TODO dex verify
                     LOGD("dex_file %d is invalid", j);
                     continue;
                 }
@@ -188,6 +211,10 @@ Java_org_luckypray_dexkit_DexKitBridge_nativeInitDexKitByClassLoader(JNIEnv *env
                     dex_images.clear();
                     has_compact = true;
                     break;
+                } else if (dexkit->IsDexVerifyEnabled()
+                           && !dexkit::VerifyDexHeader(static_cast<const uint8_t *>(dex_file->begin_), header->file_size, 0)) {
+                    LOGD("dex_file %d has an invalid header", j);
+                    continue;
                 } else {
                     LOGD("push standard dex file %d, image size: %zu", j, header->file_size);
                     dex_images.emplace_back(dex_file->begin_);
@@ -232,11 +259,13 @@ Java_org_luckypray_dexkit_DexKitBridge_nativeInitDexKitByClassLoader(JNIEnv *env
 DEXKIT_JNI jlong
 Java_org_luckypray_dexkit_DexKitBridge_nativeInitDexKitByBytesArray(JNIEnv *env,
                                                                     jclass clazz,
-                                                                    jobjectArray dex_bytes_array) {
+                                                                    jobjectArray dex_bytes_array,
+                                                                    jboolean verify_dex) {
     if (!dex_bytes_array) {
         return 0;
     }
     auto dexkit = new dexkit::DexKit();
+    dexkit->SetDexVerifyEnabled(verify_dex);
     std::vector<std::unique_ptr<dexkit::MemMap>> images;
     for (int32_t i = 0, len = env->GetArrayLength(dex_bytes_array); i < len; ++i) {
         auto dex_byte = (jbyteArray) env->GetObjectArrayElement(dex_bytes_array, i);
@@ -260,7 +289,8 @@ Java_org_luckypray_dexkit_DexKitBridge_nativeInitDexKitByBytesArray(JNIEnv *env,
 
 DEXKIT_JNI jlong
 Java_org_luckypray_dexkit_DexKitBridge_nativeInitDexKit(JNIEnv *env, jclass clazz,
-                                                        jstring apk_path
+                                                        jstring apk_path,
+                                                        jboolean verify_dex
 ) {
     if (!apk_path) {
         return 0;
@@ -268,6 +298,7 @@ Java_org_luckypray_dexkit_DexKitBridge_nativeInitDexKit(JNIEnv *env, jclass claz
     auto cpath = ScopedUtfChars(env, apk_path);
     LOGI("apkPath -> %s", cpath.c_str());
     auto dexkit = new dexkit::DexKit();
+    dexkit->SetDexVerifyEnabled(verify_dex);
     auto ret = dexkit->AddZipPath(cpath.c_str());
     if (ret != Error::SUCCESS) {
         throwException(env, ret);
@@ -277,6 +308,31 @@ Java_org_luckypray_dexkit_DexKitBridge_nativeInitDexKit(JNIEnv *env, jclass claz
     return (jlong) dexkit;
 }
 
+DEXKIT_JNI jlong
+Java_org_luckypray_dexkit_DexKitBridge_nativeInitDexKitByPaths(JNIEnv *env, jclass clazz,
+                                                               jobjectArray apk_paths,
+                                                               jboolean verify_dex
+) {
+    if (!apk_paths) {
+        return 0;
+    }
+    auto dexkit = new dexkit::DexKit();
+    dexkit->SetDexVerifyEnabled(verify_dex);
+    // one source per path, in array order
+    for (int32_t i = 0, len = env->GetArrayLength(apk_paths); i < len; ++i) {
+        auto apk_path = (jstring) env->GetObjectArrayElement(apk_paths, i);
+        auto cpath = ScopedUtfChars(env, apk_path);
+        LOGI("apkPath[%d] -> %s", i, cpath.c_str());
+        auto ret = dexkit->AddZipPath(cpath.c_str());
+        if (ret != Error::SUCCESS) {
+            throwException(env, ret);
+            delete dexkit;
+            return 0;
+        }
+    }
+    return (jlong) dexkit;
+}
+
 DEXKIT_JNI void
 Java_org_luckypray_dexkit_DexKitBridge_nativeSetThreadNum(JNIEnv *env, jclass clazz,
                                                           jlong native_ptr, jint thread_num
@@ -322,6 +378,96 @@ Java_org_luckypray_dexkit_DexKitBridge_nativeInitFullCache(JNIEnv *env, jclass c
     }
 }
 
+DEXKIT_JNI void
+Java_org_luckypray_dexkit_DexKitBridge_nativeSetQueryIndexEnabled(JNIEnv *env, jclass clazz,
+                                                                  jlong native_ptr,
+                                                                  jboolean enabled
+) {
+    if (!native_ptr) {
+        return;
+    }
+    auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
+    dexkit->SetQueryIndexEnabled(enabled);
+}
+
+DEXKIT_JNI void
+Java_org_luckypray_dexkit_DexKitBridge_nativeBuildStringIndex(JNIEnv *env, jclass clazz,
+                                                              jlong native_ptr
+) {
+    if (!native_ptr) {
+        return;
+    }
+    auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
+    auto ret = dexkit->BuildStringIndex();
+    if (ret != Error::SUCCESS) {
+        throwException(env, ret);
+    }
+}
+
+DEXKIT_JNI jlong
+Java_org_luckypray_dexkit_DexKitBridge_nativeGetStringIndexMemoryUsage(JNIEnv *env, jclass clazz,
+                                                                       jlong native_ptr
+) {
+    if (!native_ptr) {
+        return 0;
+    }
+    auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
+    return static_cast<jlong>(dexkit->GetStringIndexMemoryUsage());
+}
+
+DEXKIT_JNI void
+Java_org_luckypray_dexkit_DexKitBridge_nativeSetQueryResultCacheCapacity(JNIEnv *env, jclass clazz,
+                                                                         jlong native_ptr,
+                                                                         jlong capacity_bytes
+) {
+    if (!native_ptr) {
+        return;
+    }
+    if (capacity_bytes < 0) {
+        throwException(env, "capacityBytes must be >= 0");
+        return;
+    }
+    auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
+    dexkit->SetQueryResultCacheCapacity(static_cast<size_t>(capacity_bytes));
+}
+
+DEXKIT_JNI void
+Java_org_luckypray_dexkit_DexKitBridge_nativeSaveQueryResultCache(JNIEnv *env, jclass clazz,
+                                                                  jlong native_ptr,
+                                                                  jstring path
+) {
+    if (!native_ptr) {
+        return;
+    }
+    auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
+    auto cpath = ScopedUtfChars(env, path);
+    auto ret = dexkit->SaveQueryResultCache(cpath.c_str());
+    if (ret != Error::SUCCESS) {
+        throwException(env, ret);
+    }
+}
+
+DEXKIT_JNI jboolean
+Java_org_luckypray_dexkit_DexKitBridge_nativeLoadQueryResultCache(JNIEnv *env, jclass clazz,
+                                                                  jlong native_ptr,
+                                                                  jstring path
+) {
+    if (!native_ptr) {
+        return JNI_FALSE;
+    }
+    auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
+    auto cpath = ScopedUtfChars(env, path);
+    auto ret = dexkit->LoadQueryResultCache(cpath.c_str());
+    if (ret == Error::SUCCESS) {
+        return JNI_TRUE;
+    }
+    // a missing or stale file only means the queries run again
+    if (ret != Error::FILE_NOT_FOUND && ret != Error::QUERY_CACHE_MISMATCH) {
+        throwException(env, ret);
+    }
+    return JNI_FALSE;
+}
+
 DEXKIT_JNI jint
 Java_org_luckypray_dexkit_DexKitBridge_nativeGetDexNum(JNIEnv *env, jclass clazz,
                                                        jlong native_ptr
@@ -333,6 +479,33 @@ Java_org_luckypray_dexkit_DexKitBridge_nativeGetDexNum(JNIEnv *env, jclass clazz
     return dexkit->GetDexNum();
 }
 
+DEXKIT_JNI jint
+Java_org_luckypray_dexkit_DexKitBridge_nativeGetSourceNum(JNIEnv *env, jclass clazz,
+                                                          jlong native_ptr
+) {
+    if (!native_ptr) {
+        return 0;
+    }
+    auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
+    return dexkit->GetSourceNum();
+}
+
+DEXKIT_JNI jintArray
+Java_org_luckypray_dexkit_DexKitBridge_nativeGetSourceDexIds(JNIEnv *env, jclass clazz,
+                                                             jlong native_ptr,
+                                                             jint source_id
+) {
+    if (!native_ptr) {
+        return {};
+    }
+    auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
+    auto result = dexkit->GetSourceDexIds(source_id);
+    auto int_vector = std::vector<int>(result.begin(), result.end());
+    jintArray ret = env->NewIntArray(int_vector.size());
+    env->SetIntArrayRegion(ret, 0, int_vector.size(), (const jint *) int_vector.data());
+    return ret;
+}
+
 DEXKIT_JNI void
 Java_org_luckypray_dexkit_DexKitBridge_nativeRelease(JNIEnv *env, jclass clazz,
                                                      jlong native_ptr
@@ -372,7 +545,7 @@ Java_org_luckypray_dexkit_DexKitBridge_nativeBatchFindClassUsingStrings(JNIEnv *
     auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
     jbyte *bytes = env->GetByteArrayElements(arr, nullptr);
     auto query = From<dexkit::schema::BatchFindClassUsingStrings>(bytes);
-    auto result = dexkit->BatchFindClassUsingStrings(query);
+    auto result = dexkit->BatchFindClassUsingStrings(query, GetQueryOptions(query));
     jbyteArray ret = nullptr;
     checkAndSetFlatBufferResult(env, result, ret);
     env->ReleaseByteArrayElements(arr, bytes, 0);
@@ -391,7 +564,7 @@ Java_org_luckypray_dexkit_DexKitBridge_nativeBatchFindMethodUsingStrings(JNIEnv
     auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
     jbyte *bytes = env->GetByteArrayElements(arr, nullptr);
     auto query = From<dexkit::schema::BatchFindMethodUsingStrings>(bytes);
-    auto result = dexkit->BatchFindMethodUsingStrings(query);
+    auto result = dexkit->BatchFindMethodUsingStrings(query, GetQueryOptions(query));
     jbyteArray ret = nullptr;
     checkAndSetFlatBufferResult(env, result, ret);
     env->ReleaseByteArrayElements(arr, bytes, 0);
@@ -409,7 +582,7 @@ Java_org_luckypray_dexkit_DexKitBridge_nativeFindClass(JNIEnv *env, jclass clazz
     auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
     jbyte *bytes = env->GetByteArrayElements(arr, nullptr);
     auto query = From<dexkit::schema::FindClass>(bytes);
-    auto result = dexkit->FindClass(query);
+    auto result = dexkit->FindClass(query, GetQueryOptions(query));
     jbyteArray ret = nullptr;
     checkAndSetFlatBufferResult(env, result, ret);
     env->ReleaseByteArrayElements(arr, bytes, 0);
@@ -427,7 +600,7 @@ Java_org_luckypray_dexkit_DexKitBridge_nativeFindMethod(JNIEnv *env, jclass claz
     auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
     jbyte *bytes = env->GetByteArrayElements(arr, nullptr);
     auto query = From<dexkit::schema::FindMethod>(bytes);
-    auto result = dexkit->FindMethod(query);
+    auto result = dexkit->FindMethod(query, GetQueryOptions(query));
     jbyteArray ret = nullptr;
     checkAndSetFlatBufferResult(env, result, ret);
     env->ReleaseByteArrayElements(arr, bytes, 0);
@@ -445,13 +618,122 @@ Java_org_luckypray_dexkit_DexKitBridge_nativeFindField(JNIEnv *env, jclass clazz
     auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
     jbyte *bytes = env->GetByteArrayElements(arr, nullptr);
     auto query = From<dexkit::schema::FindField>(bytes);
-    auto result = dexkit->FindField(query);
+    auto result = dexkit->FindField(query, GetQueryOptions(query));
     jbyteArray ret = nullptr;
     checkAndSetFlatBufferResult(env, result, ret);
     env->ReleaseByteArrayElements(arr, bytes, 0);
     return ret;
 }
 
+DEXKIT_JNI jobjectArray
+Java_org_luckypray_dexkit_DexKitBridge_nativeMultiFindClass(JNIEnv *env, jclass clazz,
+                                                            jlong native_ptr,
+                                                            jbyteArray arr
+) {
+    if (!native_ptr) {
+        return {};
+    }
+    auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
+    jbyte *bytes = env->GetByteArrayElements(arr, nullptr);
+    auto query = From<dexkit::schema::MultiFindClass>(bytes);
+    std::vector<const dexkit::schema::FindClass *> queries;
+    if (query->queries()) {
+        queries.assign(query->queries()->begin(), query->queries()->end());
+    }
+    auto results = dexkit->MultiFindClass(queries, GetQueryOptions(query));
+    jobjectArray ret = env->NewObjectArray(results.size(), env->FindClass("[B"), nullptr);
+    for (size_t i = 0; i < results.size(); ++i) {
+        jbyteArray item = nullptr;
+        checkAndSetFlatBufferResult(env, results[i], item);
+        env->SetObjectArrayElement(ret, i, item);
+        env->DeleteLocalRef(item);
+    }
+    env->ReleaseByteArrayElements(arr, bytes, 0);
+    return ret;
+}
+
+DEXKIT_JNI jobjectArray
+Java_org_luckypray_dexkit_DexKitBridge_nativeMultiFindMethod(JNIEnv *env, jclass clazz,
+                                                             jlong native_ptr,
+                                                             jbyteArray arr
+) {
+    if (!native_ptr) {
+        return {};
+    }
+    auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
+    jbyte *bytes = env->GetByteArrayElements(arr, nullptr);
+    auto query = From<dexkit::schema::MultiFindMethod>(bytes);
+    std::vector<const dexkit::schema::FindMethod *> queries;
+    if (query->queries()) {
+        queries.assign(query->queries()->begin(), query->queries()->end());
+    }
+    auto results = dexkit->MultiFindMethod(queries, GetQueryOptions(query));
+    jobjectArray ret = env->NewObjectArray(results.size(), env->FindClass("[B"), nullptr);
+    for (size_t i = 0; i < results.size(); ++i) {
+        jbyteArray item = nullptr;
+        checkAndSetFlatBufferResult(env, results[i], item);
+        env->SetObjectArrayElement(ret, i, item);
+        env->DeleteLocalRef(item);
+    }
+    env->ReleaseByteArrayElements(arr, bytes, 0);
+    return ret;
+}
+
+DEXKIT_JNI jbyteArray
+Java_org_luckypray_dexkit_DexKitBridge_nativeExecuteQueryPipeline(JNIEnv *env, jclass clazz,
+                                                                  jlong native_ptr,
+                                                                  jbyteArray arr
+) {
+    if (!native_ptr) {
+        return {};
+    }
+    auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
+    jbyte *bytes = env->GetByteArrayElements(arr, nullptr);
+    auto pipeline = From<dexkit::schema::QueryPipeline>(bytes);
+    std::unique_ptr<flatbuffers::FlatBufferBuilder> result;
+    auto error = dexkit->ExecuteQueryPipeline(pipeline, result);
+    env->ReleaseByteArrayElements(arr, bytes, 0);
+    if (error != Error::SUCCESS) {
+        throwException(env, error);
+        return {};
+    }
+    jbyteArray ret = nullptr;
+    checkAndSetFlatBufferResult(env, result, ret);
+    return ret;
+}
+
+
+DEXKIT_JNI jbyteArray
+Java_org_luckypray_dexkit_DexKitBridge_nativeFindSubclasses(JNIEnv *env, jclass clazz,
+                                                            jlong native_ptr,
+                                                            jstring class_descriptor,
+                                                            jboolean direct_only) {
+    if (!native_ptr) {
+        return {};
+    }
+    auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
+    auto cdesc = ScopedUtfChars(env, class_descriptor);
+    auto result = dexkit->FindSubclasses(cdesc.c_str(), direct_only);
+    jbyteArray ret = nullptr;
+    checkAndSetFlatBufferResult(env, result, ret);
+    return ret;
+}
+
+DEXKIT_JNI jbyteArray
+Java_org_luckypray_dexkit_DexKitBridge_nativeFindImplementors(JNIEnv *env, jclass clazz,
+                                                              jlong native_ptr,
+                                                              jstring interface_descriptor,
+                                                              jboolean direct_only) {
+    if (!native_ptr) {
+        return {};
+    }
+    auto dexkit = reinterpret_cast<dexkit::DexKit *>(native_ptr);
+    auto cdesc = ScopedUtfChars(env, interface_descriptor);
+    auto result = dexkit->FindImplementors(cdesc.c_str(), direct_only);
+    jbyteArray ret = nullptr;
+    checkAndSetFlatBufferResult(env, result, ret);
+    return ret;
+}
 
 DEXKIT_JNI jbyteArray
 Java_org_luckypray_dexkit_DexKitBridge_nativeGetClassData(JNIEnv *env, jclass clazz,
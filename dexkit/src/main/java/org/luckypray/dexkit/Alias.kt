@@ -50,12 +50,17 @@ internal typealias InnerMethodMatcher = org.luckypray.dexkit.schema.`-MethodMatc
 internal typealias InnerMethodMeta = org.luckypray.dexkit.schema.`-MethodMeta`
 internal typealias InnerMethodMetaArrayHolder = org.luckypray.dexkit.schema.`-MethodMetaArrayHolder`
 internal typealias InnerMethodsMatcher = org.luckypray.dexkit.schema.`-MethodsMatcher`
+internal typealias InnerMultiFindClass = org.luckypray.dexkit.schema.`-MultiFindClass`
+internal typealias InnerMultiFindMethod = org.luckypray.dexkit.schema.`-MultiFindMethod`
 internal typealias InnerNumber = org.luckypray.dexkit.schema.`-Number`
 internal typealias InnerOpCodeMatchType = org.luckypray.dexkit.schema.`-OpCodeMatchType`
 internal typealias InnerOpCodesMatcher = org.luckypray.dexkit.schema.`-OpCodesMatcher`
 internal typealias InnerParameterMatcher = org.luckypray.dexkit.schema.`-ParameterMatcher`
 internal typealias InnerParametersAnnotationMetaArrayHoler = org.luckypray.dexkit.schema.`-ParametersAnnotationMetaArrayHoler`
 internal typealias InnerParametersMatcher = org.luckypray.dexkit.schema.`-ParametersMatcher`
+internal typealias InnerQueryPipeline = org.luckypray.dexkit.schema.`-QueryPipeline`
+internal typealias InnerQueryPipelineStage = org.luckypray.dexkit.schema.`-QueryPipelineStage`
+internal typealias InnerQueryPriority = org.luckypray.dexkit.schema.`-QueryPriority`
 internal typealias InnerRetentionPolicyType = org.luckypray.dexkit.schema.`-RetentionPolicyType`
 internal typealias InnerStringMatchType = org.luckypray.dexkit.schema.`-StringMatchType`
 internal typealias InnerStringMatcher = org.luckypray.dexkit.schema.`-StringMatcher`
@@ -29,7 +29,11 @@ import org.luckypray.dexkit.query.BatchFindMethodUsingStrings
 import org.luckypray.dexkit.query.FindClass
 import org.luckypray.dexkit.query.FindField
 import org.luckypray.dexkit.query.FindMethod
+import org.luckypray.dexkit.query.MultiFindClass
+import org.luckypray.dexkit.query.MultiFindMethod
+import org.luckypray.dexkit.query.QueryPipeline
 import org.luckypray.dexkit.result.AnnotationData
+import org.luckypray.dexkit.result.BaseDataList
 import org.luckypray.dexkit.result.ClassData
 import org.luckypray.dexkit.result.ClassDataList
 import org.luckypray.dexkit.result.FieldData
@@ -81,16 +85,20 @@ class DexKitBridge : Closeable {
      */
     val isValid get() = token != 0L
 
-    private constructor(apkPath: String) {
-        token = nativeInitDexKit(apkPath)
+    private constructor(apkPath: String, verifyDex: Boolean) {
+        token = nativeInitDexKit(apkPath, verifyDex)
     }
 
-    private constructor(dexBytesArray: Array<ByteArray>) {
-        token = nativeInitDexKitByBytesArray(dexBytesArray)
+    private constructor(apkPaths: Array<String>, verifyDex: Boolean) {
+        token = nativeInitDexKitByPaths(apkPaths, verifyDex)
     }
 
-    private constructor(classLoader: ClassLoader, useMemoryDexFile: Boolean) {
-        token = nativeInitDexKitByClassLoader(classLoader, useMemoryDexFile)
+    private constructor(dexBytesArray: Array<ByteArray>, verifyDex: Boolean) {
+        token = nativeInitDexKitByBytesArray(dexBytesArray, verifyDex)
+    }
+
+    private constructor(classLoader: ClassLoader, useMemoryDexFile: Boolean, verifyDex: Boolean) {
+        token = nativeInitDexKitByClassLoader(classLoader, useMemoryDexFile, verifyDex)
     }
 
     /**
@@ -123,6 +131,83 @@ class DexKitBridge : Closeable {
         withNativeReadToken { nativeInitFullCache(it) }
     }
 
+    /**
+     * Enable or disable the query indexes (type/member names, op codes, numbers, strings,
+     * references and class hierarchy) used to narrow the candidates of find queries.
+     * Disabled queries scan every class, method or field instead, the results are the same.
+     * Enabled by default.
+     * ----------------
+     * 启用或禁用用于缩小查询候选范围的索引（类型/成员名、字节码、数字、字符串、引用以及类继承关系）。
+     * 禁用后查询将扫描全部类、方法或字段，查询结果不变。默认启用。
+     *
+     * @param [enabled] whether the indexes are used
+     */
+    fun setQueryIndexEnabled(enabled: Boolean) {
+        withNativeWriteToken { nativeSetQueryIndexEnabled(it, enabled) }
+    }
+
+    /**
+     * Build the string pool index of every dex, case sensitive literal usingStrings matchers
+     * then seed their candidates from it. Not part of [initFullCache], the index costs extra
+     * memory, see [getStringIndexMemoryUsage].
+     * ----------------
+     * 为所有 dex 构建字符串池索引，区分大小写的字面量 usingStrings 匹配将基于该索引查找候选。
+     * 该索引不包含在 [initFullCache] 中，其额外内存占用见 [getStringIndexMemoryUsage]。
+     */
+    fun buildStringIndex() {
+        withNativeReadToken { nativeBuildStringIndex(it) }
+    }
+
+    /**
+     * Bytes held by the string pool index, `0` until [buildStringIndex] is called.
+     * ----------------
+     * 字符串池索引占用的字节数，调用 [buildStringIndex] 之前为 `0`。
+     */
+    fun getStringIndexMemoryUsage(): Long {
+        return withNativeReadToken { nativeGetStringIndexMemoryUsage(it) }
+    }
+
+    /**
+     * Cache the results of findClass/findMethod/findField until a dex source is added, bounded by
+     * an approximate byte size. Use `0` (the default) to disable the cache.
+     * ----------------
+     * 缓存 findClass/findMethod/findField 的查询结果直到添加新的 dex 来源，占用上限为近似字节数。
+     * 使用 `0`（默认）禁用缓存。
+     *
+     * @param [capacityBytes] cache capacity in bytes
+     */
+    fun setQueryResultCacheCapacity(capacityBytes: Long) {
+        require(capacityBytes >= 0) { "capacityBytes must be >= 0" }
+        withNativeWriteToken { nativeSetQueryResultCacheCapacity(it, capacityBytes) }
+    }
+
+    /**
+     * Write the cached query results to [path]. The file is bound to the loaded dex files,
+     * see [loadQueryResultCache].
+     * ----------------
+     * 将已缓存的查询结果写入 [path]。该文件与已加载的 dex 绑定，见 [loadQueryResultCache]。
+     *
+     * @param [path] cache file path
+     */
+    fun saveQueryResultCache(path: String) {
+        withNativeReadToken { nativeSaveQueryResultCache(it, path) }
+    }
+
+    /**
+     * Load query results written by [saveQueryResultCache]. Loaded entries still count towards
+     * [setQueryResultCacheCapacity], nothing is loaded while the cache is disabled.
+     * ----------------
+     * 加载 [saveQueryResultCache] 写入的查询结果。加载的条目同样受 [setQueryResultCacheCapacity]
+     * 限制，缓存禁用时不会加载任何内容。
+     *
+     * @param [path] cache file path
+     * @return `false` if the file does not exist or was saved for different dex files
+     * / 文件不存在或属于不同的 dex 时返回 `false`
+     */
+    fun loadQueryResultCache(path: String): Boolean {
+        return withNativeReadToken { nativeLoadQueryResultCache(it, path) }
+    }
+
     /**
      * set DexKit work thread number
      * ----------------
@@ -153,6 +238,31 @@ class DexKitBridge : Closeable {
         return withNativeReadToken { nativeGetDexNum(it) }
     }
 
+    /**
+     * Get the number of sources. Each apk path, the whole dex bytes array, or each dex file of a
+     * class loader the bridge was created from is one source, source ids follow that order,
+     * see [FindClass.searchInSources].
+     * ----------------
+     * 获取来源数量。创建 bridge 时的每个 apk 路径、整个 dex 字节数组或类加载器中的每个 dex 文件为一个来源，
+     * 来源 id 与其顺序一致，见 [FindClass.searchInSources]。
+     */
+    fun getSourceNum(): Int {
+        return withNativeReadToken { nativeGetSourceNum(it) }
+    }
+
+    /**
+     * Get the ids of the dex files loaded by a source. A dex loaded by several sources is parsed
+     * once, its id is reported by each of them.
+     * ----------------
+     * 获取某个来源加载的 dex id。被多个来源加载的同一 dex 只会解析一次，其 id 会出现在每个来源中。
+     *
+     * @param [sourceId] source id / 来源 id
+     * @return dex ids, empty for an unknown source / dex id 列表，来源不存在时为空
+     */
+    fun getSourceDexIds(sourceId: Int): List<Int> {
+        return withNativeReadToken { nativeGetSourceDexIds(it, sourceId) }.toList()
+    }
+
     /**
      * write all dex file to [outPath]
      * ----------------
@@ -231,6 +341,88 @@ class DexKitBridge : Closeable {
         return findField(bytes)
     }
 
+    /**
+     * Runs several class searches with one scan of each dex.
+     * ----------------
+     * 通过每个 dex 的一次扫描执行多个类搜索。
+     *
+     * @param [multiFind] query object / 查询对象
+     * @return [List]<[ClassDataList]> in query order / 按查询顺序排列
+     */
+    fun multiFindClass(multiFind: MultiFindClass): List<ClassDataList> {
+        val bytes = multiFind.serializedBytes()
+        return multiFindClass(bytes)
+    }
+
+    /**
+     * Runs several method searches with one scan of each dex.
+     * ----------------
+     * 通过每个 dex 的一次扫描执行多个方法搜索。
+     *
+     * @param [multiFind] query object / 查询对象
+     * @return [List]<[MethodDataList]> in query order / 按查询顺序排列
+     */
+    fun multiFindMethod(multiFind: MultiFindMethod): List<MethodDataList> {
+        val bytes = multiFind.serializedBytes()
+        return multiFindMethod(bytes)
+    }
+
+    /**
+     * Run chained queries in one call, only the results of the output stage are returned.
+     * ----------------
+     * 在一次调用中执行链式查询，仅返回输出阶段的结果。
+     *
+     * @param [pipeline] query object / 查询对象
+     * @return [ClassDataList], [MethodDataList] or [FieldDataList] depending on the query of the
+     * output stage / 根据输出阶段的查询类型返回 [ClassDataList]、[MethodDataList] 或 [FieldDataList]
+     */
+    fun executeQueryPipeline(pipeline: QueryPipeline): BaseDataList<*> {
+        val bytes = pipeline.serializedBytes()
+        val res = withNativeReadToken { nativeExecuteQueryPipeline(it, bytes) }
+        val output = pipeline.resolveOutputStage()!!
+        return when {
+            output.findClass != null -> parseClassDataList(res)
+            output.findMethod != null -> parseMethodDataList(res)
+            else -> parseFieldDataList(res)
+        }
+    }
+
+    /**
+     * Find the classes extending [className], through any number of super classes unless
+     * [directOnly]. The class does not need to be declared by the loaded dex files,
+     * e.g. `android.app.Activity`. Interfaces are not reported.
+     * ----------------
+     * 查找继承 [className] 的类，除非 [directOnly] 否则包含间接子类。该类不需要在已加载的 dex 中声明，
+     * 例如 `android.app.Activity`。结果不包含接口。
+     *
+     * @param [className] class name or descriptor / 类名或类描述
+     * @param [directOnly] only direct subclasses / 仅查找直接子类
+     * @return [ClassDataList]
+     */
+    @JvmOverloads
+    fun findSubclasses(className: String, directOnly: Boolean = false): ClassDataList {
+        val descriptor = toClassDescriptor(className)
+        val res = withNativeReadToken { nativeFindSubclasses(it, descriptor, directOnly) }
+        return parseClassDataList(res)
+    }
+
+    /**
+     * Find the classes implementing [interfaceName]. Unless [directOnly], classes inheriting it
+     * from a super class or through a sub interface are reported as well.
+     * ----------------
+     * 查找实现 [interfaceName] 的类。除非 [directOnly]，否则也包含通过父类或子接口间接实现的类。
+     *
+     * @param [interfaceName] interface name or descriptor / 接口名或接口描述
+     * @param [directOnly] only classes declaring the interface / 仅查找直接声明该接口的类
+     * @return [ClassDataList]
+     */
+    @JvmOverloads
+    fun findImplementors(interfaceName: String, directOnly: Boolean = false): ClassDataList {
+        val descriptor = toClassDescriptor(interfaceName)
+        val res = withNativeReadToken { nativeFindImplementors(it, descriptor, directOnly) }
+        return parseClassDataList(res)
+    }
+
     /**
      * Convert [Class] to [ClassData] (if exists).
      * ----------------
@@ -252,12 +444,7 @@ class DexKitBridge : Closeable {
      * @return [ClassData]
      */
     fun getClassData(identifier: String): ClassData? {
-        val descriptor: String = if (identifier.first() == 'L' && identifier.last() == ';') {
-            identifier
-        } else {
-            "L" + identifier.replace('.', '/') + ";"
-        }
-        DexClass(descriptor)
+        val descriptor = toClassDescriptor(identifier)
         return withNativeReadToken { nativeGetClassData(it, descriptor) }?.let {
             ClassData.from(this, InnerClassMeta.getRootAsClassMeta(ByteBuffer.wrap(it)))
         }
@@ -371,6 +558,30 @@ class DexKitBridge : Closeable {
         return findField(FindField().apply(init))
     }
 
+    /**
+     * @see [multiFindClass]
+     */
+    @JvmSynthetic
+    fun multiFindClass(init: MultiFindClass.() -> Unit): List<ClassDataList> {
+        return multiFindClass(MultiFindClass().apply(init))
+    }
+
+    /**
+     * @see [multiFindMethod]
+     */
+    @JvmSynthetic
+    fun multiFindMethod(init: MultiFindMethod.() -> Unit): List<MethodDataList> {
+        return multiFindMethod(MultiFindMethod().apply(init))
+    }
+
+    /**
+     * @see [executeQueryPipeline]
+     */
+    @JvmSynthetic
+    fun executeQueryPipeline(init: QueryPipeline.() -> Unit): BaseDataList<*> {
+        return executeQueryPipeline(QueryPipeline().apply(init))
+    }
+
     // endregion
 
     /**
@@ -418,6 +629,20 @@ class DexKitBridge : Closeable {
      */
     private fun findClass(encodeBytes: ByteArray): ClassDataList {
         val res = withNativeReadToken { nativeFindClass(it, encodeBytes) }
+        return parseClassDataList(res)
+    }
+
+    private fun toClassDescriptor(identifier: String): String {
+        val descriptor = if (identifier.first() == 'L' && identifier.last() == ';') {
+            identifier
+        } else {
+            "L" + identifier.replace('.', '/') + ";"
+        }
+        DexClass(descriptor)
+        return descriptor
+    }
+
+    private fun parseClassDataList(res: ByteArray): ClassDataList {
         val holder = InnerClassMetaArrayHolder.getRootAsClassMetaArrayHolder(ByteBuffer.wrap(res))
         val list = ClassDataList()
         for (i in 0 until holder.classesLength) {
@@ -432,6 +657,10 @@ class DexKitBridge : Closeable {
      */
     private fun findMethod(encodeBytes: ByteArray): MethodDataList {
         val res = withNativeReadToken { nativeFindMethod(it, encodeBytes) }
+        return parseMethodDataList(res)
+    }
+
+    private fun parseMethodDataList(res: ByteArray): MethodDataList {
         val holder = InnerMethodMetaArrayHolder.getRootAsMethodMetaArrayHolder(ByteBuffer.wrap(res))
         val list = MethodDataList()
         for (i in 0 until holder.methodsLength) {
@@ -446,6 +675,10 @@ class DexKitBridge : Closeable {
      */
     private fun findField(encodeBytes: ByteArray): FieldDataList {
         val res = withNativeReadToken { nativeFindField(it, encodeBytes) }
+        return parseFieldDataList(res)
+    }
+
+    private fun parseFieldDataList(res: ByteArray): FieldDataList {
         val holder = InnerFieldMetaArrayHolder.getRootAsFieldMetaArrayHolder(ByteBuffer.wrap(res))
         val list = FieldDataList()
         for (i in 0 until holder.fieldsLength) {
@@ -455,6 +688,38 @@ class DexKitBridge : Closeable {
         return list
     }
 
+    /**
+     * find classes by [MultiFindClass]'s [FlatBufferBuilder], one [ClassDataList] per query
+     */
+    private fun multiFindClass(encodeBytes: ByteArray): List<ClassDataList> {
+        val res = withNativeReadToken { nativeMultiFindClass(it, encodeBytes) }
+        return res.map { bytes ->
+            val holder = InnerClassMetaArrayHolder.getRootAsClassMetaArrayHolder(ByteBuffer.wrap(bytes))
+            val list = ClassDataList()
+            for (i in 0 until holder.classesLength) {
+                list.add(ClassData.from(this@DexKitBridge, holder.classes(i)!!))
+            }
+            list.sortBy { it.descriptor }
+            list
+        }
+    }
+
+    /**
+     * find methods by [MultiFindMethod]'s [FlatBufferBuilder], one [MethodDataList] per query
+     */
+    private fun multiFindMethod(encodeBytes: ByteArray): List<MethodDataList> {
+        val res = withNativeReadToken { nativeMultiFindMethod(it, encodeBytes) }
+        return res.map { bytes ->
+            val holder = InnerMethodMetaArrayHolder.getRootAsMethodMetaArrayHolder(ByteBuffer.wrap(bytes))
+            val list = MethodDataList()
+            for (i in 0 until holder.methodsLength) {
+                list.add(MethodData.from(this@DexKitBridge, holder.methods(i)!!))
+            }
+            list.sortBy { it.descriptor }
+            list
+        }
+    }
+
     @JvmSynthetic
     internal fun getTypeByIds(encodeIdArray: LongArray): ClassDataList {
         val res = withNativeReadToken { nativeGetClassByIds(it, encodeIdArray) }
@@ -616,11 +881,32 @@ class DexKitBridge : Closeable {
          * @see [Companion.create]
          *
          * @param apkPath apk path / apk 路径
+         * @param verifyDex check the header bounds and checksum of every dex, creation fails if
+         * any is invalid / 校验每个 dex 的头部边界与校验和，任一 dex 无效时创建失败
+         * @return [DexKitBridge]
+         */
+        @JvmStatic
+        @JvmOverloads
+        fun create(apkPath: String, verifyDex: Boolean = false): DexKitBridge {
+            return DexKitBridge(apkPath, verifyDex)
+        }
+
+        /**
+         * create DexKitBridge by several apk paths, each path is one source, see [getSourceNum].
+         * The same dex loaded by several paths is only parsed once.
+         * ----------------
+         * 通过多个 apk 路径创建 DexKitBridge，每个路径为一个来源，见 [getSourceNum]。
+         * 多个路径中相同的 dex 只会解析一次。
+         *
+         * @param apkPaths apk paths / apk 路径列表
+         * @param verifyDex check the header bounds and checksum of every dex, creation fails if
+         * any is invalid / 校验每个 dex 的头部边界与校验和，任一 dex 无效时创建失败
          * @return [DexKitBridge]
          */
         @JvmStatic
-        fun create(apkPath: String): DexKitBridge {
-            return DexKitBridge(apkPath)
+        @JvmOverloads
+        fun create(apkPaths: Collection<String>, verifyDex: Boolean = false): DexKitBridge {
+            return DexKitBridge(apkPaths.toTypedArray(), verifyDex)
         }
 
         /**
@@ -629,11 +915,14 @@ class DexKitBridge : Closeable {
          * 通过 dex 字节数组创建 DexKitBridge
          *
          * @param dexBytesArray dex bytes array / dex 字节数组
+         * @param verifyDex check the header bounds and checksum of every dex, creation fails if
+         * any is invalid / 校验每个 dex 的头部边界与校验和，任一 dex 无效时创建失败
          * @return [DexKitBridge]
          */
         @JvmStatic
-        fun create(dexBytesArray: Array<ByteArray>): DexKitBridge {
-            return DexKitBridge(dexBytesArray)
+        @JvmOverloads
+        fun create(dexBytesArray: Array<ByteArray>, verifyDex: Boolean = false): DexKitBridge {
+            return DexKitBridge(dexBytesArray, verifyDex)
         }
 
         /**
@@ -646,9 +935,12 @@ class DexKitBridge : Closeable {
          *
          * @param loader class loader / 类加载器
          * @param useMemoryDexFile whether to use memory dex file / 是否使用内存 dex 文件
+         * @param verifyDex check the header bounds and checksum of every dex, memory dex files
+         * that fail are skipped / 校验每个 dex 的头部边界与校验和，校验失败的内存 dex 文件将被跳过
          */
         @JvmStatic
-        fun create(loader: ClassLoader, useMemoryDexFile: Boolean): DexKitBridge {
+        @JvmOverloads
+        fun create(loader: ClassLoader, useMemoryDexFile: Boolean, verifyDex: Boolean = false): DexKitBridge {
             val baseDexClz = try {
                 Class.forName("dalvik.system.BaseDexClassLoader")
             } catch (_: ClassNotFoundException) {
@@ -658,19 +950,23 @@ class DexKitBridge : Closeable {
             if (!baseDexClz.isInstance(loader)) {
                 error("classLoader must be a BaseDexClassLoader (e.g. PathClassLoader/DexClassLoader)")
             }
-            return DexKitBridge(loader, useMemoryDexFile)
+            return DexKitBridge(loader, useMemoryDexFile, verifyDex)
         }
 
         @JvmStatic
-        private external fun nativeInitDexKit(apkPath: String): Long
+        private external fun nativeInitDexKit(apkPath: String, verifyDex: Boolean): Long
 
         @JvmStatic
-        private external fun nativeInitDexKitByBytesArray(dexBytesArray: Array<ByteArray>): Long
+        private external fun nativeInitDexKitByPaths(apkPaths: Array<String>, verifyDex: Boolean): Long
+
+        @JvmStatic
+        private external fun nativeInitDexKitByBytesArray(dexBytesArray: Array<ByteArray>, verifyDex: Boolean): Long
 
         @JvmStatic
         private external fun nativeInitDexKitByClassLoader(
             loader: ClassLoader,
-            useMemoryDexFile: Boolean
+            useMemoryDexFile: Boolean,
+            verifyDex: Boolean
         ): Long
 
         @JvmStatic
@@ -682,9 +978,33 @@ class DexKitBridge : Closeable {
         @JvmStatic
         private external fun nativeInitFullCache(nativePtr: Long)
 
+        @JvmStatic
+        private external fun nativeSetQueryIndexEnabled(nativePtr: Long, enabled: Boolean)
+
+        @JvmStatic
+        private external fun nativeBuildStringIndex(nativePtr: Long)
+
+        @JvmStatic
+        private external fun nativeGetStringIndexMemoryUsage(nativePtr: Long): Long
+
+        @JvmStatic
+        private external fun nativeSetQueryResultCacheCapacity(nativePtr: Long, capacityBytes: Long)
+
+        @JvmStatic
+        private external fun nativeSaveQueryResultCache(nativePtr: Long, path: String)
+
+        @JvmStatic
+        private external fun nativeLoadQueryResultCache(nativePtr: Long, path: String): Boolean
+
         @JvmStatic
         private external fun nativeGetDexNum(nativePtr: Long): Int
 
+        @JvmStatic
+        private external fun nativeGetSourceNum(nativePtr: Long): Int
+
+        @JvmStatic
+        private external fun nativeGetSourceDexIds(nativePtr: Long, sourceId: Int): IntArray
+
         @JvmStatic
         private external fun nativeRelease(nativePtr: Long)
 
@@ -706,6 +1026,21 @@ class DexKitBridge : Closeable {
         @JvmStatic
         private external fun nativeFindField(nativePtr: Long, bytes: ByteArray): ByteArray
 
+        @JvmStatic
+        private external fun nativeMultiFindClass(nativePtr: Long, bytes: ByteArray): Array<ByteArray>
+
+        @JvmStatic
+        private external fun nativeMultiFindMethod(nativePtr: Long, bytes: ByteArray): Array<ByteArray>
+
+        @JvmStatic
+        private external fun nativeExecuteQueryPipeline(nativePtr: Long, bytes: ByteArray): ByteArray
+
+        @JvmStatic
+        private external fun nativeFindSubclasses(nativePtr: Long, classDescriptor: String, directOnly: Boolean): ByteArray
+
+        @JvmStatic
+        private external fun nativeFindImplementors(nativePtr: Long, interfaceDescriptor: String, directOnly: Boolean): ByteArray
+
         @JvmStatic
         private external fun nativeGetClassData(nativePtr: Long, dexDescriptor: String): ByteArray?
 
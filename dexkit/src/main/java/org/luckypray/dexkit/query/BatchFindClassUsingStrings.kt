@@ -25,7 +25,9 @@ package org.luckypray.dexkit.query
 
 import com.google.flatbuffers.FlatBufferBuilder
 import org.luckypray.dexkit.InnerBatchFindClassUsingStrings
+import org.luckypray.dexkit.InnerQueryPriority
 import org.luckypray.dexkit.query.base.BaseFinder
+import org.luckypray.dexkit.query.enums.QueryPriority
 import org.luckypray.dexkit.query.enums.StringMatchType
 import org.luckypray.dexkit.query.matchers.StringMatchersGroup
 import org.luckypray.dexkit.query.matchers.base.StringMatcher
@@ -66,6 +68,23 @@ class BatchFindClassUsingStrings : BaseFinder() {
     var searchGroups: MutableList<StringMatchersGroup>? = null
         private set
 
+    /**
+     * Scheduling class of this query among concurrent queries on the same bridge,
+     * `null` lets DexKit choose.
+     * ----------------
+     * 此查询在同一 bridge 并发查询间的调度优先级，为 `null` 时由 DexKit 决定。
+     */
+    @set:JvmSynthetic
+    var priority: QueryPriority? = null
+
+    /**
+     * Share of the workers relative to other queries of the same [priority], 0 uses the default.
+     * ----------------
+     * 相对于同一 [priority] 的其他查询的工作线程份额，0 表示使用默认值。
+     */
+    @set:JvmSynthetic
+    var weight: Int = 0
+
     /**
      * Search classes in the specified packages.
      * ----------------
@@ -219,6 +238,31 @@ class BatchFindClassUsingStrings : BaseFinder() {
         addSearchGroup(StringMatchersGroup(groupName, usingStrings.map { StringMatcher(it, matchType, ignoreCase) }))
     }
 
+    /**
+     * Scheduling class of this query among concurrent queries on the same bridge.
+     * ----------------
+     * 此查询在同一 bridge 并发查询间的调度优先级。
+     *
+     * @param priority query priority / 查询优先级
+     * @return [BatchFindClassUsingStrings]
+     */
+    fun priority(priority: QueryPriority) = also {
+        this.priority = priority
+    }
+
+    /**
+     * Share of the workers relative to other queries of the same [priority].
+     * ----------------
+     * 相对于同一 [priority] 的其他查询的工作线程份额。
+     *
+     * @param weight query weight, 0 uses the default / 查询权重，0 表示使用默认值
+     * @return [BatchFindClassUsingStrings]
+     */
+    fun weight(weight: Int) = also {
+        require(weight >= 0) { "weight must be non-negative" }
+        this.weight = weight
+    }
+
     // region DSL
 
     @JvmSynthetic
@@ -260,7 +304,9 @@ class BatchFindClassUsingStrings : BaseFinder() {
             ignorePackagesCase,
             searchClasses?.map { it.getEncodeId() }?.toLongArray()
                 ?.let { InnerBatchFindClassUsingStrings.createInClassesVector(fbb, it) } ?: 0,
-            fbb.createVectorOfTables(searchGroups!!.map { it.build(fbb) }.toIntArray())
+            fbb.createVectorOfTables(searchGroups!!.map { it.build(fbb) }.toIntArray()),
+            priority?.value ?: InnerQueryPriority.Default,
+            weight.toUInt()
         )
         fbb.finish(root)
         return root
@@ -25,7 +25,9 @@ package org.luckypray.dexkit.query
 
 import com.google.flatbuffers.FlatBufferBuilder
 import org.luckypray.dexkit.InnerFindField
+import org.luckypray.dexkit.InnerQueryPriority
 import org.luckypray.dexkit.query.base.BaseFinder
+import org.luckypray.dexkit.query.enums.QueryPriority
 import org.luckypray.dexkit.query.matchers.FieldMatcher
 import org.luckypray.dexkit.result.ClassData
 import org.luckypray.dexkit.result.FieldData
@@ -82,6 +84,33 @@ class FindField : BaseFinder() {
     var matcher: FieldMatcher? = null
         private set
 
+    /**
+     * Scheduling class of this query among concurrent queries on the same bridge,
+     * `null` lets DexKit choose.
+     * ----------------
+     * 此查询在同一 bridge 并发查询间的调度优先级，为 `null` 时由 DexKit 决定。
+     */
+    @set:JvmSynthetic
+    var priority: QueryPriority? = null
+
+    /**
+     * Share of the workers relative to other queries of the same [priority], 0 uses the default.
+     * ----------------
+     * 相对于同一 [priority] 的其他查询的工作线程份额，0 表示使用默认值。
+     */
+    @set:JvmSynthetic
+    var weight: Int = 0
+
+    /**
+     * Only search the dex files loaded by these sources, see [org.luckypray.dexkit.DexKitBridge.getSourceNum].
+     * `null` or empty searches every loaded dex.
+     * ----------------
+     * 仅在这些来源加载的 dex 中搜索，见 [org.luckypray.dexkit.DexKitBridge.getSourceNum]。
+     * 为 `null` 或空时搜索所有已加载的 dex。
+     */
+    @set:JvmSynthetic
+    var sourceIds: Collection<Int>? = null
+
     /**
      * Search classes in the specified packages.
      * ----------------
@@ -188,6 +217,46 @@ class FindField : BaseFinder() {
         this.matcher = matcher
     }
 
+    /**
+     * Scheduling class of this query among concurrent queries on the same bridge.
+     * ----------------
+     * 此查询在同一 bridge 并发查询间的调度优先级。
+     *
+     * @param priority query priority / 查询优先级
+     * @return [FindField]
+     */
+    fun priority(priority: QueryPriority) = also {
+        this.priority = priority
+    }
+
+    /**
+     * Share of the workers relative to other queries of the same [priority].
+     * ----------------
+     * 相对于同一 [priority] 的其他查询的工作线程份额。
+     *
+     * @param weight query weight, 0 uses the default / 查询权重，0 表示使用默认值
+     * @return [FindField]
+     */
+    fun weight(weight: Int) = also {
+        require(weight >= 0) { "weight must be non-negative" }
+        this.weight = weight
+    }
+
+    /**
+     * Only search the fields of the dex files loaded by these sources.
+     * ----------------
+     * 仅在这些来源加载的 dex 中搜索字段。
+     *
+     *     searchInSources(listOf(0))
+     *
+     * @param sourceIds source ids, in the order the sources were added / 来源 id，与来源添加顺序一致
+     * @return [FindField]
+     */
+    fun searchInSources(sourceIds: Collection<Int>) = also {
+        require(sourceIds.all { it >= 0 }) { "sourceIds must be non-negative" }
+        this.sourceIds = sourceIds
+    }
+
     // region DSL
 
     /**
@@ -205,6 +274,7 @@ class FindField : BaseFinder() {
         fun create() = FindField()
     }
     
+    @OptIn(ExperimentalUnsignedTypes::class)
     override fun innerBuild(fbb: FlatBufferBuilder): Int {
         val root = InnerFindField.createFindField(
             fbb,
@@ -218,7 +288,11 @@ class FindField : BaseFinder() {
             searchFields?.map { it.getEncodeId() }?.toLongArray()
                 ?.let { InnerFindField.createInFieldsVector(fbb, it) } ?: 0,
             findFirst,
-            matcher?.build(fbb) ?: 0
+            matcher?.build(fbb) ?: 0,
+            priority?.value ?: InnerQueryPriority.Default,
+            weight.toUInt(),
+            sourceIds?.map { it.toUInt() }?.toUIntArray()
+                ?.let { InnerFindField.createSourceIdsVector(fbb, it) } ?: 0
         )
         fbb.finish(root)
         return root
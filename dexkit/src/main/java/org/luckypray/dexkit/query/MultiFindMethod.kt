@@ -0,0 +1,136 @@
+/*
+ * DexKit - An high-performance runtime parsing library for dex
+ * implemented in C++
+ * Copyright (C) 2022-2023 LuckyPray
+ * https://github.com/LuckyPray/DexKit
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public 
+ * License as published by the Free Software Foundation, either 
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see
+ * <https://www.gnu.org/licenses/>.
+ * <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+ */
+@file:Suppress("MemberVisibilityCanBePrivate", "unused")
+
+package org.luckypray.dexkit.query
+
+import com.google.flatbuffers.FlatBufferBuilder
+import org.luckypray.dexkit.InnerMultiFindMethod
+import org.luckypray.dexkit.InnerQueryPriority
+import org.luckypray.dexkit.query.base.BaseFinder
+import org.luckypray.dexkit.query.enums.QueryPriority
+
+class MultiFindMethod : BaseFinder() {
+    /**
+     * [FindMethod] queries answered by one scan of each dex, results keep this order.
+     * ----------------
+     * 通过每个 dex 的一次扫描完成的 [FindMethod] 查询，结果保持此顺序。
+     */
+    var queries: MutableList<FindMethod>? = null
+        private set
+
+    /**
+     * Scheduling class of the shared scan among concurrent queries on the same bridge,
+     * `null` lets DexKit choose.
+     * ----------------
+     * 共享扫描在同一 bridge 并发查询间的调度优先级，为 `null` 时由 DexKit 决定。
+     */
+    @set:JvmSynthetic
+    var priority: QueryPriority? = null
+
+    /**
+     * Share of the workers relative to other queries of the same [priority], 0 uses the default.
+     * ----------------
+     * 相对于同一 [priority] 的其他查询的工作线程份额，0 表示使用默认值。
+     */
+    @set:JvmSynthetic
+    var weight: Int = 0
+
+    /**
+     * Search methods for each of the given queries.
+     * ----------------
+     * 为每个给定的查询搜索方法。
+     *
+     * @param queries queries / 查询列表
+     * @return [MultiFindMethod]
+     */
+    fun queries(queries: Collection<FindMethod>) = also {
+        this.queries = queries.toMutableList()
+    }
+
+    /**
+     * Add a query to the shared scan.
+     * ----------------
+     * 向共享扫描中添加一个查询。
+     *
+     * @param query query / 查询
+     * @return [MultiFindMethod]
+     */
+    fun add(query: FindMethod) = also {
+        queries = queries ?: mutableListOf()
+        queries!!.add(query)
+    }
+
+    /**
+     * Scheduling class of the shared scan among concurrent queries on the same bridge.
+     * ----------------
+     * 共享扫描在同一 bridge 并发查询间的调度优先级。
+     *
+     * @param priority query priority / 查询优先级
+     * @return [MultiFindMethod]
+     */
+    fun priority(priority: QueryPriority) = also {
+        this.priority = priority
+    }
+
+    /**
+     * Share of the workers relative to other queries of the same [priority].
+     * ----------------
+     * 相对于同一 [priority] 的其他查询的工作线程份额。
+     *
+     * @param weight query weight, 0 uses the default / 查询权重，0 表示使用默认值
+     * @return [MultiFindMethod]
+     */
+    fun weight(weight: Int) = also {
+        require(weight >= 0) { "weight must be non-negative" }
+        this.weight = weight
+    }
+
+    // region DSL
+
+    /**
+     * @see add
+     */
+    @JvmSynthetic
+    fun add(init: FindMethod.() -> Unit) = also {
+        add(FindMethod().apply(init))
+    }
+
+    // endregion
+
+    companion object {
+        @JvmStatic
+        fun create() = MultiFindMethod()
+    }
+
+    override fun innerBuild(fbb: FlatBufferBuilder): Int {
+        val queries = queries ?: throw IllegalAccessException("queries not be empty")
+        val root = InnerMultiFindMethod.createMultiFindMethod(
+            fbb,
+            InnerMultiFindMethod.createQueriesVector(fbb, queries.map { it.build(fbb) }.toIntArray()),
+            priority?.value ?: InnerQueryPriority.Default,
+            weight.toUInt()
+        )
+        fbb.finish(root)
+        return root
+    }
+}
\ No newline at end of file
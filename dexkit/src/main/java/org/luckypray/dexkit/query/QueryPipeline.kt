@@ -0,0 +1,119 @@
+/*
+ * DexKit - An high-performance runtime parsing library for dex
+ * implemented in C++
+ * Copyright (C) 2022-2023 LuckyPray
+ * https://github.com/LuckyPray/DexKit
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public 
+ * License as published by the Free Software Foundation, either 
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see
+ * <https://www.gnu.org/licenses/>.
+ * <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+ */
+@file:Suppress("MemberVisibilityCanBePrivate", "unused")
+
+package org.luckypray.dexkit.query
+
+import com.google.flatbuffers.FlatBufferBuilder
+import org.luckypray.dexkit.InnerQueryPipeline
+import org.luckypray.dexkit.query.base.BaseFinder
+
+class QueryPipeline : BaseFinder() {
+    /**
+     * Stages run in order, a stage may search in the results of earlier ones.
+     * ----------------
+     * 按顺序执行的阶段，每个阶段可以在前序阶段的结果中搜索。
+     */
+    var stages: MutableList<QueryPipelineStage>? = null
+        private set
+
+    /**
+     * Index of the stage whose results are returned, `-1` for the last one.
+     * Stages it does not depend on are skipped.
+     * ----------------
+     * 返回结果的阶段索引，`-1` 表示最后一个阶段。与其无关的阶段将被跳过。
+     */
+    @set:JvmSynthetic
+    var outputStage: Int = -1
+
+    /**
+     * Run the given stages.
+     * ----------------
+     * 执行给定的阶段。
+     *
+     * @param stages stages / 阶段列表
+     * @return [QueryPipeline]
+     */
+    fun stages(stages: Collection<QueryPipelineStage>) = also {
+        this.stages = stages.toMutableList()
+    }
+
+    /**
+     * Append a stage, its index is the number of stages added before it.
+     * ----------------
+     * 追加一个阶段，其索引为之前已添加的阶段数量。
+     *
+     * @param stage stage / 阶段
+     * @return [QueryPipeline]
+     */
+    fun add(stage: QueryPipelineStage) = also {
+        stages = stages ?: mutableListOf()
+        stages!!.add(stage)
+    }
+
+    /**
+     * Index of the stage whose results are returned.
+     * ----------------
+     * 返回结果的阶段索引。
+     *
+     * @param stage stage index / 阶段索引
+     * @return [QueryPipeline]
+     */
+    fun outputStage(stage: Int) = also {
+        require(stage >= 0) { "stage must be non-negative" }
+        this.outputStage = stage
+    }
+
+    // region DSL
+
+    /**
+     * @see add
+     */
+    @JvmSynthetic
+    fun add(init: QueryPipelineStage.() -> Unit) = also {
+        add(QueryPipelineStage().apply(init))
+    }
+
+    // endregion
+
+    companion object {
+        @JvmStatic
+        fun create() = QueryPipeline()
+    }
+
+    @JvmSynthetic
+    internal fun resolveOutputStage(): QueryPipelineStage? {
+        val stages = stages ?: return null
+        return stages.getOrNull(if (outputStage < 0) stages.size - 1 else outputStage)
+    }
+
+    override fun innerBuild(fbb: FlatBufferBuilder): Int {
+        val stages = stages ?: throw IllegalAccessException("stages not be empty")
+        val root = InnerQueryPipeline.createQueryPipeline(
+            fbb,
+            InnerQueryPipeline.createStagesVector(fbb, stages.map { it.build(fbb) }.toIntArray()),
+            outputStage
+        )
+        fbb.finish(root)
+        return root
+    }
+}
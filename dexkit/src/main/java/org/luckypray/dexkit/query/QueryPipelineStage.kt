@@ -0,0 +1,214 @@
+/*
+ * DexKit - An high-performance runtime parsing library for dex
+ * implemented in C++
+ * Copyright (C) 2022-2023 LuckyPray
+ * https://github.com/LuckyPray/DexKit
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public 
+ * License as published by the Free Software Foundation, either 
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see
+ * <https://www.gnu.org/licenses/>.
+ * <https://github.com/LuckyPray/DexKit/blob/master/LICENSE>.
+ */
+@file:Suppress("MemberVisibilityCanBePrivate", "unused")
+
+package org.luckypray.dexkit.query
+
+import com.google.flatbuffers.FlatBufferBuilder
+import org.luckypray.dexkit.InnerQueryPipelineStage
+import org.luckypray.dexkit.query.base.BaseMatcher
+
+class QueryPipelineStage : BaseMatcher() {
+    /**
+     * Class query of this stage, a stage runs exactly one of [findClass], [findMethod] or [findField].
+     * ----------------
+     * 该阶段的类查询，每个阶段只执行 [findClass]、[findMethod]、[findField] 中的一个。
+     */
+    var findClass: FindClass? = null
+        private set
+
+    /**
+     * Method query of this stage.
+     * ----------------
+     * 该阶段的方法查询。
+     */
+    var findMethod: FindMethod? = null
+        private set
+
+    /**
+     * Field query of this stage.
+     * ----------------
+     * 该阶段的字段查询。
+     */
+    var findField: FindField? = null
+        private set
+
+    /**
+     * Index of an earlier stage whose classes replace the query's own search classes,
+     * method or field results contribute their declaring classes. `-1` keeps the query's own.
+     * ----------------
+     * 前序阶段的索引，其结果类将替换该查询自身的搜索类，方法或字段结果取其声明类。
+     * `-1` 表示使用查询自身的设置。
+     */
+    @set:JvmSynthetic
+    var inClassesFrom: Int = -1
+
+    /**
+     * Index of an earlier method stage whose results replace the query's own search methods.
+     * ----------------
+     * 前序方法阶段的索引，其结果将替换该查询自身的搜索方法。
+     */
+    @set:JvmSynthetic
+    var inMethodsFrom: Int = -1
+
+    /**
+     * Index of an earlier field stage whose results replace the query's own search fields.
+     * ----------------
+     * 前序字段阶段的索引，其结果将替换该查询自身的搜索字段。
+     */
+    @set:JvmSynthetic
+    var inFieldsFrom: Int = -1
+
+    /**
+     * Run a class query in this stage.
+     * ----------------
+     * 在该阶段执行类查询。
+     *
+     * @param query query / 查询
+     * @return [QueryPipelineStage]
+     */
+    fun findClass(query: FindClass) = also {
+        clearQuery()
+        this.findClass = query
+    }
+
+    /**
+     * Run a method query in this stage.
+     * ----------------
+     * 在该阶段执行方法查询。
+     *
+     * @param query query / 查询
+     * @return [QueryPipelineStage]
+     */
+    fun findMethod(query: FindMethod) = also {
+        clearQuery()
+        this.findMethod = query
+    }
+
+    /**
+     * Run a field query in this stage.
+     * ----------------
+     * 在该阶段执行字段查询。
+     *
+     * @param query query / 查询
+     * @return [QueryPipelineStage]
+     */
+    fun findField(query: FindField) = also {
+        clearQuery()
+        this.findField = query
+    }
+
+    /**
+     * Search in the classes found by an earlier stage.
+     * ----------------
+     * 在前序阶段找到的类中搜索。
+     *
+     * @param stage earlier stage index / 前序阶段索引
+     * @return [QueryPipelineStage]
+     */
+    fun inClassesFrom(stage: Int) = also {
+        require(stage >= 0) { "stage must be non-negative" }
+        this.inClassesFrom = stage
+    }
+
+    /**
+     * Search in the methods found by an earlier method stage.
+     * ----------------
+     * 在前序方法阶段找到的方法中搜索。
+     *
+     * @param stage earlier stage index / 前序阶段索引
+     * @return [QueryPipelineStage]
+     */
+    fun inMethodsFrom(stage: Int) = also {
+        require(stage >= 0) { "stage must be non-negative" }
+        this.inMethodsFrom = stage
+    }
+
+    /**
+     * Search in the fields found by an earlier field stage.
+     * ----------------
+     * 在前序字段阶段找到的字段中搜索。
+     *
+     * @param stage earlier stage index / 前序阶段索引
+     * @return [QueryPipelineStage]
+     */
+    fun inFieldsFrom(stage: Int) = also {
+        require(stage >= 0) { "stage must be non-negative" }
+        this.inFieldsFrom = stage
+    }
+
+    private fun clearQuery() {
+        findClass = null
+        findMethod = null
+        findField = null
+    }
+
+    // region DSL
+
+    /**
+     * @see findClass
+     */
+    @JvmSynthetic
+    fun findClass(init: FindClass.() -> Unit) = also {
+        findClass(FindClass().apply(init))
+    }
+
+    /**
+     * @see findMethod
+     */
+    @JvmSynthetic
+    fun findMethod(init: FindMethod.() -> Unit) = also {
+        findMethod(FindMethod().apply(init))
+    }
+
+    /**
+     * @see findField
+     */
+    @JvmSynthetic
+    fun findField(init: FindField.() -> Unit) = also {
+        findField(FindField().apply(init))
+    }
+
+    // endregion
+
+    companion object {
+        @JvmStatic
+        fun create() = QueryPipelineStage()
+    }
+
+    override fun innerBuild(fbb: FlatBufferBuilder): Int {
+        if (findClass == null && findMethod == null && findField == null) {
+            throw IllegalAccessException("stage query not be empty")
+        }
+        val root = InnerQueryPipelineStage.createQueryPipelineStage(
+            fbb,
+            findClass?.build(fbb) ?: 0,
+            findMethod?.build(fbb) ?: 0,
+            findField?.build(fbb) ?: 0,
+            inClassesFrom,
+            inMethodsFrom,
+            inFieldsFrom
+        )
+        fbb.finish(root)
+        return root
+    }
+}
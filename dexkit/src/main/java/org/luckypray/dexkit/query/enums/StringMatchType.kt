@@ -30,5 +30,6 @@ enum class StringMatchType(val value: Byte) {
     EndsWith(InnerStringMatchType.EndWith),
     SimilarRegex(InnerStringMatchType.SimilarRegex),
     Equals(InnerStringMatchType.Equal),
+    Regex(InnerStringMatchType.Regex),
     ;
 }
\ No newline at end of file
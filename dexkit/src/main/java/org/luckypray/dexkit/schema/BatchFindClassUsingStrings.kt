@@ -102,6 +102,34 @@ internal class `-BatchFindClassUsingStrings` : Table() {
         get() {
             val o = __offset(12); return if (o != 0) __vector_len(o) else 0
         }
+    val priority : Byte
+        get() {
+            val o = __offset(14)
+            return if(o != 0) bb.get(o + bb_pos) else 0
+        }
+    fun mutatePriority(priority: Byte) : Boolean {
+        val o = __offset(14)
+        return if (o != 0) {
+            bb.put(o + bb_pos, priority)
+            true
+        } else {
+            false
+        }
+    }
+    val weight : UInt
+        get() {
+            val o = __offset(16)
+            return if(o != 0) bb.getInt(o + bb_pos).toUInt() else 0u
+        }
+    fun mutateWeight(weight: UInt) : Boolean {
+        val o = __offset(16)
+        return if (o != 0) {
+            bb.putInt(o + bb_pos, weight.toInt())
+            true
+        } else {
+            false
+        }
+    }
     companion object {
         fun validateVersion() = Constants.FLATBUFFERS_23_5_26()
         fun getRootAsBatchFindClassUsingStrings(_bb: ByteBuffer): `-BatchFindClassUsingStrings` = getRootAsBatchFindClassUsingStrings(_bb, `-BatchFindClassUsingStrings`())
@@ -109,16 +137,18 @@ internal class `-BatchFindClassUsingStrings` : Table() {
             _bb.order(ByteOrder.LITTLE_ENDIAN)
             return (obj.__assign(_bb.getInt(_bb.position()) + _bb.position(), _bb))
         }
-        fun createBatchFindClassUsingStrings(builder: FlatBufferBuilder, searchPackagesOffset: Int, excludePackagesOffset: Int, ignorePackagesCase: Boolean, inClassesOffset: Int, matchersOffset: Int) : Int {
-            builder.startTable(5)
+        fun createBatchFindClassUsingStrings(builder: FlatBufferBuilder, searchPackagesOffset: Int, excludePackagesOffset: Int, ignorePackagesCase: Boolean, inClassesOffset: Int, matchersOffset: Int, priority: Byte, weight: UInt) : Int {
+            builder.startTable(7)
+            addWeight(builder, weight)
             addMatchers(builder, matchersOffset)
             addInClasses(builder, inClassesOffset)
             addExcludePackages(builder, excludePackagesOffset)
             addSearchPackages(builder, searchPackagesOffset)
+            addPriority(builder, priority)
             addIgnorePackagesCase(builder, ignorePackagesCase)
             return endBatchFindClassUsingStrings(builder)
         }
-        fun startBatchFindClassUsingStrings(builder: FlatBufferBuilder) = builder.startTable(5)
+        fun startBatchFindClassUsingStrings(builder: FlatBufferBuilder) = builder.startTable(7)
         fun addSearchPackages(builder: FlatBufferBuilder, searchPackages: Int) = builder.addOffset(0, searchPackages, 0)
         fun createSearchPackagesVector(builder: FlatBufferBuilder, data: IntArray) : Int {
             builder.startVector(4, data.size, 4)
@@ -156,6 +186,8 @@ internal class `-BatchFindClassUsingStrings` : Table() {
             return builder.endVector()
         }
         fun startMatchersVector(builder: FlatBufferBuilder, numElems: Int) = builder.startVector(4, numElems, 4)
+        fun addPriority(builder: FlatBufferBuilder, priority: Byte) = builder.addByte(5, priority, 0)
+        fun addWeight(builder: FlatBufferBuilder, weight: UInt) = builder.addInt(6, weight.toInt(), 0)
         fun endBatchFindClassUsingStrings(builder: FlatBufferBuilder) : Int {
             val o = builder.endTable()
             return o
@@ -135,6 +135,57 @@ internal class `-FindField` : Table() {
             null
         }
     }
+    val priority : Byte
+        get() {
+            val o = __offset(18)
+            return if(o != 0) bb.get(o + bb_pos) else 0
+        }
+    fun mutatePriority(priority: Byte) : Boolean {
+        val o = __offset(18)
+        return if (o != 0) {
+            bb.put(o + bb_pos, priority)
+            true
+        } else {
+            false
+        }
+    }
+    val weight : UInt
+        get() {
+            val o = __offset(20)
+            return if(o != 0) bb.getInt(o + bb_pos).toUInt() else 0u
+        }
+    fun mutateWeight(weight: UInt) : Boolean {
+        val o = __offset(20)
+        return if (o != 0) {
+            bb.putInt(o + bb_pos, weight.toInt())
+            true
+        } else {
+            false
+        }
+    }
+    fun sourceIds(j: Int) : UInt {
+        val o = __offset(22)
+        return if (o != 0) {
+            bb.getInt(__vector(o) + j * 4).toUInt()
+        } else {
+            0u
+        }
+    }
+    val sourceIdsLength : Int
+        get() {
+            val o = __offset(22); return if (o != 0) __vector_len(o) else 0
+        }
+    val sourceIdsAsByteBuffer : ByteBuffer get() = __vector_as_bytebuffer(22, 4)
+    fun sourceIdsInByteBuffer(_bb: ByteBuffer) : ByteBuffer = __vector_in_bytebuffer(_bb, 22, 4)
+    fun mutateSourceIds(j: Int, sourceIds: UInt) : Boolean {
+        val o = __offset(22)
+        return if (o != 0) {
+            bb.putInt(__vector(o) + j * 4, sourceIds.toInt())
+            true
+        } else {
+            false
+        }
+    }
     companion object {
         fun validateVersion() = Constants.FLATBUFFERS_23_5_26()
         fun getRootAsFindField(_bb: ByteBuffer): `-FindField` = getRootAsFindField(_bb, `-FindField`())
@@ -142,18 +193,21 @@ internal class `-FindField` : Table() {
             _bb.order(ByteOrder.LITTLE_ENDIAN)
             return (obj.__assign(_bb.getInt(_bb.position()) + _bb.position(), _bb))
         }
-        fun createFindField(builder: FlatBufferBuilder, searchPackagesOffset: Int, excludePackagesOffset: Int, ignorePackagesCase: Boolean, inClassesOffset: Int, inFieldsOffset: Int, findFirst: Boolean, matcherOffset: Int) : Int {
-            builder.startTable(7)
+        fun createFindField(builder: FlatBufferBuilder, searchPackagesOffset: Int, excludePackagesOffset: Int, ignorePackagesCase: Boolean, inClassesOffset: Int, inFieldsOffset: Int, findFirst: Boolean, matcherOffset: Int, priority: Byte, weight: UInt, sourceIdsOffset: Int) : Int {
+            builder.startTable(10)
+            addSourceIds(builder, sourceIdsOffset)
+            addWeight(builder, weight)
             addMatcher(builder, matcherOffset)
             addInFields(builder, inFieldsOffset)
             addInClasses(builder, inClassesOffset)
             addExcludePackages(builder, excludePackagesOffset)
             addSearchPackages(builder, searchPackagesOffset)
+            addPriority(builder, priority)
             addFindFirst(builder, findFirst)
             addIgnorePackagesCase(builder, ignorePackagesCase)
             return endFindField(builder)
         }
-        fun startFindField(builder: FlatBufferBuilder) = builder.startTable(7)
+        fun startFindField(builder: FlatBufferBuilder) = builder.startTable(10)
         fun addSearchPackages(builder: FlatBufferBuilder, searchPackages: Int) = builder.addOffset(0, searchPackages, 0)
         fun createSearchPackagesVector(builder: FlatBufferBuilder, data: IntArray) : Int {
             builder.startVector(4, data.size, 4)
@@ -193,6 +247,18 @@ internal class `-FindField` : Table() {
         fun startInFieldsVector(builder: FlatBufferBuilder, numElems: Int) = builder.startVector(8, numElems, 8)
         fun addFindFirst(builder: FlatBufferBuilder, findFirst: Boolean) = builder.addBoolean(5, findFirst, false)
         fun addMatcher(builder: FlatBufferBuilder, matcher: Int) = builder.addOffset(6, matcher, 0)
+        fun addPriority(builder: FlatBufferBuilder, priority: Byte) = builder.addByte(7, priority, 0)
+        fun addWeight(builder: FlatBufferBuilder, weight: UInt) = builder.addInt(8, weight.toInt(), 0)
+        fun addSourceIds(builder: FlatBufferBuilder, sourceIds: Int) = builder.addOffset(9, sourceIds, 0)
+        @kotlin.ExperimentalUnsignedTypes
+        fun createSourceIdsVector(builder: FlatBufferBuilder, data: UIntArray) : Int {
+            builder.startVector(4, data.size, 4)
+            for (i in data.size - 1 downTo 0) {
+                builder.addInt(data[i].toInt())
+            }
+            return builder.endVector()
+        }
+        fun startSourceIdsVector(builder: FlatBufferBuilder, numElems: Int) = builder.startVector(4, numElems, 4)
         fun endFindField(builder: FlatBufferBuilder) : Int {
             val o = builder.endTable()
             return o
@@ -0,0 +1,103 @@
+// automatically generated by the FlatBuffers compiler, do not modify
+
+package org.luckypray.dexkit.schema
+
+import com.google.flatbuffers.BaseVector
+import com.google.flatbuffers.BooleanVector
+import com.google.flatbuffers.ByteVector
+import com.google.flatbuffers.Constants
+import com.google.flatbuffers.DoubleVector
+import com.google.flatbuffers.FlatBufferBuilder
+import com.google.flatbuffers.FloatVector
+import com.google.flatbuffers.LongVector
+import com.google.flatbuffers.StringVector
+import com.google.flatbuffers.Struct
+import com.google.flatbuffers.Table
+import com.google.flatbuffers.UnionVector
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import kotlin.math.sign
+
+@Suppress("unused")
+internal class `-MultiFindMethod` : Table() {
+
+    fun __init(_i: Int, _bb: ByteBuffer)  {
+        __reset(_i, _bb)
+    }
+    fun __assign(_i: Int, _bb: ByteBuffer) : `-MultiFindMethod` {
+        __init(_i, _bb)
+        return this
+    }
+    fun queries(j: Int) : `-FindMethod`? = queries(`-FindMethod`(), j)
+    fun queries(obj: `-FindMethod`, j: Int) : `-FindMethod`? {
+        val o = __offset(4)
+        return if (o != 0) {
+            obj.__assign(__indirect(__vector(o) + j * 4), bb)
+        } else {
+            null
+        }
+    }
+    val queriesLength : Int
+        get() {
+            val o = __offset(4); return if (o != 0) __vector_len(o) else 0
+        }
+    val priority : Byte
+        get() {
+            val o = __offset(6)
+            return if(o != 0) bb.get(o + bb_pos) else 0
+        }
+    fun mutatePriority(priority: Byte) : Boolean {
+        val o = __offset(6)
+        return if (o != 0) {
+            bb.put(o + bb_pos, priority)
+            true
+        } else {
+            false
+        }
+    }
+    val weight : UInt
+        get() {
+            val o = __offset(8)
+            return if(o != 0) bb.getInt(o + bb_pos).toUInt() else 0u
+        }
+    fun mutateWeight(weight: UInt) : Boolean {
+        val o = __offset(8)
+        return if (o != 0) {
+            bb.putInt(o + bb_pos, weight.toInt())
+            true
+        } else {
+            false
+        }
+    }
+    companion object {
+        fun validateVersion() = Constants.FLATBUFFERS_23_5_26()
+        fun getRootAsMultiFindMethod(_bb: ByteBuffer): `-MultiFindMethod` = getRootAsMultiFindMethod(_bb, `-MultiFindMethod`())
+        fun getRootAsMultiFindMethod(_bb: ByteBuffer, obj: `-MultiFindMethod`): `-MultiFindMethod` {
+            _bb.order(ByteOrder.LITTLE_ENDIAN)
+            return (obj.__assign(_bb.getInt(_bb.position()) + _bb.position(), _bb))
+        }
+        fun createMultiFindMethod(builder: FlatBufferBuilder, queriesOffset: Int, priority: Byte, weight: UInt) : Int {
+            builder.startTable(3)
+            addWeight(builder, weight)
+            addQueries(builder, queriesOffset)
+            addPriority(builder, priority)
+            return endMultiFindMethod(builder)
+        }
+        fun startMultiFindMethod(builder: FlatBufferBuilder) = builder.startTable(3)
+        fun addQueries(builder: FlatBufferBuilder, queries: Int) = builder.addOffset(0, queries, 0)
+        fun createQueriesVector(builder: FlatBufferBuilder, data: IntArray) : Int {
+            builder.startVector(4, data.size, 4)
+            for (i in data.size - 1 downTo 0) {
+                builder.addOffset(data[i])
+            }
+            return builder.endVector()
+        }
+        fun startQueriesVector(builder: FlatBufferBuilder, numElems: Int) = builder.startVector(4, numElems, 4)
+        fun addPriority(builder: FlatBufferBuilder, priority: Byte) = builder.addByte(1, priority, 0)
+        fun addWeight(builder: FlatBufferBuilder, weight: UInt) = builder.addInt(2, weight.toInt(), 0)
+        fun endMultiFindMethod(builder: FlatBufferBuilder) : Int {
+            val o = builder.endTable()
+            return o
+        }
+    }
+}
\ No newline at end of file
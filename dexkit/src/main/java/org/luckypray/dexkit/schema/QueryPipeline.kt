@@ -0,0 +1,87 @@
+// automatically generated by the FlatBuffers compiler, do not modify
+
+package org.luckypray.dexkit.schema
+
+import com.google.flatbuffers.BaseVector
+import com.google.flatbuffers.BooleanVector
+import com.google.flatbuffers.ByteVector
+import com.google.flatbuffers.Constants
+import com.google.flatbuffers.DoubleVector
+import com.google.flatbuffers.FlatBufferBuilder
+import com.google.flatbuffers.FloatVector
+import com.google.flatbuffers.LongVector
+import com.google.flatbuffers.StringVector
+import com.google.flatbuffers.Struct
+import com.google.flatbuffers.Table
+import com.google.flatbuffers.UnionVector
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import kotlin.math.sign
+
+@Suppress("unused")
+internal class `-QueryPipeline` : Table() {
+
+    fun __init(_i: Int, _bb: ByteBuffer)  {
+        __reset(_i, _bb)
+    }
+    fun __assign(_i: Int, _bb: ByteBuffer) : `-QueryPipeline` {
+        __init(_i, _bb)
+        return this
+    }
+    fun stages(j: Int) : `-QueryPipelineStage`? = stages(`-QueryPipelineStage`(), j)
+    fun stages(obj: `-QueryPipelineStage`, j: Int) : `-QueryPipelineStage`? {
+        val o = __offset(4)
+        return if (o != 0) {
+            obj.__assign(__indirect(__vector(o) + j * 4), bb)
+        } else {
+            null
+        }
+    }
+    val stagesLength : Int
+        get() {
+            val o = __offset(4); return if (o != 0) __vector_len(o) else 0
+        }
+    val outputStage : Int
+        get() {
+            val o = __offset(6)
+            return if(o != 0) bb.getInt(o + bb_pos) else -1
+        }
+    fun mutateOutputStage(outputStage: Int) : Boolean {
+        val o = __offset(6)
+        return if (o != 0) {
+            bb.putInt(o + bb_pos, outputStage)
+            true
+        } else {
+            false
+        }
+    }
+    companion object {
+        fun validateVersion() = Constants.FLATBUFFERS_23_5_26()
+        fun getRootAsQueryPipeline(_bb: ByteBuffer): `-QueryPipeline` = getRootAsQueryPipeline(_bb, `-QueryPipeline`())
+        fun getRootAsQueryPipeline(_bb: ByteBuffer, obj: `-QueryPipeline`): `-QueryPipeline` {
+            _bb.order(ByteOrder.LITTLE_ENDIAN)
+            return (obj.__assign(_bb.getInt(_bb.position()) + _bb.position(), _bb))
+        }
+        fun createQueryPipeline(builder: FlatBufferBuilder, stagesOffset: Int, outputStage: Int) : Int {
+            builder.startTable(2)
+            addOutputStage(builder, outputStage)
+            addStages(builder, stagesOffset)
+            return endQueryPipeline(builder)
+        }
+        fun startQueryPipeline(builder: FlatBufferBuilder) = builder.startTable(2)
+        fun addStages(builder: FlatBufferBuilder, stages: Int) = builder.addOffset(0, stages, 0)
+        fun createStagesVector(builder: FlatBufferBuilder, data: IntArray) : Int {
+            builder.startVector(4, data.size, 4)
+            for (i in data.size - 1 downTo 0) {
+                builder.addOffset(data[i])
+            }
+            return builder.endVector()
+        }
+        fun startStagesVector(builder: FlatBufferBuilder, numElems: Int) = builder.startVector(4, numElems, 4)
+        fun addOutputStage(builder: FlatBufferBuilder, outputStage: Int) = builder.addInt(1, outputStage, -1)
+        fun endQueryPipeline(builder: FlatBufferBuilder) : Int {
+            val o = builder.endTable()
+            return o
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+// automatically generated by the FlatBuffers compiler, do not modify
+
+package org.luckypray.dexkit.schema
+
+import com.google.flatbuffers.BaseVector
+import com.google.flatbuffers.BooleanVector
+import com.google.flatbuffers.ByteVector
+import com.google.flatbuffers.Constants
+import com.google.flatbuffers.DoubleVector
+import com.google.flatbuffers.FlatBufferBuilder
+import com.google.flatbuffers.FloatVector
+import com.google.flatbuffers.LongVector
+import com.google.flatbuffers.StringVector
+import com.google.flatbuffers.Struct
+import com.google.flatbuffers.Table
+import com.google.flatbuffers.UnionVector
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import kotlin.math.sign
+
+@Suppress("unused")
+internal class `-QueryPipelineStage` : Table() {
+
+    fun __init(_i: Int, _bb: ByteBuffer)  {
+        __reset(_i, _bb)
+    }
+    fun __assign(_i: Int, _bb: ByteBuffer) : `-QueryPipelineStage` {
+        __init(_i, _bb)
+        return this
+    }
+    val findClass : `-FindClass`? get() = findClass(`-FindClass`())
+    fun findClass(obj: `-FindClass`) : `-FindClass`? {
+        val o = __offset(4)
+        return if (o != 0) {
+            obj.__assign(__indirect(o + bb_pos), bb)
+        } else {
+            null
+        }
+    }
+    val findMethod : `-FindMethod`? get() = findMethod(`-FindMethod`())
+    fun findMethod(obj: `-FindMethod`) : `-FindMethod`? {
+        val o = __offset(6)
+        return if (o != 0) {
+            obj.__assign(__indirect(o + bb_pos), bb)
+        } else {
+            null
+        }
+    }
+    val findField : `-FindField`? get() = findField(`-FindField`())
+    fun findField(obj: `-FindField`) : `-FindField`? {
+        val o = __offset(8)
+        return if (o != 0) {
+            obj.__assign(__indirect(o + bb_pos), bb)
+        } else {
+            null
+        }
+    }
+    val inClassesFrom : Int
+        get() {
+            val o = __offset(10)
+            return if(o != 0) bb.getInt(o + bb_pos) else -1
+        }
+    fun mutateInClassesFrom(inClassesFrom: Int) : Boolean {
+        val o = __offset(10)
+        return if (o != 0) {
+            bb.putInt(o + bb_pos, inClassesFrom)
+            true
+        } else {
+            false
+        }
+    }
+    val inMethodsFrom : Int
+        get() {
+            val o = __offset(12)
+            return if(o != 0) bb.getInt(o + bb_pos) else -1
+        }
+    fun mutateInMethodsFrom(inMethodsFrom: Int) : Boolean {
+        val o = __offset(12)
+        return if (o != 0) {
+            bb.putInt(o + bb_pos, inMethodsFrom)
+            true
+        } else {
+            false
+        }
+    }
+    val inFieldsFrom : Int
+        get() {
+            val o = __offset(14)
+            return if(o != 0) bb.getInt(o + bb_pos) else -1
+        }
+    fun mutateInFieldsFrom(inFieldsFrom: Int) : Boolean {
+        val o = __offset(14)
+        return if (o != 0) {
+            bb.putInt(o + bb_pos, inFieldsFrom)
+            true
+        } else {
+            false
+        }
+    }
+    companion object {
+        fun validateVersion() = Constants.FLATBUFFERS_23_5_26()
+        fun getRootAsQueryPipelineStage(_bb: ByteBuffer): `-QueryPipelineStage` = getRootAsQueryPipelineStage(_bb, `-QueryPipelineStage`())
+        fun getRootAsQueryPipelineStage(_bb: ByteBuffer, obj: `-QueryPipelineStage`): `-QueryPipelineStage` {
+            _bb.order(ByteOrder.LITTLE_ENDIAN)
+            return (obj.__assign(_bb.getInt(_bb.position()) + _bb.position(), _bb))
+        }
+        fun createQueryPipelineStage(builder: FlatBufferBuilder, findClassOffset: Int, findMethodOffset: Int, findFieldOffset: Int, inClassesFrom: Int, inMethodsFrom: Int, inFieldsFrom: Int) : Int {
+            builder.startTable(6)
+            addInFieldsFrom(builder, inFieldsFrom)
+            addInMethodsFrom(builder, inMethodsFrom)
+            addInClassesFrom(builder, inClassesFrom)
+            addFindField(builder, findFieldOffset)
+            addFindMethod(builder, findMethodOffset)
+            addFindClass(builder, findClassOffset)
+            return endQueryPipelineStage(builder)
+        }
+        fun startQueryPipelineStage(builder: FlatBufferBuilder) = builder.startTable(6)
+        fun addFindClass(builder: FlatBufferBuilder, findClass: Int) = builder.addOffset(0, findClass, 0)
+        fun addFindMethod(builder: FlatBufferBuilder, findMethod: Int) = builder.addOffset(1, findMethod, 0)
+        fun addFindField(builder: FlatBufferBuilder, findField: Int) = builder.addOffset(2, findField, 0)
+        fun addInClassesFrom(builder: FlatBufferBuilder, inClassesFrom: Int) = builder.addInt(3, inClassesFrom, -1)
+        fun addInMethodsFrom(builder: FlatBufferBuilder, inMethodsFrom: Int) = builder.addInt(4, inMethodsFrom, -1)
+        fun addInFieldsFrom(builder: FlatBufferBuilder, inFieldsFrom: Int) = builder.addInt(5, inFieldsFrom, -1)
+        fun endQueryPipelineStage(builder: FlatBufferBuilder) : Int {
+            val o = builder.endTable()
+            return o
+        }
+    }
+}
\ No newline at end of file
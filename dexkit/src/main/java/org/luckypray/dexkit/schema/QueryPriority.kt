@@ -0,0 +1,13 @@
+// automatically generated by the FlatBuffers compiler, do not modify
+
+package org.luckypray.dexkit.schema
+
+@Suppress("unused")
+internal class `-QueryPriority` private constructor() {
+    companion object {
+        const val Default: Byte = 0
+        const val Background: Byte = 1
+        const val Normal: Byte = 2
+        const val LatencySensitive: Byte = 3
+    }
+}
\ No newline at end of file
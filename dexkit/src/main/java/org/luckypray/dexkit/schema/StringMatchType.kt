@@ -10,5 +10,6 @@ internal class `-StringMatchType` private constructor() {
         const val EndWith: Byte = 2
         const val SimilarRegex: Byte = 3
         const val Equal: Byte = 4
+        const val Regex: Byte = 5
     }
 }
\ No newline at end of file
@@ -2,13 +2,27 @@ package org.luckypray.dexkit
 
 import org.junit.Test
 import org.luckypray.dexkit.annotations.DexKitExperimentalApi
+import org.luckypray.dexkit.query.FindClass
+import org.luckypray.dexkit.query.FindField
+import org.luckypray.dexkit.query.FindMethod
+import org.luckypray.dexkit.query.QueryPipeline
+import org.luckypray.dexkit.query.enums.QueryPriority
 import org.luckypray.dexkit.query.enums.StringMatchType
 import org.luckypray.dexkit.query.enums.UsingType
+import org.luckypray.dexkit.result.ClassData
+import org.luckypray.dexkit.result.FieldData
+import org.luckypray.dexkit.result.FieldDataList
+import org.luckypray.dexkit.result.MethodData
+import org.luckypray.dexkit.result.MethodDataList
 import java.io.File
+import java.lang.reflect.Modifier
 import java.util.concurrent.CountDownLatch
 import java.util.concurrent.Executors
 import java.util.concurrent.TimeUnit
 import java.util.concurrent.atomic.AtomicReference
+import java.util.zip.ZipEntry
+import java.util.zip.ZipFile
+import java.util.zip.ZipOutputStream
 
 
 class UnitTest {
@@ -502,6 +516,99 @@ class UnitTest {
         assert(cls.className == "org.luckypray.dexkit.demo.PlayActivity")
     }
 
+    private fun findClassNames(packageName: String, pattern: String? = null): Set<String> {
+        return bridge.findClass {
+            searchPackages(packageName)
+            if (pattern != null) {
+                matcher {
+                    className(pattern, StringMatchType.Regex)
+                }
+            }
+        }.map { it.name }.toSet()
+    }
+
+    @Test
+    fun testRegexClassNameAnchors() {
+        val names = findClassNames("org.luckypray.dexkit.demo")
+        val pattern = "^org\\.luckypray\\.dexkit\\.demo\\.[A-Za-z]+Activity$"
+        val res = findClassNames("org.luckypray.dexkit.demo", pattern)
+        assert(res == names.filter { Regex(pattern).containsMatchIn(it) }.toSet())
+        assert(res.contains("org.luckypray.dexkit.demo.PlayActivity"))
+        // an end anchor before a begin anchor only matches the empty string
+        listOf("$^", "$^(a|b)*", "c*?$^\\d?").forEach {
+            assert(findClassNames("org.luckypray.dexkit.demo", it).isEmpty())
+        }
+    }
+
+    @Test
+    fun testRegexClassNameAlternation() {
+        val res = findClassNames("org.luckypray.dexkit.demo", "\\.(Play|Main)Activity$")
+        assert(res == setOf("org.luckypray.dexkit.demo.PlayActivity", "org.luckypray.dexkit.demo.MainActivity"))
+    }
+
+    @Test
+    fun testRegexClassNameDfaOverflow() {
+        // tracking every 'a' among the last 12 chars needs far more than the 1024 lazy DFA states,
+        // the rest of the input is matched by NFA simulation
+        val names = findClassNames("androidx")
+        val pattern = "a.{11}$"
+        val res = findClassNames("androidx", pattern)
+        assert(res.isNotEmpty())
+        assert(res == names.filter { Regex(pattern).containsMatchIn(it) }.toSet())
+    }
+
+    @Test
+    fun testRegexUnsupportedSyntaxMatchesNothing() {
+        listOf("Play(?=Activity)", "(Play)\\1", "Activity{2,1}").forEach {
+            assert(findClassNames("org.luckypray.dexkit.demo", it).isEmpty())
+        }
+    }
+
+    @Test
+    fun testRegexUsingStrings() {
+        fun find(value: String, matchType: StringMatchType) = bridge.findMethod {
+            searchPackages("org.luckypray.dexkit.demo")
+            matcher {
+                addUsingString(value, matchType)
+            }
+        }.map { it.descriptor }.toSet()
+        val res = find("^on(Create|Click)", StringMatchType.Regex)
+        assert(res.isNotEmpty())
+        assert(res == find("onCreate", StringMatchType.StartsWith) + find("onClick", StringMatchType.StartsWith))
+    }
+
+    @Test
+    fun testRegexIgnoreCase() {
+        fun findNames(pattern: String, ignoreCase: Boolean) = bridge.findClass {
+            searchPackages("org.luckypray.dexkit.demo")
+            matcher {
+                className(pattern, StringMatchType.Regex, ignoreCase)
+            }
+        }.map { it.name }.toSet()
+        val names = findClassNames("org.luckypray.dexkit.demo")
+        val alternation = "\\.(PLAY|main)activity$"
+        assert(findNames(alternation, false).isEmpty())
+        assert(findNames(alternation, true) == setOf(
+            "org.luckypray.dexkit.demo.PlayActivity",
+            "org.luckypray.dexkit.demo.MainActivity"
+        ))
+        // class ranges and escapes fold case as well
+        val range = "\\.[a-z]+ACTIVITY$"
+        assert(findNames(range, true) == names.filter {
+            Regex(range, RegexOption.IGNORE_CASE).containsMatchIn(it)
+        }.toSet())
+        fun findMethods(value: String, matchType: StringMatchType, ignoreCase: Boolean) = bridge.findMethod {
+            searchPackages("org.luckypray.dexkit.demo")
+            matcher {
+                addUsingString(value, matchType, ignoreCase)
+            }
+        }.map { it.descriptor }.toSet()
+        val res = findMethods("^ROLLDICE\\W", StringMatchType.Regex, true)
+        assert(res.isNotEmpty())
+        assert(res == findMethods("rollDice: ", StringMatchType.StartsWith, false))
+        assert(findMethods("^ROLLDICE\\W", StringMatchType.Regex, false).isEmpty())
+    }
+
     @Test
     fun testConcurrentFindMethodOnSharedBridge() {
         DexKitBridge.create(demoApkPath).use { parallelBridge ->
@@ -668,6 +775,847 @@ class UnitTest {
         }
     }
 
+    @Test
+    fun testQueryPriorityAndWeightKeepResults() {
+        DexKitBridge.create(demoApkPath).use { parallelBridge ->
+            parallelBridge.setThreadNum(2)
+            parallelBridge.setMaxConcurrentQueries(2)
+            val expected = parallelBridge.findMethod {
+                excludePackages("org.luckypray.dexkit.demo.hook")
+                matcher {
+                    usingNumbers(114514)
+                }
+            }.map { it.descriptor }.toSet()
+            assert(expected.size == 2)
+            val executor = Executors.newFixedThreadPool(QueryPriority.values().size)
+            try {
+                val futures = QueryPriority.values().mapIndexed { index, priority ->
+                    executor.submit<Set<String>> {
+                        parallelBridge.findMethod {
+                            priority(priority)
+                            weight(index + 1)
+                            excludePackages("org.luckypray.dexkit.demo.hook")
+                            matcher {
+                                usingNumbers(114514)
+                            }
+                        }.map { it.descriptor }.toSet()
+                    }
+                }
+                futures.forEach { assert(it.get(60, TimeUnit.SECONDS) == expected) }
+            } finally {
+                executor.shutdownNow()
+            }
+            val batch = parallelBridge.batchFindClassUsingStrings {
+                priority(QueryPriority.Background)
+                weight(3)
+                searchPackages("org.luckypray.dexkit.demo")
+                groups(mapOf("main_activity" to listOf("onClick: playButton")))
+            }
+            assert(batch["main_activity"]?.size == 1)
+        }
+    }
+
+    @Test
+    fun testMultiFindMatchesSingleQueries() {
+        val classQueries = listOf(
+            FindClass().matcher { usingStrings("PlayActivity") },
+            FindClass().searchPackages("org.luckypray.dexkit.demo").matcher {
+                className("Activity", StringMatchType.EndsWith)
+            },
+            FindClass().matcher { className("org.luckypray.dexkit.demo.NotExists") }
+        )
+        val classResults = bridge.multiFindClass { queries(classQueries) }
+        assert(classResults.size == classQueries.size)
+        classQueries.forEachIndexed { index, query ->
+            assert(classResults[index].map { it.descriptor } == bridge.findClass(query).map { it.descriptor })
+        }
+        val methodQueries = listOf(
+            FindMethod().matcher { usingNumbers(114514) },
+            FindMethod().searchPackages("org.luckypray.dexkit.demo").matcher { name = "onClick" },
+            FindMethod().matcher { usingStrings("NotExistsString-DexKit") }
+        )
+        val methodResults = bridge.multiFindMethod { queries(methodQueries) }
+        assert(methodResults.size == methodQueries.size)
+        methodQueries.forEachIndexed { index, query ->
+            assert(methodResults[index].map { it.descriptor } == bridge.findMethod(query).map { it.descriptor })
+        }
+        assert(methodResults[0].isNotEmpty())
+    }
+
+
+    // the indexes only narrow the candidates, a full scan gives the reference result
+    private fun assertSameWithoutQueryIndex(find: DexKitBridge.() -> List<String>): List<String> {
+        return DexKitBridge.create(demoApkPath).use { indexBridge ->
+            indexBridge.setQueryIndexEnabled(false)
+            val expected = indexBridge.find().sorted()
+            indexBridge.setQueryIndexEnabled(true)
+            assert(indexBridge.find().sorted() == expected)
+            expected
+        }
+    }
+
+    @Test
+    fun testOpCodeIndexKeepsResults() {
+        val onClick = "Lorg/luckypray/dexkit/demo/MainActivity;->onClick(Landroid/view/View;)V"
+        val opCodes = bridge.getMethodData(onClick)!!.opCodes
+        assert(opCodes.size >= 3)
+        val res = assertSameWithoutQueryIndex {
+            findMethod {
+                matcher {
+                    opCodes(opCodes.take(3))
+                }
+            }.map { it.descriptor }
+        }
+        assert(onClick in res)
+        val wildcard = assertSameWithoutQueryIndex {
+            findMethod {
+                matcher {
+                    opCodes(listOf(opCodes[0], -1, opCodes[2]))
+                }
+            }.map { it.descriptor }
+        }
+        assert(res.all { it in wildcard })
+    }
+
+    @Test
+    fun testSuperClassMatcherForms() {
+        val nameOnly = assertSameWithoutQueryIndex {
+            findClass {
+                matcher {
+                    superClass("androidx.appcompat.app.AppCompatActivity")
+                }
+            }.map { it.name }
+        }
+        assert(nameOnly.size == 2)
+        // a nested constraint takes the declaring dex of the super class into account
+        val nested = bridge.findClass {
+            matcher {
+                superClass {
+                    className("androidx.appcompat.app.AppCompatActivity")
+                    superClass("androidx.fragment.app.FragmentActivity")
+                }
+            }
+        }.map { it.name }.sorted()
+        assert(nested == nameOnly)
+        val implementors = assertSameWithoutQueryIndex {
+            findClass {
+                searchPackages("org.luckypray.dexkit.demo")
+                matcher {
+                    interfaces { add("android.view.View\$OnClickListener") }
+                }
+            }.map { it.name }
+        }
+        assert(implementors == listOf("org.luckypray.dexkit.demo.MainActivity"))
+    }
+
+    @Test
+    fun testFindSubclasses() {
+        val direct = bridge.findSubclasses("androidx.appcompat.app.AppCompatActivity", directOnly = true)
+        val matched = bridge.findClass {
+            matcher {
+                superClass("androidx.appcompat.app.AppCompatActivity")
+            }
+        }
+        assert(direct.map { it.descriptor } == matched.map { it.descriptor })
+        val transitive = bridge.findSubclasses("android.app.Activity").map { it.name }
+        assert(transitive.containsAll(listOf(
+            "androidx.appcompat.app.AppCompatActivity",
+            "org.luckypray.dexkit.demo.MainActivity",
+            "org.luckypray.dexkit.demo.PlayActivity"
+        )))
+        assert(bridge.findSubclasses("Landroid/app/Activity;").map { it.name } == transitive)
+        assert(bridge.findSubclasses("org.luckypray.dexkit.demo.NotExists").isEmpty())
+    }
+
+    @Test
+    fun testFindImplementors() {
+        val direct = bridge.findImplementors("android.view.View\$OnClickListener", directOnly = true).map { it.name }
+        assert("org.luckypray.dexkit.demo.MainActivity" in direct)
+        val transitive = bridge.findImplementors("android.view.View\$OnClickListener").map { it.name }
+        assert(transitive.containsAll(direct))
+        val demoImplementors = transitive.filter { it.startsWith("org.luckypray.dexkit.demo.") }
+        assert(demoImplementors == listOf("org.luckypray.dexkit.demo.MainActivity"))
+    }
+
+    @Test
+    fun testReferenceIndexKeepsResults() {
+        fun findUsingField(usingType: UsingType) = assertSameWithoutQueryIndex {
+            findMethod {
+                matcher {
+                    usingFields {
+                        add {
+                            declaredClass = "org.luckypray.dexkit.demo.RouterManager"
+                            name = "sApplication"
+                            this.usingType = usingType
+                        }
+                    }
+                }
+            }.map { it.descriptor }
+        }
+        val any = findUsingField(UsingType.Any)
+        assert(any.isNotEmpty())
+        assert(any == (findUsingField(UsingType.Get) + findUsingField(UsingType.Put)).distinct().sorted())
+        val invoking = assertSameWithoutQueryIndex {
+            findMethod {
+                searchPackages("org.luckypray.dexkit.demo")
+                matcher {
+                    addInvoke {
+                        declaredClass = "android.util.Log"
+                        name = "d"
+                    }
+                }
+            }.map { it.descriptor }
+        }
+        assert("Lorg/luckypray/dexkit/demo/MainActivity;->onClick(Landroid/view/View;)V" in invoking)
+        assertSameWithoutQueryIndex {
+            findMethod {
+                matcher {
+                    addCaller {
+                        declaredClass = "org.luckypray.dexkit.demo.MainActivity"
+                        name = "onClick"
+                    }
+                }
+            }.map { it.descriptor }
+        }
+    }
+
+    @Test
+    fun testMemberNameIndexKeepsResults() {
+        val onCreate = assertSameWithoutQueryIndex {
+            findMethod {
+                matcher {
+                    name = "onCreate"
+                    paramTypes("android.os.Bundle")
+                }
+            }.map { it.descriptor }
+        }
+        assert("Lorg/luckypray/dexkit/demo/PlayActivity;->onCreate(Landroid/os/Bundle;)V" in onCreate)
+        // every parameter type is exact, so the proto shorty alone seeds the candidates
+        val viewHandlers = assertSameWithoutQueryIndex {
+            findMethod {
+                searchPackages("org.luckypray.dexkit.demo")
+                matcher {
+                    returnType("void")
+                    paramTypes("android.view.View")
+                }
+            }.map { it.descriptor }
+        }
+        assert("Lorg/luckypray/dexkit/demo/MainActivity;->onClick(Landroid/view/View;)V" in viewHandlers)
+        val tags = assertSameWithoutQueryIndex {
+            findField {
+                matcher {
+                    name = "TAG"
+                }
+            }.map { it.descriptor }
+        }
+        assert("Lorg/luckypray/dexkit/demo/MainActivity;->TAG:Ljava/lang/String;" in tags)
+    }
+
+    @Test
+    fun testUsingNumberIndexKeepsResults() {
+        val ints = assertSameWithoutQueryIndex {
+            findMethod {
+                excludePackages("org.luckypray.dexkit.demo.hook")
+                matcher {
+                    usingNumbers(114514)
+                }
+            }.map { it.descriptor }
+        }
+        assert(ints.size == 2)
+        // floating constants are probed with the matcher tolerance
+        val floats = assertSameWithoutQueryIndex {
+            findMethod {
+                excludePackages("org.luckypray.dexkit.demo.hook")
+                matcher {
+                    usingNumbers {
+                        add {
+                            floatValue(0.987f)
+                        }
+                        add {
+                            intValue(114514)
+                        }
+                    }
+                }
+            }.map { it.descriptor }
+        }
+        assert(floats.size == 1)
+        assert(floats.all { it in ints })
+    }
+
+    @Test
+    fun testStringIndexKeepsResults() {
+        DexKitBridge.create(demoApkPath).use { indexBridge ->
+            fun find() = listOf(
+                indexBridge.findMethod {
+                    matcher { usingStrings(listOf("getRandomDice: "), StringMatchType.Equals) }
+                },
+                indexBridge.findMethod {
+                    matcher { addUsingString("rollDice", StringMatchType.Contains) }
+                },
+                indexBridge.findMethod {
+                    matcher { addUsingString("playButton", StringMatchType.EndsWith) }
+                }
+            ).map { result -> result.map { it.descriptor }.sorted() }
+            indexBridge.initFullCache()
+            assert(indexBridge.getStringIndexMemoryUsage() == 0L)
+            val expected = find()
+            assert(expected.all { it.isNotEmpty() })
+            indexBridge.buildStringIndex()
+            assert(indexBridge.getStringIndexMemoryUsage() > 0L)
+            assert(find() == expected)
+        }
+    }
+
+    @Test
+    fun testTypeNameIndexKeepsResults() {
+        val contains = assertSameWithoutQueryIndex {
+            findClass {
+                matcher {
+                    className("dexkit.demo.Play", StringMatchType.Contains)
+                }
+            }.map { it.name }
+        }
+        assert("org.luckypray.dexkit.demo.PlayActivity" in contains)
+        assert(contains.all { it.startsWith("org.luckypray.dexkit.demo.Play") })
+        val endsWith = assertSameWithoutQueryIndex {
+            findClass {
+                searchPackages("org.luckypray.dexkit.demo")
+                matcher {
+                    className("Activity", StringMatchType.EndsWith)
+                }
+            }.map { it.name }
+        }
+        assert(endsWith.containsAll(listOf(
+            "org.luckypray.dexkit.demo.MainActivity",
+            "org.luckypray.dexkit.demo.PlayActivity"
+        )))
+        // shorter than a trigram, nothing to look up
+        val short = assertSameWithoutQueryIndex {
+            findClass {
+                searchPackages("org.luckypray.dexkit.demo")
+                matcher {
+                    className("Ac", StringMatchType.Contains)
+                }
+            }.map { it.name }
+        }
+        assert(short.containsAll(endsWith))
+    }
+
+    private fun readDemoDexFiles(): Array<ByteArray> {
+        return ZipFile(demoApkPath).use { zip ->
+            generateSequence(1) { it + 1 }
+                .map { zip.getEntry(if (it == 1) "classes.dex" else "classes$it.dex") }
+                .takeWhile { it != null }
+                .map { entry -> zip.getInputStream(entry).use { it.readBytes() } }
+                .toList()
+                .toTypedArray()
+        }
+    }
+
+    private fun findForQueryResultCache(target: DexKitBridge): List<List<String>> {
+        return listOf(
+            target.findClass {
+                matcher { className("dexkit.demo.Play", StringMatchType.Contains) }
+            }.map { it.descriptor },
+            target.findMethod {
+                matcher { addUsingString("rollDice", StringMatchType.Contains) }
+            }.map { it.descriptor },
+            target.findField {
+                matcher { modifiers(Modifier.STATIC) }
+                searchPackages("org.luckypray.dexkit.demo")
+            }.map { it.descriptor }
+        ).map { it.sorted() }
+    }
+
+    @Test
+    fun testQueryResultCacheKeepsResults() {
+        val expected = findForQueryResultCache(bridge)
+        assert(expected.all { it.isNotEmpty() })
+        DexKitBridge.create(demoApkPath).use { cacheBridge ->
+            cacheBridge.setQueryResultCacheCapacity(1L shl 20)
+            assert(findForQueryResultCache(cacheBridge) == expected)
+            // served from the cache
+            assert(findForQueryResultCache(cacheBridge) == expected)
+            cacheBridge.setQueryResultCacheCapacity(0)
+            assert(findForQueryResultCache(cacheBridge) == expected)
+        }
+    }
+
+    @Test
+    fun testQueryResultCacheSaveAndLoad() {
+        val expected = findForQueryResultCache(bridge)
+        val cacheFile = File.createTempFile("dexkit-query-cache", ".bin")
+        try {
+            DexKitBridge.create(demoApkPath).use { saveBridge ->
+                saveBridge.setQueryResultCacheCapacity(1L shl 20)
+                findForQueryResultCache(saveBridge)
+                saveBridge.saveQueryResultCache(cacheFile.absolutePath)
+            }
+            assert(cacheFile.length() > 0)
+            val dexFiles = readDemoDexFiles()
+            // same dex files loaded from memory
+            DexKitBridge.create(dexFiles).use { loadBridge ->
+                loadBridge.setQueryResultCacheCapacity(1L shl 20)
+                assert(loadBridge.loadQueryResultCache(cacheFile.absolutePath))
+                assert(findForQueryResultCache(loadBridge) == expected)
+            }
+            // a different header signature stands in for another build of the apk
+            dexFiles[0] = dexFiles[0].copyOf().also { it[12] = (it[12] + 1).toByte() }
+            DexKitBridge.create(dexFiles).use { otherBridge ->
+                otherBridge.setQueryResultCacheCapacity(1L shl 20)
+                assert(!otherBridge.loadQueryResultCache(cacheFile.absolutePath))
+                assert(findForQueryResultCache(otherBridge) == expected)
+            }
+            DexKitBridge.create(demoApkPath).use { missBridge ->
+                missBridge.setQueryResultCacheCapacity(1L shl 20)
+                assert(!missBridge.loadQueryResultCache(cacheFile.absolutePath + ".missing"))
+            }
+        } finally {
+            cacheFile.delete()
+        }
+    }
+
+    @Test
+    fun testQueryPipelineMatchesSeparateQueries() {
+        fun findActivities() = FindClass().apply {
+            searchPackages("org.luckypray.dexkit.demo")
+            matcher { className("Activity", StringMatchType.EndsWith) }
+        }
+        val classes = bridge.findClass(findActivities())
+        val methods = bridge.findMethod {
+            searchInClass(classes)
+            matcher { name("onCreate") }
+        }
+        val fields = bridge.findField {
+            searchInClass(methods.map { it.declaredClass!! })
+        }
+        assert(classes.isNotEmpty() && methods.isNotEmpty() && fields.isNotEmpty())
+        fun pipeline() = QueryPipeline().apply {
+            add { findClass(findActivities()) }
+            add {
+                findMethod { matcher { name("onCreate") } }
+                inClassesFrom(0)
+            }
+            add {
+                findField(FindField())
+                inClassesFrom(1)
+            }
+        }
+        val chained = bridge.executeQueryPipeline(pipeline())
+        assert(chained is FieldDataList)
+        assert(chained.map { (it as FieldData).descriptor } == fields.map { it.descriptor })
+        val middle = bridge.executeQueryPipeline(pipeline().outputStage(1))
+        assert(middle is MethodDataList)
+        assert(middle.map { (it as MethodData).descriptor } == methods.map { it.descriptor })
+        val first = bridge.executeQueryPipeline(pipeline().outputStage(0))
+        assert(first.map { (it as ClassData).descriptor } == classes.map { it.descriptor })
+    }
+
+    @Test
+    fun testVerifyDexOnCreate() {
+        val expected = findForQueryResultCache(bridge)
+        DexKitBridge.create(demoApkPath, verifyDex = true).use { verifyBridge ->
+            assert(verifyBridge.getDexNum() == bridge.getDexNum())
+            assert(findForQueryResultCache(verifyBridge) == expected)
+        }
+        val dexFiles = readDemoDexFiles()
+        DexKitBridge.create(dexFiles, verifyDex = true).use { verifyBridge ->
+            assert(verifyBridge.getDexNum() == dexFiles.size)
+        }
+        // a stale checksum is only noticed when verification is on
+        dexFiles[0] = dexFiles[0].copyOf().also { it[8] = (it[8] + 1).toByte() }
+        DexKitBridge.create(dexFiles).use { uncheckedBridge ->
+            assert(findForQueryResultCache(uncheckedBridge) == expected)
+        }
+        try {
+            DexKitBridge.create(dexFiles, verifyDex = true).close()
+            throw AssertionError("dex with a bad checksum should be rejected")
+        } catch (_: IllegalStateException) {
+        }
+    }
+
+    @Test
+    fun testSourceScopedQueries() {
+        val otherApk = File.createTempFile("dexkit-source", ".apk")
+        try {
+            // a different header signature makes each dex a distinct copy with the same classes
+            ZipOutputStream(otherApk.outputStream()).use { zip ->
+                readDemoDexFiles().forEachIndexed { i, bytes ->
+                    zip.putNextEntry(ZipEntry(if (i == 0) "classes.dex" else "classes${i + 1}.dex"))
+                    zip.write(bytes.copyOf().also { it[12] = (it[12] + 1).toByte() })
+                    zip.closeEntry()
+                }
+            }
+            DexKitBridge.create(listOf(demoApkPath, demoApkPath, otherApk.absolutePath)).use { sourceBridge ->
+                assert(sourceBridge.getSourceNum() == 3)
+                // the second load of demo.apk shares the dex items of the first
+                assert(sourceBridge.getSourceDexIds(0) == sourceBridge.getSourceDexIds(1))
+                assert(sourceBridge.getDexNum() == bridge.getDexNum() * 2)
+                assert(sourceBridge.getSourceDexIds(2).none { it in sourceBridge.getSourceDexIds(0) })
+                assert(sourceBridge.getSourceDexIds(3).isEmpty())
+                fun find(sources: List<Int>?) = sourceBridge.findClass {
+                    sources?.let { searchInSources(it) }
+                    matcher { className("org.luckypray.dexkit.demo.MainActivity") }
+                }
+                assert(find(null).size == 2)
+                assert(find(listOf(0)).size == 1)
+                assert(find(listOf(1)).size == 1)
+                assert(find(listOf(0, 1)).size == 1)
+                assert(find(listOf(2)).size == 1)
+                assert(find(listOf(1, 2)).size == 2)
+                assert(find(listOf(3)).isEmpty())
+                val scopedMethods = sourceBridge.findMethod {
+                    searchInSources(listOf(2))
+                    matcher { addUsingString("rollDice", StringMatchType.Contains) }
+                }
+                assert(scopedMethods.map { it.descriptor } == bridge.findMethod {
+                    matcher { addUsingString("rollDice", StringMatchType.Contains) }
+                }.map { it.descriptor })
+            }
+        } finally {
+            otherApk.delete()
+        }
+    }
+
+    @Test
+    fun testThreadNumAndWarmUpKeepResults() {
+        val expected = findForQueryResultCache(bridge)
+        assert(expected.all { it.isNotEmpty() })
+        DexKitBridge.create(demoApkPath).use { poolBridge ->
+            // every change of the thread count replaces the pool shared by queries and warm-up
+            listOf(1, 4, 2).forEach { threadNum ->
+                poolBridge.setThreadNum(threadNum)
+                assert(findForQueryResultCache(poolBridge) == expected)
+                poolBridge.initFullCache()
+                assert(findForQueryResultCache(poolBridge) == expected)
+            }
+        }
+        // the sources are read on the same pool
+        DexKitBridge.create(listOf(demoApkPath, demoApkPath)).use { pathsBridge ->
+            pathsBridge.setThreadNum(3)
+            pathsBridge.initFullCache()
+            assert(findForQueryResultCache(pathsBridge).map { it.distinct() } == expected.map { it.distinct() })
+        }
+    }
+
+    // overlapping keywords, one keyword inside another and a group that matches nothing
+    private val usingStringsGroups = mapOf(
+        "on_click" to listOf("onClick"),
+        "play_activity" to listOf("onClick: rollButton", "rollDice"),
+        "dice" to listOf("Dice"),
+        "roll_dice" to listOf("rollDice: ", "Dice"),
+        "not_exists" to listOf("onClick", "NotExistsString-DexKit")
+    )
+
+    private fun batchFindUsingStrings(target: DexKitBridge): List<Map<String, List<String>>> {
+        val classes = target.batchFindClassUsingStrings {
+            searchPackages("org.luckypray.dexkit.demo")
+            groups(usingStringsGroups)
+        }
+        val methods = target.batchFindMethodUsingStrings {
+            searchPackages("org.luckypray.dexkit.demo")
+            groups(usingStringsGroups)
+        }
+        return listOf(
+            usingStringsGroups.keys.associateWith { key -> classes[key].orEmpty().map { it.descriptor }.sorted() },
+            usingStringsGroups.keys.associateWith { key -> methods[key].orEmpty().map { it.descriptor }.sorted() }
+        )
+    }
+
+    @Test
+    fun testBatchFindUsingStringsMatchesSingleQueries() {
+        val (classes, methods) = batchFindUsingStrings(bridge)
+        usingStringsGroups.forEach { (key, usingStrings) ->
+            assert(classes[key] == bridge.findClass {
+                searchPackages("org.luckypray.dexkit.demo")
+                matcher { usingStrings(usingStrings) }
+            }.map { it.descriptor }.sorted())
+            assert(methods[key] == bridge.findMethod {
+                searchPackages("org.luckypray.dexkit.demo")
+                matcher { usingStrings(usingStrings) }
+            }.map { it.descriptor }.sorted())
+        }
+        assert(classes.getValue("on_click").size == 2)
+        assert(classes.getValue("play_activity").size == 1)
+        assert(methods.getValue("play_activity").isEmpty())
+        assert(methods.getValue("dice").size >= 2)
+        assert(classes.getValue("not_exists").isEmpty())
+    }
+
+    @Test
+    fun testBatchFindUsingStringsKeepsResultsAcrossThreadNum() {
+        val expected = batchFindUsingStrings(bridge)
+        DexKitBridge.create(demoApkPath).use { sliceBridge ->
+            // the slices of a dex are merged into the same groups, whatever the thread count
+            listOf(1, 4).forEach { threadNum ->
+                sliceBridge.setThreadNum(threadNum)
+                assert(batchFindUsingStrings(sliceBridge) == expected)
+            }
+        }
+    }
+
+    @Test
+    fun testFindResultsMatchGetData() {
+        // results are written straight from the dex, they must read the same as a lookup
+        val classes = bridge.findClass {
+            searchPackages("org.luckypray.dexkit.demo")
+        }
+        assert(classes.isNotEmpty())
+        classes.forEach { found ->
+            val data = bridge.getClassData(found.descriptor)!!
+            assert(found.getEncodeId() == data.getEncodeId())
+            assert(found.sourceFile == data.sourceFile)
+            assert(found.modifiers == data.modifiers)
+            assert(found.superClass?.descriptor == data.superClass?.descriptor)
+            assert(found.interfaces.map { it.descriptor } == data.interfaces.map { it.descriptor })
+            assert(found.methods.map { it.descriptor } == data.methods.map { it.descriptor })
+            assert(found.fields.map { it.descriptor } == data.fields.map { it.descriptor })
+        }
+        val methods = bridge.findMethod {
+            searchPackages("org.luckypray.dexkit.demo")
+        }
+        assert(methods.isNotEmpty())
+        methods.forEach { found ->
+            val data = bridge.getMethodData(found.descriptor)!!
+            assert(found.getEncodeId() == data.getEncodeId())
+            assert(found.modifiers == data.modifiers)
+            assert(found.returnTypeName == data.returnTypeName)
+            assert(found.paramTypeNames == data.paramTypeNames)
+            assert(found.declaredClass?.descriptor == data.declaredClass?.descriptor)
+        }
+        val fields = bridge.findField {
+            searchPackages("org.luckypray.dexkit.demo")
+        }
+        assert(fields.isNotEmpty())
+        fields.forEach { found ->
+            val data = bridge.getFieldData(found.descriptor)!!
+            assert(found.getEncodeId() == data.getEncodeId())
+            assert(found.modifiers == data.modifiers)
+            assert(found.typeName == data.typeName)
+            assert(found.declaredClass.descriptor == data.declaredClass.descriptor)
+        }
+    }
+
+    @Test
+    fun testPackageFilterIgnoreCase() {
+        val all = findClassNames("org.luckypray.dexkit")
+        fun findNames(ignoreCase: Boolean, search: List<String>, exclude: List<String> = emptyList()) = bridge.findClass {
+            searchPackages(search)
+            excludePackages(exclude)
+            ignorePackagesCase(ignoreCase)
+        }.map { it.name }.toSet()
+        fun inPackage(name: String, packageName: String, ignoreCase: Boolean) = name.startsWith("$packageName.", ignoreCase)
+
+        val demo = "org.luckypray.dexkit.demo"
+        val hook = "org.luckypray.dexkit.demo.HOOK"
+        val expected = all.filter { inPackage(it, demo, true) && !inPackage(it, hook, true) }.toSet()
+        assert(expected.isNotEmpty())
+        assert(expected.size < all.count { inPackage(it, demo, false) })
+        assert(findNames(true, listOf("ORG.LuckyPray.DexKit.Demo"), listOf(hook)) == expected)
+        assert(findNames(true, listOf(demo), listOf(hook)) == expected)
+        assert(findNames(false, listOf("ORG.LuckyPray.DexKit.Demo"), listOf(hook)).isEmpty())
+        // case sensitive, the excluded package does not exist
+        assert(findNames(false, listOf(demo), listOf(hook)) == all.filter { inPackage(it, demo, false) }.toSet())
+        // a package only matches whole segments
+        assert(findNames(false, listOf("org.luckypray.dexkit.dem")).isEmpty())
+        assert(findNames(true, listOf("ORG.LUCKYPRAY.DEXKIT.DEM")).isEmpty())
+    }
+
+    @Test
+    fun testSearchInMatchesFilteredResults() {
+        fun String.owner() = substringBefore("->")
+        val allClasses = bridge.findClass { }
+        val demoClasses = allClasses.filter { it.name.startsWith("org.luckypray.dexkit.demo.") }
+        assert(demoClasses.isNotEmpty() && demoClasses.size < allClasses.size)
+        // a few ids and every id of the dex, the two ends of the restriction sets
+        listOf(demoClasses, allClasses).forEach { classes ->
+            val allowed = classes.map { it.descriptor }.toSet()
+            assert(bridge.findClass {
+                searchIn(classes)
+                matcher { className("Activity", StringMatchType.EndsWith) }
+            }.map { it.descriptor }.sorted() == bridge.findClass {
+                matcher { className("Activity", StringMatchType.EndsWith) }
+            }.map { it.descriptor }.filter { it in allowed }.sorted())
+            assert(bridge.findMethod {
+                searchInClass(classes)
+                matcher { name = "onCreate" }
+            }.map { it.descriptor }.sorted() == bridge.findMethod {
+                matcher { name = "onCreate" }
+            }.map { it.descriptor }.filter { it.owner() in allowed }.sorted())
+            assert(bridge.findField {
+                searchInClass(classes)
+                matcher { modifiers(Modifier.STATIC) }
+            }.map { it.descriptor }.sorted() == bridge.findField {
+                matcher { modifiers(Modifier.STATIC) }
+            }.map { it.descriptor }.filter { it.owner() in allowed }.sorted())
+        }
+
+        val demoMethods = bridge.findMethod { searchPackages("org.luckypray.dexkit.demo") }
+        val someMethods = demoMethods.filterIndexed { index, _ -> index % 2 == 0 }
+        val allowedMethods = someMethods.map { it.descriptor }.toSet()
+        assert(bridge.findMethod {
+            searchInMethod(someMethods)
+            matcher { modifiers(Modifier.PUBLIC) }
+        }.map { it.descriptor }.sorted() == demoMethods.filter {
+            it.modifiers and Modifier.PUBLIC != 0 && it.descriptor in allowedMethods
+        }.map { it.descriptor }.sorted())
+
+        val demoFields = bridge.findField { searchPackages("org.luckypray.dexkit.demo") }
+        val someFields = demoFields.filterIndexed { index, _ -> index % 2 == 0 }
+        val allowedFields = someFields.map { it.descriptor }.toSet()
+        assert(bridge.findField {
+            searchInField(someFields)
+            matcher { modifiers(Modifier.STATIC) }
+        }.map { it.descriptor }.sorted() == demoFields.filter {
+            it.modifiers and Modifier.STATIC != 0 && it.descriptor in allowedFields
+        }.map { it.descriptor }.sorted())
+    }
+
+    @Test
+    fun testMultiFindMixesDedicatedAndSharedQueries() {
+        val demoClasses = bridge.findClass { searchPackages("org.luckypray.dexkit.demo") }
+        val activities = demoClasses.filter { it.name.endsWith("Activity") }
+        // the first ones take their own path, the others share one scan
+        val classQueries = listOf(
+            FindClass().searchIn(activities).matcher { usingStrings("onClick") },
+            FindClass().matcher { className("org.luckypray.dexkit.demo.PlayActivity") },
+            FindClass().matcher { superClass("android.os.Handler") },
+            FindClass().searchInSources(listOf(0)).matcher { usingStrings("rollDice") },
+            FindClass().matcher { usingStrings("onClick") },
+            FindClass().searchPackages("org.luckypray.dexkit.demo").matcher {
+                className("Activity", StringMatchType.EndsWith)
+            },
+            FindClass().matcher { usingStrings("NotExistsString-DexKit") }
+        )
+        val classResults = bridge.multiFindClass { queries(classQueries) }
+        assert(classResults.size == classQueries.size)
+        classQueries.forEachIndexed { index, query ->
+            assert(classResults[index].map { it.descriptor } == bridge.findClass(query).map { it.descriptor })
+        }
+        assert(classResults.take(classResults.size - 1).all { it.isNotEmpty() })
+
+        val methodQueries = listOf(
+            FindMethod().searchInClass(activities).matcher { name = "onCreate" },
+            FindMethod().matcher { declaredClass("org.luckypray.dexkit.demo.MainActivity") },
+            FindMethod().matcher { usingNumbers(114514) },
+            FindMethod().searchPackages("org.luckypray.dexkit.demo").matcher { name = "onClick" },
+            FindMethod().matcher { usingStrings("Dice") },
+            FindMethod().matcher { usingStrings("NotExistsString-DexKit") }
+        )
+        val methodResults = bridge.multiFindMethod { queries(methodQueries) }
+        assert(methodResults.size == methodQueries.size)
+        methodQueries.forEachIndexed { index, query ->
+            assert(methodResults[index].map { it.descriptor } == bridge.findMethod(query).map { it.descriptor })
+        }
+        assert(methodResults.take(methodResults.size - 1).all { it.isNotEmpty() })
+
+        // a find-first query returns one of the full results
+        val firstResults = bridge.multiFindMethod {
+            queries(listOf(
+                FindMethod().apply { findFirst = true }.matcher { usingStrings("Dice") },
+                FindMethod().matcher { usingStrings("Dice") }
+            ))
+        }
+        assert(firstResults[0].size == 1)
+        assert(firstResults[0].single().descriptor in firstResults[1].map { it.descriptor })
+    }
+
+    @Test
+    fun testCompiledMatchersKeepQueryVariantsApart() {
+        fun findMethods(value: String, matchType: StringMatchType, ignoreCase: Boolean) = bridge.findMethod {
+            searchPackages("org.luckypray.dexkit.demo")
+            matcher { addUsingString(value, matchType, ignoreCase) }
+        }.map { it.descriptor }.toSet()
+        fun findClasses(usingStrings: List<String>, ignoreCase: Boolean) = bridge.findClass {
+            searchPackages("org.luckypray.dexkit.demo")
+            matcher { usingStrings(usingStrings, StringMatchType.Contains, ignoreCase) }
+        }.map { it.descriptor }.toSet()
+
+        val rollDice = findMethods("rollDice", StringMatchType.Contains, false)
+        assert(rollDice.isNotEmpty())
+        val onClick = findClasses(listOf("onClick"), false)
+        assert(onClick.size == 2)
+        // the same strings with another case or match type must not reuse a compiled matcher
+        repeat(2) {
+            assert(findMethods("ROLLDICE", StringMatchType.Contains, false).isEmpty())
+            assert(findMethods("ROLLDICE", StringMatchType.Contains, true) == rollDice)
+            assert(findMethods("rollDice", StringMatchType.Equals, false).isEmpty())
+            assert(findMethods("rollDice: ", StringMatchType.Equals, false) == rollDice)
+            assert(findMethods("rollDice", StringMatchType.StartsWith, false) == rollDice)
+            assert(findClasses(listOf("ONCLICK"), false).isEmpty())
+            assert(findClasses(listOf("ONCLICK"), true) == onClick)
+            assert(findClasses(listOf("onClick", "rollDice"), false).size == 1)
+        }
+    }
+
+    @Test
+    fun testUsingStringsKeywordScanMatchesOracle() {
+        val demoMethods = bridge.findMethod { searchPackages("org.luckypray.dexkit.demo") }
+        val methodStrings = demoMethods.associate { it.descriptor to it.usingStrings }
+        val keywordSets = listOf(
+            listOf("onClick"),
+            listOf("onClick", "Button"),
+            listOf("Dice", "rollDice"),
+            listOf("Dice", "getRandom", "Dice: "),
+            listOf("o", "n", "c"),
+            listOf("Dice", "NotExistsString-DexKit"),
+            listOf("NotExistsString-DexKit")
+        )
+        listOf(false, true).forEach { ignoreCase ->
+            keywordSets.forEach { keywords ->
+                val values = if (ignoreCase) keywords.map { it.uppercase() } else keywords
+                val expected = methodStrings.filterValues { strings ->
+                    values.all { value -> strings.any { it.contains(value, ignoreCase) } }
+                }.keys
+                val found = bridge.findMethod {
+                    searchPackages("org.luckypray.dexkit.demo")
+                    matcher { usingStrings(values, StringMatchType.Contains, ignoreCase) }
+                }.map { it.descriptor }.toSet()
+                assert(found == expected)
+            }
+        }
+        assert(methodStrings.filterValues { strings -> strings.any { it.contains("Dice") } }.size >= 2)
+    }
+
+    @Test
+    fun testAdaptiveSlicesKeepResults() {
+        // a cheap matcher over every item and a nested one that costs more per item
+        fun findAll(target: DexKitBridge) = listOf(
+            target.findClass {
+                matcher { className("Activity", StringMatchType.EndsWith) }
+            }.map { it.descriptor },
+            target.findMethod {
+                matcher { paramCount = 0 }
+            }.map { it.descriptor },
+            target.findMethod {
+                matcher {
+                    declaredClass { superClass("Activity", StringMatchType.EndsWith) }
+                    addInvoke { name = "findViewById" }
+                }
+            }.map { it.descriptor },
+            target.findField {
+                matcher { modifiers(Modifier.STATIC) }
+            }.map { it.descriptor }
+        ).map { it.sorted() }
+
+        DexKitBridge.create(demoApkPath).use { sliceBridge ->
+            sliceBridge.setThreadNum(1)
+            val expected = findAll(sliceBridge)
+            assert(expected.all { it.isNotEmpty() })
+            // the slice sizes learned by the first runs must not change the results
+            listOf(8, 8, 1).forEach { threadNum ->
+                sliceBridge.setThreadNum(threadNum)
+                assert(findAll(sliceBridge) == expected)
+            }
+            sliceBridge.setThreadNum(8)
+            val first = sliceBridge.findMethod {
+                findFirst = true
+                matcher { paramCount = 0 }
+            }
+            assert(first.size == 1)
+            assert(first.single().descriptor in expected[1])
+        }
+    }
 
     @Test
     fun testConcurrentBatchFindClassUsingStringsOnSharedBridge() {